@@ -8,6 +8,7 @@
 #include <Graphics/Uniforms.hpp>
 #include <Resource/GraphicsProgramCompiler.hpp>
 #include <ImGui/ImGui.hpp>
+#include <ImGui/MemoryPanel.hpp>
 
 #include <limits>
 
@@ -363,6 +364,10 @@ public:
                 }
 
                 ImGui::End();
+
+                #ifdef MORPH_PROFILE
+                    ImGuiMemoryPanel::Draw();
+                #endif
             }
             defaultFramebuffer.SwapBuffers();
             m_windowManager->PollEvents();
@@ -0,0 +1,60 @@
+#include "AliasTable.hpp"
+
+namespace Morph {
+
+void AliasTable::build(const std::vector<double> &weights)
+{
+    u32 n = (u32)weights.size();
+    cells.resize(n);
+    probability.assign(n, 0);
+    double total = buildCells(weights.data(), n, cells.data());
+    if (total <= 0)
+        return;
+    for (u32 i = 0; i < n; ++i)
+        probability[i] = weights[i] / total;
+}
+
+void AliasTable::clear()
+{
+    cells.clear();
+    probability.clear();
+}
+
+double AliasTable::buildCells(const double *weights, u32 n, AliasCell *cells)
+{
+    double total = 0;
+    for (u32 i = 0; i < n; ++i)
+    {
+        total += weights[i];
+        cells[i] = {1, i};
+    }
+    if (n == 0 || total <= 0)
+        return total;
+
+    // cells scaled so the average is 1, the underfull ones are topped up from the overfull ones
+    std::vector<double> scaled(n);
+    std::vector<u32> small, large;
+    double scale = n / total;
+    for (u32 i = 0; i < n; ++i)
+    {
+        scaled[i] = weights[i] * scale;
+        (scaled[i] < 1 ? small : large).push_back(i);
+    }
+    while (!small.empty() && !large.empty())
+    {
+        u32 s = small.back();
+        small.pop_back();
+        u32 l = large.back();
+        cells[s] = {(float)scaled[s], l};
+        scaled[l] -= 1 - scaled[s];
+        if (scaled[l] < 1)
+        {
+            large.pop_back();
+            small.push_back(l);
+        }
+    }
+    // what is left is 1 up to rounding errors and keeps the initial {1, i}
+    return total;
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,61 @@
+#ifndef RSO_ALIAS_TABLE_HPP
+#define RSO_ALIAS_TABLE_HPP
+
+#include "Precision.hpp"
+
+#include <vector>
+
+namespace Morph {
+
+// Cell of an alias table, keeps its own index with the probability keep and gives the rest to alias
+struct AliasCell
+{
+  float keep;
+  u32 alias;
+};
+
+// Discrete distribution sampled in constant time (Walker's alias method, built by Vose's algorithm)
+class AliasTable
+{
+  std::vector<AliasCell> cells;
+  // normalized weights
+  std::vector<double> probability;
+
+public:
+  // weights do not have to be normalized, zero weights are never sampled
+  void build(const std::vector<double> &weights);
+  void clear();
+
+  u32 sample(double u) const { return sampleCells(cells.data(), size(), u); }
+
+  double pdf(u32 index) const { return probability[index]; }
+  u32 size() const { return (u32)cells.size(); }
+  bool empty() const { return cells.empty(); }
+
+  // Fill n cells for the weights, for tables stored in larger arrays. Returns the sum of the weights.
+  static double buildCells(const double *weights, u32 n, AliasCell *cells);
+
+  // Index drawn with probability proportional to its weight from one uniform number in [0, 1).
+  // The fraction of u within the cell decides between the cell and its alias, and what is left
+  // of it is returned as a new uniform number in remainder.
+  static u32 sampleCells(const AliasCell *cells, u32 n, double u, double *remainder = nullptr)
+  {
+    double scaled = u * n;
+    u32 cell = std::min((u32)scaled, n - 1);
+    double fraction = scaled - cell;
+    double keep = cells[cell].keep;
+    if (fraction < keep)
+    {
+      if (remainder)
+        *remainder = fraction / keep;
+      return cell;
+    }
+    if (remainder)
+      *remainder = std::min((fraction - keep) / (1 - keep), 1 - 0x1p-53);
+    return cells[cell].alias;
+  }
+};
+
+}
+
+#endif // RSO_ALIAS_TABLE_HPP
\ No newline at end of file
@@ -2,6 +2,9 @@
 
 namespace Morph {
 
+// render time of an iteration, a new frame for every 60 Hz vsync and key presses are applied within a frame
+static const double frameBudget = 0.016;
+
 Application::Application(const WindowAppConfig& config)
     : WindowApp(config),
     m_windowManagerErrorAttacher(&windowManager(), this, &Application::OnWindowManagerError),
@@ -9,6 +12,7 @@ Application::Application(const WindowAppConfig& config)
     m_keyEventAttacher(&windowManager(), this, &Application::OnKeyEvent),
     m_scrollEventAttacher(&windowManager(), this, &Application::OnScrollEvent),
     m_scene(m_jobManager),
+    m_renderThread(m_scene),
     m_graphicsSettings({
         MultisampleEnabledSetting(true),
         DepthTestEnabledSetting(true),
@@ -32,16 +36,19 @@ Application::Application(const WindowAppConfig& config)
 {
     uvec2 winSize = window().GetSize();
     Globals::resize_image(winSize);
-    Globals::init();
     m_scene.build();
     Globals::method = LIGHT_SOURCE;
+    Globals::frameBudget = frameBudget;
+    m_renderThread.start();
     Usage();
 }
 
 void Application::RunFrame(f64 lastIterTime, f64 lastFrameTime)
 {
-    m_scene.renderIteration();
-    m_screenTexture.Update(Globals::ldrImage.data());
+    // the previous frame stays on screen until the render thread finishes a new one
+    if(m_renderThread.newFrame()) {
+        m_screenTexture.Update(m_renderThread.frame().data());
+    }
     FramebufferBinder framebufferBinder = context().BindFramebuffer(context().GetDefaultFramebuffer());
     framebufferBinder.Clear();
     context().SetViewport(context().GetDefaultFramebuffer().dim());
@@ -58,12 +65,12 @@ void Application::OnWindowManagerError(const WindowManagerError& error)
 
 void Application::OnWindowSizeEvent(const WindowSizeEvent& event)
 {
-    spdlog::trace("window resize {}", event.size);
+    MORPH_APP_LOG_TRACE("window resize {}", event.size);
 }
 
 void Application::OnKeyEvent(const KeyEvent& event)
 {
-    spdlog::trace("key {} {}", enum_name(event.key), enum_name(event.action));
+    MORPH_APP_LOG_TRACE("key {} {}", enum_name(event.key), enum_name(event.action));
     if(event.action == KeyAction::PRESS) {
         if(event.key == Key::O) {
             spdlog::set_level(spdlog::level::trace);
@@ -71,94 +78,121 @@ void Application::OnKeyEvent(const KeyEvent& event)
         if(event.key == Key::P) {
             spdlog::set_level(spdlog::level::info);
         }
-        switch (event.key)
+        // the render thread reads the globals during an iteration, they change between two iterations
+        Key key = event.key;
+        m_renderThread.submit([key]() { ApplyKey(key); });
+    }
+}
+
+void Application::ApplyKey(Key key)
+{
+    switch (key)
+    {
+    case Key::L:
+        Globals::method = LIGHT_SOURCE;
+        Globals::weight = methodWeight(Globals::method);
+        printf("Light source sampling\n");
+        //m_scene.render();
+        Globals::clear();
+        break;
+    case Key::B:
+        Globals::method = BRDF;
+        Globals::weight = methodWeight(Globals::method);
+        printf("BRDF sampling\n");
+        //m_scene.render();
+        Globals::clear();
+        break;
+    case Key::H:
+        Globals::method = HALF_WEIGHT;
+        Globals::weight = methodWeight(Globals::method);
+        printf("half weight sampling\n");
+        //m_scene.render();
+        Globals::clear();
+        break;
+    case Key::M:
+        Globals::method = MULTIPLE_IMPORTANCE;
+        Globals::weight = methodWeight(Globals::method);
+        printf("Multiple importance sampling\n");
+        //m_scene.render();
+        Globals::clear();
+        break;
+    case Key::P:
+        Globals::method = PATH_TRACING;
+        Globals::weight = methodWeight(Globals::method);
+        printf("Path tracing\n");
+        //m_scene.render();
+        Globals::clear();
+        break;
+    case Key::K:
+        Globals::usePacketTracing = !Globals::usePacketTracing;
+        printf("Packet tracing of primary rays %s\n", Globals::usePacketTracing ? "on" : "off");
+        break;
+    case Key::A:
+        Globals::useAdaptiveSampling = !Globals::useAdaptiveSampling;
+        printf("Adaptive sampling %s\n", Globals::useAdaptiveSampling ? "on" : "off");
+        Globals::clear();
+        break;
+    case Key::F:
+        Globals::frameBudget = Globals::frameBudget > 0 ? 0 : frameBudget;
+        if (Globals::frameBudget == 0)
+            Globals::samplesPerFrame = 1;
+        printf("Frame time budget %s\n", Globals::frameBudget > 0 ? "on" : "off");
+        break;
+    case Key::S:
+        Globals::sampler = (SamplerType)((Globals::sampler + 1) % (BLUE_NOISE + 1));
+        printf("%s sampler\n", samplerName(Globals::sampler));
+        Globals::clear();
+        break;
+    case Key::W:
+    {
+        printf("Writing reference file\n");
+        FILE *refImage = fopen("image.bin", "wb");
+        if (refImage)
         {
-        case Key::L:
-            Globals::method = LIGHT_SOURCE;
-            Globals::weight = 1;
-            printf("Light source sampling\n");
-            //m_scene.render();
-            Globals::clear();
+        fwrite(Globals::hdrImage.data(), sizeof(vec3), Globals::screenSize.x * Globals::screenSize.y, refImage);
+        fclose(refImage);
+        }
+    }
+    case Key::O:
+    {
+        printf("Writing output HDR file (extension .hdr)\n");
+        FILE *fp;
+        const char* hdrFilename = "test.hdr";
+        const char* tgaFilename = "test.tga";
+        switch (Globals::method)
+        {
+            case LIGHT_SOURCE:
+            hdrFilename = "lightsource.hdr";
+            tgaFilename = "lightsource.tga";
             break;
-        case Key::B:
-            Globals::method = BRDF;
-            Globals::weight = 0;
-            printf("BRDF sampling\n");
-            //m_scene.render();
-            Globals::clear();
+            case BRDF:
+            hdrFilename = "brdf.hdr";
+            tgaFilename = "brdf.tga";
             break;
-        case Key::H:
-            Globals::method = HALF_WEIGHT;
-            Globals::weight = 0.5;
-            printf("half weight sampling\n");
-            //m_scene.render();
-            Globals::clear();
+            case HALF_WEIGHT:
+            hdrFilename = "half_weight.hdr";
+            tgaFilename = "half_weight.tga";
             break;
-        case Key::M:
-            Globals::method = MULTIPLE_IMPORTANCE;
-            Globals::weight = 0.5;
-            printf("Multiple importance sampling\n");
-            //m_scene.render();
-            Globals::clear();
+            case MULTIPLE_IMPORTANCE:
+            hdrFilename = "multiple_importance.hdr";
+            tgaFilename = "multiple_importance.tga";
             break;
-        case Key::P:
-            Globals::method = PATH_TRACING;
-            Globals::weight = 1;
-            printf("Path tracing\n");
-            //m_scene.render();
-            Globals::clear();
+            case PATH_TRACING:
+            hdrFilename = "path_tracing.hdr";
+            tgaFilename = "path_tracing.tga";
             break;
-        case Key::W:
-        {
-            printf("Writing reference file\n");
-            FILE *refImage = fopen("image.bin", "wb");
-            if (refImage)
-            {
-            fwrite(Globals::hdrImage.data(), sizeof(vec3), Globals::screenSize.x * Globals::screenSize.y, refImage);
-            fclose(refImage);
-            }
         }
-        case Key::O:
-        {
-            printf("Writing output HDR file (extension .hdr)\n");
-            FILE *fp;
-            const char* hdrFilename = "test.hdr";
-            const char* tgaFilename = "test.tga";
-            switch (Globals::method)
-            {
-                case LIGHT_SOURCE:
-                hdrFilename = "lightsource.hdr";
-                tgaFilename = "lightsource.tga";
-                break;
-                case BRDF:
-                hdrFilename = "brdf.hdr";
-                tgaFilename = "brdf.tga";
-                break;
-                case HALF_WEIGHT:
-                hdrFilename = "half_weight.hdr";
-                tgaFilename = "half_weight.tga";
-                break;
-                case MULTIPLE_IMPORTANCE:
-                hdrFilename = "multiple_importance.hdr";
-                tgaFilename = "multiple_importance.tga";
-                break;
-                case PATH_TRACING:
-                hdrFilename = "path_tracing.hdr";
-                tgaFilename = "path_tracing.tga";
-                break;
-            }
 
-            SaveHDR(hdrFilename, Globals::hdrImage);
-            SaveTGA(tgaFilename, Globals::ldrImage);
-            break;
-        }
-        } // switch (key)
+        SaveHDR(hdrFilename, Globals::hdrImage);
+        SaveTGA(tgaFilename, Globals::ldrImage);
+        break;
     }
+    } // switch (key)
 }
 
 void Application::OnScrollEvent(const ScrollEvent& event)
 {
-    spdlog::trace("scroll {}", event.offset);
+    MORPH_APP_LOG_TRACE("scroll {}", event.offset);
 }
 
 void Application::Usage()
@@ -168,6 +202,10 @@ void Application::Usage()
     printf(" 'l': light source sampling \n");
     printf(" 'm': multiple importance sampling \n");
     printf(" 'p': path tracing \n");
+    printf(" 'k': toggle packet tracing of primary rays \n");
+    printf(" 'a': toggle adaptive sampling \n");
+    printf(" 'f': toggle the frame time budget, off renders every scheduled sample per frame \n");
+    printf(" 's': cycle the samplers (independent, sobol, halton, blue noise) \n");
     printf(" 't': testing \n");
     printf(" 'g': generate multiple images \n");
     printf(" 'r': Show reference\n");
@@ -7,12 +7,14 @@
 
 #include <Morph.hpp>
 #include <Core/JobManager.hpp>
+#include <Core/Log.hpp>
 #include <App/WindowApp.hpp>
 #include <Graphics/Context.hpp>
 #include <Graphics/Uniforms.hpp>
 #include <Resource/GraphicsProgramCompiler.hpp>
 #include <Resource/Common.hpp>
 
+#include "RenderThread.hpp"
 #include "Scene.hpp"
 
 namespace Morph {
@@ -28,6 +30,8 @@ private:
 
     JobManager m_jobManager;
     Scene m_scene;
+    // declared after the scene, stops rendering before the scene is destroyed
+    RenderThread m_renderThread;
 
     GraphicsSettings m_graphicsSettings;
     GraphicsSettingsApplier m_graphicsSettingsApplier;
@@ -47,6 +51,8 @@ private:
     void OnWindowSizeEvent(const WindowSizeEvent& event);
     void OnKeyEvent(const KeyEvent& event);
     void OnScrollEvent(const ScrollEvent& event);
+    // settings of the keys, runs on the render thread
+    static void ApplyKey(Key key);
 
     void Usage();
 };
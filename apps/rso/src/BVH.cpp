@@ -0,0 +1,250 @@
+#include "BVH.hpp"
+
+#include <algorithm>
+
+namespace Morph {
+
+// relative cost of one node traversal compared to one primitive test
+static const double traversalCost = 0.5;
+
+std::vector<u32> BVHTree::build(const std::vector<AABB> &boxes)
+{
+    nodes.clear();
+    std::vector<BuildItem> items;
+    items.reserve(boxes.size());
+    for (u32 i = 0; i < (u32)boxes.size(); ++i)
+        items.push_back({boxes[i], boxes[i].center(), i});
+
+    std::vector<u32> order;
+    if (items.empty())
+        return order;
+
+    nodes.reserve(2 * items.size());
+    nodes.emplace_back();
+    buildRecursive(0, items, 0, (u32)items.size(), 0);
+    nodes.shrink_to_fit();
+
+    // leaves reference continuous ranges of items in their final order
+    order.reserve(items.size());
+    for (const BuildItem &item : items)
+        order.push_back(item.index);
+    return order;
+}
+
+void BVHTree::buildRecursive(u32 nodeIndex, std::vector<BuildItem> &items, u32 from, u32 to, int depth)
+{
+    AABB box, centroidBox;
+    for (u32 i = from; i < to; ++i)
+    {
+        box.extend(items[i].box);
+        centroidBox.extend(items[i].centroid);
+    }
+    nodes[nodeIndex].box = box;
+    nodes[nodeIndex].offset = from;
+
+    u32 count = to - from;
+    if (count <= maxLeafSize || (depth >= maxDepth - 1 && count <= std::numeric_limits<u16>::max()))
+    {
+        nodes[nodeIndex].count = (u16)count;
+        return;
+    }
+    // close to maxDepth the count is halved when the levels left could not bring it within the u16 of a leaf otherwise
+    int levelsLeft = maxDepth - 1 - depth;
+    bool halve = levelsLeft <= 32 && count > ((u64)std::numeric_limits<u16>::max() << (levelsLeft - 1));
+
+    // split along the axis with the largest centroid spread
+    rvec3 extent = centroidBox.extent();
+    int axis = 0;
+    if (extent.y > extent[axis])
+        axis = 1;
+    if (extent.z > extent[axis])
+        axis = 2;
+
+    u32 mid = from;
+    if (extent[axis] <= 0)
+    {
+        // all centroids coincide, only splitting by count keeps leaves small
+        if (count <= std::numeric_limits<u16>::max())
+        {
+            nodes[nodeIndex].count = (u16)count;
+            return;
+        }
+    }
+    else if (!halve)
+    {
+        struct Bin
+        {
+            AABB box;
+            u32 count = 0;
+        } bins[binCount];
+
+        real binScale = binCount / extent[axis];
+        auto binIndex = [&](const BuildItem &item) {
+            int b = (int)((item.centroid[axis] - centroidBox.pMin[axis]) * binScale);
+            return std::min(b, binCount - 1);
+        };
+        for (u32 i = from; i < to; ++i)
+        {
+            Bin &bin = bins[binIndex(items[i])];
+            bin.box.extend(items[i].box);
+            bin.count++;
+        }
+
+        // sweep from the right to get the cost of all the binCount - 1 split planes
+        double rightArea[binCount];
+        u32 rightCount[binCount];
+        AABB rightBox;
+        u32 rightSum = 0;
+        for (int b = binCount - 1; b > 0; --b)
+        {
+            rightBox.extend(bins[b].box);
+            rightSum += bins[b].count;
+            rightArea[b] = rightSum > 0 ? rightBox.surfaceArea() : 0;
+            rightCount[b] = rightSum;
+        }
+
+        int bestSplit = -1;
+        double bestCost = std::numeric_limits<double>::infinity();
+        AABB leftBox;
+        u32 leftSum = 0;
+        for (int b = 1; b < binCount; ++b)
+        {
+            leftBox.extend(bins[b - 1].box);
+            leftSum += bins[b - 1].count;
+            if (leftSum == 0 || rightCount[b] == 0)
+                continue;
+            double cost = leftSum * leftBox.surfaceArea() + rightCount[b] * rightArea[b];
+            if (cost < bestCost)
+            {
+                bestCost = cost;
+                bestSplit = b;
+            }
+        }
+
+        double leafCost = count;
+        double splitCost = traversalCost + bestCost / box.surfaceArea();
+        if ((bestSplit < 0 || splitCost >= leafCost) && count <= std::numeric_limits<u16>::max())
+        {
+            nodes[nodeIndex].count = (u16)count;
+            return;
+        }
+
+        if (bestSplit > 0)
+        {
+            BuildItem *first = items.data() + from;
+            BuildItem *last = items.data() + to;
+            mid = from + (u32)(std::partition(first, last, [&](const BuildItem &item) { return binIndex(item) < bestSplit; }) - first);
+        }
+    }
+
+    if (mid == from || mid == to)
+    {
+        mid = from + count / 2;
+        std::nth_element(items.begin() + from, items.begin() + mid, items.begin() + to,
+            [axis](const BuildItem &a, const BuildItem &b) { return a.centroid[axis] < b.centroid[axis]; });
+    }
+
+    nodes[nodeIndex].axis = (u8)axis;
+    u32 leftIndex = (u32)nodes.size();
+    nodes.emplace_back();
+    buildRecursive(leftIndex, items, from, mid, depth + 1);
+    u32 rightIndex = (u32)nodes.size();
+    nodes.emplace_back();
+    nodes[nodeIndex].offset = rightIndex;
+    buildRecursive(rightIndex, items, mid, to, depth + 1);
+}
+
+void BVH::clear()
+{
+    tree.clear();
+    primitives.clear();
+    unbounded.clear();
+}
+
+void BVH::build(const std::vector<Intersectable *> &objects)
+{
+    clear();
+    std::vector<AABB> boxes;
+    std::vector<Intersectable *> bounded;
+    for (Intersectable *obj : objects)
+    {
+        AABB box = obj->bounds();
+        if (!box.isFinite())
+        {
+            unbounded.push_back(obj);
+            continue;
+        }
+        boxes.push_back(box);
+        bounded.push_back(obj);
+    }
+
+    std::vector<u32> order = tree.build(boxes);
+    primitives.reserve(order.size());
+    for (u32 i : order)
+        primitives.push_back(bounded[i]);
+}
+
+Hit BVH::intersect(const Ray &ray, Intersectable *skip) const
+{
+    // objects like meshes can be hit again by rays leaving their surface
+    if (skip && skip->canOccludeItself())
+        skip = nullptr;
+
+    Hit bestHit;
+    for (Intersectable *obj : unbounded)
+    {
+        if (obj == skip)
+            continue;
+        Hit hit = obj->intersect(ray);
+        if (hit.t > Globals::epsilon && (bestHit.t < 0 || hit.t < bestHit.t))
+            bestHit = hit;
+    }
+
+    // nodes further than the closest hit so far are skipped
+    real tMax = bestHit.t < 0 ? std::numeric_limits<real>::infinity() : bestHit.t;
+    tree.traverse(ray, tMax, [&](u32 first, u32 count, real &tMax) {
+        for (u32 i = first; i < first + count; ++i)
+        {
+            Intersectable *obj = primitives[i];
+            if (obj == skip)
+                continue;
+            Hit hit = obj->intersect(ray);
+            if (hit.t > Globals::epsilon && (bestHit.t < 0 || hit.t < bestHit.t))
+            {
+                bestHit = hit;
+                tMax = hit.t;
+            }
+        }
+    });
+    return bestHit;
+}
+
+void BVH::intersectPacket(const RayPacket4 &packet, PacketHit4 &hit) const
+{
+    for (Intersectable *obj : unbounded)
+        obj->intersectPacket(packet, packet.active, hit);
+
+    tree.traversePacket(packet, hit, [&](u32 first, u32 count, const mask4 &active) {
+        for (u32 i = first; i < first + count; ++i)
+            primitives[i]->intersectPacket(packet, active, hit);
+    });
+}
+
+void BVH::intersectPacket(const RayPacket4 &packet, Hit *hits) const
+{
+    PacketHit4 packetHit;
+    intersectPacket(packet, packetHit);
+
+    // the packet only finds the closest objects, their hit details come from the single ray test
+    for (int i = 0; i < RayPacket4::size; ++i)
+    {
+        if (!(packet.activeBits & (1 << i)))
+            continue;
+        hits[i] = packetHit.object[i] ? packetHit.object[i]->intersect(packet.rays[i]) : Hit();
+        // rounding of the packet test can differ in grazing cases
+        if (packetHit.object[i] && !(hits[i].t > Globals::epsilon))
+            hits[i] = intersect(packet.rays[i], nullptr);
+    }
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,197 @@
+#ifndef RSO_BVH_HPP
+#define RSO_BVH_HPP
+
+#include "RayPacket.hpp"
+
+namespace Morph {
+
+// Node of the flattened hierarchy, one node fills one cache line in double precision
+// and half of it in float. The first child of an interior node directly follows its parent.
+struct alignas(8 * sizeof(real)) BVHNode
+{
+  AABB box;
+  // leaf: index of the first primitive, interior: index of the second child
+  u32 offset = 0;
+  // number of primitives, 0 for interior nodes
+  u16 count = 0;
+  // split axis, used to visit the nearer child first
+  u8 axis = 0;
+};
+
+static_assert(sizeof(BVHNode) == 8 * sizeof(real), "BVHNode should fill exactly 8 scalars");
+
+// slab test of the ray against the box limited to the (0, tMax) interval
+template<typename T>
+inline bool intersectBox(const AABBT<T> &box, const tvec3<T> &origin, const tvec3<T> &invDir, T tMax)
+{
+  T t0 = 0;
+  T t1 = tMax;
+  for (int a = 0; a < 3; ++a)
+  {
+    T tNear = (box.pMin[a] - origin[a]) * invDir[a];
+    T tFar = (box.pMax[a] - origin[a]) * invDir[a];
+    if (tNear > tFar)
+      std::swap(tNear, tFar);
+    // keeps hits on the box boundary despite the rounding of the slab distances
+    tFar *= 1 + 4 * std::numeric_limits<T>::epsilon();
+    t0 = tNear > t0 ? tNear : t0;
+    t1 = tFar < t1 ? tFar : t1;
+    if (t0 > t1)
+      return false;
+  }
+  return true;
+}
+
+// Hierarchy over primitive bounds built with binned surface area heuristic.
+// Leaves reference ranges of the primitive order returned by build.
+class BVHTree
+{
+  std::vector<BVHNode> nodes;
+
+public:
+  static const int binCount = 12;
+  static const int maxLeafSize = 4;
+  static const int maxDepth = 64;
+
+  // returns the primitive indices in leaf order, callers store their primitives in this order
+  std::vector<u32> build(const std::vector<AABB> &boxes);
+  void clear() { nodes.clear(); }
+
+  size_t nodeCount() const { return nodes.size(); }
+  bool empty() const { return nodes.empty(); }
+  const AABB &bounds() const { return nodes[0].box; }
+
+  // Calls intersectLeaf(first, count, tMax) for leaves hit before tMax in front to back order,
+  // the callback shortens tMax when it finds a closer hit so further nodes are skipped
+  template<typename F>
+  void traverse(const Ray &ray, real &tMax, F &&intersectLeaf) const
+  {
+    if (nodes.empty())
+      return;
+    rvec3 invDir = rvec3(1) / ray.dir;
+    bool dirIsNeg[3] = {invDir.x < 0, invDir.y < 0, invDir.z < 0};
+
+    u32 stack[maxDepth];
+    int stackSize = 0;
+    u32 nodeIndex = 0;
+    while (true)
+    {
+      const BVHNode &node = nodes[nodeIndex];
+      if (intersectBox(node.box, ray.start, invDir, tMax))
+      {
+        if (node.count > 0)
+        {
+          intersectLeaf(node.offset, (u32)node.count, tMax);
+        }
+        else
+        {
+          // visit the child on the near side of the split first
+          if (dirIsNeg[node.axis])
+          {
+            stack[stackSize++] = nodeIndex + 1;
+            nodeIndex = node.offset;
+          }
+          else
+          {
+            stack[stackSize++] = node.offset;
+            nodeIndex = nodeIndex + 1;
+          }
+          continue;
+        }
+      }
+      if (stackSize == 0)
+        break;
+      nodeIndex = stack[--stackSize];
+    }
+  }
+
+  // Packet version of traverse, calls intersectLeaf(first, count, active) with the lanes
+  // which hit the leaf before their hit.t, children are ordered by the first active lane
+  template<typename F>
+  void traversePacket(const RayPacket4 &packet, const PacketHit4 &hit, F &&intersectLeaf) const
+  {
+    if (nodes.empty() || !packet.activeBits)
+      return;
+    double dir[3][RayPacket4::size];
+    store(dir[0], packet.dx);
+    store(dir[1], packet.dy);
+    store(dir[2], packet.dz);
+    int lane = 0;
+    while (!(packet.activeBits & (1 << lane)))
+      lane++;
+    bool dirIsNeg[3] = {dir[0][lane] < 0, dir[1][lane] < 0, dir[2][lane] < 0};
+
+    u32 stack[maxDepth];
+    int stackSize = 0;
+    u32 nodeIndex = 0;
+    while (true)
+    {
+      const BVHNode &node = nodes[nodeIndex];
+      mask4 active = packet.active & intersectBox(node.box, packet, hit.t);
+      if (movemask(active))
+      {
+        if (node.count > 0)
+        {
+          intersectLeaf(node.offset, (u32)node.count, active);
+        }
+        else
+        {
+          if (dirIsNeg[node.axis])
+          {
+            stack[stackSize++] = nodeIndex + 1;
+            nodeIndex = node.offset;
+          }
+          else
+          {
+            stack[stackSize++] = node.offset;
+            nodeIndex = nodeIndex + 1;
+          }
+          continue;
+        }
+      }
+      if (stackSize == 0)
+        break;
+      nodeIndex = stack[--stackSize];
+    }
+  }
+
+private:
+  struct BuildItem
+  {
+    AABB box;
+    rvec3 centroid;
+    u32 index;
+  };
+
+  void buildRecursive(u32 nodeIndex, std::vector<BuildItem> &items, u32 from, u32 to, int depth);
+};
+
+// Bounding volume hierarchy over the scene objects
+class BVH
+{
+  BVHTree tree;
+  // bounded objects in leaf order
+  std::vector<Intersectable *> primitives;
+  // objects with infinite bounds, tested for every ray
+  std::vector<Intersectable *> unbounded;
+
+public:
+  void build(const std::vector<Intersectable *> &objects);
+  void clear();
+
+  // Nearest hit further than epsilon ignoring the skip object, same result as testing every object
+  Hit intersect(const Ray &ray, Intersectable *skip) const;
+
+  // Closest hits of the packet rays, writes one hit per active lane, gives the same hits as intersect
+  void intersectPacket(const RayPacket4 &packet, Hit *hits) const;
+
+  // Only updates the distances and objects of the closest hits of the active lanes
+  void intersectPacket(const RayPacket4 &packet, PacketHit4 &hit) const;
+
+  size_t nodeCount() const { return tree.nodeCount(); }
+  size_t primitiveCount() const { return primitives.size() + unbounded.size(); }
+};
+
+}
+
+#endif // RSO_BVH_HPP
\ No newline at end of file
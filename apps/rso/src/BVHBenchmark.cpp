@@ -0,0 +1,316 @@
+#include "BVHBenchmark.hpp"
+
+#include "PrimitiveStore.hpp"
+#include "TriangleMesh.hpp"
+
+#include <Resource/Generated.hpp>
+
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <random>
+
+namespace Morph {
+
+using BenchmarkClock = std::chrono::steady_clock;
+
+static double secondsSince(BenchmarkClock::time_point begin)
+{
+    return std::chrono::duration<double>(BenchmarkClock::now() - begin).count();
+}
+
+// what Scene::firstIntersect did before the BVH
+static Hit intersectLinear(const std::vector<Intersectable *> &objects, const Ray &ray)
+{
+    Hit bestHit;
+    for (Intersectable *obj : objects)
+    {
+        Hit hit = obj->intersect(ray);
+        if (hit.t > Globals::epsilon && (bestHit.t < 0 || hit.t < bestHit.t))
+            bestHit = hit;
+    }
+    return bestHit;
+}
+
+// misses agree on their own, hits need the same object at the same distance up to the rounding of the kernels
+static bool sameHit(const Hit &expected, const Hit &actual)
+{
+    if (expected.t < 0 || actual.t < 0)
+        return expected.t < 0 && actual.t < 0;
+    return expected.object == actual.object && fabs(expected.t - actual.t) <= 1000 * std::numeric_limits<real>::epsilon() * expected.t;
+}
+
+// stores a result of the timed casts where the compiler has to assume it is read, so they are not dropped
+static void doNotOptimize(double value)
+{
+    static volatile double sink;
+    sink = value;
+}
+
+// runs the batch repeatedly for at least minSeconds, the batch returns how many rays it cast, returns rays per second
+template<typename F>
+static double measureRaysPerSecond(double minSeconds, F batch)
+{
+    size_t traced = 0;
+    BenchmarkClock::time_point begin = BenchmarkClock::now();
+    double elapsed = 0;
+    do
+    {
+        traced += batch();
+        elapsed = secondsSince(begin);
+    } while (elapsed < minSeconds);
+    return traced / elapsed;
+}
+
+// casts the first rayCount rays one by one
+template<typename F>
+static double measureRaysPerSecond(const std::vector<Ray> &rays, size_t rayCount, double minSeconds, F cast)
+{
+    return measureRaysPerSecond(minSeconds, [&]() {
+        double hits = 0;
+        for (size_t i = 0; i < rayCount; ++i)
+            hits += cast(rays[i]).t;
+        doNotOptimize(hits);
+        return rayCount;
+    });
+}
+
+static rvec3 randomDirection(std::mt19937 &rng)
+{
+    std::uniform_real_distribution<double> direction(-1, 1);
+    while (true)
+    {
+        dvec3 dir(direction(rng), direction(rng), direction(rng));
+        double len2 = dot(dir, dir);
+        if (len2 <= 1 && len2 > 1e-6)
+            return rvec3(dir);
+    }
+}
+
+// brute force test of all the triangles of the mesh
+static real intersectTrianglesLinear(const std::vector<MeshTriangle> &triangles, const Ray &ray)
+{
+    WatertightRay wray(ray.dir);
+    real tMax = std::numeric_limits<real>::infinity();
+    for (const MeshTriangle &tri : triangles)
+    {
+        real t, b1, b2;
+        if (intersectTriangle(tri, ray.start, wray, Globals::epsilon, tMax, t, b1, b2))
+            tMax = t;
+    }
+    return std::isinf(tMax) ? -1 : tMax;
+}
+
+// tessellated unit spheres, rays from outside aimed at the mesh and rays from the center
+// which have to hit the closed surface when the test is watertight
+static int benchmarkMeshes(size_t rayCount, double linearTestBudget, double minSeconds)
+{
+    const uvec2 tessellations[] = {uvec2(98, 50), uvec2(314, 158), uvec2(998, 500)};
+
+    Material material;
+    int failures = 0;
+    printf("\n%10s %12s %10s %16s %16s %10s %8s\n", "triangles", "build[ms]", "nodes", "bvh[rays/s]", "linear[rays/s]", "speedup", "leaks");
+    for (uvec2 tessellation : tessellations)
+    {
+        IndexedVerticesMesh3D<u32> mesh = GeneratedResources::Sphere(tessellation.x, tessellation.y, 1.0f);
+        std::mt19937 rng(tessellation.x);
+
+        BenchmarkClock::time_point buildBegin = BenchmarkClock::now();
+        TriangleMesh triangleMesh(mesh, &material);
+        double buildSeconds = secondsSince(buildBegin);
+
+        std::vector<MeshTriangle> triangles(mesh.indices.size() / 3);
+        for (size_t i = 0; i < triangles.size(); ++i)
+        {
+            triangles[i].v0 = mesh.vertices[mesh.indices[3 * i]].position;
+            triangles[i].v1 = mesh.vertices[mesh.indices[3 * i + 1]].position;
+            triangles[i].v2 = mesh.vertices[mesh.indices[3 * i + 2]].position;
+            triangles[i].index = (u32)i;
+        }
+
+        std::vector<Ray> rays;
+        rays.reserve(rayCount);
+        while (rays.size() < rayCount)
+        {
+            rvec3 start = normalize(randomDirection(rng)) * real(3);
+            rvec3 target = randomDirection(rng) * real(1.2);
+            rays.push_back(Ray(start, target - start));
+        }
+
+        size_t linearRayCount = std::min(rayCount, std::max((size_t)100, (size_t)(linearTestBudget / triangles.size())));
+        for (size_t i = 0; i < linearRayCount; ++i)
+        {
+            double expected = intersectTrianglesLinear(triangles, rays[i]);
+            double actual = triangleMesh.intersect(rays[i]).t;
+            if ((expected < 0) != (actual < 0) || fabs(expected - actual) > 1e-6)
+                failures++;
+        }
+
+        int leaks = 0;
+        for (size_t i = 0; i < rayCount; ++i)
+        {
+            if (triangleMesh.intersect(Ray(rvec3(0), randomDirection(rng))).t < 0)
+                leaks++;
+        }
+        failures += leaks;
+
+        double bvhRate = measureRaysPerSecond(rays, rayCount, minSeconds, [&](const Ray &ray) { return triangleMesh.intersect(ray); });
+        double linearRate = measureRaysPerSecond(rays, linearRayCount, minSeconds, [&](const Ray &ray) { Hit hit; hit.t = intersectTrianglesLinear(triangles, ray); return hit; });
+        printf("%10zu %12.2f %10zu %16.0f %16.0f %9.1fx %8d\n", triangleMesh.triangleCount(), buildSeconds * 1000, triangleMesh.nodeCount(), bvhRate, linearRate, bvhRate / linearRate, leaks);
+        fflush(stdout);
+    }
+    return failures;
+}
+
+// Pinhole camera rays over the whole scene grouped into 2x2 pixel packets like RaytraceJob,
+// compares single ray and packet traversal of the same BVH
+static int benchmarkPackets(double minSeconds)
+{
+    const int sceneSizes[] = {100, 10000, 100000};
+    const int resolution = 256;
+
+    Material material;
+    int mismatches = 0;
+    printf("\n%10s %20s %20s %10s\n", "spheres", "single[rays/s]", "packet[rays/s]", "speedup");
+    for (int sphereCount : sceneSizes)
+    {
+        std::mt19937 rng(sphereCount);
+        double side = 4.0 * std::cbrt((double)sphereCount);
+        std::uniform_real_distribution<double> position(0, side);
+        std::uniform_real_distribution<double> radius(0.2, 0.6);
+        std::vector<std::unique_ptr<Sphere>> spheres;
+        std::vector<Intersectable *> objects;
+        for (int i = 0; i < sphereCount; ++i)
+        {
+            spheres.push_back(std::make_unique<Sphere>(rvec3(position(rng), position(rng), position(rng)), radius(rng), &material, false));
+            objects.push_back(spheres.back().get());
+        }
+        BVH bvh;
+        bvh.build(objects);
+        PrimitiveStore store;
+        store.build(objects);
+
+        // camera in front of the cube looking at its center
+        rvec3 eye(side * 0.5, side * 0.5, -side);
+        std::vector<Ray> rays;
+        rays.reserve(resolution * resolution);
+        for (int y = 0; y < resolution; y += 2)
+        {
+            for (int x = 0; x < resolution; x += 2)
+            {
+                for (int i = 0; i < RayPacket4::size; ++i)
+                {
+                    rvec3 pixel((x + i % 2 + 0.5) / resolution * side, (y + i / 2 + 0.5) / resolution * side, 0);
+                    rays.push_back(Ray(eye, pixel - eye));
+                }
+            }
+        }
+
+        for (size_t p = 0; p < rays.size(); p += RayPacket4::size)
+        {
+            Hit hits[RayPacket4::size], storeHits[RayPacket4::size];
+            bvh.intersectPacket(RayPacket4(&rays[p], RayPacket4::size), hits);
+            store.intersectPacket(RayPacket4(&rays[p], RayPacket4::size), storeHits);
+            for (int i = 0; i < RayPacket4::size; ++i)
+            {
+                Hit expected = bvh.intersect(rays[p + i], nullptr);
+                if (!sameHit(expected, hits[i]))
+                    mismatches++;
+                if (!sameHit(expected, storeHits[i]))
+                    mismatches++;
+            }
+        }
+
+        double singleRate = measureRaysPerSecond(rays, rays.size(), minSeconds, [&](const Ray &ray) { return bvh.intersect(ray, nullptr); });
+        double packetRate = measureRaysPerSecond(minSeconds, [&]() {
+            double hits = 0;
+            for (size_t p = 0; p < rays.size(); p += RayPacket4::size)
+            {
+                Hit packetHits[RayPacket4::size];
+                bvh.intersectPacket(RayPacket4(&rays[p], RayPacket4::size), packetHits);
+                hits += packetHits[0].t;
+            }
+            doNotOptimize(hits);
+            return rays.size();
+        });
+        printf("%10d %20.0f %20.0f %9.2fx\n", sphereCount, singleRate, packetRate, packetRate / singleRate);
+        fflush(stdout);
+    }
+    return mismatches;
+}
+
+int runBVHBenchmark()
+{
+    const int sceneSizes[] = {10, 100, 1000, 10000, 100000};
+    const size_t rayCount = 100000;
+    // the linear scan is limited to this many ray-sphere tests per scene size
+    const double linearTestBudget = 5e7;
+    const double minSeconds = 0.5;
+
+    Material material;
+    int mismatches = 0;
+    printf("%10s %12s %10s %16s %16s %16s %10s\n", "spheres", "build[ms]", "nodes", "bvh[rays/s]", "store[rays/s]", "linear[rays/s]", "speedup");
+    for (int sphereCount : sceneSizes)
+    {
+        std::mt19937 rng(sphereCount);
+        // keep the density of the spheres constant
+        double side = 4.0 * std::cbrt((double)sphereCount);
+        std::uniform_real_distribution<double> position(0, side);
+        std::uniform_real_distribution<double> radius(0.2, 0.6);
+
+        std::vector<std::unique_ptr<Sphere>> spheres;
+        std::vector<Intersectable *> objects;
+        spheres.reserve(sphereCount);
+        objects.reserve(sphereCount);
+        for (int i = 0; i < sphereCount; ++i)
+        {
+            rvec3 center(position(rng), position(rng), position(rng));
+            spheres.push_back(std::make_unique<Sphere>(center, radius(rng), &material, false));
+            objects.push_back(spheres.back().get());
+        }
+
+        // rays start inside the scene in uniformly distributed directions, like secondary rays
+        std::vector<Ray> rays;
+        rays.reserve(rayCount);
+        while (rays.size() < rayCount)
+            rays.push_back(Ray(rvec3(position(rng), position(rng), position(rng)), randomDirection(rng)));
+
+        BVH bvh;
+        BenchmarkClock::time_point buildBegin = BenchmarkClock::now();
+        bvh.build(objects);
+        double buildSeconds = secondsSince(buildBegin);
+        PrimitiveStore store;
+        store.build(objects);
+
+        size_t linearRayCount = std::min(rayCount, std::max((size_t)100, (size_t)(linearTestBudget / sphereCount)));
+        for (size_t i = 0; i < linearRayCount; ++i)
+        {
+            Hit expected = intersectLinear(objects, rays[i]);
+            Hit actual = bvh.intersect(rays[i], nullptr);
+            if (!sameHit(expected, actual))
+                mismatches++;
+        }
+        for (size_t i = 0; i < rayCount; ++i)
+        {
+            Hit expected = bvh.intersect(rays[i], nullptr);
+            Hit actual = store.intersect(rays[i], nullptr);
+            if (!sameHit(expected, actual))
+                mismatches++;
+        }
+
+        double bvhRate = measureRaysPerSecond(rays, rayCount, minSeconds, [&](const Ray &ray) { return bvh.intersect(ray, nullptr); });
+        double storeRate = measureRaysPerSecond(rays, rayCount, minSeconds, [&](const Ray &ray) { return store.intersect(ray, nullptr); });
+        double linearRate = measureRaysPerSecond(rays, linearRayCount, minSeconds, [&](const Ray &ray) { return intersectLinear(objects, ray); });
+        printf("%10d %12.2f %10zu %16.0f %16.0f %16.0f %9.1fx\n", sphereCount, buildSeconds * 1000, bvh.nodeCount(), bvhRate, storeRate, linearRate, bvhRate / linearRate);
+        fflush(stdout);
+    }
+
+    mismatches += benchmarkMeshes(rayCount, linearTestBudget, minSeconds);
+    mismatches += benchmarkPackets(minSeconds);
+    if (mismatches > 0)
+        printf("ERROR: %d rays hit a different object with the BVH, with packets or leaked through a mesh\n", mismatches);
+    return mismatches > 0 ? 1 : 0;
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,14 @@
+#ifndef RSO_BVH_BENCHMARK_HPP
+#define RSO_BVH_BENCHMARK_HPP
+
+namespace Morph {
+
+// Scene size scaling of the ray casting, prints rays/s of the BVH, of the PrimitiveStore and of the linear scan
+// for 10 to 100k random spheres and for triangle meshes with 10k to 1M triangles,
+// and single rays against 2x2 packets of both for coherent camera rays,
+// returns non zero when they disagree on some hit or a ray leaks through a closed mesh
+int runBVHBenchmark();
+
+}
+
+#endif // RSO_BVH_BENCHMARK_HPP
\ No newline at end of file
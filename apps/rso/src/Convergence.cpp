@@ -0,0 +1,455 @@
+#include "Convergence.hpp"
+
+#include "Headless.hpp"
+#include "Image.hpp"
+#include "Scene.hpp"
+
+#include <Core/JobManager.hpp>
+#include <Resource/Storage.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#define _USE_MATH_DEFINES
+#include <math.h>
+
+namespace Morph {
+
+// one channel of an image, row major
+using Plane = std::vector<float>;
+
+// Filters the rows with kx and then the columns with ky, both of odd length, the borders are clamped
+static Plane filterSeparable(const Plane& in, int width, int height, const std::vector<float>& kx, const std::vector<float>& ky)
+{
+    int rx = (int)kx.size() / 2, ry = (int)ky.size() / 2;
+    Plane rows(in.size()), out(in.size());
+    for (int y = 0; y < height; ++y)
+    {
+        const float* row = &in[(size_t)y * width];
+        for (int x = 0; x < width; ++x)
+        {
+            float sum = 0;
+            for (int i = -rx; i <= rx; ++i)
+                sum += kx[i + rx] * row[std::clamp(x + i, 0, width - 1)];
+            rows[(size_t)y * width + x] = sum;
+        }
+    }
+    for (int y = 0; y < height; ++y)
+    {
+        float* outRow = &out[(size_t)y * width];
+        for (int i = -ry; i <= ry; ++i)
+        {
+            const float* row = &rows[(size_t)std::clamp(y + i, 0, height - 1) * width];
+            float k = ky[i + ry];
+            for (int x = 0; x < width; ++x)
+                outRow[x] += k * row[x];
+        }
+    }
+    return out;
+}
+
+// linear sRGB and CIE XYZ with the D65 white of the sRGB primaries
+static dvec3 rgbToXYZ(dvec3 c)
+{
+    return dvec3(0.4124564 * c.x + 0.3575761 * c.y + 0.1804375 * c.z,
+                 0.2126729 * c.x + 0.7151522 * c.y + 0.0721750 * c.z,
+                 0.0193339 * c.x + 0.1191920 * c.y + 0.9503041 * c.z);
+}
+
+static dvec3 xyzToRGB(dvec3 c)
+{
+    return dvec3(3.2404542 * c.x - 1.5371385 * c.y - 0.4985314 * c.z,
+                 -0.9692660 * c.x + 1.8760108 * c.y + 0.0415560 * c.z,
+                 0.0556434 * c.x - 0.2040259 * c.y + 1.0572252 * c.z);
+}
+
+static const dvec3 whiteXYZ = rgbToXYZ(dvec3(1));
+
+// L*a*b* with the Hunt adjustment of FLIP, the chroma fades with the lightness
+static dvec3 huntLab(dvec3 rgb)
+{
+    dvec3 t = rgbToXYZ(glm::min(glm::max(rgb, dvec3(0)), dvec3(1))) / whiteXYZ;
+    const double delta = 6.0 / 29.0;
+    for (int i = 0; i < 3; ++i)
+        t[i] = t[i] > delta * delta * delta ? std::cbrt(t[i]) : t[i] / (3 * delta * delta) + 4.0 / 29.0;
+    double l = 116 * t.y - 16;
+    return dvec3(l, 0.01 * l * 500 * (t.x - t.y), 0.01 * l * 200 * (t.y - t.z));
+}
+
+// HyAB distance, the lightness difference and the euclidean distance of the chroma
+static double hyab(dvec3 a, dvec3 b)
+{
+    return std::abs(a.x - b.x) + std::sqrt((a.y - b.y) * (a.y - b.y) + (a.z - b.z) * (a.z - b.z));
+}
+
+// The YCxCz opponent channels of the LDR image filtered with the contrast sensitivity functions of FLIP,
+// converted back to linear RGB
+static std::vector<dvec3> flipFilteredColors(const std::vector<dvec3>& rgb, int width, int height, double pixelsPerDegree)
+{
+    Plane channels[3];
+    for (Plane& channel : channels)
+        channel.resize(rgb.size());
+    for (size_t p = 0; p < rgb.size(); ++p)
+    {
+        dvec3 t = rgbToXYZ(rgb[p]) / whiteXYZ;
+        channels[0][p] = (float)(116 * t.y - 16);
+        channels[1][p] = (float)(500 * (t.x - t.y));
+        channels[2][p] = (float)(200 * (t.y - t.z));
+    }
+
+    // sums of a * sqrt(pi / b) * exp(-(pi x)^2 / b) with x in degrees, a2 = 0 for the first two channels
+    const double csf[3][4] = {{1, 0.0047, 0, 1e-5}, {1, 0.0053, 0, 1e-5}, {34.1, 0.04, 13.5, 0.025}};
+    int radius = (int)std::ceil(3 * std::sqrt(0.04 / (2 * M_PI * M_PI)) * pixelsPerDegree);
+    for (int c = 0; c < 3; ++c)
+    {
+        Plane filtered(rgb.size(), 0.0f);
+        std::vector<float> terms[2];
+        double weights[2], norm = 0;
+        for (int t = 0; t < 2; ++t)
+        {
+            double a = csf[c][2 * t], b = csf[c][2 * t + 1];
+            double sum = 0;
+            for (int i = -radius; i <= radius; ++i)
+            {
+                double x = i / pixelsPerDegree;
+                terms[t].push_back((float)std::exp(-M_PI * M_PI * x * x / b));
+                sum += terms[t].back();
+            }
+            // the 2D kernel of a term is a * pi / b times the product of the 1D factors
+            weights[t] = a * M_PI / b;
+            norm += weights[t] * sum * sum;
+        }
+        for (int t = 0; t < 2; ++t)
+        {
+            if (weights[t] == 0)
+                continue;
+            Plane term = filterSeparable(channels[c], width, height, terms[t], terms[t]);
+            float scale = (float)(weights[t] / norm);
+            for (size_t p = 0; p < filtered.size(); ++p)
+                filtered[p] += scale * term[p];
+        }
+        channels[c] = std::move(filtered);
+    }
+
+    std::vector<dvec3> out(rgb.size());
+    for (size_t p = 0; p < rgb.size(); ++p)
+    {
+        double y = (channels[0][p] + 16) / 116.0;
+        dvec3 t(channels[1][p] / 500.0 + y, y, y - channels[2][p] / 200.0);
+        out[p] = xyzToRGB(t * whiteXYZ);
+    }
+    return out;
+}
+
+// Edge and point strength of the luminance, from the first and second derivatives of a Gaussian
+static void flipFeatures(const Plane& luminance, int width, int height, double pixelsPerDegree, Plane& edges, Plane& points)
+{
+    double sd = 0.5 * 0.082 * pixelsPerDegree;
+    int radius = (int)std::ceil(3 * sd);
+    std::vector<float> gauss, first, second;
+    double gaussSum = 0, firstPositive = 0, secondPositive = 0, secondNegative = 0;
+    for (int i = -radius; i <= radius; ++i)
+    {
+        double g = std::exp(-i * i / (2 * sd * sd));
+        double d2 = (i * i / (sd * sd) - 1) * g;
+        gauss.push_back((float)g);
+        first.push_back((float)(-i * g));
+        second.push_back((float)d2);
+        gaussSum += g;
+        firstPositive += std::max(-i * g, 0.0);
+        (d2 > 0 ? secondPositive : secondNegative) += std::abs(d2);
+    }
+    // the positive weights of the 2D kernels sum to 1 and the negative ones to -1
+    for (size_t i = 0; i < gauss.size(); ++i)
+    {
+        gauss[i] /= (float)gaussSum;
+        first[i] /= (float)firstPositive;
+        second[i] /= (float)(second[i] > 0 ? secondPositive : secondNegative);
+    }
+    Plane edgeX = filterSeparable(luminance, width, height, first, gauss);
+    Plane edgeY = filterSeparable(luminance, width, height, gauss, first);
+    Plane pointX = filterSeparable(luminance, width, height, second, gauss);
+    Plane pointY = filterSeparable(luminance, width, height, gauss, second);
+    edges.resize(luminance.size());
+    points.resize(luminance.size());
+    for (size_t p = 0; p < luminance.size(); ++p)
+    {
+        edges[p] = std::sqrt(edgeX[p] * edgeX[p] + edgeY[p] * edgeY[p]);
+        points[p] = std::sqrt(pointX[p] * pointX[p] + pointY[p] * pointY[p]);
+    }
+}
+
+// LDR FLIP of Andersson et al. 2020 on linear RGB in [0, 1]
+static double flipError(const std::vector<dvec3>& test, const std::vector<dvec3>& reference, int width, int height, double pixelsPerDegree)
+{
+    const double qc = 0.7, qf = 0.5, pc = 0.4, pt = 0.95;
+    std::vector<dvec3> filteredTest = flipFilteredColors(test, width, height, pixelsPerDegree);
+    std::vector<dvec3> filteredReference = flipFilteredColors(reference, width, height, pixelsPerDegree);
+
+    Plane luminance(test.size());
+    Plane testEdges, testPoints, referenceEdges, referencePoints;
+    for (size_t p = 0; p < test.size(); ++p)
+        luminance[p] = (float)(rgbToXYZ(test[p]).y / whiteXYZ.y);
+    flipFeatures(luminance, width, height, pixelsPerDegree, testEdges, testPoints);
+    for (size_t p = 0; p < reference.size(); ++p)
+        luminance[p] = (float)(rgbToXYZ(reference[p]).y / whiteXYZ.y);
+    flipFeatures(luminance, width, height, pixelsPerDegree, referenceEdges, referencePoints);
+
+    // the largest color difference is between green and blue
+    double maxColor = std::pow(hyab(huntLab(dvec3(0, 1, 0)), huntLab(dvec3(0, 0, 1))), qc);
+    double sum = 0;
+    for (size_t p = 0; p < test.size(); ++p)
+    {
+        double color = std::pow(hyab(huntLab(filteredTest[p]), huntLab(filteredReference[p])), qc);
+        // small differences are spread over [0, pt), the rest is compressed into [pt, 1]
+        if (color < pc * maxColor)
+            color *= pt / (pc * maxColor);
+        else
+            color = pt + (color - pc * maxColor) / (maxColor - pc * maxColor) * (1 - pt);
+        double feature = std::max(std::abs(testEdges[p] - referenceEdges[p]), std::abs(testPoints[p] - referencePoints[p]));
+        feature = std::pow(feature / std::sqrt(2.0), qf);
+        sum += std::pow(color, 1 - feature);
+    }
+    return sum / test.size();
+}
+
+ImageError imageError(const vector2d<vec3>& image, const vector2d<vec3>& reference, float exposure, double pixelsPerDegree)
+{
+    ImageError error;
+    uvec2 size = image.dim();
+    size_t pixelCount = (size_t)size.x * size.y;
+    std::vector<dvec3> test(pixelCount), ldrReference(pixelCount);
+    double squared = 0, relative = 0;
+    for (u32 y = 0; y < size.y; ++y)
+    {
+        for (u32 x = 0; x < size.x; ++x)
+        {
+            dvec3 value = image(x, y), expected = reference(x, y);
+            dvec3 d = value - expected;
+            squared += dot(d, d);
+            relative += dot(d / (expected * expected + 0.01), d);
+            // the tone mapping of the app without the gamma, FLIP takes linear values
+            size_t p = (size_t)y * size.x + x;
+            test[p] = dvec3(1) - glm::exp(-value * (double)exposure);
+            ldrReference[p] = dvec3(1) - glm::exp(-expected * (double)exposure);
+        }
+    }
+    error.rmse = std::sqrt(squared / (3 * pixelCount));
+    error.relMSE = relative / (3 * pixelCount);
+    error.flip = flipError(test, ldrReference, size.x, size.y, pixelsPerDegree);
+    return error;
+}
+
+struct ConvergenceOptions
+{
+    std::string reference;
+    SceneType scene = HW1_3_SCENE;
+    const char* filename = nullptr;
+    std::vector<Method> methods = {BRDF, LIGHT_SOURCE, MULTIPLE_IMPORTANCE, PATH_TRACING};
+    SamplerType sampler = SOBOL;
+    // the size of the app window, image.bin has no header
+    uvec2 size = uvec2(600, 600);
+    int threads = 0;
+    double seconds = 10;
+    double interval = 0.5;
+    int samplesPerIteration = 1;
+    bool adaptive = true;
+    double threshold = 0.02;
+    double pixelsPerDegree = 67;
+    std::string output;
+};
+
+static void convergenceUsage()
+{
+    printf("Usage: rso --convergence --reference <image.bin|file.hdr> [options]\n");
+    printf(" --reference <path>             image.bin of the w key or an .hdr of --headless --no-adaptive at the same size\n");
+    printf(" --scene hw1_3|hw2|hw4|mesh|spheres  test scene (hw1_3)\n");
+    printf(" --file <path>                  HDR environment map or OBJ model of the scene\n");
+    printf(" --methods <list>               comma separated brdf, light, half, mis, path (brdf,light,mis,path)\n");
+    printf(" --sampler independent|sobol|halton|blue-noise  sample sequences (sobol)\n");
+    printf(" --size <width>x<height>        resolution of the reference (600x600)\n");
+    printf(" --threads <n>                  worker threads, 0 for one per hardware thread (0)\n");
+    printf(" --time <seconds>               render time of each method (10)\n");
+    printf(" --interval <seconds>           render time between error measurements (0.5)\n");
+    printf(" --iteration-spp <n>            samples per pixel in one iteration (1)\n");
+    printf(" --threshold <error>            relative error of converged pixels (0.02)\n");
+    printf(" --no-adaptive                  the same number of samples in every pixel\n");
+    printf(" --ppd <pixels>                 pixels per degree of the FLIP error (67)\n");
+    printf(" --output <file.csv>            also writes the CSV to a file\n");
+}
+
+static bool parseMethods(const char* value, std::vector<Method>& methods)
+{
+    methods.clear();
+    std::string list = value;
+    size_t begin = 0;
+    while (begin <= list.size())
+    {
+        size_t end = std::min(list.find(',', begin), list.size());
+        Method method;
+        if (!parseMethod(list.substr(begin, end - begin).c_str(), method))
+            return false;
+        methods.push_back(method);
+        begin = end + 1;
+    }
+    return !methods.empty();
+}
+
+static bool parseOptions(int argc, char** argv, ConvergenceOptions& options)
+{
+    for (int i = 0; i < argc; ++i)
+    {
+        const char* arg = argv[i];
+        if (strcmp(arg, "--no-adaptive") == 0)
+        {
+            options.adaptive = false;
+            continue;
+        }
+        if (strcmp(arg, "--help") == 0 || i + 1 >= argc)
+            return false;
+        const char* value = argv[++i];
+        bool valid = true;
+        if (strcmp(arg, "--reference") == 0)
+            options.reference = value;
+        else if (strcmp(arg, "--scene") == 0)
+            valid = parseScene(value, options.scene);
+        else if (strcmp(arg, "--file") == 0)
+            options.filename = value;
+        else if (strcmp(arg, "--methods") == 0)
+            valid = parseMethods(value, options.methods);
+        else if (strcmp(arg, "--sampler") == 0)
+            valid = parseSampler(value, options.sampler);
+        else if (strcmp(arg, "--size") == 0)
+            valid = parseSize(value, options.size);
+        else if (strcmp(arg, "--threads") == 0)
+            valid = parseThreads(value, options.threads);
+        else if (strcmp(arg, "--time") == 0)
+            valid = sscanf(value, "%lf", &options.seconds) == 1 && options.seconds > 0;
+        else if (strcmp(arg, "--interval") == 0)
+            valid = sscanf(value, "%lf", &options.interval) == 1 && options.interval > 0;
+        else if (strcmp(arg, "--iteration-spp") == 0)
+            valid = sscanf(value, "%d", &options.samplesPerIteration) == 1 && options.samplesPerIteration > 0;
+        else if (strcmp(arg, "--threshold") == 0)
+            valid = sscanf(value, "%lf", &options.threshold) == 1 && options.threshold > 0;
+        else if (strcmp(arg, "--ppd") == 0)
+            valid = sscanf(value, "%lf", &options.pixelsPerDegree) == 1 && options.pixelsPerDegree > 0;
+        else if (strcmp(arg, "--output") == 0)
+            options.output = value;
+        else
+            valid = false;
+        if (!valid)
+        {
+            fprintf(stderr, "ERROR: invalid option %s %s\n", arg, value);
+            return false;
+        }
+    }
+    return !options.reference.empty();
+}
+
+// image.bin holds the floats of Globals::hdrImage without a header, .hdr files are read like env maps
+static bool readReference(const std::string& path, uvec2 size, vector2d<vec3>& reference)
+{
+    reference.assign(size, vec3(0));
+    size_t suffix = path.size() >= 4 ? path.size() - 4 : 0;
+    if (path.compare(suffix, std::string::npos, ".hdr") == 0)
+    {
+        Image image = ReadHDR(path.c_str(), FLOAT_PIXELS);
+        if (image.width != (int)size.x || image.height != (int)size.y)
+        {
+            fprintf(stderr, "ERROR: %s is %dx%d, the render %ux%u\n", path.c_str(), image.width, image.height, size.x, size.y);
+            return false;
+        }
+        for (u32 y = 0; y < size.y; ++y)
+            for (u32 x = 0; x < size.x; ++x)
+                reference(x, y) = vec3(image.pixel(x, y));
+        return true;
+    }
+    opt<string> contents = ResourceStorage::ReadFile(path);
+    if (!contents)
+    {
+        fprintf(stderr, "ERROR: cannot read %s\n", path.c_str());
+        return false;
+    }
+    if (contents->size() != reference.size() * sizeof(vec3))
+    {
+        fprintf(stderr, "ERROR: %s has %zu bytes, %ux%u pixels need %zu, see --size\n", path.c_str(), contents->size(), size.x,
+                size.y, reference.size() * sizeof(vec3));
+        return false;
+    }
+    memcpy(reference.data(), contents->data(), contents->size());
+    return true;
+}
+
+int runConvergence(int argc, char** argv)
+{
+    ConvergenceOptions options;
+    if (!parseOptions(argc, argv, options))
+    {
+        convergenceUsage();
+        return 1;
+    }
+    vector2d<vec3> reference;
+    if (!readReference(options.reference, options.size, reference))
+        return 1;
+
+    using Clock = std::chrono::steady_clock;
+    JobManager jobManager(options.threads);
+    Globals::resize_image(options.size);
+    Globals::sampler = options.sampler;
+    Globals::samplesPerFrame = options.samplesPerIteration;
+    Globals::useAdaptiveSampling = options.adaptive;
+    Globals::adaptiveThreshold = options.threshold;
+    Globals::maxSamples = 0;
+
+    Scene scene(jobManager);
+    scene.build(options.scene, options.filename);
+
+    std::string csv = "method,sampler,adaptive,seconds,iterations,spp,rmse,relmse,flip\n";
+    double pixelCount = (double)options.size.x * options.size.y;
+    for (Method method : options.methods)
+    {
+        Globals::method = method;
+        Globals::weight = methodWeight(method);
+        Globals::clear();
+
+        double renderSeconds = 0, nextMeasurement = options.interval;
+        u64 iterations = 0, samples = 0;
+        ImageError error;
+        while (renderSeconds < options.seconds && !scene.finished())
+        {
+            Clock::time_point begin = Clock::now();
+            scene.renderIteration();
+            renderSeconds += std::chrono::duration<double>(Clock::now() - begin).count();
+            iterations++;
+            samples += scene.lastIteration().samples;
+
+            bool last = renderSeconds >= options.seconds || scene.finished();
+            if (renderSeconds < nextMeasurement && !last)
+                continue;
+            nextMeasurement = (std::floor(renderSeconds / options.interval) + 1) * options.interval;
+            error = imageError(Globals::hdrImage, reference, Globals::exposure, options.pixelsPerDegree);
+            char line[256];
+            snprintf(line, sizeof(line), "%s,%s,%d,%.4f,%llu,%.3f,%.6e,%.6e,%.6e\n", methodName(method), samplerOption(options.sampler).c_str(),
+                     options.adaptive ? 1 : 0, renderSeconds, (unsigned long long)iterations, samples / pixelCount, error.rmse, error.relMSE,
+                     error.flip);
+            csv += line;
+        }
+        // efficiency is the inverse of the error times the time, higher is better at equal time
+        fprintf(stderr, "%s: %.2f s, %.1f spp, rmse %.4e, relMSE %.4e, FLIP %.4f, efficiency %.4g\n", methodName(method), renderSeconds,
+                samples / pixelCount, error.rmse, error.relMSE, error.flip, 1 / (error.relMSE * renderSeconds));
+    }
+
+    fputs(csv.c_str(), stdout);
+    if (!options.output.empty() && !ResourceStorage::WriteToFile(options.output, csv))
+    {
+        fprintf(stderr, "ERROR: cannot write %s\n", options.output.c_str());
+        return 1;
+    }
+    return 0;
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,29 @@
+#ifndef RSO_CONVERGENCE_HPP
+#define RSO_CONVERGENCE_HPP
+
+#include "Globals.hpp"
+
+namespace Morph {
+
+// Errors of a rendering against a reference image of the same size
+struct ImageError
+{
+  double rmse = 0;
+  // squared error relative to the squared reference value plus 0.01, averaged over pixels and channels
+  double relMSE = 0;
+  // mean LDR FLIP error of the images tone mapped with the exposure, between 0 and 1
+  double flip = 0;
+};
+
+// pixelsPerDegree is the viewing distance of the FLIP filters, 67 is a 0.7 m wide 4k monitor seen from 0.7 m
+ImageError imageError(const vector2d<vec3>& image, const vector2d<vec3>& reference, float exposure, double pixelsPerDegree = 67);
+
+// Equal time comparison of the sampling methods against a reference image, either the raw image.bin
+// written with the w key or an .hdr file of --headless. Renders each method for a wall clock budget
+// and records the errors at fixed intervals of the render time, the error evaluation is not counted.
+// Prints the error over time curves as CSV, returns non zero on bad arguments or a missing reference.
+int runConvergence(int argc, char** argv);
+
+}
+
+#endif // RSO_CONVERGENCE_HPP
\ No newline at end of file
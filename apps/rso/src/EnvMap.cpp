@@ -1,144 +1,244 @@
 #include "EnvMap.hpp"
 
+#include <Core/JobManager.hpp>
+#include <Profile/MemoryTracker.hpp>
+
+#include "RayPacket.hpp"
+
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+
 #define _USE_MATH_DEFINES
 #include <math.h>
 
 namespace Morph {
 
-Distribution1D::Distribution1D(const std::vector<double>& f, int n)
+// Job running one part of the rows of a preprocessing step
+class EnvMapRowsJob : public Job
+{
+public:
+    EnvMapRowsJob(const std::function<void(int, int)> &step, int fromRow, int toRow) : _step(&step), _fromRow(fromRow), _toRow(toRow) {}
+    void Run() override { (*_step)(_fromRow, _toRow); }
+private:
+    const std::function<void(int, int)> *_step;
+    int _fromRow;
+    int _toRow;
+};
+
+// Run step on [from, to) ranges covering the rows, on the workers of the job manager when there is one
+static void forRows(JobManager *jobManager, int rows, const std::function<void(int, int)> &step)
 {
-    func.resize(n, 0);
-    cdf.resize(n + 1, 0);
-    count = n;
-    std::copy(f.begin(), f.begin() + n, func.begin());
-    ComputeStep1dCDF();
-    invFuncInt = 1. / funcInt;
-    invCount = 1. / count;
+    if (!jobManager) {
+        step(0, rows);
+        return;
+    }
+    // a few jobs per worker to even out the rows of different cost
+    int jobCount = std::min(rows, jobManager->GetMaxNumberOfWorkers() * 4);
+    std::vector<EnvMapRowsJob> jobs;
+    jobs.reserve(jobCount);
+    for (int j = 0; j < jobCount; ++j) {
+        jobs.emplace_back(step, rows * j / jobCount, rows * (j + 1) / jobCount);
+    }
+    for (EnvMapRowsJob &job : jobs) {
+        jobManager->SubmitJob(&job);
+    }
+    jobManager->WaitForJobsToFinish();
 }
 
-double Distribution1D::Sample(double u, double *pdf) {
-    // Find surrounding cdf segments
-    double *ptr = std::lower_bound(cdf.data(), cdf.data()+count+1, u);
-    int offset = std::max(0, (int) (ptr-cdf.data()-1));
-    // Return offset along current cdf segment
-    u = (u - cdf[offset]) / (cdf[offset+1] - cdf[offset]);
-    *pdf = func[offset] * invFuncInt;
-    return offset + u;
+static u64 hashContents(const MappedFile &file)
+{
+    u64 hash = mixBits(file.size());
+    usize words = file.size() / 8;
+    for (usize i = 0; i < words; ++i) {
+        u64 word;
+        memcpy(&word, file.data() + i * 8, 8);
+        hash = mixBits(hash ^ word) + i;
+    }
+    u64 tail = 0;
+    memcpy(&tail, file.data() + words * 8, file.size() - words * 8);
+    return mixBits(hash ^ tail);
 }
 
-void Distribution1D::ComputeStep1dCDF()
+// The tables go to a temporary file renamed over the cache, so processes which mapped the old cache keep
+// reading it whole instead of faulting on a truncated file, and no partial cache is left on failure.
+static bool writeCache(const string &cachePath, const string &contents)
 {
-    for (int i = 0; i < count; ++i) {
-        cdf[i + 1] = cdf[i] + (func[i] / (double)count);
+    string tempPath = cachePath + "." + std::to_string(std::chrono::system_clock::now().time_since_epoch().count()) + ".tmp";
+    std::ofstream file(tempPath, std::ios::binary);
+    file.write(contents.data(), contents.size());
+    file.close();
+    std::error_code error;
+    if (file.fail()) {
+        std::filesystem::remove(tempPath, error);
+        return false;
     }
-    funcInt = std::max(cdf[count], Globals::epsilon);
-    for (int i = 0; i < count; ++i) {
-        cdf[i + 1] /= funcInt;
+    std::filesystem::rename(tempPath, cachePath, error);
+    if (error) {
+        std::filesystem::remove(tempPath, error);
+        return false;
     }
+    return true;
 }
 
-EnvMap::EnvMap(const char* hdrFilename) : Sphere(dvec3(), 1, new EnvMapMaterial(hdrFilename), true, 1)
+EnvMap::EnvMap(const char* hdrFilename, JobManager *jobManager) : Sphere(rvec3(0), 1, new EnvMapMaterial(hdrFilename, jobManager), true, 1)
 {
+    MORPH_MEMORY_TAG("rso.envmap");
     EnvMapMaterial* mat = (EnvMapMaterial*)material;
-    const Image& hdrImage = mat->hdrImage;
-    width = hdrImage.width;
-    height = hdrImage.height;
-    int size = hdrImage.width * hdrImage.height;
-    intensities.resize(size, 0);
-    for (int y = 0; y < height; ++y) {
-        // compensate the poles
-        double sinTheta = sin(M_PI * (double) y / (double)height);
-        for (int x = 0; x < width; ++x) {
-        int i = x + y * width;
-        intensities[i] = std::max(dot(dvec3(0.2989, 0.5870, 0.1140), hdrImage.data[i]), Globals::epsilon);
-        }
-    }
+    width = mat->hdrImage.width;
+    height = mat->hdrImage.height;
 
-    const double sigma = 1;
-    int gauss_size = 7;
-    std::vector<double> gauss;
-    gauss.resize(gauss_size, 0);
-    for (int g = 0; g  < gauss_size; ++g) {
-        int dg = g - (gauss_size/2);
-        gauss[g] = exp(-(dg * dg) / (2.0 * sigma * sigma)) / sqrt(2.0 * M_PI * sigma * sigma);
+    // the timing only feeds the debug log, which is compiled out of release builds
+#if MORPH_LOG_ACTIVE_LEVEL <= MORPH_LOG_LEVEL_DEBUG
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+#endif
+    opt<MappedFile> hdrFile = MappedFile::Map(hdrFilename);
+    u64 hdrHash = hdrFile ? hashContents(*hdrFile) : 0;
+    string cachePath = string(hdrFilename) + ".envcache";
+    if (hdrFile && loadTables(cachePath, hdrHash)) {
+        MORPH_APP_LOG_DEBUG("env map tables of {} loaded from {}", hdrFilename, cachePath);
+    } else {
+        string contents = buildTables(hdrHash, jobManager);
+        if (!hdrFile || !writeCache(cachePath, contents)) {
+            MORPH_APP_LOG_WARN("env map tables of {} could not be cached in {}", hdrFilename, cachePath);
+        }
+        useTables(MappedFile::FromBuffer(std::move(contents)));
     }
+#if MORPH_LOG_ACTIVE_LEVEL <= MORPH_LOG_LEVEL_DEBUG
+    MORPH_APP_LOG_DEBUG("env map tables of {}x{} took {}[ms]", width, height,
+        std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - begin).count());
+#endif
+}
 
-    std::vector<double> tmpIntensities;
-    tmpIntensities.resize(size, 0);
-
-    // horizontal convolution
-    for (int y = 0; y < height; ++y) {
-        for (int x = 0; x < width; ++x) {
-        int i = x + y * width;
-        for (int g = 0; g  < gauss_size; ++g) {
-            int dx = g - (gauss_size/2);
-            int px = (x + dx + width) % width;
-            int di = px + y * width;
-            tmpIntensities[i] += gauss[g] * intensities[di];
-        }
-        }
+bool EnvMap::loadTables(const string &cachePath, u64 hdrHash)
+{
+    opt<MappedFile> file = MappedFile::Map(cachePath);
+    if (!file || file->size() != sizeof(EnvMapCacheHeader) + (width * height + height) * sizeof(AliasCell) + width * height * sizeof(float)) {
+        return false;
     }
-    // vertical convolution
-    intensities.assign(size, 0);
-    for (int x = 0; x < width; ++x) {
-        for (int y = 0; y < height; ++y) {
-        int i = x + y * width;
-        for (int g = 0; g  < gauss_size; ++g) {
-            int dy = g - (gauss_size/2);
-            int py = y + dy;
-            if (py < 0)
-            py = -py;
-            else if (py >= height)
-            py = 2 * height - py - 2;
-            int di = x + py * width;
-            intensities[i] += gauss[g] * tmpIntensities[di];
-        }
-        }
+    EnvMapCacheHeader header;
+    memcpy(&header, file->data(), sizeof(header));
+    if (header.magic != EnvMapCacheHeader::s_magic || header.version != EnvMapCacheHeader::s_version ||
+        header.hdrHash != hdrHash || header.width != (u32)width || header.height != (u32)height) {
+        return false;
     }
+    useTables(*file);
+    return true;
+}
 
-    std::vector<double> func;
-    func.resize(std::max(width, height), 0);
+void EnvMap::useTables(MappedFile file)
+{
+    tables = file;
+    cells = (const AliasCell *)(tables.data() + sizeof(EnvMapCacheHeader));
+    pixelPdfs = (const float *)(cells + width * height + height);
+}
 
-    std::vector<double> sinVals;
-    sinVals.resize(height, 0);
-    for (int y = 0; y < height; ++y)
-        sinVals[y] = sin(M_PI * ((double)y + 0.5) / (double)height);
+string EnvMap::buildTables(u64 hdrHash, JobManager *jobManager) const
+{
+    const Image& hdrImage = ((EnvMapMaterial*)material)->hdrImage;
+    int size = width * height;
+    string contents(sizeof(EnvMapCacheHeader) + (size + height) * sizeof(AliasCell) + size * sizeof(float), 0);
+    EnvMapCacheHeader header;
+    header.magic = EnvMapCacheHeader::s_magic;
+    header.version = EnvMapCacheHeader::s_version;
+    header.hdrHash = hdrHash;
+    header.width = width;
+    header.height = height;
+    memcpy(&contents[0], &header, sizeof(header));
+    AliasCell *outCells = (AliasCell *)(&contents[0] + sizeof(EnvMapCacheHeader));
+    float *outPdfs = (float *)(outCells + size + height);
 
-    vDistribs.resize(width, Distribution1D());
+    const double sigma = 1;
+    const int gaussSize = 7;
+    const int radius = gaussSize / 2;
+    dpack4 gauss[gaussSize];
+    double gaussScalar[gaussSize];
+    for (int g = 0; g < gaussSize; ++g) {
+        int dg = g - radius;
+        gaussScalar[g] = exp(-(dg * dg) / (2.0 * sigma * sigma)) / sqrt(2.0 * M_PI * sigma * sigma);
+        gauss[g] = broadcast(gaussScalar[g]);
+    }
 
-    for (int x = 0; x < width; ++x) {
-        // Compute sampling distribution for column x
-        for (int y = 0; y < height; ++y) {
-        int i = x + y * width;
-        func[y] = intensities[i] * sinVals[y];
+    // luminance blurred horizontally, the rows wrap around
+    std::vector<double> blurredRows(size);
+    forRows(jobManager, height, [&](int fromRow, int toRow) {
+        std::vector<double> padded(width + 2 * radius + 4);
+        for (int y = fromRow; y < toRow; ++y) {
+            for (int x = 0; x < width + 2 * radius; ++x) {
+                int px = (x - radius + width) % width;
+                padded[x] = std::max(dot(dvec3(0.2989, 0.5870, 0.1140), hdrImage.pixel(px, y)), (double)Globals::epsilon);
+            }
+            double *out = &blurredRows[y * width];
+            int x = 0;
+            for (; x + 4 <= width; x += 4) {
+                dpack4 sum = gauss[0] * load(&padded[x]);
+                for (int g = 1; g < gaussSize; ++g) {
+                    sum = sum + gauss[g] * load(&padded[x + g]);
+                }
+                store(out + x, sum);
+            }
+            for (; x < width; ++x) {
+                double sum = 0;
+                for (int g = 0; g < gaussSize; ++g) {
+                    sum += gaussScalar[g] * padded[x + g];
+                }
+                out[x] = sum;
+            }
         }
-        vDistribs[x] = Distribution1D(func, height);
-    }
+    });
 
-    // Compute sampling distribution for columns of image
-    for (int x = 0; x < width; ++x) {
-        func[x] = vDistribs[x].funcInt;
-    }
-    uDistrib = Distribution1D(func, width);
-
-    // testing code
-    #if 0
-        g_testImage = mat->hdrImage;
-        for (int i = 0; i < 200000; ++i)
-        {
-        dvec3 dir;
-        dvec3 normal;
-        samplePoint(dvec3(0), dir, normal);
-        mat->getLeRef(dir) = dvec3(1,0,0);
+    // vertical blur mirrored at the poles, weighted by the solid angle of the row, and the alias tables of the rows
+    std::vector<double> weights(size);
+    std::vector<double> rowWeights(height);
+    forRows(jobManager, height, [&](int fromRow, int toRow) {
+        for (int y = fromRow; y < toRow; ++y) {
+            const double *taps[gaussSize];
+            for (int g = 0; g < gaussSize; ++g) {
+                int py = y + g - radius;
+                if (py < 0)
+                    py = -py;
+                else if (py >= height)
+                    py = 2 * height - py - 2;
+                taps[g] = &blurredRows[py * width];
+            }
+            // the rows near the poles cover less of the sphere
+            double sinTheta = sin(M_PI * ((double)y + 0.5) / (double)height);
+            double *out = &weights[y * width];
+            int x = 0;
+            for (; x + 4 <= width; x += 4) {
+                dpack4 sum = gauss[0] * load(taps[0] + x);
+                for (int g = 1; g < gaussSize; ++g) {
+                    sum = sum + gauss[g] * load(taps[g] + x);
+                }
+                store(out + x, sum * broadcast(sinTheta));
+            }
+            for (; x < width; ++x) {
+                double sum = 0;
+                for (int g = 0; g < gaussSize; ++g) {
+                    sum += gaussScalar[g] * taps[g][x];
+                }
+                out[x] = sum * sinTheta;
+            }
+            rowWeights[y] = AliasTable::buildCells(out, width, &outCells[y * width]);
+        }
+    });
+    double total = AliasTable::buildCells(rowWeights.data(), height, &outCells[size]);
+
+    double pdfScale = (double)size / (total * 2.0 * M_PI * M_PI);
+    forRows(jobManager, height, [&](int fromRow, int toRow) {
+        for (int i = fromRow * width; i < toRow * width; ++i) {
+            outPdfs[i] = (float)(weights[i] * pdfScale);
         }
-        std::swap(g_testImage, mat->hdrImage);
-    #endif
+    });
+    return contents;
 }
 
 Hit EnvMap::intersect(const Ray &r)
 {
     Hit hit;
-    hit.t = std::numeric_limits<double>::infinity();
+    hit.t = std::numeric_limits<real>::infinity();
     //hit.t = 1000;
     //hit.t = 1;
     hit.position = r.start + r.dir;
@@ -148,39 +248,31 @@ Hit EnvMap::intersect(const Ray &r)
     return hit;
 }
 
-void EnvMap::samplePoint(const dvec3 &illuminatedPoint, dvec3 &point, dvec3 &normal, int workerId)
+void EnvMap::samplePoint(const rvec3 &illuminatedPoint, rvec3 &point, rvec3 &normal, Sampler &sampler)
 {
-    double e1 = Globals::drandom(workerId);
-    double pdfs[2];
-    double fx = uDistrib.Sample(e1, &pdfs[0]);
-    int x = glm::clamp((int)fx, 0, uDistrib.count-1);
-    double e2 = Globals::drandom(workerId);
-    double fy = vDistribs[x].Sample(e2, &pdfs[1]);
-
-    double theta = fy * vDistribs[x].invCount * M_PI;
-    double phi = fx * uDistrib.invCount * 2. * M_PI;
-
-    dvec3 dir;
-    dir.x = cos(phi) * sin(theta);
-    dir.y = sin(phi) * sin(theta);
-    dir.z = cos(theta);
+    // the row from the first number, the pixel in the row from the second one, the position
+    // within the pixel from what is left of them
+    double fy, fx;
+    u32 y = AliasTable::sampleCells(&cells[width * height], height, sampler.uniform(), &fy);
+    u32 x = AliasTable::sampleCells(&cells[y * width], width, sampler.uniform(), &fx);
+
+    double theta = (y + fy) / height * M_PI;
+    double phi = (x + fx) / width * 2. * M_PI;
+
+    rvec3 dir;
+    dir.x = (real)(cos(phi) * sin(theta));
+    dir.y = (real)(sin(phi) * sin(theta));
+    dir.z = (real)cos(theta);
     point = illuminatedPoint + dir;
     normal = -dir;
 }
 
-double EnvMap::pointSampleProb(double totalPower, dvec3 dir)
+real EnvMap::pointSampleProb(real totalPower, rvec3 dir)
 {
-    double theta = acos(dir.z);
-    double phi = atan2(dir.y, dir.x);
-    if (phi < 0) {
-        phi += 2 * M_PI;
-    }
-
-    int x = glm::clamp((int)(width * phi / (2 * M_PI)), 0, (width - 1));
-    int y = glm::clamp((int)(height * theta / M_PI), 0, (height - 1));
-    double puv = (uDistrib.func[x] * vDistribs[x].func[y]) / (uDistrib.funcInt * vDistribs[x].funcInt);
-    //return puv * nu * nv / (2.0 * M_PI * M_PI * sinTheta);
-    return (power / totalPower) * puv / (2.0 * M_PI * M_PI * sin(theta));
+    const EquirectLookup &lookup = ((EnvMapMaterial *)material)->lookup;
+    double sinTheta;
+    u32 i = lookup.pixel(dvec3(dir), sinTheta);
+    return (real)((power / totalPower) * pixelPdfs[i] / sinTheta);
 }
 
 }
\ No newline at end of file
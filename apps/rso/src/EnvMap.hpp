@@ -1,45 +1,66 @@
 #ifndef RSO_ENVMAP_HPP
 #define RSO_ENVMAP_HPP
 
+#include <Resource/MappedFile.hpp>
+
+#include "AliasTable.hpp"
 #include "SceneObjs.hpp"
 
 namespace Morph {
 
-struct Distribution1D
-{
-  std::vector<double> func;
-  std::vector<double> cdf;
-  double funcInt;
-  double invFuncInt;
-  double invCount;
-  int count;
-
-  Distribution1D(){}
-  
-  Distribution1D(const std::vector<double>& f, int n);
+class JobManager;
 
-  double Sample(double u, double *pdf);
+// Layout of the cache of the sampling tables: header, cells, pixelPdfs
+struct EnvMapCacheHeader
+{
+  static constexpr array<char, 4> s_magic = {'R', 'E', 'N', 'V'};
+  static constexpr u32 s_version = 1;
 
-private:
-  void ComputeStep1dCDF();
+  array<char, 4> magic;
+  u32 version;
+  // hash of the contents of the HDR file the tables were built from
+  u64 hdrHash;
+  u32 width;
+  u32 height;
 };
 
 struct EnvMap : public Sphere
 {
   int width;
   int height;
-  std::vector<double> intensities;
-  
-  Distribution1D uDistrib;
-  std::vector<Distribution1D> vDistribs;
+  // Sampling tables, either mapped from the cache file or built and kept in memory in the same layout
+  MappedFile tables;
+  // Alias tables of the pixels of each row given the row, followed by the table of the rows.
+  // Sampling and the pdf take constant time and touch one row of a single allocation.
+  const AliasCell *cells = nullptr;
+  // probability of the pixels times width * height / (2 pi^2), the density over the solid angle
+  // in a direction is this divided by its sin(theta)
+  const float *pixelPdfs = nullptr;
 
-  EnvMap(const char* hdrFilename);
+  // The tables are cached in hdrFilename + ".envcache" and rebuilt when the HDR file changes.
+  // The preprocessing runs on the job manager when it is given.
+  EnvMap(const char* hdrFilename, JobManager *jobManager = nullptr);
 
   Hit intersect(const Ray &r) override;
 
-  void samplePoint(const dvec3 &illuminatedPoint, dvec3 &point, dvec3 &normal, int workerId) override;
+  // the environment surrounds the whole scene
+  AABB bounds() override { return AABB::infinite(); }
 
-  double pointSampleProb(double totalPower, dvec3 dir) override;
+  // not a real sphere, the packet test of Sphere does not apply
+  void intersectPacket(const RayPacket4 &packet, const mask4 &active, PacketHit4 &hit) override
+  {
+    Intersectable::intersectPacket(packet, active, hit);
+  }
+
+  void samplePoint(const rvec3 &illuminatedPoint, rvec3 &point, rvec3 &normal, Sampler &sampler) override;
+
+  real pointSampleProb(real totalPower, rvec3 dir) override;
+
+private:
+  bool loadTables(const string &cachePath, u64 hdrHash);
+  // blurred luminance of the pixels weighted by the solid angle of their rows, written into the layout of the cache
+  string buildTables(u64 hdrHash, JobManager *jobManager) const;
+  void useTables(MappedFile file);
 };
 
 }
@@ -0,0 +1,53 @@
+#include "Equirect.hpp"
+
+#define _USE_MATH_DEFINES
+#include <math.h>
+
+namespace Morph {
+
+void EquirectLookup::Axis::build(const std::vector<double> &_borders)
+{
+    borders = _borders;
+    u32 cells = (u32)borders.size() - 1;
+    // the pseudo angles stretch the angles at most twice, so two buckets per cell keep few borders in each
+    u32 buckets = 2 * cells;
+    bucketScale = buckets / borders.back();
+    firstCell.resize(buckets);
+    u32 cell = 0;
+    for (u32 b = 0; b < buckets; ++b)
+    {
+        double start = b / bucketScale;
+        while (cell + 1 < cells && start >= borders[cell + 1])
+            cell++;
+        firstCell[b] = cell;
+    }
+}
+
+void EquirectLookup::build(int _width, int _height)
+{
+    width = _width;
+    std::vector<double> borders(_width + 1);
+    for (int x = 0; x < _width; ++x)
+    {
+        double phi = 2 * M_PI * x / _width;
+        borders[x] = azimuth(cos(phi), sin(phi));
+    }
+    borders[_width] = 4;
+    // rounding of the trigonometric functions must not make the borders decrease
+    for (int x = 1; x <= _width; ++x)
+        borders[x] = std::max(borders[x], borders[x - 1]);
+    columns.build(borders);
+
+    borders.resize(_height + 1);
+    for (int y = 0; y <= _height; ++y)
+    {
+        double theta = M_PI * y / _height;
+        borders[y] = polar(cos(theta), sin(theta));
+    }
+    borders[_height] = 2;
+    for (int y = 1; y <= _height; ++y)
+        borders[y] = std::max(borders[y], borders[y - 1]);
+    rows.build(borders);
+}
+
+}
\ No newline at end of file
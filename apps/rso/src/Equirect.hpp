@@ -0,0 +1,84 @@
+#ifndef RSO_EQUIRECT_HPP
+#define RSO_EQUIRECT_HPP
+
+#include "Precision.hpp"
+
+#include <vector>
+
+namespace Morph {
+
+// Pixel of an equirectangular image seen in a direction, without acos and atan2.
+// The polar and azimuthal angles are replaced by cheap monotonic pseudo angles, the pixel
+// borders are precomputed in them and a uniform grid of buckets over the pseudo angle
+// gives the first pixel to check. Each bucket spans at most a few borders.
+class EquirectLookup
+{
+  // borders of the cells along one pseudo angle and the first cell of each bucket
+  struct Axis
+  {
+    std::vector<double> borders;
+    std::vector<u32> firstCell;
+    double bucketScale = 0;
+
+    void build(const std::vector<double> &_borders);
+
+    u32 find(double p) const
+    {
+      u32 bucket = std::min((u32)(p * bucketScale), (u32)firstCell.size() - 1);
+      u32 cell = firstCell[bucket];
+      while (cell + 2 < borders.size() && p >= borders[cell + 1])
+        cell++;
+      return cell;
+    }
+  };
+
+  Axis rows;
+  Axis columns;
+  int width = 0;
+
+public:
+  void build(int _width, int _height);
+
+  // Index x + y * width of the pixel, sinTheta is the sine of the polar angle of the direction
+  u32 pixel(const dvec3 &dir, double &sinTheta) const
+  {
+    double rho = std::sqrt(dir.x * dir.x + dir.y * dir.y);
+    sinTheta = rho;
+    return columns.find(azimuth(dir.x, dir.y)) + rows.find(polar(dir.z, rho)) * width;
+  }
+
+  u32 pixel(const dvec3 &dir) const
+  {
+    double sinTheta;
+    return pixel(dir, sinTheta);
+  }
+
+  // column and row of the pixel
+  void pixel(const dvec3 &dir, u32 &x, u32 &y) const
+  {
+    double rho = std::sqrt(dir.x * dir.x + dir.y * dir.y);
+    x = columns.find(azimuth(dir.x, dir.y));
+    y = rows.find(polar(dir.z, rho));
+  }
+
+  // pseudo angle in [0, 4) increasing with atan2(y, x) from 0 to 2 pi
+  static double azimuth(double x, double y)
+  {
+    if (x == 0 && y == 0)
+      return 0;
+    if (y >= 0)
+      return x >= 0 ? y / (x + y) : 1 - x / (y - x);
+    return x < 0 ? 2 + y / (x + y) : 3 + x / (x - y);
+  }
+
+  // pseudo angle in [0, 2] increasing with the polar angle acos(z) from 0 to pi, rho = sqrt(x^2 + y^2)
+  static double polar(double z, double rho)
+  {
+    double sum = std::abs(z) + rho;
+    return sum > 0 ? 1 - z / sum : 0;
+  }
+};
+
+}
+
+#endif // RSO_EQUIRECT_HPP
\ No newline at end of file
@@ -1,55 +1,82 @@
 #include "Globals.hpp"
 
-#include <thread>
+#include <Profile/MemoryTracker.hpp>
 
 namespace Morph {
 
 float Globals::gamma = 2.2;
 float Globals::exposure = 1.0;
-const double Globals::epsilon = 1e-9;
+const real Globals::epsilon = PrecisionTraits<real>::epsilon;
 int Globals::nTotalSamples = 600;
 int Globals::samplesPerFrame = 1;
 int Globals::currentNumSamples = 1;
 Method Globals::method = Method::BRDF;
+SamplerType Globals::sampler = SOBOL;
+PixelStorage Globals::envMapStorage = RGBE_PIXELS;
 bool Globals::useMultithreading = true;
-std::vector<RandGen> Globals::randomGenerators;
+bool Globals::usePacketTracing = true;
 uvec2 Globals::screenSize = uvec2(600, 600);
 vector2d<dvec3> Globals::radianceAccumulator;
+vector2d<PixelStats> Globals::pixelStats;
 vector2d<vec3> Globals::hdrImage;
 vector2d<vec3> Globals::ldrImage;
 float Globals::weight = 0;
+bool Globals::useAdaptiveSampling = false;
+double Globals::adaptiveThreshold = 0.02;
+int Globals::adaptiveMinSamples = 16;
+int Globals::adaptiveMaxBoost = 4;
+int Globals::maxSamples = 0;
+double Globals::frameBudget = 0;
+int Globals::maxSamplesPerFrame = 64;
+
+const char* methodName(Method method)
+{
+    switch (method)
+    {
+    case BRDF:
+        return "brdf";
+    case LIGHT_SOURCE:
+        return "light";
+    case HALF_WEIGHT:
+        return "half";
+    case MULTIPLE_IMPORTANCE:
+        return "mis";
+    case PATH_TRACING:
+        return "path";
+    }
+    return "unknown";
+}
+
+float methodWeight(Method method)
+{
+    switch (method)
+    {
+    case BRDF:
+        return 0;
+    case HALF_WEIGHT:
+    case MULTIPLE_IMPORTANCE:
+        return 0.5f;
+    default:
+        return 1;
+    }
+}
 
 void Globals::resize_image(uvec2 _screenSize)
 {
+    MORPH_MEMORY_TAG("rso.framebuffers");
     screenSize = _screenSize;
     radianceAccumulator.assign(screenSize, dvec3(0));
+    pixelStats.assign(screenSize, PixelStats());
     hdrImage.assign(screenSize, vec3(0));
     ldrImage.assign(screenSize, vec3(0));
 }
 
 void Globals::clear()
 {
-    srand(1);
     currentNumSamples = samplesPerFrame;
+    MORPH_MEMORY_TAG("rso.framebuffers");
     radianceAccumulator.assign(screenSize, dvec3(0));
-}
-
-void Globals::init()
-{
-    srand(1);
-    randomGenerators.clear();
-    for (int i = 0; i < (int)std::thread::hardware_concurrency(); ++i)
-      randomGenerators.push_back(RandGen(i + 1));
-}
-
-double Globals::drandom(int workerId)
-{
-    if (useMultithreading) {
-        std::thread::id this_id = std::this_thread::get_id();
-        return randomGenerators[workerId].Generate();
-    } else {
-        return (double)rand() / RAND_MAX;
-    }
+    pixelStats.assign(screenSize, PixelStats());
 }
 
 }
\ No newline at end of file
@@ -4,7 +4,11 @@
 #include <Morph.hpp>
 #include <Core/Arrays.hpp>
 
-#include <random>
+#include "Precision.hpp"
+#include "Sampler.hpp"
+
+#include <cmath>
+#include <limits>
 
 //#include "vec.hpp"
 
@@ -20,13 +24,47 @@ enum Method
   PATH_TRACING
 };
 
-class RandGen {
-public:
-  RandGen(int seed) : eng(seed), distr(0.0, 1.0) {}
-  double Generate() { return distr(eng); }
-private:
-  std::default_random_engine eng;
-  std::uniform_real_distribution<double> distr;
+// short name of the method, e.g. for file names and the command line
+const char* methodName(Method method);
+
+// Globals::weight of the method, the weights of the keys in the interactive app
+float methodWeight(Method method);
+
+// Pixel formats of the environment map in memory
+enum PixelStorage
+{
+  // 4 bytes, shared exponent like the Radiance files, so the pixels read from them are exact
+  RGBE_PIXELS,
+  // 6 bytes, half floats
+  HALF_PIXELS,
+  // 12 bytes, floats
+  FLOAT_PIXELS
+};
+
+// Running mean and variance of the sample luminances of a pixel (Welford's algorithm)
+struct PixelStats
+{
+  int samples = 0;
+  double mean = 0;
+  double m2 = 0;
+  // no more samples are taken for the pixel
+  bool converged = false;
+
+  void add(double value)
+  {
+    samples++;
+    double delta = value - mean;
+    mean += delta / samples;
+    m2 += delta * (value - mean);
+  }
+
+  // standard error of the pixel value relative to the value, dark pixels are judged by the absolute error
+  double relativeError() const
+  {
+    if (samples < 2)
+      return std::numeric_limits<double>::infinity();
+    return std::sqrt(m2 / ((samples - 1) * (double)samples)) / (mean + 0.01);
+  }
 };
 
 class Globals
@@ -34,27 +72,44 @@ class Globals
 public:
     static float gamma;
     static float exposure;
-    static const double epsilon;
+    static const real epsilon;
 
     static int nTotalSamples; // samples in one render iteration - should be even number
     static int samplesPerFrame;
     static int currentNumSamples;
 
     static Method method;
+    static SamplerType sampler;
+    static PixelStorage envMapStorage;
 
     static bool useMultithreading;
-    static std::vector<RandGen> randomGenerators;
+    // primary rays of 2x2 pixels are intersected together
+    static bool usePacketTracing;
     static uvec2 screenSize;
     static vector2d<dvec3> radianceAccumulator;
+    static vector2d<PixelStats> pixelStats;
     static vector2d<vec3> hdrImage;
     static vector2d<vec3> ldrImage;
     static float weight;
 
+    // pixels stop sampling once their relative error is below adaptiveThreshold, off in the window so that
+    // the image.bin references of the w key are not capped at the threshold, on in --headless and --convergence
+    static bool useAdaptiveSampling;
+    static double adaptiveThreshold;
+    // samples before a pixel may converge, guards against paths that have not found the light yet
+    static int adaptiveMinSamples;
+    // tiles above the threshold get up to this many times samplesPerFrame in an iteration
+    static int adaptiveMaxBoost;
+    // samples per pixel after which the render is finished, 0 for no limit
+    static int maxSamples;
+    // wall clock seconds of one render iteration, 0 takes every scheduled sample. With a budget the
+    // iteration stops at the deadline and samplesPerFrame adapts to fill the budget.
+    static double frameBudget;
+    // upper limit of the adapted samplesPerFrame
+    static int maxSamplesPerFrame;
+
     static void resize_image(uvec2 _screenSize);
     static void clear();
-    static void init();
-
-    static double drandom(int workerId);
 };
 
 }
@@ -0,0 +1,265 @@
+#include "Headless.hpp"
+
+#include "Image.hpp"
+#include "Scene.hpp"
+
+#include <Core/JobManager.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+namespace Morph {
+
+struct HeadlessOptions
+{
+    SceneType scene = HW1_3_SCENE;
+    const char* filename = nullptr;
+    Method method = PATH_TRACING;
+    SamplerType sampler = SOBOL;
+    uvec2 size = uvec2(600, 600);
+    int threads = 0;
+    int spp = 0;
+    double seconds = 0;
+    int samplesPerIteration = 1;
+    bool adaptive = true;
+    double threshold = 0.02;
+    // milliseconds of one iteration, 0 for no deadline
+    double frameBudget = 0;
+    std::string output = "render";
+};
+
+static void headlessUsage()
+{
+    printf("Usage: rso --headless [options]\n");
+    printf(" --scene hw1_3|hw2|hw4|mesh|spheres  test scene (hw1_3)\n");
+    printf(" --file <path>                  HDR environment map or OBJ model of the scene\n");
+    printf(" --method brdf|light|half|mis|path  sampling method (path)\n");
+    printf(" --sampler independent|sobol|halton|blue-noise  sample sequences (sobol)\n");
+    printf(" --spp <n>                      samples per pixel (64 without --time)\n");
+    printf(" --time <seconds>               wall clock budget of the rendering\n");
+    printf(" --size <width>x<height>        resolution (600x600)\n");
+    printf(" --threads <n>                  worker threads, 0 for one per hardware thread (0)\n");
+    printf(" --iteration-spp <n>            samples per pixel in one iteration (1)\n");
+    printf(" --threshold <error>            relative error of converged pixels (0.02)\n");
+    printf(" --no-adaptive                  the same number of samples in every pixel\n");
+    printf(" --frame-budget <ms>            time of one iteration like the window, adapts the iteration spp\n");
+    printf(" --output <prefix>              writes <prefix>.hdr, <prefix>.tga and <prefix>.json (render)\n");
+}
+
+std::string samplerOption(SamplerType type)
+{
+    std::string name = samplerName(type);
+    for (char& c : name)
+        if (c == ' ')
+            c = '-';
+    return name;
+}
+
+bool parseScene(const char* value, SceneType& scene)
+{
+    for (int type = HW1_3_SCENE; type <= SPHERES_SCENE; ++type)
+    {
+        if (strcmp(value, sceneName((SceneType)type)) == 0)
+        {
+            scene = (SceneType)type;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool parseMethod(const char* value, Method& method)
+{
+    for (int type = BRDF; type <= PATH_TRACING; ++type)
+    {
+        if (strcmp(value, methodName((Method)type)) == 0)
+        {
+            method = (Method)type;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool parseSampler(const char* value, SamplerType& sampler)
+{
+    for (int type = INDEPENDENT; type <= BLUE_NOISE; ++type)
+    {
+        if (samplerOption((SamplerType)type) == value)
+        {
+            sampler = (SamplerType)type;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool parseSize(const char* value, uvec2& size)
+{
+    uvec2 parsed;
+    if (sscanf(value, "%ux%u", &parsed.x, &parsed.y) != 2 || parsed.x == 0 || parsed.y == 0)
+        return false;
+    size = parsed;
+    return true;
+}
+
+bool parseThreads(const char* value, int& threads)
+{
+    int parsed;
+    if (sscanf(value, "%d", &parsed) != 1 || parsed < 0)
+        return false;
+    threads = parsed;
+    return true;
+}
+
+static bool parseOptions(int argc, char** argv, HeadlessOptions& options)
+{
+    for (int i = 0; i < argc; ++i)
+    {
+        const char* arg = argv[i];
+        if (strcmp(arg, "--no-adaptive") == 0)
+        {
+            options.adaptive = false;
+            continue;
+        }
+        if (strcmp(arg, "--help") == 0 || i + 1 >= argc)
+            return false;
+        const char* value = argv[++i];
+        bool valid = true;
+        if (strcmp(arg, "--scene") == 0)
+            valid = parseScene(value, options.scene);
+        else if (strcmp(arg, "--file") == 0)
+            options.filename = value;
+        else if (strcmp(arg, "--method") == 0)
+            valid = parseMethod(value, options.method);
+        else if (strcmp(arg, "--sampler") == 0)
+            valid = parseSampler(value, options.sampler);
+        else if (strcmp(arg, "--spp") == 0)
+            valid = sscanf(value, "%d", &options.spp) == 1 && options.spp > 0;
+        else if (strcmp(arg, "--time") == 0)
+            valid = sscanf(value, "%lf", &options.seconds) == 1 && options.seconds > 0;
+        else if (strcmp(arg, "--size") == 0)
+            valid = parseSize(value, options.size);
+        else if (strcmp(arg, "--threads") == 0)
+            valid = parseThreads(value, options.threads);
+        else if (strcmp(arg, "--iteration-spp") == 0)
+            valid = sscanf(value, "%d", &options.samplesPerIteration) == 1 && options.samplesPerIteration > 0;
+        else if (strcmp(arg, "--threshold") == 0)
+            valid = sscanf(value, "%lf", &options.threshold) == 1 && options.threshold > 0;
+        else if (strcmp(arg, "--frame-budget") == 0)
+            valid = sscanf(value, "%lf", &options.frameBudget) == 1 && options.frameBudget >= 0;
+        else if (strcmp(arg, "--output") == 0)
+            options.output = value;
+        else
+            valid = false;
+        if (!valid)
+        {
+            fprintf(stderr, "ERROR: invalid option %s %s\n", arg, value);
+            return false;
+        }
+    }
+    if (options.spp == 0 && options.seconds == 0)
+        options.spp = 64;
+    return true;
+}
+
+static bool writeReport(const std::string& filename, const HeadlessOptions& options, int workers, double buildSeconds,
+                        double renderSeconds, const std::vector<IterationStats>& iterations, size_t convergedPixels)
+{
+    FILE* file = fopen(filename.c_str(), "w");
+    if (!file)
+        return false;
+    u64 rays = 0, samples = 0;
+    for (const IterationStats& iteration : iterations)
+    {
+        rays += iteration.rays;
+        samples += iteration.samples;
+    }
+    double perSecond = renderSeconds > 0 ? 1 / renderSeconds : 0;
+    fprintf(file, "{\n");
+    fprintf(file, "  \"scene\": \"%s\",\n", sceneName(options.scene));
+    fprintf(file, "  \"method\": \"%s\",\n", methodName(options.method));
+    fprintf(file, "  \"sampler\": \"%s\",\n", samplerOption(options.sampler).c_str());
+    fprintf(file, "  \"width\": %u,\n", options.size.x);
+    fprintf(file, "  \"height\": %u,\n", options.size.y);
+    fprintf(file, "  \"threads\": %d,\n", workers);
+    fprintf(file, "  \"adaptive\": %s,\n", options.adaptive ? "true" : "false");
+    fprintf(file, "  \"spp_limit\": %d,\n", options.spp);
+    fprintf(file, "  \"time_limit_seconds\": %g,\n", options.seconds);
+    fprintf(file, "  \"frame_budget_ms\": %g,\n", options.frameBudget);
+    fprintf(file, "  \"build_seconds\": %.6f,\n", buildSeconds);
+    fprintf(file, "  \"render_seconds\": %.6f,\n", renderSeconds);
+    fprintf(file, "  \"rays\": %llu,\n", (unsigned long long)rays);
+    fprintf(file, "  \"samples\": %llu,\n", (unsigned long long)samples);
+    fprintf(file, "  \"rays_per_second\": %.1f,\n", rays * perSecond);
+    fprintf(file, "  \"samples_per_second\": %.1f,\n", samples * perSecond);
+    fprintf(file, "  \"converged_pixels\": %zu,\n", convergedPixels);
+    fprintf(file, "  \"iterations\": [");
+    for (size_t i = 0; i < iterations.size(); ++i)
+    {
+        fprintf(file, "%s\n    {\"seconds\": %.6f, \"rays\": %llu, \"samples\": %llu, \"stopped\": %s}", i > 0 ? "," : "", iterations[i].seconds,
+                (unsigned long long)iterations[i].rays, (unsigned long long)iterations[i].samples, iterations[i].stopped ? "true" : "false");
+    }
+    fprintf(file, "\n  ]\n}\n");
+    return fclose(file) == 0;
+}
+
+int runHeadless(int argc, char** argv)
+{
+    HeadlessOptions options;
+    if (!parseOptions(argc, argv, options))
+    {
+        headlessUsage();
+        return 1;
+    }
+
+    using Clock = std::chrono::steady_clock;
+    JobManager jobManager(options.threads);
+    Globals::resize_image(options.size);
+    Globals::method = options.method;
+    Globals::weight = methodWeight(options.method);
+    Globals::sampler = options.sampler;
+    Globals::samplesPerFrame = options.samplesPerIteration;
+    Globals::useAdaptiveSampling = options.adaptive;
+    Globals::adaptiveThreshold = options.threshold;
+    Globals::maxSamples = options.spp;
+    Globals::frameBudget = options.frameBudget * 1e-3;
+
+    Clock::time_point begin = Clock::now();
+    Scene scene(jobManager);
+    scene.build(options.scene, options.filename);
+    double buildSeconds = std::chrono::duration<double>(Clock::now() - begin).count();
+    Globals::clear();
+
+    std::vector<IterationStats> iterations;
+    begin = Clock::now();
+    double renderSeconds = 0;
+    while (!scene.finished() && (options.seconds == 0 || renderSeconds < options.seconds))
+    {
+        scene.renderIteration();
+        iterations.push_back(scene.lastIteration());
+        renderSeconds = std::chrono::duration<double>(Clock::now() - begin).count();
+    }
+
+    size_t convergedPixels = 0;
+    for (const PixelStats& stats : Globals::pixelStats.flattend())
+        convergedPixels += stats.converged;
+    std::string hdrFilename = options.output + ".hdr";
+    std::string tgaFilename = options.output + ".tga";
+    std::string reportFilename = options.output + ".json";
+    bool written = SaveHDR(hdrFilename.c_str(), Globals::hdrImage);
+    written = SaveTGA(tgaFilename.c_str(), Globals::ldrImage) && written;
+    written = writeReport(reportFilename, options, jobManager.GetMaxNumberOfWorkers(), buildSeconds, renderSeconds, iterations, convergedPixels) && written;
+    printf("%s %s: %zu iterations in %.2f s, %zu of %zu pixels converged\n", sceneName(options.scene), methodName(options.method),
+           iterations.size(), renderSeconds, convergedPixels, (size_t)options.size.x * options.size.y);
+    if (!written)
+    {
+        fprintf(stderr, "ERROR: cannot write %s.*\n", options.output.c_str());
+        return 1;
+    }
+    return 0;
+}
+
+}
\ No newline at end of file
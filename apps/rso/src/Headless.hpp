@@ -0,0 +1,32 @@
+#ifndef RSO_HEADLESS_HPP
+#define RSO_HEADLESS_HPP
+
+#include "Sampler.hpp"
+#include "Scene.hpp"
+
+#include <string>
+
+namespace Morph {
+
+// Batch render without a window or GL context, e.g. on machines without a display.
+// The arguments after --headless choose the scene, method, sampler, resolution, thread count
+// and a sample or time budget. Writes <output>.hdr, <output>.tga and a JSON timing report
+// <output>.json, returns non zero on bad arguments or when an output cannot be written.
+int runHeadless(int argc, char** argv);
+
+// command line name of the sampler, the spaces of samplerName are dashes
+std::string samplerOption(SamplerType type);
+
+// Option values shared by --headless, --convergence and --render-benchmark,
+// false and the result untouched when the value is not valid
+bool parseScene(const char* value, SceneType& scene);
+bool parseMethod(const char* value, Method& method);
+bool parseSampler(const char* value, SamplerType& sampler);
+// <width>x<height>, both positive
+bool parseSize(const char* value, uvec2& size);
+// 0 for one per hardware thread
+bool parseThreads(const char* value, int& threads);
+
+}
+
+#endif // RSO_HEADLESS_HPP
\ No newline at end of file
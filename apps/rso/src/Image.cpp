@@ -1,86 +1,115 @@
 #include "Image.hpp"
 
+#include <Resource/ResourceManager.hpp>
+
+#include <cmath>
+#include <cstring>
 #include <iostream>
 
 namespace Morph {
 
-double average(dvec3 v)
+static RGBE encodeRGBE(const float* rgb)
 {
-  return dot(v, dvec3(1)) / 3.0;
+    float v = std::max(rgb[0], std::max(rgb[1], rgb[2]));
+    if (!(v >= 1e-32f))
+        return {0, 0, 0, 0};
+    int e;
+    // the mantissas are rounded down like the Radiance writer does, so values read from RGBE survive exactly
+    float scale = std::frexp(v, &e) * 256.0f / v;
+    if (e + 128 > 255)
+        return {255, 255, 255, 255};
+    return {(u8)std::max(rgb[0] * scale, 0.0f), (u8)std::max(rgb[1] * scale, 0.0f), (u8)std::max(rgb[2] * scale, 0.0f), (u8)(e + 128)};
 }
 
-Image ReadHDR(const char* filename)
+// IEEE half with round to nearest even, large values become infinity and tiny ones denormals or zero
+static u16 floatToHalf(float f)
 {
-    FILE *fp;
-    fp = fopen(filename, "rb");
-
-    if (!fp) {
-        std::cout << "failed to open: " << filename << std::endl;
-        return {};
+    u32 bits;
+    memcpy(&bits, &f, 4);
+    u32 sign = (bits >> 16) & 0x8000u;
+    u32 magnitude = bits & 0x7fffffffu;
+    if (magnitude >= 0x7f800000u)
+        return (u16)(sign | 0x7c00u | (magnitude > 0x7f800000u ? 0x200u : 0));
+    if (magnitude >= 0x477ff000u)
+        return (u16)(sign | 0x7c00u);
+    if (magnitude < 0x38800000u)
+    {
+        // denormal half, the float is rounded at the position of the last half bit
+        float denormal;
+        u32 absBits = magnitude;
+        memcpy(&denormal, &absBits, 4);
+        return (u16)(sign | (u32)std::nearbyint(denormal * 16777216.0f));
     }
+    u32 rounded = magnitude + 0xfffu + ((magnitude >> 13) & 1u) - 0x38000000u;
+    return (u16)(sign | (rounded >> 13));
+}
 
-    char programtype[20];
-    float gamma;
-    float exposure;
-    char format[20];
-    int height;
-    int width;
-    if (fscanf(fp, "#?%s\n", programtype) < 0)
-        abort();
-    if (fscanf(fp, "GAMMA=%g\n", &gamma) < 0)
-        abort();
-    if (fscanf(fp, "EXPOSURE=%g\n", &exposure) < 0)
-        abort();
-    if (fscanf(fp, "FORMAT=%s\n\n", format) < 0)
-        abort();
-    if (fscanf(fp, "-Y %d +X %d\n", &height, &width) < 0)
-        abort();
-
-    size_t count = width * height;
-    std::vector<RGBE> data;
-    data.resize(count);
-
-    std::vector<dvec3> image;
-    image.resize(count);
-
-    size_t kk = fread(data.data(), (size_t)4, count, fp);
-
-    const bool flipY = true;
+const float* const Image::rgbeScale = ResourceManager::RGBEScales().data();
 
-    for (int i = 0; i < count; ++i)
+Image::Image(const float* rgb, int _width, int _height, PixelStorage _storage)
+    : width(_width), height(_height), storage(_storage)
+{
+    bytes = storage == RGBE_PIXELS ? 4 : storage == HALF_PIXELS ? 6 : 12;
+    size_t count = (size_t)width * height;
+    data.resize(count * bytes);
+    for (size_t i = 0; i < count; ++i)
     {
-        const RGBE& rgbe = data[i];
-        int x = i % width;
-        int y = flipY ? ((height - 1) - (i / width)) : (i / width);
-        dvec3& col = image[x + y * width];
-
-        int e = (int)rgbe.e - 128;
-        float maxRGB = std::max(rgbe.r, std::max(rgbe.g, rgbe.b));
-        // maxRGB = maxV * v = maxV * frexp(maxV, &e) * 256 / maxV = frexp(maxV, &e) * 256
-        // frexp(maxV, &e) = maxRGB / 256
-        float frexp_maxV_e = maxRGB / 256.0f;
-        // maxV = frexp_maxV_e * 2^e
-        float maxV = frexp_maxV_e * powf(2, e);
-        // maxRGB = maxV * v
-        float v = maxRGB / maxV;
-
-        if (maxV != 0) {
-            col.x = rgbe.r / v;
-            col.y = rgbe.g / v;
-            col.z = rgbe.b / v;
-        } else {
-            col.x = 0;
-            col.y = 0;
-            col.z = 0;
+        const float* in = rgb + i * 3;
+        u8* out = &data[i * bytes];
+        switch (storage)
+        {
+        case RGBE_PIXELS:
+        {
+            RGBE rgbe = encodeRGBE(in);
+            memcpy(out, &rgbe, 4);
+            break;
+        }
+        case HALF_PIXELS:
+        {
+            u16 half[3] = {floatToHalf(in[0]), floatToHalf(in[1]), floatToHalf(in[2])};
+            memcpy(out, half, 6);
+            break;
+        }
+        case FLOAT_PIXELS:
+            memcpy(out, in, 12);
+            break;
         }
     }
+}
 
-    fclose(fp);
+Image::Image(std::vector<u8>&& rgbe, int _width, int _height)
+    : width(_width), height(_height), storage(RGBE_PIXELS), data(std::move(rgbe)), bytes(4)
+{
+}
 
-    return {image, width, height};
+const char* pixelStorageName(PixelStorage storage)
+{
+    switch (storage)
+    {
+    case RGBE_PIXELS:
+        return "rgbe";
+    case HALF_PIXELS:
+        return "half";
+    case FLOAT_PIXELS:
+        return "float";
+    }
+    return "unknown";
+}
+
+Image ReadHDR(const char* filename, PixelStorage storage, JobManager* jobManager)
+{
+    opt<Image2D> hdr = storage == RGBE_PIXELS ? ResourceManager::LoadImage2D_HDR_RGBE(filename, jobManager)
+                                              : ResourceManager::LoadImage2D_HDR(filename, jobManager);
+    if (!hdr) {
+        std::cerr << "failed to read: " << filename << std::endl;
+        return {};
+    }
+    if (storage == RGBE_PIXELS)
+        return Image(std::move(hdr->data), hdr->dim.x, hdr->dim.y);
+    return Image((const float*)hdr->data.data(), hdr->dim.x, hdr->dim.y, storage);
 }
 
-void SaveHDR(const char* filename, const vector2d<vec3>& inImage)
+bool SaveHDR(const char* filename, const vector2d<vec3>& inImage)
 {
   FILE *fp;
   fp = fopen(filename, "wb");
@@ -150,15 +179,16 @@ void SaveHDR(const char* filename, const vector2d<vec3>& inImage)
       abort(); // error
     }
   }
+  return fp != nullptr;
 }
 
-void SaveTGA(const char* filename, const vector2d<vec3>& inImage)
+bool SaveTGA(const char* filename, const vector2d<vec3>& inImage)
 {
   // Save TGA file for the image, simple format
   FILE *ofile = 0;
   ofile = fopen(filename, "wb");
   if (!ofile)
-    return;
+    return false;
 
   fputc(0, ofile);
   fputc(0, ofile);
@@ -191,6 +221,7 @@ void SaveTGA(const char* filename, const vector2d<vec3>& inImage)
     }
   }
   fclose(ofile);
+  return true;
 }
 
 }
\ No newline at end of file
@@ -3,27 +3,95 @@
 
 #include "Globals.hpp"
 
+#include <cmath>
+#include <cstring>
+#include <limits>
+
 namespace Morph {
 
-double average(dvec3 v);
+class JobManager;
+
+template<typename T>
+T average(const tvec3<T> &v)
+{
+  return (v.x + v.y + v.z) / T(3);
+}
 
 struct RGBE
 {
   unsigned char r, g, b, e;
 };
 
+// Image kept in one of the compact pixel formats and decoded on every lookup, rows one after another
 struct Image
 {
-  std::vector<dvec3> data;
-  int width;
-  int height;
+  int width = 0;
+  int height = 0;
+  PixelStorage storage = FLOAT_PIXELS;
+  std::vector<u8> data;
+
+  Image() {}
+  // rgb holds width * height float triplets row after row
+  Image(const float* rgb, int _width, int _height, PixelStorage _storage);
+  // RGBE_PIXELS taking over width * height RGBE quadruplets row after row
+  Image(std::vector<u8>&& rgbe, int _width, int _height);
+
+  dvec3 pixel(int x, int y) const
+  {
+    const u8* p = &data[((size_t)y * width + x) * bytes];
+    switch (storage)
+    {
+    case RGBE_PIXELS:
+    {
+      double scale = rgbeScale[p[3]];
+      return dvec3(p[0] * scale, p[1] * scale, p[2] * scale);
+    }
+    case HALF_PIXELS:
+    {
+      u16 half[3];
+      memcpy(half, p, 6);
+      return dvec3(halfToFloat(half[0]), halfToFloat(half[1]), halfToFloat(half[2]));
+    }
+    default:
+    {
+      float rgb[3];
+      memcpy(rgb, p, 12);
+      return dvec3(rgb[0], rgb[1], rgb[2]);
+    }
+    }
+  }
+
+  size_t bytesPerPixel() const { return bytes; }
+
+private:
+  // ResourceManager::RGBEScales, the value of a mantissa of 1 for every exponent byte
+  static const float* const rgbeScale;
+
+  size_t bytes = 12;
+
+  // the half bits moved into a float are the value scaled by 2^-112, denormals included, NaNs become infinity
+  static float halfToFloat(u16 h)
+  {
+    u32 bits = (u32)(h & 0x7fffu) << 13;
+    float f;
+    memcpy(&f, &bits, 4);
+    f *= 0x1p112f;
+    if (bits >= 0x0f800000u)
+      f = std::numeric_limits<float>::infinity();
+    return (h & 0x8000u) ? -f : f;
+  }
 };
 
-Image ReadHDR(const char* filename);
+const char* pixelStorageName(PixelStorage storage);
+
+// rows bottom-up, the scanlines are decoded on the job manager when it is given. RGBE storage keeps the
+// pixels of the file as they are, the other storages go through a float image of 12 bytes per pixel.
+Image ReadHDR(const char* filename, PixelStorage storage, JobManager* jobManager = nullptr);
 
-void SaveHDR(const char* filename, const vector2d<vec3>& inImage);
+// false when the file cannot be created
+bool SaveHDR(const char* filename, const vector2d<vec3>& inImage);
 
-void SaveTGA(const char* filename, const vector2d<vec3>& inImage);
+bool SaveTGA(const char* filename, const vector2d<vec3>& inImage);
 
 }
 
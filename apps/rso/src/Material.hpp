@@ -1,40 +1,133 @@
 #ifndef RSO_MATERIAL_HPP
 #define RSO_MATERIAL_HPP
 
+#include "Equirect.hpp"
 #include "Image.hpp"
 
 namespace Morph {
 
+// Max-Phong BRDF kernels, instantiated for the renderer precision and by the precision benchmark
+
+// Evaluate the BRDF given normal, view direction (outgoing) and light direction (incoming)
+template<typename T>
+tvec3<T> phongBRDF(const tvec3<T> &N, const tvec3<T> &V, const tvec3<T> &L,
+                   const tvec3<T> &diffuseAlbedo, const tvec3<T> &specularAlbedo, T shininess)
+{
+  tvec3<T> brdf(0);
+  T cosThetaL = dot(N, L);
+  T cosThetaV = dot(N, V);
+  if (cosThetaL <= PrecisionTraits<T>::epsilon || cosThetaV <= PrecisionTraits<T>::epsilon)
+    return brdf;
+  brdf = diffuseAlbedo / glm::pi<T>(); // diffuse part
+  tvec3<T> R = N * (cosThetaL * T(2)) - L;
+  T cosPhi = dot(V, R);
+  if (cosPhi <= 0)
+    return brdf; // farther by PI/2 from reflected direction
+  // max-Phong specular BRDF: symmetric and energy conserving
+  return brdf + specularAlbedo * ((shininess + 1) / 2 / glm::pi<T>() * std::pow(cosPhi, shininess) / std::max(cosThetaL, cosThetaV));
+}
+
+// BRDF.cos(theta) importance sampling from two uniform random numbers, false when the sample is absorbed
+template<typename T>
+bool phongSampleDirection(const tvec3<T> &N, const tvec3<T> &V, T e1, T e2,
+                          const tvec3<T> &diffuseAlbedo, const tvec3<T> &specularAlbedo, T shininess, tvec3<T> &L)
+{
+  const T epsilon = PrecisionTraits<T>::epsilon;
+  L = tvec3<T>(0);
+  T avgDiffAlbedo = average(diffuseAlbedo);
+  if (e1 < avgDiffAlbedo) // sample diffuse
+  {
+    T length = std::sqrt(N.x * N.x + N.y * N.y);
+    tvec3<T> Tn;
+    if (std::abs(N.x) > epsilon && std::abs(N.y) > epsilon) {
+      Tn = tvec3<T>(N.y / length, -N.x / length, 0);
+    } else if (std::abs(N.y) > epsilon) {
+      length = std::sqrt(N.y * N.y + N.z * N.z);
+      Tn = tvec3<T>(0, -N.z / length, N.y / length);
+    } else {
+      length = std::sqrt(N.x * N.x + N.z * N.z);
+      Tn = tvec3<T>(-N.z / length, 0, N.x / length);
+    }
+    tvec3<T> B = cross(N, Tn);
+
+    e1 = e1 / avgDiffAlbedo;
+
+    // compute diffuse sample
+    T sqrt1me1 = std::sqrt(1 - e1);
+    T x = sqrt1me1 * std::cos(2 * glm::pi<T>() * e2);
+    T y = sqrt1me1 * std::sin(2 * glm::pi<T>() * e2);
+    T z = std::sqrt(e1);
+
+    L = Tn * x + B * y + N * z;
+    return dot(N, L) >= 0;
+  }
+  T avgSpecAlbedo = average(specularAlbedo);
+  if (e1 < avgDiffAlbedo + avgSpecAlbedo)
+  {
+    tvec3<T> R = N * (2 * dot(V, N)) - V;
+
+    tvec3<T> B = cross(N, R);
+    tvec3<T> Tn = cross(R, B);
+
+    e1 = (e1 - avgDiffAlbedo) / avgSpecAlbedo;
+
+    T sqrt1mPow = std::sqrt(1 - std::pow(e1, 2 / (shininess + 1)));
+    T x = sqrt1mPow * std::cos(2 * glm::pi<T>() * e2);
+    T y = sqrt1mPow * std::sin(2 * glm::pi<T>() * e2);
+    T z = std::pow(e1, 1 / (shininess + 1));
+
+    L = Tn * x + B * y + R * z;
+    return dot(N, L) >= 0;
+  }
+  // otherwise the contribution is 0
+  return false;
+}
+
+// Evaluate the probability density of phongSampleDirection
+template<typename T>
+T phongSampleProb(const tvec3<T> &N, const tvec3<T> &V, const tvec3<T> &L,
+                  const tvec3<T> &diffuseAlbedo, const tvec3<T> &specularAlbedo, T shininess)
+{
+  tvec3<T> R = N * (2 * dot(L, N)) - L;
+  T cosAlpha = dot(V, R);
+  T cosTheta = dot(N, L);
+  if (cosTheta <= 0 || cosAlpha <= 0)
+    return 0;
+  T probDiffuse = average(diffuseAlbedo) * cosTheta / glm::pi<T>();
+  T probSpecular = average(specularAlbedo) * (shininess + 1) * std::pow(cosAlpha, shininess) / (2 * glm::pi<T>());
+  return probDiffuse + probSpecular;
+}
+
 // The definition of material surface (BRDF + emission)
 struct Material
 {
-  dvec3 Le = dvec3(0);             // the emmited power
-  dvec3 diffuseAlbedo = dvec3(0);  // albedo for diffuse component
-  dvec3 specularAlbedo = dvec3(0); // albedo for specular component
-  double shininess = 0;
+  rvec3 Le = rvec3(0);             // the emmited power
+  rvec3 diffuseAlbedo = rvec3(0);  // albedo for diffuse component
+  rvec3 specularAlbedo = rvec3(0); // albedo for specular component
+  real shininess = 0;
 
   Material() { shininess = 0; }
 
   // Evaluate the BRDF given normal, view direction (outgoing) and light direction (incoming)
-  dvec3 BRDF(const dvec3 &N, const dvec3 &V, const dvec3 &L);
+  rvec3 BRDF(const rvec3 &N, const rvec3 &V, const rvec3 &L);
   // BRDF.cos(theta) importance sampling for input normal, outgoing direction
-  bool sampleDirection(const dvec3 &N, const dvec3 &V, dvec3 &L, int workerId);
+  bool sampleDirection(const rvec3 &N, const rvec3 &V, rvec3 &L, Sampler &sampler);
   // Evaluate the probability given input normal, view (outgoing) direction and incoming light direction
-  double sampleProb(const dvec3 &N, const dvec3 &V, const dvec3 &L);
+  real sampleProb(const rvec3 &N, const rvec3 &V, const rvec3 &L);
 
-  virtual dvec3 getLe(dvec3 dir) const { return Le; }
+  virtual rvec3 getLe(rvec3 dir) const { return Le; }
 };
 
 // Material used for light source
 struct LightMaterial : Material
 {
-  LightMaterial(dvec3 _Le) { Le = _Le; }
+  LightMaterial(rvec3 _Le) { Le = _Le; }
 };
 
 // Material used for objects, given how much is reflective/shiny
 struct TableMaterial : Material
 {
-  TableMaterial(double shine, const dvec3& diff, const dvec3& spec)
+  TableMaterial(real shine, const rvec3& diff, const rvec3& spec)
   {
     shininess = shine;
     diffuseAlbedo = diff;
@@ -45,16 +138,15 @@ struct TableMaterial : Material
 struct EnvMapMaterial : public Material
 {
   Image hdrImage;
+  // pixel of hdrImage in a direction
+  EquirectLookup lookup;
 
-  EnvMapMaterial(const char* hdrFilename);
+  EnvMapMaterial(const char* hdrFilename, JobManager* jobManager = nullptr);
 
-  dvec3 getLe(dvec3 dir) const override;
+  rvec3 getLe(rvec3 dir) const override;
 
-  dvec3& getLeRef(dvec3 dir);
 private:
-  dvec3 sample(int x, int y) const;
-
-  dvec3 sampleBilinear(double x, double y) const;
+  dvec3 sample(int x, int y) const { return hdrImage.pixel(x, y); }
 };
 
 }
@@ -0,0 +1,41 @@
+#ifndef RSO_PRECISION_HPP
+#define RSO_PRECISION_HPP
+
+#include <Morph.hpp>
+
+namespace Morph {
+
+template<typename T>
+using tvec3 = glm::vec<3, T, glm::defaultp>;
+
+// Tolerances which depend on the scalar type of the ray tracing kernels
+template<typename T>
+struct PrecisionTraits;
+
+template<>
+struct PrecisionTraits<double>
+{
+  // minimal distance of a hit and threshold for small cosines and albedos
+  static constexpr double epsilon = 1e-9;
+  // offset of rays leaving a surface relative to the size of the object
+  static constexpr double relativeOffset = 1e-7;
+};
+
+template<>
+struct PrecisionTraits<float>
+{
+  static constexpr float epsilon = 1e-4f;
+  static constexpr float relativeOffset = 1e-4f;
+};
+
+// Scalar type of the renderer, accumulation of the radiance over samples stays in double
+#ifdef RSO_FLOAT_PRECISION
+using real = float;
+#else
+using real = double;
+#endif
+using rvec3 = tvec3<real>;
+
+}
+
+#endif // RSO_PRECISION_HPP
\ No newline at end of file
@@ -0,0 +1,509 @@
+#include "PrecisionBenchmark.hpp"
+
+#include "SceneObjs.hpp"
+#include "TriangleMesh.hpp"
+
+#include <Resource/Generated.hpp>
+
+#include <chrono>
+#include <random>
+
+namespace Morph {
+
+using BenchmarkClock = std::chrono::steady_clock;
+
+static double secondsSince(BenchmarkClock::time_point begin)
+{
+    return std::chrono::duration<double>(BenchmarkClock::now() - begin).count();
+}
+
+// runs test(i) over all the inputs repeatedly for at least minSeconds, returns operations per second
+template<typename F>
+static double measureRate(size_t count, size_t operationsPerInput, double minSeconds, F test)
+{
+    size_t done = 0;
+    double sink = 0;
+    BenchmarkClock::time_point begin = BenchmarkClock::now();
+    double elapsed = 0;
+    do
+    {
+        for (size_t i = 0; i < count; ++i)
+            sink += test(i);
+        done += count * operationsPerInput;
+        elapsed = secondsSince(begin);
+    } while (elapsed < minSeconds);
+    // keeps the compiler from dropping the tests
+    if (sink == 0.123456789)
+        printf(" ");
+    return done / elapsed;
+}
+
+// error of the float results relative to the double reference
+struct PrecisionError
+{
+    double maxRelative = 0;
+    double sumRelative = 0;
+    size_t count = 0;
+    // results of a different kind, e.g. a hit in one precision and a miss in the other
+    size_t mismatches = 0;
+
+    void add(double reference, double value)
+    {
+        double relative = std::abs(value - reference) / std::max(std::abs(reference), 1e-12);
+        maxRelative = std::max(maxRelative, relative);
+        sumRelative += relative;
+        count++;
+    }
+    double meanRelative() const { return count > 0 ? sumRelative / count : 0; }
+};
+
+static void printRow(const char *kernel, double doubleRate, double floatRate, const PrecisionError &error)
+{
+    printf("%-10s %16.0f %16.0f %9.2fx %12.2e %12.2e %10zu\n", kernel, doubleRate, floatRate, floatRate / doubleRate,
+           error.meanRelative(), error.maxRelative, error.mismatches);
+    fflush(stdout);
+}
+
+static dvec3 randomDirection(std::mt19937 &rng)
+{
+    std::uniform_real_distribution<double> direction(-1, 1);
+    while (true)
+    {
+        dvec3 dir(direction(rng), direction(rng), direction(rng));
+        double len2 = dot(dir, dir);
+        if (len2 <= 1 && len2 > 1e-6)
+            return dir / std::sqrt(len2);
+    }
+}
+
+template<typename T>
+static std::vector<RayT<T>> convertRays(const std::vector<RayT<double>> &rays)
+{
+    std::vector<RayT<T>> result(rays.size());
+    for (size_t i = 0; i < rays.size(); ++i)
+    {
+        result[i].start = tvec3<T>(rays[i].start);
+        result[i].dir = tvec3<T>(rays[i].dir);
+    }
+    return result;
+}
+
+// Spheres converted to the kernel precision
+template<typename T>
+struct SphereSet
+{
+    std::vector<tvec3<T>> centers;
+    std::vector<T> radii;
+
+    SphereSet(const std::vector<dvec3> &_centers, const std::vector<double> &_radii)
+    {
+        for (size_t i = 0; i < _centers.size(); ++i)
+        {
+            centers.push_back(tvec3<T>(_centers[i]));
+            radii.push_back((T)_radii[i]);
+        }
+    }
+
+    // closest sphere further than epsilon ignoring the skip sphere, -1 when the ray misses all
+    int nearest(const RayT<T> &ray, int skip, T &tNearest) const
+    {
+        int index = -1;
+        for (int s = 0; s < (int)centers.size(); ++s)
+        {
+            if (s == skip)
+                continue;
+            T t = intersectSphere(centers[s], radii[s], ray);
+            if (t > PrecisionTraits<T>::epsilon && (index < 0 || t < tNearest))
+            {
+                tNearest = t;
+                index = s;
+            }
+        }
+        return index;
+    }
+};
+
+static void benchmarkSpheres(double minSeconds)
+{
+    const int sphereCount = 64;
+    const size_t rayCount = 4096;
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<double> position(0, 20);
+    std::uniform_real_distribution<double> radius(0.5, 2);
+    std::vector<dvec3> centers;
+    std::vector<double> radii;
+    for (int i = 0; i < sphereCount; ++i)
+    {
+        centers.push_back(dvec3(position(rng), position(rng), position(rng)));
+        radii.push_back(radius(rng));
+    }
+    std::vector<RayT<double>> rays;
+    for (size_t i = 0; i < rayCount; ++i)
+        rays.push_back(RayT<double>(dvec3(position(rng), position(rng), position(rng)), randomDirection(rng)));
+
+    SphereSet<double> spheresD(centers, radii);
+    SphereSet<float> spheresF(centers, radii);
+    std::vector<RayT<float>> raysF = convertRays<float>(rays);
+
+    PrecisionError error;
+    for (size_t i = 0; i < rayCount; ++i)
+    {
+        double tD = 0;
+        float tF = 0;
+        int hitD = spheresD.nearest(rays[i], -1, tD);
+        int hitF = spheresF.nearest(raysF[i], -1, tF);
+        if (hitD != hitF)
+            error.mismatches++;
+        else if (hitD >= 0)
+            error.add(tD, tF);
+    }
+    double doubleRate = measureRate(rayCount, sphereCount, minSeconds, [&](size_t i) { double t = 0; return spheresD.nearest(rays[i], -1, t) + t; });
+    double floatRate = measureRate(rayCount, sphereCount, minSeconds, [&](size_t i) { float t = 0; return spheresF.nearest(raysF[i], -1, t) + t; });
+    printRow("sphere", doubleRate, floatRate, error);
+}
+
+template<typename T>
+static int countBoxHits(const std::vector<AABBT<T>> &boxes, const RayT<T> &ray)
+{
+    tvec3<T> invDir = tvec3<T>(1) / ray.dir;
+    int hits = 0;
+    for (const AABBT<T> &box : boxes)
+        hits += intersectBox(box, ray.start, invDir, std::numeric_limits<T>::infinity()) ? 1 : 0;
+    return hits;
+}
+
+static void benchmarkBoxes(double minSeconds)
+{
+    const int boxCount = 64;
+    const size_t rayCount = 4096;
+    std::mt19937 rng(2);
+    std::uniform_real_distribution<double> position(0, 20);
+    std::uniform_real_distribution<double> size(0.5, 4);
+    std::vector<AABBT<double>> boxesD;
+    std::vector<AABBT<float>> boxesF;
+    for (int i = 0; i < boxCount; ++i)
+    {
+        dvec3 pMin(position(rng), position(rng), position(rng));
+        dvec3 pMax = pMin + dvec3(size(rng), size(rng), size(rng));
+        boxesD.push_back(AABBT<double>(pMin, pMax));
+        boxesF.push_back(AABBT<float>(vec3(pMin), vec3(pMax)));
+    }
+    std::vector<RayT<double>> rays;
+    for (size_t i = 0; i < rayCount; ++i)
+        rays.push_back(RayT<double>(dvec3(position(rng), position(rng), position(rng)), randomDirection(rng)));
+    std::vector<RayT<float>> raysF = convertRays<float>(rays);
+
+    // the slab test only answers hit or miss, float boxes are rounded so only the disagreements are counted
+    PrecisionError error;
+    for (size_t i = 0; i < rayCount; ++i)
+        error.mismatches += std::abs(countBoxHits(boxesD, rays[i]) - countBoxHits(boxesF, raysF[i]));
+    double doubleRate = measureRate(rayCount, boxCount, minSeconds, [&](size_t i) { return countBoxHits(boxesD, rays[i]); });
+    double floatRate = measureRate(rayCount, boxCount, minSeconds, [&](size_t i) { return countBoxHits(boxesF, raysF[i]); });
+    printRow("box", doubleRate, floatRate, error);
+}
+
+// closest triangle by testing all of them, negative when the ray misses the mesh
+template<typename T>
+static T nearestTriangle(const std::vector<MeshTriangle> &triangles, const RayT<T> &ray)
+{
+    WatertightRayT<T> wray(ray.dir);
+    T tMax = std::numeric_limits<T>::infinity();
+    for (const MeshTriangle &tri : triangles)
+    {
+        T t, b1, b2;
+        if (intersectTriangle(tri, ray.start, wray, PrecisionTraits<T>::epsilon, tMax, t, b1, b2))
+            tMax = t;
+    }
+    return std::isinf(tMax) ? -1 : tMax;
+}
+
+static int benchmarkTriangles(double minSeconds)
+{
+    const size_t rayCount = 2048;
+    IndexedVerticesMesh3D<u32> mesh = GeneratedResources::Sphere(128, 64, 1.0f);
+    std::vector<MeshTriangle> triangles(mesh.indices.size() / 3);
+    for (size_t i = 0; i < triangles.size(); ++i)
+    {
+        triangles[i].v0 = mesh.vertices[mesh.indices[3 * i]].position;
+        triangles[i].v1 = mesh.vertices[mesh.indices[3 * i + 1]].position;
+        triangles[i].v2 = mesh.vertices[mesh.indices[3 * i + 2]].position;
+        triangles[i].index = (u32)i;
+    }
+
+    std::mt19937 rng(3);
+    std::vector<RayT<double>> rays, insideRays;
+    for (size_t i = 0; i < rayCount; ++i)
+    {
+        dvec3 start = randomDirection(rng) * 3.0;
+        dvec3 target = randomDirection(rng) * 1.2;
+        rays.push_back(RayT<double>(start, target - start));
+        insideRays.push_back(RayT<double>(randomDirection(rng) * 0.5, randomDirection(rng)));
+    }
+    std::vector<RayT<float>> raysF = convertRays<float>(rays);
+    std::vector<RayT<float>> insideRaysF = convertRays<float>(insideRays);
+
+    PrecisionError error;
+    int leaksD = 0, leaksF = 0;
+    for (size_t i = 0; i < rayCount; ++i)
+    {
+        double tD = nearestTriangle(triangles, rays[i]);
+        float tF = nearestTriangle(triangles, raysF[i]);
+        if ((tD < 0) != (tF < 0))
+            error.mismatches++;
+        else if (tD > 0)
+            error.add(tD, tF);
+        leaksD += nearestTriangle(triangles, insideRays[i]) < 0 ? 1 : 0;
+        leaksF += nearestTriangle(triangles, insideRaysF[i]) < 0 ? 1 : 0;
+    }
+    double doubleRate = measureRate(rayCount, triangles.size(), minSeconds, [&](size_t i) { return nearestTriangle(triangles, rays[i]); });
+    double floatRate = measureRate(rayCount, triangles.size(), minSeconds, [&](size_t i) { return nearestTriangle(triangles, raysF[i]); });
+    printRow("triangle", doubleRate, floatRate, error);
+    printf("%-10s %16d %16d %10s %12s %12s %10s\n", "leaks", leaksD, leaksF, "", "", "", "");
+    return leaksD + leaksF;
+}
+
+// Phong lobe parameters and directions of one BRDF evaluation
+struct BRDFInput
+{
+    dvec3 N, V, L;
+    dvec3 diffuseAlbedo, specularAlbedo;
+    double shininess;
+    double e1, e2;
+};
+
+template<typename T>
+static T evaluateBRDF(const BRDFInput &in)
+{
+    tvec3<T> N(in.N), V(in.V), L(in.L), kd(in.diffuseAlbedo), ks(in.specularAlbedo);
+    T shininess = (T)in.shininess;
+    return average(phongBRDF(N, V, L, kd, ks, shininess)) + phongSampleProb(N, V, L, kd, ks, shininess);
+}
+
+// cosine of the sampled direction, negative when the sample is absorbed
+template<typename T>
+static T sampleBRDF(const BRDFInput &in)
+{
+    tvec3<T> N(in.N), V(in.V), kd(in.diffuseAlbedo), ks(in.specularAlbedo), L;
+    if (!phongSampleDirection(N, V, (T)in.e1, (T)in.e2, kd, ks, (T)in.shininess, L))
+        return -1;
+    return dot(N, L);
+}
+
+static void benchmarkBRDF(double minSeconds)
+{
+    const size_t inputCount = 4096;
+    std::mt19937 rng(4);
+    std::uniform_real_distribution<double> uniform(0, 1);
+    std::vector<BRDFInput> inputs(inputCount);
+    for (BRDFInput &in : inputs)
+    {
+        in.N = randomDirection(rng);
+        in.V = randomDirection(rng);
+        in.L = randomDirection(rng);
+        // directions on the hemisphere of the normal
+        if (dot(in.N, in.V) < 0)
+            in.V = -in.V;
+        if (dot(in.N, in.L) < 0)
+            in.L = -in.L;
+        double diffuse = uniform(rng);
+        in.diffuseAlbedo = dvec3(diffuse);
+        in.specularAlbedo = dvec3((1 - diffuse) * uniform(rng));
+        // shininess of the test scenes spans 500 to 10000
+        in.shininess = std::pow(10.0, 1 + 3 * uniform(rng));
+        in.e1 = uniform(rng);
+        in.e2 = uniform(rng);
+    }
+
+    PrecisionError evalError, sampleError;
+    for (const BRDFInput &in : inputs)
+    {
+        double valueD = evaluateBRDF<double>(in);
+        if (valueD > 0)
+            evalError.add(valueD, evaluateBRDF<float>(in));
+        double cosD = sampleBRDF<double>(in);
+        double cosF = sampleBRDF<float>(in);
+        if ((cosD < 0) != (cosF < 0))
+            sampleError.mismatches++;
+        else if (cosD > 0)
+            sampleError.add(cosD, cosF);
+    }
+    printRow("brdf", measureRate(inputCount, 1, minSeconds, [&](size_t i) { return evaluateBRDF<double>(inputs[i]); }),
+             measureRate(inputCount, 1, minSeconds, [&](size_t i) { return evaluateBRDF<float>(inputs[i]); }), evalError);
+    printRow("sample", measureRate(inputCount, 1, minSeconds, [&](size_t i) { return sampleBRDF<double>(inputs[i]); }),
+             measureRate(inputCount, 1, minSeconds, [&](size_t i) { return sampleBRDF<float>(inputs[i]); }), sampleError);
+}
+
+// Small scene of the homework 4 spheres with one spherical light
+struct DirectLightingScene
+{
+    std::vector<dvec3> centers;
+    std::vector<double> radii;
+    std::vector<dvec3> diffuseAlbedo;
+    std::vector<dvec3> specularAlbedo;
+    std::vector<double> shininess;
+    int light = 0;
+    dvec3 Le = dvec3(20, 10, 5);
+    std::vector<RayT<double>> cameraRays;
+    std::vector<double> randoms;
+    int samples = 0;
+
+    void add(const dvec3 &center, double radius, const dvec3 &kd, const dvec3 &ks, double shine)
+    {
+        centers.push_back(center);
+        radii.push_back(radius);
+        diffuseAlbedo.push_back(kd);
+        specularAlbedo.push_back(ks);
+        shininess.push_back(shine);
+    }
+};
+
+// Direct lighting by BRDF sampling with the kernels of precision T, the samples are summed in double.
+// A loop over the kernels alone, the renderer itself is compared by running --render-benchmark
+// and --headless in the double and the float build.
+template<typename T>
+static std::vector<double> renderDirectLighting(const DirectLightingScene &scene)
+{
+    SphereSet<T> spheres(scene.centers, scene.radii);
+    std::vector<RayT<T>> rays = convertRays<T>(scene.cameraRays);
+    std::vector<double> image(rays.size(), 0);
+    for (size_t p = 0; p < rays.size(); ++p)
+    {
+        T t = 0;
+        int hit = spheres.nearest(rays[p], -1, t);
+        if (hit < 0)
+            continue;
+        if (hit == scene.light)
+        {
+            image[p] = average(scene.Le);
+            continue;
+        }
+        tvec3<T> position = rays[p].start + rays[p].dir * t;
+        tvec3<T> N = (position - spheres.centers[hit]) / spheres.radii[hit];
+        tvec3<T> V = -rays[p].dir;
+        tvec3<T> kd(scene.diffuseAlbedo[hit]), ks(scene.specularAlbedo[hit]);
+        T shininess = (T)scene.shininess[hit];
+        dvec3 radiance(0);
+        for (int s = 0; s < scene.samples; ++s)
+        {
+            const double *e = &scene.randoms[2 * (p * scene.samples + s)];
+            tvec3<T> L;
+            if (!phongSampleDirection(N, V, (T)e[0], (T)e[1], kd, ks, shininess, L))
+                continue;
+            T pdf = phongSampleProb(N, V, L, kd, ks, shininess);
+            T cosTheta = dot(N, L);
+            if (pdf <= 0 || cosTheta <= 0)
+                continue;
+            RayT<T> shadowRay;
+            shadowRay.start = position;
+            shadowRay.dir = L;
+            T tLight = 0;
+            if (spheres.nearest(shadowRay, hit, tLight) != scene.light)
+                continue;
+            radiance += dvec3(phongBRDF(N, V, L, kd, ks, shininess) * (cosTheta / pdf));
+        }
+        image[p] = average(radiance * scene.Le) / scene.samples;
+    }
+    return image;
+}
+
+static int benchmarkDirectLighting(double minSeconds)
+{
+    const int resolution = 128;
+    DirectLightingScene scene;
+    scene.samples = 16;
+    // the table is a large sphere, its float quadratic loses most digits
+    scene.add(dvec3(0, 0, -1000), 1000, dvec3(0.5), dvec3(0.5), 500);
+    scene.add(dvec3(-0.5, -4, 2), 2, dvec3(0.05), dvec3(0.9), 5000);
+    scene.add(dvec3(0, 0, 2), 2, dvec3(0, 0, 0.75), dvec3(0.2), 5000);
+    scene.add(dvec3(-4, -0.5, 2), 2, dvec3(0.9, 0, 0), dvec3(0.05), 5000);
+    scene.add(dvec3(-1, -1, 5.5), 2, dvec3(0.5), dvec3(0.5), 5000);
+    scene.light = (int)scene.centers.size();
+    scene.add(dvec3(-2, -2, 8), 1, dvec3(0), dvec3(0), 0);
+
+    dvec3 eye(-12, -12, 10), lookat(0, 0, 0);
+    dvec3 w = eye - lookat;
+    double f = length(w) * std::tan(glm::radians(35.0) / 2);
+    dvec3 right = normalize(cross(dvec3(0, 0, 1), w)) * f;
+    dvec3 up = normalize(cross(w, right)) * f;
+    for (int y = 0; y < resolution; ++y)
+    {
+        for (int x = 0; x < resolution; ++x)
+        {
+            dvec3 pixel = lookat + right * (2.0 * (x + 0.5) / resolution - 1) + up * (2.0 * (y + 0.5) / resolution - 1);
+            scene.cameraRays.push_back(RayT<double>(eye, pixel - eye));
+        }
+    }
+    std::mt19937 rng(5);
+    std::uniform_real_distribution<double> uniform(0, 1);
+    scene.randoms.resize(2 * scene.cameraRays.size() * scene.samples);
+    for (double &e : scene.randoms)
+        e = uniform(rng);
+
+    std::vector<double> imageD = renderDirectLighting<double>(scene);
+    std::vector<double> imageF = renderDirectLighting<float>(scene);
+    PrecisionError error;
+    double squaredError = 0, squaredReference = 0;
+    for (size_t p = 0; p < imageD.size(); ++p)
+    {
+        if (imageD[p] > 0)
+            error.add(imageD[p], imageF[p]);
+        // pixels whose value changed by more than 1%, e.g. a sample which hit the light only in one precision
+        if (std::abs(imageF[p] - imageD[p]) > 0.01 * std::max(imageD[p], 1e-3))
+            error.mismatches++;
+        squaredError += (imageF[p] - imageD[p]) * (imageF[p] - imageD[p]);
+        squaredReference += imageD[p] * imageD[p];
+    }
+    double relativeRMSE = std::sqrt(squaredError / std::max(squaredReference, 1e-12));
+
+    size_t pixelCount = scene.cameraRays.size();
+    size_t sampleCount = pixelCount * scene.samples;
+    double doubleRate = 0, floatRate = 0;
+    {
+        BenchmarkClock::time_point begin = BenchmarkClock::now();
+        size_t frames = 0;
+        double sink = 0;
+        do
+        {
+            sink += renderDirectLighting<double>(scene)[pixelCount / 2];
+            frames++;
+        } while (secondsSince(begin) < minSeconds);
+        doubleRate = frames * sampleCount / secondsSince(begin);
+        if (sink == 0.123456789)
+            printf(" ");
+    }
+    {
+        BenchmarkClock::time_point begin = BenchmarkClock::now();
+        size_t frames = 0;
+        double sink = 0;
+        do
+        {
+            sink += renderDirectLighting<float>(scene)[pixelCount / 2];
+            frames++;
+        } while (secondsSince(begin) < minSeconds);
+        floatRate = frames * sampleCount / secondsSince(begin);
+        if (sink == 0.123456789)
+            printf(" ");
+    }
+    printRow("direct", doubleRate, floatRate, error);
+    printf("direct lighting loop relative RMSE of float against double %.2e over %zu pixels with %d samples\n", relativeRMSE, pixelCount,
+           scene.samples);
+
+    // float may change individual samples, the image as a whole should stay the same
+    return relativeRMSE > 1e-2 ? 1 : 0;
+}
+
+int runPrecisionBenchmark()
+{
+    const double minSeconds = 0.5;
+    printf("%-10s %16s %16s %10s %12s %12s %10s\n", "kernel", "double[ops/s]", "float[ops/s]", "speedup", "mean rel err", "max rel err", "mismatch");
+    benchmarkSpheres(minSeconds);
+    benchmarkBoxes(minSeconds);
+    int failures = benchmarkTriangles(minSeconds);
+    benchmarkBRDF(minSeconds);
+    failures += benchmarkDirectLighting(minSeconds);
+    if (failures > 0)
+        printf("ERROR: rays leaked through the closed mesh or the float image differs from the double reference\n");
+    return failures > 0 ? 1 : 0;
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,14 @@
+#ifndef RSO_PRECISION_BENCHMARK_HPP
+#define RSO_PRECISION_BENCHMARK_HPP
+
+namespace Morph {
+
+// Float against double instances of the templated ray tracing kernels: sphere, box and
+// watertight triangle tests, the Phong BRDF and a small direct lighting render.
+// Prints the throughput of both, the float error relative to double and the rays leaking
+// through a closed mesh, returns non zero when float leaks or changes the image noticeably
+int runPrecisionBenchmark();
+
+}
+
+#endif // RSO_PRECISION_BENCHMARK_HPP
\ No newline at end of file
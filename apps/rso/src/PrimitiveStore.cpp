@@ -0,0 +1,349 @@
+#include "PrimitiveStore.hpp"
+
+#include <unordered_map>
+
+namespace Morph {
+
+// Rect fields in the packet lanes, either four consecutive rects or one rect repeated
+struct RectPack4
+{
+    dpack4 r0[3], normal[3], right[3], forward[3];
+    dpack4 width, height;
+};
+
+static RectPack4 loadRects(const RectArrays &rects, u32 i)
+{
+    RectPack4 rect;
+    for (int a = 0; a < 3; ++a)
+    {
+        rect.r0[a] = load(&rects.r0[a][i]);
+        rect.normal[a] = load(&rects.normal[a][i]);
+        rect.right[a] = load(&rects.right[a][i]);
+        rect.forward[a] = load(&rects.forward[a][i]);
+    }
+    rect.width = load(&rects.width[i]);
+    rect.height = load(&rects.height[i]);
+    return rect;
+}
+
+static RectPack4 broadcastRect(const RectArrays &rects, u32 i)
+{
+    RectPack4 rect;
+    for (int a = 0; a < 3; ++a)
+    {
+        rect.r0[a] = broadcast(rects.r0[a][i]);
+        rect.normal[a] = broadcast(rects.normal[a][i]);
+        rect.right[a] = broadcast(rects.right[a][i]);
+        rect.forward[a] = broadcast(rects.forward[a][i]);
+    }
+    rect.width = broadcast(rects.width[i]);
+    rect.height = broadcast(rects.height[i]);
+    return rect;
+}
+
+// Same test as Rect::intersect, clears the lanes which miss from valid and returns the distance for the others
+static dpack4 intersectRect4(const RayPacket4 &rays, const RectPack4 &rect, mask4 &valid)
+{
+    dpack4 denom = rect.normal[0] * rays.dx + rect.normal[1] * rays.dy + rect.normal[2] * rays.dz;
+    dpack4 toX = rect.r0[0] - rays.ox;
+    dpack4 toY = rect.r0[1] - rays.oy;
+    dpack4 toZ = rect.r0[2] - rays.oz;
+    dpack4 t = (rect.normal[0] * toX + rect.normal[1] * toY + rect.normal[2] * toZ) / denom;
+    // hit position relative to the anchor point
+    dpack4 pX = rays.dx * t - toX;
+    dpack4 pY = rays.dy * t - toY;
+    dpack4 pZ = rays.dz * t - toZ;
+    dpack4 x = pX * rect.right[0] + pY * rect.right[1] + pZ * rect.right[2];
+    dpack4 y = pX * rect.forward[0] + pY * rect.forward[1] + pZ * rect.forward[2];
+    const dpack4 zero = broadcast(0);
+    valid = valid & (vmax(denom, zero - denom) > broadcast(Globals::epsilon)) & (t >= zero) &
+            (vmax(x, zero - x) <= rect.width) & (vmax(y, zero - y) <= rect.height);
+    return t;
+}
+
+// moves tBest and best to the closest of the valid lanes, lane j is primitive first + j
+static void closestLane(const mask4 &valid, const dpack4 &t, u32 first, double &tBest, u32 &best)
+{
+    int bits = movemask(valid);
+    if (!bits)
+        return;
+    double lanes[RayPacket4::size];
+    store(lanes, t);
+    for (int j = 0; j < RayPacket4::size; ++j)
+    {
+        if ((bits & (1 << j)) && lanes[j] < tBest)
+        {
+            tBest = lanes[j];
+            best = first + j;
+        }
+    }
+}
+
+// the valid lanes hit by object before their closest hit so far are updated
+static void updateClosest(mask4 valid, const dpack4 &t, Intersectable *object, PacketHit4 &hit)
+{
+    valid = valid & (t > broadcast(Globals::epsilon)) & (t < hit.t);
+    int bits = movemask(valid);
+    if (!bits)
+        return;
+    hit.t = select(valid, t, hit.t);
+    for (int j = 0; j < RayPacket4::size; ++j)
+    {
+        if (bits & (1 << j))
+            hit.object[j] = object;
+    }
+}
+
+// lanes of the four primitives from first which are in range and are not the skipped one
+static mask4 primitiveLanes(u32 first, u32 end, u32 skip)
+{
+    int bits = (1 << std::min(end - first, (u32)RayPacket4::size)) - 1;
+    // the unsigned difference is out of range also when skip is before first
+    if (skip - first < (u32)RayPacket4::size)
+        bits &= ~(1 << (skip - first));
+    return laneMask(bits);
+}
+
+void PrimitiveStore::clear()
+{
+    materials.clear();
+    spheres = SphereArrays();
+    rects = RectArrays();
+    sphereTree.clear();
+    rectTree.clear();
+    others.clear();
+}
+
+void PrimitiveStore::build(const std::vector<Intersectable *> &objects)
+{
+    clear();
+    std::vector<Sphere *> sphereObjects;
+    std::vector<Rect *> rectObjects;
+    std::vector<Intersectable *> otherObjects;
+    for (Intersectable *obj : objects)
+    {
+        obj->storeIndex = -1;
+        // an EnvMap is a Sphere without finite bounds, only the BVH of the others handles it
+        if (!obj->bounds().isFinite())
+            otherObjects.push_back(obj);
+        else if (Sphere *sphere = dynamic_cast<Sphere *>(obj))
+            sphereObjects.push_back(sphere);
+        else if (Rect *rect = dynamic_cast<Rect *>(obj))
+            rectObjects.push_back(rect);
+        else
+            otherObjects.push_back(obj);
+    }
+    others.build(otherObjects);
+
+    std::unordered_map<Material *, u32> materialIndices;
+    auto addMaterial = [&](Material *material) {
+        auto inserted = materialIndices.emplace(material, (u32)materials.size());
+        if (inserted.second)
+            materials.push_back(material);
+        return inserted.first->second;
+    };
+
+    // the arrays are stored in the leaf order of their hierarchy
+    std::vector<AABB> boxes;
+    for (Sphere *sphere : sphereObjects)
+        boxes.push_back(sphere->bounds());
+    for (u32 i : sphereTree.build(boxes))
+    {
+        Sphere *sphere = sphereObjects[i];
+        sphere->storeIndex = (int)spheres.size();
+        for (int a = 0; a < 3; ++a)
+            spheres.center[a].push_back(sphere->center[a]);
+        spheres.radius.push_back(sphere->radius);
+        spheres.material.push_back(addMaterial(sphere->material));
+        spheres.object.push_back(sphere);
+    }
+
+    boxes.clear();
+    for (Rect *rect : rectObjects)
+        boxes.push_back(rect->bounds());
+    for (u32 i : rectTree.build(boxes))
+    {
+        Rect *rect = rectObjects[i];
+        rect->storeIndex = (int)rects.size();
+        for (int a = 0; a < 3; ++a)
+        {
+            rects.r0[a].push_back(rect->r0[a]);
+            rects.normal[a].push_back(rect->normal[a]);
+            rects.right[a].push_back(rect->right[a]);
+            rects.forward[a].push_back(rect->forward[a]);
+        }
+        rects.width.push_back(rect->width);
+        rects.height.push_back(rect->height);
+        rects.material.push_back(addMaterial(rect->material));
+        rects.object.push_back(rect);
+    }
+
+    padArrays();
+}
+
+void PrimitiveStore::padArrays()
+{
+    // the lanes past the last primitive are loaded but always masked out
+    const size_t padding = RayPacket4::size - 1;
+    auto pad = [padding](std::vector<double> &values) { values.resize(values.size() + padding, 0.0); };
+    for (int a = 0; a < 3; ++a)
+    {
+        pad(spheres.center[a]);
+        pad(rects.r0[a]);
+        pad(rects.normal[a]);
+        pad(rects.right[a]);
+        pad(rects.forward[a]);
+    }
+    pad(spheres.radius);
+    pad(rects.width);
+    pad(rects.height);
+}
+
+u32 PrimitiveStore::sphereIndex(const Intersectable *obj) const
+{
+    if (!obj || obj->storeIndex < 0 || (u32)obj->storeIndex >= spheres.size() || spheres.object[obj->storeIndex] != obj)
+        return ~0u;
+    return (u32)obj->storeIndex;
+}
+
+u32 PrimitiveStore::rectIndex(const Intersectable *obj) const
+{
+    if (!obj || obj->storeIndex < 0 || (u32)obj->storeIndex >= rects.size() || rects.object[obj->storeIndex] != obj)
+        return ~0u;
+    return (u32)obj->storeIndex;
+}
+
+void PrimitiveStore::intersectSpheres(const RayPacket4 &rays, u32 first, u32 count, u32 skip, double &tBest, u32 &best) const
+{
+    for (u32 i = first; i < first + count; i += RayPacket4::size)
+    {
+        mask4 valid = primitiveLanes(i, first + count, skip);
+        dpack4 t = intersectSphere4(rays, load(&spheres.center[0][i]), load(&spheres.center[1][i]), load(&spheres.center[2][i]),
+                                    load(&spheres.radius[i]), valid);
+        valid = valid & (t > broadcast(Globals::epsilon)) & (t < broadcast(tBest));
+        closestLane(valid, t, i, tBest, best);
+    }
+}
+
+void PrimitiveStore::intersectRects(const RayPacket4 &rays, u32 first, u32 count, u32 skip, double &tBest, u32 &best) const
+{
+    for (u32 i = first; i < first + count; i += RayPacket4::size)
+    {
+        mask4 valid = primitiveLanes(i, first + count, skip);
+        dpack4 t = intersectRect4(rays, loadRects(rects, i), valid);
+        valid = valid & (t > broadcast(Globals::epsilon)) & (t < broadcast(tBest));
+        closestLane(valid, t, i, tBest, best);
+    }
+}
+
+Hit PrimitiveStore::sphereHit(u32 index, const Ray &ray, real t) const
+{
+    Hit hit;
+    hit.t = t;
+    hit.position = ray.start + ray.dir * t;
+    rvec3 center(spheres.center[0][index], spheres.center[1][index], spheres.center[2][index]);
+    hit.normal = (hit.position - center) / real(spheres.radius[index]);
+    hit.material = materials[spheres.material[index]];
+    hit.object = spheres.object[index];
+    return hit;
+}
+
+Hit PrimitiveStore::rectHit(u32 index, const Ray &ray, real t) const
+{
+    Hit hit;
+    hit.t = t;
+    hit.position = ray.start + ray.dir * t;
+    hit.normal = rvec3(rects.normal[0][index], rects.normal[1][index], rects.normal[2][index]);
+    hit.material = materials[rects.material[index]];
+    hit.object = rects.object[index];
+    return hit;
+}
+
+Hit PrimitiveStore::intersect(const Ray &ray, Intersectable *skip) const
+{
+    Hit bestHit = others.intersect(ray, skip);
+    if (spheres.size() == 0 && rects.size() == 0)
+        return bestHit;
+
+    // the ray repeated in all the lanes is tested against four primitives at a time
+    RayPacket4 rays(ray);
+    double tBest = bestHit.t < 0 ? std::numeric_limits<double>::infinity() : bestHit.t;
+    u32 bestSphere = ~0u, bestRect = ~0u;
+    u32 skipSphere = sphereIndex(skip), skipRect = rectIndex(skip);
+
+    real tMax = (real)tBest;
+    sphereTree.traverse(ray, tMax, [&](u32 first, u32 count, real &tMax) {
+        intersectSpheres(rays, first, count, skipSphere, tBest, bestSphere);
+        tMax = (real)tBest;
+    });
+    tMax = (real)tBest;
+    rectTree.traverse(ray, tMax, [&](u32 first, u32 count, real &tMax) {
+        intersectRects(rays, first, count, skipRect, tBest, bestRect);
+        tMax = (real)tBest;
+    });
+
+    // a rect is only found when it is closer than all the spheres
+    if (bestRect != ~0u)
+        return rectHit(bestRect, ray, (real)tBest);
+    if (bestSphere != ~0u)
+        return sphereHit(bestSphere, ray, (real)tBest);
+    return bestHit;
+}
+
+void PrimitiveStore::intersectPacket(const RayPacket4 &packet, Hit *hits) const
+{
+    PacketHit4 packetHit;
+    others.intersectPacket(packet, packetHit);
+
+    // four rays against one primitive at a time
+    sphereTree.traversePacket(packet, packetHit, [&](u32 first, u32 count, const mask4 &active) {
+        for (u32 i = first; i < first + count; ++i)
+        {
+            mask4 valid = active;
+            dpack4 t = intersectSphere4(packet, broadcast(spheres.center[0][i]), broadcast(spheres.center[1][i]),
+                                        broadcast(spheres.center[2][i]), broadcast(spheres.radius[i]), valid);
+            updateClosest(valid, t, spheres.object[i], packetHit);
+        }
+    });
+    rectTree.traversePacket(packet, packetHit, [&](u32 first, u32 count, const mask4 &active) {
+        for (u32 i = first; i < first + count; ++i)
+        {
+            mask4 valid = active;
+            dpack4 t = intersectRect4(packet, broadcastRect(rects, i), valid);
+            updateClosest(valid, t, rects.object[i], packetHit);
+        }
+    });
+
+    double t[RayPacket4::size];
+    store(t, packetHit.t);
+    for (int i = 0; i < RayPacket4::size; ++i)
+    {
+        if (!(packet.activeBits & (1 << i)))
+            continue;
+        const Ray &ray = packet.rays[i];
+        Intersectable *obj = packetHit.object[i];
+        u32 index;
+        if (!obj)
+        {
+            hits[i] = Hit();
+        }
+        else if ((index = sphereIndex(obj)) != ~0u)
+        {
+            // the lanes compute the same distances as intersect, the hit is completed from the arrays
+            hits[i] = sphereHit(index, ray, (real)t[i]);
+        }
+        else if ((index = rectIndex(obj)) != ~0u)
+        {
+            hits[i] = rectHit(index, ray, (real)t[i]);
+        }
+        else
+        {
+            // objects of the BVH get their hit details from the single ray test like in BVH::intersectPacket
+            hits[i] = obj->intersect(ray);
+            if (!(hits[i].t > Globals::epsilon))
+                hits[i] = intersect(ray, nullptr);
+        }
+    }
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,85 @@
+#ifndef RSO_PRIMITIVE_STORE_HPP
+#define RSO_PRIMITIVE_STORE_HPP
+
+#include "BVH.hpp"
+#include "SceneObjs.hpp"
+
+namespace Morph {
+
+// Per primitive fields shared by all the primitive types
+struct PrimitiveArrays
+{
+  // index to PrimitiveStore::materials
+  std::vector<u32> material;
+  // objects the primitives were copied from, only read for the closest hit
+  std::vector<Intersectable *> object;
+
+  u32 size() const { return (u32)object.size(); }
+};
+
+// Sphere geometry in structure of arrays layout, in double like the packet lanes.
+// The arrays are padded so four spheres can be loaded from any index.
+struct SphereArrays : PrimitiveArrays
+{
+  std::vector<double> center[3];
+  std::vector<double> radius;
+};
+
+// Rect geometry in structure of arrays layout, padded like SphereArrays
+struct RectArrays : PrimitiveArrays
+{
+  std::vector<double> r0[3];
+  std::vector<double> normal[3];
+  std::vector<double> right[3];
+  std::vector<double> forward[3];
+  std::vector<double> width;
+  std::vector<double> height;
+};
+
+// Scene objects sorted by type. Spheres and rects are copied to contiguous arrays with their own
+// hierarchy and intersected without virtual calls, four primitives at a time. Other objects,
+// e.g. meshes and the environment map, stay in a BVH of Intersectable pointers.
+class PrimitiveStore
+{
+  std::vector<Material *> materials;
+  SphereArrays spheres;
+  RectArrays rects;
+  BVHTree sphereTree;
+  BVHTree rectTree;
+  BVH others;
+
+public:
+  // the objects stay owned by the caller and have to outlive the store
+  void build(const std::vector<Intersectable *> &objects);
+  void clear();
+
+  // Nearest hit further than epsilon ignoring the skip object, same result as BVH::intersect
+  Hit intersect(const Ray &ray, Intersectable *skip) const;
+
+  // Closest hits of the packet rays, writes one hit per active lane
+  void intersectPacket(const RayPacket4 &packet, Hit *hits) const;
+
+  u32 sphereCount() const { return spheres.size(); }
+  u32 rectCount() const { return rects.size(); }
+  size_t nodeCount() const { return sphereTree.nodeCount() + rectTree.nodeCount() + others.nodeCount(); }
+  size_t primitiveCount() const { return spheres.size() + rects.size() + others.primitiveCount(); }
+
+private:
+  void padArrays();
+
+  // index of the object in the arrays or ~0 when it was not copied to them
+  u32 sphereIndex(const Intersectable *obj) const;
+  u32 rectIndex(const Intersectable *obj) const;
+
+  // Update tBest and best by the primitives in [first, first + count) hit closer than tBest,
+  // rays is one ray repeated in all the lanes
+  void intersectSpheres(const RayPacket4 &rays, u32 first, u32 count, u32 skip, double &tBest, u32 &best) const;
+  void intersectRects(const RayPacket4 &rays, u32 first, u32 count, u32 skip, double &tBest, u32 &best) const;
+
+  Hit sphereHit(u32 index, const Ray &ray, real t) const;
+  Hit rectHit(u32 index, const Ray &ray, real t) const;
+};
+
+}
+
+#endif // RSO_PRIMITIVE_STORE_HPP
\ No newline at end of file
@@ -0,0 +1,64 @@
+#ifndef RSO_RANDOM_HPP
+#define RSO_RANDOM_HPP
+
+#include "Precision.hpp"
+
+namespace Morph {
+
+// Finalizer of splitmix64, spreads the counters over all the bits of the generator state
+inline u64 mixBits(u64 v)
+{
+  v ^= v >> 30;
+  v *= 0xbf58476d1ce4e5b9ull;
+  v ^= v >> 27;
+  v *= 0x94d049bb133111ebull;
+  v ^= v >> 31;
+  return v;
+}
+
+// PCG32 generator (XSH RR output of a 64 bit LCG), a multiply, an add and a few shifts per number
+class PCG32
+{
+  u64 state = 0;
+  u64 inc = 1;
+
+public:
+  PCG32(u64 seed, u64 stream)
+  {
+    inc = (stream << 1) | 1;
+    nextU32();
+    state += seed;
+    nextU32();
+  }
+
+  // Generator of one sample of one pixel. It only depends on the counters like Philox, so the image
+  // does not change with the assignment of tiles to workers and no state per thread is needed.
+  // Different streams give independent sequences for the same sample.
+  static PCG32 forSample(u32 pixel, u32 sample, u32 stream = 0)
+  {
+    return PCG32(mixBits(((u64)pixel << 32) | sample), stream);
+  }
+
+  u32 nextU32()
+  {
+    u64 old = state;
+    state = old * 6364136223846793005ull + inc;
+    u32 xorShifted = (u32)(((old >> 18) ^ old) >> 27);
+    u32 rot = (u32)(old >> 59);
+    return (xorShifted >> rot) | (xorShifted << ((32 - rot) & 31));
+  }
+
+  // uniform in [0, 1), the float version keeps 24 bits so it cannot round up to 1
+  template<typename T = double>
+  T uniform()
+  {
+    if constexpr (std::is_same<T, float>::value)
+      return (float)(nextU32() >> 8) * 0x1p-24f;
+    else
+      return (T)nextU32() * T(0x1p-32);
+  }
+};
+
+}
+
+#endif // RSO_RANDOM_HPP
\ No newline at end of file
@@ -3,14 +3,19 @@
 
 #include "Material.hpp"
 
+#include <cmath>
+#include <limits>
+
 namespace Morph {
 
 // Structure for a ray
-struct Ray
+template<typename T>
+struct RayT
 {
-  dvec3 start = dvec3(0);
-  dvec3 dir = dvec3(0);
-  Ray(const dvec3 &_start, const dvec3 &_dir)
+  tvec3<T> start = tvec3<T>(0);
+  tvec3<T> dir = tvec3<T>(0);
+  RayT() {}
+  RayT(const tvec3<T> &_start, const tvec3<T> &_dir)
   {
     start = _start;
     dir = normalize(_dir);
@@ -18,25 +23,82 @@ struct Ray
 };
 
 class Intersectable;
+struct RayPacket4;
+struct PacketHit4;
+struct mask4;
+
+// Axis aligned bounding box, empty when pMin > pMax
+template<typename T>
+struct AABBT
+{
+  tvec3<T> pMin = tvec3<T>(std::numeric_limits<T>::infinity());
+  tvec3<T> pMax = tvec3<T>(-std::numeric_limits<T>::infinity());
+
+  AABBT() {}
+  AABBT(const tvec3<T> &_pMin, const tvec3<T> &_pMax) : pMin(_pMin), pMax(_pMax) {}
+
+  // bounds of objects which cannot be enclosed, e.g. the environment map
+  static AABBT infinite()
+  {
+    return AABBT(tvec3<T>(-std::numeric_limits<T>::infinity()), tvec3<T>(std::numeric_limits<T>::infinity()));
+  }
+
+  void extend(const tvec3<T> &p)
+  {
+    pMin = glm::min(pMin, p);
+    pMax = glm::max(pMax, p);
+  }
+  void extend(const AABBT &box)
+  {
+    pMin = glm::min(pMin, box.pMin);
+    pMax = glm::max(pMax, box.pMax);
+  }
+  tvec3<T> center() const { return (pMin + pMax) * T(0.5); }
+  tvec3<T> extent() const { return pMax - pMin; }
+  T surfaceArea() const
+  {
+    tvec3<T> d = extent();
+    return T(2) * (d.x * d.y + d.y * d.z + d.z * d.x);
+  }
+  bool isFinite() const
+  {
+    return std::isfinite(pMin.x) && std::isfinite(pMin.y) && std::isfinite(pMin.z) &&
+           std::isfinite(pMax.x) && std::isfinite(pMax.y) && std::isfinite(pMax.z);
+  }
+};
 
 // Structure to store the result of ray tracing
-struct Hit
+template<typename T>
+struct HitT
 {
-  double t;
-  dvec3 position = dvec3(0);
-  dvec3 normal = dvec3(0);
+  T t;
+  tvec3<T> position = tvec3<T>(0);
+  tvec3<T> normal = tvec3<T>(0);
   Material *material;
   Intersectable *object;
-  Hit() { t = -1; }
+  HitT() { t = -1; }
 };
 
+// the renderer works in the precision selected by RSO_FLOAT_PRECISION
+using Ray = RayT<real>;
+using AABB = AABBT<real>;
+using Hit = HitT<real>;
+
 // Abstract 3D object
 struct Intersectable
 {
   Material *material;
-  double power = 0;
+  real power = 0;
+  // position in the type sorted arrays of the PrimitiveStore which copied the object, -1 if none
+  int storeIndex = -1;
   virtual Hit intersect(const Ray &ray) = 0;
-  virtual double pointSampleProb(double totalPower, dvec3 dir)
+  // objects with infinite bounds are not put to the BVH and are tested for every ray
+  virtual AABB bounds() { return AABB::infinite(); }
+  // convex objects are skipped when tracing rays leaving their surface
+  virtual bool canOccludeItself() { return false; }
+  // Updates the closest hits of the active packet lanes, by default every lane is intersected separately
+  virtual void intersectPacket(const RayPacket4 &packet, const mask4 &active, PacketHit4 &hit);
+  virtual real pointSampleProb(real totalPower, rvec3 dir)
   {
     printf("Point sample on table\n");
     return 0;
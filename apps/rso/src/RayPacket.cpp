@@ -0,0 +1,56 @@
+#include "RayPacket.hpp"
+
+namespace Morph {
+
+RayPacket4::RayPacket4(const Ray *_rays, int count) : rays(_rays)
+{
+    double o[3][size], d[3][size], inv[3][size];
+    for (int i = 0; i < size; ++i)
+    {
+        const Ray &ray = rays[i < count ? i : 0];
+        for (int a = 0; a < 3; ++a)
+        {
+            o[a][i] = ray.start[a];
+            d[a][i] = ray.dir[a];
+            inv[a][i] = 1.0 / ray.dir[a];
+        }
+    }
+    ox = load(o[0]), oy = load(o[1]), oz = load(o[2]);
+    dx = load(d[0]), dy = load(d[1]), dz = load(d[2]);
+    invDx = load(inv[0]), invDy = load(inv[1]), invDz = load(inv[2]);
+    activeBits = (1 << count) - 1;
+    active = laneMask(activeBits);
+}
+
+RayPacket4::RayPacket4(const Ray &ray) : rays(&ray)
+{
+    ox = broadcast(ray.start.x), oy = broadcast(ray.start.y), oz = broadcast(ray.start.z);
+    dx = broadcast(ray.dir.x), dy = broadcast(ray.dir.y), dz = broadcast(ray.dir.z);
+    invDx = broadcast(1.0 / ray.dir.x), invDy = broadcast(1.0 / ray.dir.y), invDz = broadcast(1.0 / ray.dir.z);
+    activeBits = 1;
+    active = laneMask(activeBits);
+}
+
+void Intersectable::intersectPacket(const RayPacket4 &packet, const mask4 &active, PacketHit4 &hit)
+{
+    int bits = movemask(active);
+    if (!bits)
+        return;
+    double t[RayPacket4::size];
+    store(t, hit.t);
+    for (int i = 0; i < RayPacket4::size; ++i)
+    {
+        if (!(bits & (1 << i)))
+            continue;
+        Hit laneHit = intersect(packet.rays[i]);
+        // the environment map is hit at infinity
+        if (laneHit.t > Globals::epsilon && (!hit.object[i] || laneHit.t < t[i]))
+        {
+            t[i] = laneHit.t;
+            hit.object[i] = this;
+        }
+    }
+    hit.t = load(t);
+}
+
+}
\ No newline at end of file
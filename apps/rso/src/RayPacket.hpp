@@ -0,0 +1,244 @@
+#ifndef RSO_RAY_PACKET_HPP
+#define RSO_RAY_PACKET_HPP
+
+#include "Ray.hpp"
+
+#if defined(__AVX__)
+#define RSO_PACKET_AVX
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define RSO_PACKET_SSE
+#include <emmintrin.h>
+#endif
+
+namespace Morph {
+
+// 4 doubles processed together, one AVX register, two SSE registers or a plain array
+struct dpack4
+{
+#if defined(RSO_PACKET_AVX)
+  __m256d v;
+#elif defined(RSO_PACKET_SSE)
+  __m128d lo, hi;
+#else
+  double v[4];
+#endif
+};
+
+// Lane mask produced by comparisons of dpack4
+struct mask4
+{
+#if defined(RSO_PACKET_AVX)
+  __m256d v;
+#elif defined(RSO_PACKET_SSE)
+  __m128d lo, hi;
+#else
+  bool v[4];
+#endif
+};
+
+#if defined(RSO_PACKET_AVX)
+
+inline dpack4 broadcast(double a) { return {_mm256_set1_pd(a)}; }
+inline dpack4 load(const double *p) { return {_mm256_loadu_pd(p)}; }
+inline void store(double *p, const dpack4 &a) { _mm256_storeu_pd(p, a.v); }
+inline dpack4 operator+(const dpack4 &a, const dpack4 &b) { return {_mm256_add_pd(a.v, b.v)}; }
+inline dpack4 operator-(const dpack4 &a, const dpack4 &b) { return {_mm256_sub_pd(a.v, b.v)}; }
+inline dpack4 operator*(const dpack4 &a, const dpack4 &b) { return {_mm256_mul_pd(a.v, b.v)}; }
+inline dpack4 operator/(const dpack4 &a, const dpack4 &b) { return {_mm256_div_pd(a.v, b.v)}; }
+// returns b when a is NaN
+inline dpack4 vmin(const dpack4 &a, const dpack4 &b) { return {_mm256_min_pd(a.v, b.v)}; }
+inline dpack4 vmax(const dpack4 &a, const dpack4 &b) { return {_mm256_max_pd(a.v, b.v)}; }
+inline dpack4 vsqrt(const dpack4 &a) { return {_mm256_sqrt_pd(a.v)}; }
+inline mask4 operator<(const dpack4 &a, const dpack4 &b) { return {_mm256_cmp_pd(a.v, b.v, _CMP_LT_OQ)}; }
+inline mask4 operator>(const dpack4 &a, const dpack4 &b) { return {_mm256_cmp_pd(a.v, b.v, _CMP_GT_OQ)}; }
+inline mask4 operator<=(const dpack4 &a, const dpack4 &b) { return {_mm256_cmp_pd(a.v, b.v, _CMP_LE_OQ)}; }
+inline mask4 operator>=(const dpack4 &a, const dpack4 &b) { return {_mm256_cmp_pd(a.v, b.v, _CMP_GE_OQ)}; }
+inline mask4 operator&(const mask4 &a, const mask4 &b) { return {_mm256_and_pd(a.v, b.v)}; }
+inline mask4 operator|(const mask4 &a, const mask4 &b) { return {_mm256_or_pd(a.v, b.v)}; }
+inline dpack4 select(const mask4 &m, const dpack4 &a, const dpack4 &b) { return {_mm256_blendv_pd(b.v, a.v, m.v)}; }
+inline int movemask(const mask4 &m) { return _mm256_movemask_pd(m.v); }
+inline mask4 laneMask(int bits)
+{
+  return {_mm256_castsi256_pd(_mm256_set_epi64x(bits & 8 ? -1 : 0, bits & 4 ? -1 : 0, bits & 2 ? -1 : 0, bits & 1 ? -1 : 0))};
+}
+
+#elif defined(RSO_PACKET_SSE)
+
+inline dpack4 broadcast(double a) { return {_mm_set1_pd(a), _mm_set1_pd(a)}; }
+inline dpack4 load(const double *p) { return {_mm_loadu_pd(p), _mm_loadu_pd(p + 2)}; }
+inline void store(double *p, const dpack4 &a)
+{
+  _mm_storeu_pd(p, a.lo);
+  _mm_storeu_pd(p + 2, a.hi);
+}
+inline dpack4 operator+(const dpack4 &a, const dpack4 &b) { return {_mm_add_pd(a.lo, b.lo), _mm_add_pd(a.hi, b.hi)}; }
+inline dpack4 operator-(const dpack4 &a, const dpack4 &b) { return {_mm_sub_pd(a.lo, b.lo), _mm_sub_pd(a.hi, b.hi)}; }
+inline dpack4 operator*(const dpack4 &a, const dpack4 &b) { return {_mm_mul_pd(a.lo, b.lo), _mm_mul_pd(a.hi, b.hi)}; }
+inline dpack4 operator/(const dpack4 &a, const dpack4 &b) { return {_mm_div_pd(a.lo, b.lo), _mm_div_pd(a.hi, b.hi)}; }
+// returns b when a is NaN
+inline dpack4 vmin(const dpack4 &a, const dpack4 &b) { return {_mm_min_pd(a.lo, b.lo), _mm_min_pd(a.hi, b.hi)}; }
+inline dpack4 vmax(const dpack4 &a, const dpack4 &b) { return {_mm_max_pd(a.lo, b.lo), _mm_max_pd(a.hi, b.hi)}; }
+inline dpack4 vsqrt(const dpack4 &a) { return {_mm_sqrt_pd(a.lo), _mm_sqrt_pd(a.hi)}; }
+inline mask4 operator<(const dpack4 &a, const dpack4 &b) { return {_mm_cmplt_pd(a.lo, b.lo), _mm_cmplt_pd(a.hi, b.hi)}; }
+inline mask4 operator>(const dpack4 &a, const dpack4 &b) { return {_mm_cmpgt_pd(a.lo, b.lo), _mm_cmpgt_pd(a.hi, b.hi)}; }
+inline mask4 operator<=(const dpack4 &a, const dpack4 &b) { return {_mm_cmple_pd(a.lo, b.lo), _mm_cmple_pd(a.hi, b.hi)}; }
+inline mask4 operator>=(const dpack4 &a, const dpack4 &b) { return {_mm_cmpge_pd(a.lo, b.lo), _mm_cmpge_pd(a.hi, b.hi)}; }
+inline mask4 operator&(const mask4 &a, const mask4 &b) { return {_mm_and_pd(a.lo, b.lo), _mm_and_pd(a.hi, b.hi)}; }
+inline mask4 operator|(const mask4 &a, const mask4 &b) { return {_mm_or_pd(a.lo, b.lo), _mm_or_pd(a.hi, b.hi)}; }
+inline dpack4 select(const mask4 &m, const dpack4 &a, const dpack4 &b)
+{
+  return {_mm_or_pd(_mm_and_pd(m.lo, a.lo), _mm_andnot_pd(m.lo, b.lo)),
+          _mm_or_pd(_mm_and_pd(m.hi, a.hi), _mm_andnot_pd(m.hi, b.hi))};
+}
+inline int movemask(const mask4 &m) { return _mm_movemask_pd(m.lo) | (_mm_movemask_pd(m.hi) << 2); }
+inline mask4 laneMask(int bits)
+{
+  return {_mm_castsi128_pd(_mm_set_epi64x(bits & 2 ? -1 : 0, bits & 1 ? -1 : 0)),
+          _mm_castsi128_pd(_mm_set_epi64x(bits & 8 ? -1 : 0, bits & 4 ? -1 : 0))};
+}
+
+#else
+
+inline dpack4 broadcast(double a) { return {{a, a, a, a}}; }
+inline dpack4 load(const double *p) { return {{p[0], p[1], p[2], p[3]}}; }
+inline void store(double *p, const dpack4 &a)
+{
+  for (int i = 0; i < 4; ++i)
+    p[i] = a.v[i];
+}
+#define RSO_PACKET_BINARY(op)                                                             \
+  inline dpack4 operator op(const dpack4 &a, const dpack4 &b)                             \
+  {                                                                                       \
+    return {{a.v[0] op b.v[0], a.v[1] op b.v[1], a.v[2] op b.v[2], a.v[3] op b.v[3]}};   \
+  }
+#define RSO_PACKET_COMPARE(op)                                                            \
+  inline mask4 operator op(const dpack4 &a, const dpack4 &b)                              \
+  {                                                                                       \
+    return {{a.v[0] op b.v[0], a.v[1] op b.v[1], a.v[2] op b.v[2], a.v[3] op b.v[3]}};   \
+  }
+RSO_PACKET_BINARY(+)
+RSO_PACKET_BINARY(-)
+RSO_PACKET_BINARY(*)
+RSO_PACKET_BINARY(/)
+RSO_PACKET_COMPARE(<)
+RSO_PACKET_COMPARE(>)
+RSO_PACKET_COMPARE(<=)
+RSO_PACKET_COMPARE(>=)
+#undef RSO_PACKET_BINARY
+#undef RSO_PACKET_COMPARE
+// same NaN behaviour as the SIMD instructions, returns b when a is NaN
+inline dpack4 vmin(const dpack4 &a, const dpack4 &b)
+{
+  dpack4 r;
+  for (int i = 0; i < 4; ++i)
+    r.v[i] = a.v[i] < b.v[i] ? a.v[i] : b.v[i];
+  return r;
+}
+inline dpack4 vmax(const dpack4 &a, const dpack4 &b)
+{
+  dpack4 r;
+  for (int i = 0; i < 4; ++i)
+    r.v[i] = a.v[i] > b.v[i] ? a.v[i] : b.v[i];
+  return r;
+}
+inline dpack4 vsqrt(const dpack4 &a)
+{
+  dpack4 r;
+  for (int i = 0; i < 4; ++i)
+    r.v[i] = std::sqrt(a.v[i]);
+  return r;
+}
+inline mask4 operator&(const mask4 &a, const mask4 &b) { return {{a.v[0] && b.v[0], a.v[1] && b.v[1], a.v[2] && b.v[2], a.v[3] && b.v[3]}}; }
+inline mask4 operator|(const mask4 &a, const mask4 &b) { return {{a.v[0] || b.v[0], a.v[1] || b.v[1], a.v[2] || b.v[2], a.v[3] || b.v[3]}}; }
+inline dpack4 select(const mask4 &m, const dpack4 &a, const dpack4 &b)
+{
+  dpack4 r;
+  for (int i = 0; i < 4; ++i)
+    r.v[i] = m.v[i] ? a.v[i] : b.v[i];
+  return r;
+}
+inline int movemask(const mask4 &m) { return (int)m.v[0] | ((int)m.v[1] << 1) | ((int)m.v[2] << 2) | ((int)m.v[3] << 3); }
+inline mask4 laneMask(int bits) { return {{(bits & 1) != 0, (bits & 2) != 0, (bits & 4) != 0, (bits & 8) != 0}}; }
+
+#endif
+
+// Four rays in structure of arrays layout, e.g. primary rays of 2x2 neighbouring pixels
+struct RayPacket4
+{
+  static const int size = 4;
+
+  dpack4 ox, oy, oz;
+  dpack4 dx, dy, dz;
+  dpack4 invDx, invDy, invDz;
+  // lanes with a ray, the rest repeat the first ray
+  int activeBits;
+  mask4 active;
+  const Ray *rays;
+
+  RayPacket4(const Ray *_rays, int count);
+  // the same ray in all the lanes, e.g. to test it against four primitives at a time
+  explicit RayPacket4(const Ray &ray);
+};
+
+// Closest hits of the packet lanes, t is infinite for lanes without a hit
+struct PacketHit4
+{
+  dpack4 t = broadcast(std::numeric_limits<double>::infinity());
+  Intersectable *object[RayPacket4::size] = {nullptr, nullptr, nullptr, nullptr};
+};
+
+// Slab test of the packet against the box limited to (0, tMax) of every lane, returns the hit lanes
+inline mask4 intersectBox(const AABB &box, const RayPacket4 &packet, const dpack4 &tMax)
+{
+  const dpack4 zero = broadcast(0);
+  // keeps hits on the box boundary despite the rounding of the slab distances
+  const dpack4 robust = broadcast(1 + 4 * std::numeric_limits<double>::epsilon());
+  dpack4 tA = (broadcast(box.pMin.x) - packet.ox) * packet.invDx;
+  dpack4 tB = (broadcast(box.pMax.x) - packet.ox) * packet.invDx;
+  dpack4 t0 = vmax(vmin(tA, tB), zero);
+  dpack4 t1 = vmin(vmax(tA, tB) * robust, tMax);
+  tA = (broadcast(box.pMin.y) - packet.oy) * packet.invDy;
+  tB = (broadcast(box.pMax.y) - packet.oy) * packet.invDy;
+  t0 = vmax(vmin(tA, tB), t0);
+  t1 = vmin(vmax(tA, tB) * robust, t1);
+  tA = (broadcast(box.pMin.z) - packet.oz) * packet.invDz;
+  tB = (broadcast(box.pMax.z) - packet.oz) * packet.invDz;
+  t0 = vmax(vmin(tA, tB), t0);
+  t1 = vmin(vmax(tA, tB) * robust, t1);
+  return t0 <= t1;
+}
+
+// Sphere test of four lanes with the formulation and root selection of intersectSphere.
+// Either side can repeat one value: four rays against one sphere for packets or one ray against
+// four spheres for the primitive store. Clears the lanes which miss from valid and returns
+// the distance of the nearer hit in front of the ray start for the others.
+inline dpack4 intersectSphere4(const RayPacket4 &rays, const dpack4 &cx, const dpack4 &cy, const dpack4 &cz,
+                               const dpack4 &radius, mask4 &valid)
+{
+  dpack4 distX = rays.ox - cx;
+  dpack4 distY = rays.oy - cy;
+  dpack4 distZ = rays.oz - cz;
+  dpack4 a = rays.dx * rays.dx + rays.dy * rays.dy + rays.dz * rays.dz;
+  dpack4 b = broadcast(0) - (distX * rays.dx + distY * rays.dy + distZ * rays.dz);
+  dpack4 ba = b / a;
+  dpack4 lineX = distX + rays.dx * ba;
+  dpack4 lineY = distY + rays.dy * ba;
+  dpack4 lineZ = distZ + rays.dz * ba;
+  dpack4 radius2 = radius * radius;
+  dpack4 discr = radius2 - (lineX * lineX + lineY * lineY + lineZ * lineZ);
+  valid = valid & (discr >= broadcast(0));
+  // most tests miss, the roots are not needed then
+  if (!movemask(valid))
+    return discr;
+  dpack4 sqrtDiscr = vsqrt(a * vmax(discr, broadcast(0)));
+  dpack4 q = b + select(b >= broadcast(0), sqrtDiscr, broadcast(0) - sqrtDiscr);
+  dpack4 t1 = (distX * distX + distY * distY + distZ * distZ - radius2) / q;
+  dpack4 t2 = q / a;
+  dpack4 tNear = vmin(t1, t2);
+  return select(tNear > broadcast(0), tNear, vmax(t1, t2));
+}
+
+}
+
+#endif // RSO_RAY_PACKET_HPP
\ No newline at end of file
@@ -0,0 +1,296 @@
+#include "RenderBenchmark.hpp"
+
+#include "Headless.hpp"
+#include "Image.hpp"
+#include "Scene.hpp"
+
+#include <Core/JobManager.hpp>
+#include <Profile/BenchmarkBaseline.hpp>
+#include <Resource/Storage.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <string>
+
+namespace Morph {
+
+using BenchmarkClock = std::chrono::steady_clock;
+
+static double secondsSince(BenchmarkClock::time_point begin)
+{
+    return std::chrono::duration<double>(BenchmarkClock::now() - begin).count();
+}
+
+struct RenderBenchmarkOptions
+{
+    std::string filter;
+    std::string outPath;
+    std::string baselinePath;
+    // allowed slowdown, overrides the tolerances of the baseline file when given
+    double tolerance = -1;
+    int threads = 1;
+    int spp = 16;
+    uvec2 size = uvec2(160, 120);
+    int repetitions = 3;
+};
+
+struct RenderBenchmarkResult
+{
+    std::string name;
+    double buildSeconds = 0;
+    // of the median repetition
+    double renderSeconds = 0;
+    double primarySeconds = 0;
+    double shadingSeconds = 0;
+    u64 rays = 0;
+    u64 samples = 0;
+
+    double samplesPerSecond() const { return samples / renderSeconds; }
+    double megaRaysPerSecond() const { return rays / renderSeconds * 1e-6; }
+};
+
+// new directory for the generated files, so files of the same name in the working directory stay untouched
+static bool createTempDirectory(std::filesystem::path& directory)
+{
+    std::error_code error;
+    std::filesystem::path base = std::filesystem::temp_directory_path(error);
+    if (error)
+        return false;
+    long long stamp = BenchmarkClock::now().time_since_epoch().count();
+    for (int attempt = 0; attempt < 100; ++attempt)
+    {
+        directory = base / ("rso_render_benchmark_" + std::to_string(stamp + attempt));
+        if (std::filesystem::create_directory(directory, error))
+            return true;
+        if (error)
+            return false;
+    }
+    return false;
+}
+
+// sky gradient with a small bright sun and some noise, the same in every run
+static void writeBenchmarkSky(const std::string& skyFilename)
+{
+    uvec2 size(1024, 512);
+    vector2d<vec3> sky(size, vec3(0));
+    PCG32 rng(7, 0);
+    for (u32 y = 0; y < size.y; ++y)
+    {
+        for (u32 x = 0; x < size.x; ++x)
+        {
+            double dx = x - size.x * 0.3, dy = y - size.y * 0.3;
+            double sun = 500 * std::exp(-(dx * dx + dy * dy) / 40.0);
+            double v = 0.2 + 0.8 * y / size.y + 0.1 * rng.uniform() + sun;
+            sky(x, y) = vec3(v * 0.8, v * 0.9, v);
+        }
+    }
+    SaveHDR(skyFilename.c_str(), sky);
+}
+
+static void renderUsage()
+{
+    printf("Usage: rso --render-benchmark [--filter text] [--out results.json] [--compare baseline.json]\n");
+    printf("                              [--tolerance t] [--threads 1] [--spp 16] [--size 160x120] [--repetitions 3]\n");
+}
+
+static bool parseOptions(int argc, char** argv, RenderBenchmarkOptions& options)
+{
+    for (int i = 0; i + 1 < argc; i += 2)
+    {
+        const char* arg = argv[i];
+        const char* value = argv[i + 1];
+        bool valid = true;
+        if (strcmp(arg, "--filter") == 0)
+            options.filter = value;
+        else if (strcmp(arg, "--out") == 0)
+            options.outPath = value;
+        else if (strcmp(arg, "--compare") == 0)
+            options.baselinePath = value;
+        else if (strcmp(arg, "--tolerance") == 0)
+            valid = sscanf(value, "%lf", &options.tolerance) == 1 && options.tolerance >= 0;
+        else if (strcmp(arg, "--threads") == 0)
+            valid = parseThreads(value, options.threads);
+        else if (strcmp(arg, "--spp") == 0)
+            valid = sscanf(value, "%d", &options.spp) == 1 && options.spp > 0;
+        else if (strcmp(arg, "--size") == 0)
+            valid = parseSize(value, options.size);
+        else if (strcmp(arg, "--repetitions") == 0)
+            valid = sscanf(value, "%d", &options.repetitions) == 1 && options.repetitions > 0;
+        else
+            valid = false;
+        if (!valid)
+            return false;
+    }
+    return argc % 2 == 0;
+}
+
+static RenderBenchmarkResult benchmarkMethod(Scene& scene, const std::string& name, Method method, const RenderBenchmarkOptions& options)
+{
+    Globals::method = method;
+    Globals::weight = methodWeight(method);
+
+    std::vector<RenderBenchmarkResult> repetitions;
+    for (int r = 0; r < options.repetitions; ++r)
+    {
+        RenderBenchmarkResult repetition;
+        repetition.name = name;
+        Globals::clear();
+        BenchmarkClock::time_point begin = BenchmarkClock::now();
+        for (int i = 0; i < options.spp; ++i)
+        {
+            scene.renderIteration();
+            const IterationStats& stats = scene.lastIteration();
+            repetition.rays += stats.rays;
+            repetition.samples += stats.samples;
+            repetition.primarySeconds += stats.primarySeconds;
+            repetition.shadingSeconds += stats.shadingSeconds;
+        }
+        repetition.renderSeconds = secondsSince(begin);
+        repetitions.push_back(repetition);
+    }
+    std::sort(repetitions.begin(), repetitions.end(),
+              [](const RenderBenchmarkResult& a, const RenderBenchmarkResult& b) { return a.renderSeconds < b.renderSeconds; });
+    return repetitions[repetitions.size() / 2];
+}
+
+static std::string resultsJson(const std::vector<RenderBenchmarkResult>& results, const RenderBenchmarkOptions& options, int workers)
+{
+    std::string json = "{\n    \"unit\": \"samples/s\",\n";
+    char line[512];
+    snprintf(line, sizeof(line), "    \"width\": %u,\n    \"height\": %u,\n    \"spp\": %d,\n    \"threads\": %d,\n    \"benchmarks\": [",
+             options.size.x, options.size.y, options.spp, workers);
+    json += line;
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        const RenderBenchmarkResult& result = results[i];
+        snprintf(line, sizeof(line),
+                 "%s        { \"name\": \"%s\", \"samples_per_second\": %.1f, \"mrays_per_second\": %.3f, \"build_ms\": %.2f, \"render_ms\": %.2f, \"primary_ms\": %.2f, \"shading_ms\": %.2f }",
+                 i == 0 ? "\n" : ",\n", result.name.c_str(), result.samplesPerSecond(), result.megaRaysPerSecond(), result.buildSeconds * 1000,
+                 result.renderSeconds * 1000, result.primarySeconds * 1000, result.shadingSeconds * 1000);
+        json += line;
+    }
+    json += "\n    ]\n}\n";
+    return json;
+}
+
+// compares samples/s against a file written with --out, "tolerance" can be set for the whole file and per benchmark
+static bool compareBaseline(const std::vector<RenderBenchmarkResult>& results, const RenderBenchmarkOptions& options, int workers)
+{
+    opt<f64> tolerance;
+    if (options.tolerance >= 0)
+        tolerance = options.tolerance;
+    opt<BenchmarkBaseline> baseline = BenchmarkBaseline::Read(options.baselinePath, "samples_per_second", tolerance);
+    if (!baseline)
+    {
+        printf("ERROR: failed to read baseline %s\n", options.baselinePath.c_str());
+        return false;
+    }
+
+    // timings of another resolution, spp or thread count are not comparable
+    const std::pair<const char*, int> settings[] = {{"width", (int)options.size.x}, {"height", (int)options.size.y}, {"spp", options.spp}, {"threads", workers}};
+    for (const auto& [key, value] : settings)
+    {
+        opt<f64> setting = baseline->GetSetting(key);
+        if (setting && *setting != value)
+        {
+            printf("ERROR: the baseline has %s %g, the run %d\n", key, *setting, value);
+            return false;
+        }
+    }
+
+    std::vector<pair<string, f64>> rates;
+    for (const RenderBenchmarkResult& result : results)
+        rates.push_back({result.name, result.samplesPerSecond()});
+    bool passed = true;
+    for (const BenchmarkComparison& comparison : baseline->Compare(rates, "samples/s", true, options.filter))
+    {
+        printf("%s%s\n", comparison.failed ? "ERROR: " : "", comparison.message.c_str());
+        passed = passed && !comparison.failed;
+    }
+    return passed;
+}
+
+int runRenderBenchmark(int argc, char** argv)
+{
+    RenderBenchmarkOptions options;
+    if (!parseOptions(argc, argv, options))
+    {
+        renderUsage();
+        return 2;
+    }
+
+    JobManager jobManager(options.threads);
+    Globals::resize_image(options.size);
+    Globals::sampler = SOBOL;
+    Globals::samplesPerFrame = 1;
+    Globals::useAdaptiveSampling = false;
+    Globals::maxSamples = 0;
+    Globals::useMultithreading = true;
+    std::filesystem::path tempDirectory;
+    if (!createTempDirectory(tempDirectory))
+    {
+        printf("ERROR: failed to create a temporary directory\n");
+        return 1;
+    }
+    std::string skyPath = (tempDirectory / "sky.hdr").string();
+    const char* skyFilename = skyPath.c_str();
+    writeBenchmarkSky(skyPath);
+
+    // an empty mesh file name gives the generated sphere of 131k triangles
+    const std::pair<SceneType, const char*> scenes[] = {
+        {HW1_3_SCENE, nullptr}, {HW2_SCENE, skyFilename}, {HW4_SCENE, skyFilename}, {MESH_SCENE, ""}, {SPHERES_SCENE, nullptr}};
+    const Method methods[] = {BRDF, LIGHT_SOURCE, MULTIPLE_IMPORTANCE, PATH_TRACING};
+
+    printf("%-24s %10s %10s %12s %12s %10s %14s\n", "scene.method", "build[ms]", "render[ms]", "primary[ms]", "shading[ms]", "Mrays/s", "samples/s");
+    std::vector<RenderBenchmarkResult> results;
+    for (const auto& [type, filename] : scenes)
+    {
+        std::vector<std::string> names;
+        for (Method method : methods)
+        {
+            std::string name = std::string(sceneName(type)) + "." + methodName(method);
+            if (options.filter.empty() || name.find(options.filter) != std::string::npos)
+                names.push_back(name);
+        }
+        if (names.empty())
+            continue;
+
+        // the env map tables are built every time, not read from the cache of the last run
+        std::remove((skyPath + ".envcache").c_str());
+        Scene scene(jobManager);
+        BenchmarkClock::time_point begin = BenchmarkClock::now();
+        scene.build(type, filename);
+        double buildSeconds = secondsSince(begin);
+
+        for (Method method : methods)
+        {
+            std::string name = std::string(sceneName(type)) + "." + methodName(method);
+            if (std::find(names.begin(), names.end(), name) == names.end())
+                continue;
+            RenderBenchmarkResult result = benchmarkMethod(scene, name, method, options);
+            result.buildSeconds = buildSeconds;
+            printf("%-24s %10.2f %10.2f %12.2f %12.2f %10.3f %14.0f\n", name.c_str(), result.buildSeconds * 1000, result.renderSeconds * 1000,
+                   result.primarySeconds * 1000, result.shadingSeconds * 1000, result.megaRaysPerSecond(), result.samplesPerSecond());
+            fflush(stdout);
+            results.push_back(result);
+        }
+    }
+    std::error_code error;
+    std::filesystem::remove_all(tempDirectory, error);
+
+    int workers = jobManager.GetMaxNumberOfWorkers();
+    if (!options.outPath.empty() && !ResourceStorage::WriteToFile(options.outPath, resultsJson(results, options, workers)))
+    {
+        printf("ERROR: failed to write %s\n", options.outPath.c_str());
+        return 1;
+    }
+    if (!options.baselinePath.empty() && !compareBaseline(results, options, workers))
+        return 1;
+    return 0;
+}
+
+}
\ No newline at end of file
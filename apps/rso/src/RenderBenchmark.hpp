@@ -0,0 +1,15 @@
+#ifndef RSO_RENDER_BENCHMARK_HPP
+#define RSO_RENDER_BENCHMARK_HPP
+
+namespace Morph {
+
+// Renders the test scenes and the synthetic sphere and mesh scenes with the BRDF, light source,
+// MIS and path tracing methods at a fixed resolution and spp without adaptive sampling. The
+// environment maps use a generated sky, so every run traces the same rays. Prints and optionally
+// writes samples/s, Mrays/s and the build, primary ray and shading times, returns non zero when
+// a render is slower than the baseline given by --compare allows.
+int runRenderBenchmark(int argc, char** argv);
+
+}
+
+#endif // RSO_RENDER_BENCHMARK_HPP
\ No newline at end of file
@@ -0,0 +1,66 @@
+#include "RenderThread.hpp"
+
+#include <Core/Log.hpp>
+
+namespace Morph {
+
+// key presses between two iterations, more are dropped
+static const usize commandCapacity = 64;
+
+RenderThread::RenderThread(Scene& _scene)
+    : scene(&_scene), commands(commandCapacity), stopping(false), wakeUp(false)
+{
+}
+
+RenderThread::~RenderThread()
+{
+    stopping = true;
+    wake();
+    if (thread.joinable())
+        thread.join();
+}
+
+void RenderThread::start()
+{
+    thread = std::thread(&RenderThread::loop, this);
+}
+
+void RenderThread::submit(std::function<void()> command)
+{
+    if (!commands.TryPush([&](std::function<void()>& cell) { cell = std::move(command); }))
+        MORPH_APP_LOG_WARN("render command queue is full, command dropped");
+    else
+        wake();
+}
+
+void RenderThread::wake()
+{
+    {
+        std::unique_lock<std::mutex> lock(wakeMutex);
+        wakeUp = true;
+    }
+    wakeCondVar.notify_one();
+}
+
+void RenderThread::loop()
+{
+    while (!stopping)
+    {
+        std::function<void()> command;
+        while (commands.TryPop([&](std::function<void()>& cell) { command = std::move(cell); cell = nullptr; }))
+            command();
+        // the last frame is published, further iterations would only copy the same image
+        if (scene->finished())
+        {
+            std::unique_lock<std::mutex> lock(wakeMutex);
+            wakeCondVar.wait(lock, [&] { return wakeUp; });
+            wakeUp = false;
+            continue;
+        }
+        scene->renderIteration();
+        frames.WriteBuffer() = Globals::ldrImage;
+        frames.Publish();
+    }
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,55 @@
+#ifndef RSO_RENDER_THREAD_HPP
+#define RSO_RENDER_THREAD_HPP
+
+#include <Core/RingBuffer.hpp>
+#include <Core/TripleBuffer.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#include "Scene.hpp"
+
+namespace Morph {
+
+// Progressive rendering decoupled from the window, the thread renders iterations back to back over the
+// job manager of the scene and publishes every finished LDR image. The window thread never waits on the
+// renderer and the renderer never waits on the swap, changes of Globals are submitted as commands that
+// run between two iterations. Once every pixel converged the thread sleeps until the next command.
+class RenderThread
+{
+  Scene* scene;
+  RingBuffer<std::function<void()>> commands;
+  TripleBuffer<vector2d<vec3>> frames;
+  std::atomic<bool> stopping;
+  // a command was submitted or the thread is stopping, wakes the thread when the image is finished
+  std::mutex wakeMutex;
+  std::condition_variable wakeCondVar;
+  bool wakeUp;
+  std::thread thread;
+
+  void loop();
+  void wake();
+
+public:
+  RenderThread(Scene& _scene);
+  ~RenderThread();
+  RenderThread(const RenderThread& other) = delete;
+  RenderThread& operator=(const RenderThread& other) = delete;
+
+  // the scene is built, starts rendering
+  void start();
+
+  // runs the command on the render thread before the next iteration, dropped with a warning when too many are pending
+  void submit(std::function<void()> command);
+
+  // takes the newest finished frame, false when none was finished since the last call
+  bool newFrame() { return frames.Update(); }
+  const vector2d<vec3>& frame() const { return frames.ReadBuffer(); }
+};
+
+}
+
+#endif // RSO_RENDER_THREAD_HPP
\ No newline at end of file
@@ -0,0 +1,247 @@
+#include "Sampler.hpp"
+
+#include <cmath>
+#include <vector>
+
+namespace Morph {
+
+// Halton uses one prime base per dimension, the dimensions past the table are independent
+static const u32 primes[] = {
+    2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37, 41, 43, 47, 53,
+    59, 61, 67, 71, 73, 79, 83, 89, 97, 101, 103, 107, 109, 113, 127, 131,
+    137, 139, 149, 151, 157, 163, 167, 173, 179, 181, 191, 193, 197, 199, 211, 223,
+    227, 229, 233, 239, 241, 251, 257, 263, 269, 271, 277, 281, 283, 293, 307, 311};
+static const u32 primeCount = sizeof(primes) / sizeof(primes[0]);
+
+static const int blueNoiseSize = 64;
+
+const char *samplerName(SamplerType type)
+{
+    switch (type)
+    {
+    case INDEPENDENT:
+        return "independent";
+    case SOBOL:
+        return "sobol";
+    case HALTON:
+        return "halton";
+    case BLUE_NOISE:
+        return "blue noise";
+    }
+    return "unknown";
+}
+
+static u32 hashCombine(u32 a, u32 b)
+{
+    return (u32)mixBits(((u64)a << 32) | b);
+}
+
+static u32 reverseBits(u32 x)
+{
+    x = (x << 16) | (x >> 16);
+    x = ((x & 0x00ff00ffu) << 8) | ((x & 0xff00ff00u) >> 8);
+    x = ((x & 0x0f0f0f0fu) << 4) | ((x & 0xf0f0f0f0u) >> 4);
+    x = ((x & 0x33333333u) << 2) | ((x & 0xccccccccu) >> 2);
+    x = ((x & 0x55555555u) << 1) | ((x & 0xaaaaaaaau) >> 1);
+    return x;
+}
+
+// Hash which changes every bit depending only on the bits below it (Laine and Karras 2011, constants of Burley 2020)
+static u32 laineKarrasPermutation(u32 x, u32 seed)
+{
+    x ^= x * 0x3d20adeau;
+    x += seed;
+    x *= (seed >> 16) | 1;
+    x ^= x * 0x05526c56u;
+    x ^= x * 0x53a22864u;
+    return x;
+}
+
+// Owen scrambling of a binary fraction, every bit is flipped by a random function of the bits above it
+static u32 nestedUniformScramble(u32 x, u32 seed)
+{
+    return reverseBits(laineKarrasPermutation(reverseBits(x), seed));
+}
+
+// The first two Sobol dimensions, van der Corput and its (0,2)-sequence pair
+static u32 sobol(u32 index, u32 dimension)
+{
+    if (dimension == 0)
+        return reverseBits(index);
+    u32 result = 0;
+    for (u32 v = 1u << 31; index; index >>= 1, v ^= v >> 1)
+    {
+        if (index & 1)
+            result ^= v;
+    }
+    return result;
+}
+
+// Owen scrambled Sobol number of the dimension. Every pair of dimensions is a (0,2)-sequence
+// with its own shuffle of the sample indices, which decorrelates the pairs (Burley 2020).
+static double scrambledSobol(u32 index, u32 dimension, u32 seed)
+{
+    u32 pairSeed = hashCombine(seed, dimension / 2);
+    u32 shuffled = nestedUniformScramble(index, pairSeed);
+    u32 bits = nestedUniformScramble(sobol(shuffled, dimension & 1), hashCombine(pairSeed, dimension & 1));
+    return bits * 0x1p-32;
+}
+
+// Radical inverse with its digits permuted by a * digit + c mod base, where a and c come
+// from the hash of the digits above, i.e. a different permutation in every node like Owen scrambling
+static double scrambledRadicalInverse(u32 index, u32 base, u32 seed)
+{
+    const double invBase = 1.0 / base;
+    double factor = invBase;
+    double result = 0;
+    u32 node = seed;
+    // the trailing zero digits are permuted too, up to the precision of 32 bit Sobol
+    while (factor > 0x1p-33)
+    {
+        u32 digit = index % base;
+        index /= base;
+        u32 h = hashCombine(node, base);
+        u32 a = 1 + h % (base - 1);
+        u32 c = (h >> 16) % base;
+        result += ((a * digit + c) % base) * factor;
+        factor *= invBase;
+        node = hashCombine(node, digit);
+    }
+    return result;
+}
+
+// Ranks of the pixels of a void and cluster blue noise mask (Ulichney 1993) tiled over the screen
+static std::vector<u16> makeBlueNoiseMask()
+{
+    const int size = blueNoiseSize;
+    const int count = size * size;
+    // toroidal gaussian with sigma 1.5 as the energy of one point
+    std::vector<float> kernel(count);
+    for (int y = 0; y < size; ++y)
+    {
+        for (int x = 0; x < size; ++x)
+        {
+            int dx = std::min(x, size - x);
+            int dy = std::min(y, size - y);
+            kernel[y * size + x] = std::exp(-(dx * dx + dy * dy) / (2 * 1.5f * 1.5f));
+        }
+    }
+
+    std::vector<u8> pattern(count, 0);
+    std::vector<float> energy(count, 0);
+    auto splat = [&](int p, float sign) {
+        int px = p % size, py = p / size;
+        for (int y = 0; y < size; ++y)
+        {
+            const float *row = &kernel[((y - py) & (size - 1)) * size];
+            for (int x = 0; x < size; ++x)
+                energy[y * size + x] += sign * row[(x - px) & (size - 1)];
+        }
+    };
+    auto tightestCluster = [&]() {
+        int best = -1;
+        for (int p = 0; p < count; ++p)
+        {
+            if (pattern[p] && (best < 0 || energy[p] > energy[best]))
+                best = p;
+        }
+        return best;
+    };
+    auto largestVoid = [&]() {
+        int best = -1;
+        for (int p = 0; p < count; ++p)
+        {
+            if (!pattern[p] && (best < 0 || energy[p] < energy[best]))
+                best = p;
+        }
+        return best;
+    };
+
+    // a tenth of the pixels set at random, moved from clusters to voids until they are evenly spread
+    PCG32 rng(1, 0);
+    int ones = 0;
+    while (ones < count / 10)
+    {
+        int p = (int)(rng.nextU32() % count);
+        if (pattern[p])
+            continue;
+        pattern[p] = 1;
+        splat(p, 1);
+        ones++;
+    }
+    while (true)
+    {
+        int cluster = tightestCluster();
+        pattern[cluster] = 0;
+        splat(cluster, -1);
+        int hole = largestVoid();
+        pattern[hole] = 1;
+        splat(hole, 1);
+        if (hole == cluster)
+            break;
+    }
+
+    std::vector<u16> rank(count);
+    std::vector<u8> initialPattern = pattern;
+    std::vector<float> initialEnergy = energy;
+    // the initial points get the low ranks, the tightest cluster is removed first
+    for (int r = ones - 1; r >= 0; --r)
+    {
+        int cluster = tightestCluster();
+        pattern[cluster] = 0;
+        splat(cluster, -1);
+        rank[cluster] = (u16)r;
+    }
+    // the rest is filled from the largest void, which is also the tightest cluster of the empty pixels
+    pattern = initialPattern;
+    energy = initialEnergy;
+    for (int r = ones; r < count; ++r)
+    {
+        int hole = largestVoid();
+        pattern[hole] = 1;
+        splat(hole, 1);
+        rank[hole] = (u16)r;
+    }
+    return rank;
+}
+
+// blue noise value of the pixel, every dimension uses the mask with its own toroidal offset
+static double blueNoise(uvec2 pixel, u32 dimension)
+{
+    static const std::vector<u16> mask = makeBlueNoiseMask();
+    u32 h = hashCombine(0x9e3779b9u, dimension);
+    u32 x = (pixel.x + h) & (blueNoiseSize - 1);
+    u32 y = (pixel.y + (h >> 16)) & (blueNoiseSize - 1);
+    return (mask[y * blueNoiseSize + x] + 0.5) / (blueNoiseSize * blueNoiseSize);
+}
+
+Sampler::Sampler(SamplerType _type, uvec2 _pixel, u32 _sampleIndex)
+    : type(_type), pixel(_pixel), pixelSeed(hashCombine(_pixel.x, _pixel.y)), sampleIndex(_sampleIndex),
+      rng(PCG32::forSample(pixelSeed, _sampleIndex))
+{
+}
+
+double Sampler::next()
+{
+    u32 d = dimension++;
+    switch (type)
+    {
+    case SOBOL:
+        return scrambledSobol(sampleIndex, d, pixelSeed);
+    case HALTON:
+        if (d < primeCount)
+            return scrambledRadicalInverse(sampleIndex, primes[d], hashCombine(pixelSeed, d));
+        break;
+    case BLUE_NOISE:
+    {
+        // the pixels share the points, their errors are decorrelated by the blue noise shifts
+        double u = scrambledSobol(sampleIndex, d, 0) + blueNoise(pixel, d);
+        return u < 1 ? u : u - 1;
+    }
+    case INDEPENDENT:
+        break;
+    }
+    return rng.uniform();
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,68 @@
+#ifndef RSO_SAMPLER_HPP
+#define RSO_SAMPLER_HPP
+
+#include "Random.hpp"
+
+#include <algorithm>
+
+namespace Morph {
+
+// Sequences the samples of a pixel are drawn from
+enum SamplerType
+{
+  INDEPENDENT,
+  // Owen scrambled Sobol (0,2)-sequences, each pair of dimensions with its own shuffle
+  SOBOL,
+  // Halton with a random digit permutation per node of the radical inverse
+  HALTON,
+  // the same scrambled Sobol points in all the pixels shifted by a blue noise mask per dimension
+  BLUE_NOISE
+};
+
+const char *samplerName(SamplerType type);
+
+// Numbers of one sample of one pixel. Each path vertex owns a fixed range of dimensions
+// and each sampling decision a fixed dimension within it, so a decision gets its numbers
+// from the same low discrepancy dimension in all the samples of the pixel no matter
+// how many numbers the other decisions drew.
+class Sampler
+{
+public:
+  // dimensions of one path vertex, the next numbers after the first one follow it
+  enum Dimension
+  {
+    LIGHT_SELECTION = 0,
+    LIGHT_POINT = 1,
+    BRDF_DIRECTION = 3,
+    ROULETTE = 5,
+    DIMENSIONS_PER_VERTEX = 6
+  };
+
+  Sampler(SamplerType type, uvec2 pixel, u32 sampleIndex);
+
+  // the next numbers are drawn for the decision at the given vertex of the path
+  void start(int vertex, Dimension first) { dimension = (u32)(vertex * DIMENSIONS_PER_VERTEX + first); }
+
+  // next dimension of the sample, uniform in [0, 1)
+  template<typename T = double>
+  T uniform()
+  {
+    // the float conversion would round values just below 1 up
+    return std::min((T)next(), T(1) - std::numeric_limits<T>::epsilon() / 2);
+  }
+
+private:
+  double next();
+
+  SamplerType type;
+  uvec2 pixel;
+  u32 pixelSeed;
+  u32 sampleIndex;
+  u32 dimension = 0;
+  // numbers of the independent sampler and of dimensions past the low discrepancy ones
+  PCG32 rng;
+};
+
+}
+
+#endif // RSO_SAMPLER_HPP
\ No newline at end of file
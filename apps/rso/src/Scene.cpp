@@ -1,5 +1,11 @@
 #include "Scene.hpp"
+#include "TriangleMesh.hpp"
 
+#include <Resource/Generated.hpp>
+#include <Resource/ResourceManager.hpp>
+
+#include <Core/Log.hpp>
+#include <bitset>
 #include <iostream>
 #include <chrono>
 #define _USE_MATH_DEFINES
@@ -7,124 +13,227 @@
 
 namespace Morph {
 
-void Camera::set(const dvec3 &_eye, const dvec3 &_lookat, const dvec3 &_vup, double fov)
+// rays intersected by the thread, the jobs add their part to the scene totals when they finish
+static thread_local u64 threadRays = 0;
+
+void Camera::set(const rvec3 &_eye, const rvec3 &_lookat, const rvec3 &_vup, real fov)
 {
     eye = _eye;
     lookat = _lookat;
-    dvec3 w = eye - lookat;
-    double f = length(w);
-    right = normalize(cross(_vup, w)) * f * tan(fov / 2);
-    up = normalize(cross(w, right)) * f * tan(fov / 2);
+    rvec3 w = eye - lookat;
+    real f = length(w);
+    right = normalize(cross(_vup, w)) * f * std::tan(fov / 2);
+    up = normalize(cross(w, right)) * f * std::tan(fov / 2);
 }
 Ray Camera::getRay(int X, int Y)
 { // X,Y - pixel coordinates, compute a primary ray
-    dvec3 dir = lookat +
-                right * (2.0 * (X + 0.5) / Globals::screenSize.x - 1) +
-                up * (2.0 * (Y + 0.5) / Globals::screenSize.y - 1) - eye;
+    rvec3 dir = lookat +
+                right * real(2.0 * (X + 0.5) / Globals::screenSize.x - 1) +
+                up * real(2.0 * (Y + 0.5) / Globals::screenSize.y - 1) - eye;
     return Ray(eye, normalize(dir));
 }
 
 void Scene::buildHw1_3Test()
 {
-    dvec3 eyePos(0, 6, 18);         // camera center
-    dvec3 lightCenterPos(0, 4, -6); // first light source
+    rvec3 eyePos(0, 6, 18);         // camera center
+    rvec3 lightCenterPos(0, 4, -6); // first light source
 
     // Create geometry - 4 rectangles
-    //objects.push_back(new Rect(dvec3(0, -4, +2), eyePos, lightCenterPos, 8, 1, new TableMaterial(500, dvec3(0), dvec3(1))));
-    //objects.push_back(new Rect(dvec3(0, -3.5, -2), eyePos, lightCenterPos, 8, 1, new TableMaterial(1000, dvec3(0), dvec3(1))));
-    //objects.push_back(new Rect(dvec3(0, -2.5, -6), eyePos, lightCenterPos, 8, 1, new TableMaterial(5000, dvec3(0), dvec3(1))));
-    //objects.push_back(new Rect(dvec3(0, -1, -10), eyePos, lightCenterPos, 8, 1, new TableMaterial(10000, dvec3(0), dvec3(1))));
-
-    //objects.push_back(new Rect(dvec3(0, -4, +2), eyePos, lightCenterPos, 8, 1, new TableMaterial(500, dvec3(1), dvec3(0))));
-    //objects.push_back(new Rect(dvec3(0, -3.5, -2), eyePos, lightCenterPos, 8, 1, new TableMaterial(1000, dvec3(1), dvec3(0))));
-    //objects.push_back(new Rect(dvec3(0, -2.5, -6), eyePos, lightCenterPos, 8, 1, new TableMaterial(5000, dvec3(1), dvec3(0))));
-    //objects.push_back(new Rect(dvec3(0, -1, -10), eyePos, lightCenterPos, 8, 1, new TableMaterial(10000, dvec3(1), dvec3(0))));
-
-    objects.push_back(new Rect(dvec3(0, -4, +2), eyePos, lightCenterPos, 8, 1, new TableMaterial(500, dvec3(0.5), dvec3(0.5))));
-    objects.push_back(new Rect(dvec3(0, -3.5, -2), eyePos, lightCenterPos, 8, 1, new TableMaterial(1000, dvec3(0.5), dvec3(0.5))));
-    objects.push_back(new Rect(dvec3(0, -2.5, -6), eyePos, lightCenterPos, 8, 1, new TableMaterial(5000, dvec3(0.5), dvec3(0.5))));
-    objects.push_back(new Rect(dvec3(0, -1, -10), eyePos, lightCenterPos, 8, 1, new TableMaterial(10000, dvec3(0.5), dvec3(0.5))));
-
-    //objects.push_back(new Rect(dvec3(0, -4, +2), eyePos, lightCenterPos, 8, 1, new TableMaterial(500, dvec3(0.1), dvec3(0.9))));
-    //objects.push_back(new Rect(dvec3(0, -3.5, -2), eyePos, lightCenterPos, 8, 1, new TableMaterial(1000, dvec3(0.3), dvec3(0.6))));
-    //objects.push_back(new Rect(dvec3(0, -2.5, -6), eyePos, lightCenterPos, 8, 1, new TableMaterial(5000, dvec3(0.5), dvec3(0.5))));
-    //objects.push_back(new Rect(dvec3(0, -1, -10), eyePos, lightCenterPos, 8, 1, new TableMaterial(10000, dvec3(0.9), dvec3(0.1))));
+    //objects.push_back(new Rect(rvec3(0, -4, +2), eyePos, lightCenterPos, 8, 1, new TableMaterial(500, rvec3(0), rvec3(1))));
+    //objects.push_back(new Rect(rvec3(0, -3.5, -2), eyePos, lightCenterPos, 8, 1, new TableMaterial(1000, rvec3(0), rvec3(1))));
+    //objects.push_back(new Rect(rvec3(0, -2.5, -6), eyePos, lightCenterPos, 8, 1, new TableMaterial(5000, rvec3(0), rvec3(1))));
+    //objects.push_back(new Rect(rvec3(0, -1, -10), eyePos, lightCenterPos, 8, 1, new TableMaterial(10000, rvec3(0), rvec3(1))));
+
+    //objects.push_back(new Rect(rvec3(0, -4, +2), eyePos, lightCenterPos, 8, 1, new TableMaterial(500, rvec3(1), rvec3(0))));
+    //objects.push_back(new Rect(rvec3(0, -3.5, -2), eyePos, lightCenterPos, 8, 1, new TableMaterial(1000, rvec3(1), rvec3(0))));
+    //objects.push_back(new Rect(rvec3(0, -2.5, -6), eyePos, lightCenterPos, 8, 1, new TableMaterial(5000, rvec3(1), rvec3(0))));
+    //objects.push_back(new Rect(rvec3(0, -1, -10), eyePos, lightCenterPos, 8, 1, new TableMaterial(10000, rvec3(1), rvec3(0))));
+
+    objects.push_back(new Rect(rvec3(0, -4, +2), eyePos, lightCenterPos, 8, 1, new TableMaterial(500, rvec3(0.5), rvec3(0.5))));
+    objects.push_back(new Rect(rvec3(0, -3.5, -2), eyePos, lightCenterPos, 8, 1, new TableMaterial(1000, rvec3(0.5), rvec3(0.5))));
+    objects.push_back(new Rect(rvec3(0, -2.5, -6), eyePos, lightCenterPos, 8, 1, new TableMaterial(5000, rvec3(0.5), rvec3(0.5))));
+    objects.push_back(new Rect(rvec3(0, -1, -10), eyePos, lightCenterPos, 8, 1, new TableMaterial(10000, rvec3(0.5), rvec3(0.5))));
+
+    //objects.push_back(new Rect(rvec3(0, -4, +2), eyePos, lightCenterPos, 8, 1, new TableMaterial(500, rvec3(0.1), rvec3(0.9))));
+    //objects.push_back(new Rect(rvec3(0, -3.5, -2), eyePos, lightCenterPos, 8, 1, new TableMaterial(1000, rvec3(0.3), rvec3(0.6))));
+    //objects.push_back(new Rect(rvec3(0, -2.5, -6), eyePos, lightCenterPos, 8, 1, new TableMaterial(5000, rvec3(0.5), rvec3(0.5))));
+    //objects.push_back(new Rect(rvec3(0, -1, -10), eyePos, lightCenterPos, 8, 1, new TableMaterial(10000, rvec3(0.9), rvec3(0.1))));
 
     // Create 4 light sources
-    objects.push_back(new Sphere(lightCenterPos + dvec3(-4.5, 0, 0), 0.07, new LightMaterial(dvec3(4, 2, 1))));
-    objects.push_back(new Sphere(lightCenterPos + dvec3(-1.5, 0, 0), 0.16, new LightMaterial(dvec3(2, 4, 1))));
-    objects.push_back(new Sphere(lightCenterPos + dvec3(1.5, 0, 0), 0.4, new LightMaterial(dvec3(2, 1, 4))));
-    objects.push_back(new Sphere(lightCenterPos + dvec3(4.5, 0, 0), 1, new LightMaterial(dvec3(4, 1, 2))));
+    objects.push_back(new Sphere(lightCenterPos + rvec3(-4.5, 0, 0), 0.07, new LightMaterial(rvec3(4, 2, 1))));
+    objects.push_back(new Sphere(lightCenterPos + rvec3(-1.5, 0, 0), 0.16, new LightMaterial(rvec3(2, 4, 1))));
+    objects.push_back(new Sphere(lightCenterPos + rvec3(1.5, 0, 0), 0.4, new LightMaterial(rvec3(2, 1, 4))));
+    objects.push_back(new Sphere(lightCenterPos + rvec3(4.5, 0, 0), 1, new LightMaterial(rvec3(4, 1, 2))));
 
     // Set the camera
-    camera.set(eyePos, dvec3(0, 0, 0), dvec3(0, 1, 0), 35.0 * M_PI / 180.0);
+    camera.set(eyePos, rvec3(0, 0, 0), rvec3(0, 1, 0), 35.0 * M_PI / 180.0);
 }
 
 void Scene::buildHw2Test(const char* hdrFilename)
 {
-    dvec3 eyePos(0, 6, 18);         // camera center
-    dvec3 lightCenterPos(0, 4, -6); // first light source
+    rvec3 eyePos(0, 6, 18);         // camera center
+    rvec3 lightCenterPos(0, 4, -6); // first light source
 
-    objects.push_back(new Rect(dvec3(0, -4, +2), eyePos, lightCenterPos, 8, 1, new TableMaterial(500, dvec3(0.5), dvec3(0.5))));
-    objects.push_back(new Rect(dvec3(0, -3.5, -2), eyePos, lightCenterPos, 8, 1, new TableMaterial(1000, dvec3(0.5), dvec3(0.5))));
-    objects.push_back(new Rect(dvec3(0, -2.5, -6), eyePos, lightCenterPos, 8, 1, new TableMaterial(5000, dvec3(0.5), dvec3(0.5))));
-    objects.push_back(new Rect(dvec3(0, -1, -10), eyePos, lightCenterPos, 8, 1, new TableMaterial(10000, dvec3(0.5), dvec3(0.5))));
+    objects.push_back(new Rect(rvec3(0, -4, +2), eyePos, lightCenterPos, 8, 1, new TableMaterial(500, rvec3(0.5), rvec3(0.5))));
+    objects.push_back(new Rect(rvec3(0, -3.5, -2), eyePos, lightCenterPos, 8, 1, new TableMaterial(1000, rvec3(0.5), rvec3(0.5))));
+    objects.push_back(new Rect(rvec3(0, -2.5, -6), eyePos, lightCenterPos, 8, 1, new TableMaterial(5000, rvec3(0.5), rvec3(0.5))));
+    objects.push_back(new Rect(rvec3(0, -1, -10), eyePos, lightCenterPos, 8, 1, new TableMaterial(10000, rvec3(0.5), rvec3(0.5))));
 
-    //objects.push_back(new Sphere(lightCenterPos + dvec3(0, -3, 5), 2, new TableMaterial(5000, dvec3(0.5), dvec3(0.5)), false));
+    //objects.push_back(new Sphere(lightCenterPos + rvec3(0, -3, 5), 2, new TableMaterial(5000, rvec3(0.5), rvec3(0.5)), false));
 
-    objects.push_back(new EnvMap(hdrFilename));
+    objects.push_back(new EnvMap(hdrFilename, jobManager));
 
-    camera.set(eyePos, dvec3(0, 0, 0), dvec3(0, 1, 0), 35.0 * M_PI / 180.0);
+    camera.set(eyePos, rvec3(0, 0, 0), rvec3(0, 1, 0), 35.0 * M_PI / 180.0);
 }
 
 void Scene::buildHw4Test(const char* hdrFilename)
 {
-    dvec3 eyePos(-12, -12, 10);         // camera center
+    rvec3 eyePos(-12, -12, 10);         // camera center
 
-    objects.push_back(new Rect(16, new TableMaterial(500, dvec3(0.5), dvec3(0.5))));
+    objects.push_back(new Rect(16, new TableMaterial(500, rvec3(0.5), rvec3(0.5))));
 
-    objects.push_back(new Sphere(dvec3(-0.5, -4, 2), 2, new TableMaterial(5000, dvec3(0.05), dvec3(0.9)), false));
-    objects.push_back(new Sphere(dvec3(0, 0, 2), 2, new TableMaterial(5000, dvec3(0, 0, 0.75), dvec3(0.2)), false));
-    objects.push_back(new Sphere(dvec3(-4, -0.5, 2), 2, new TableMaterial(5000, dvec3(0.9, 0, 0), dvec3(0.05)), false));
-    objects.push_back(new Sphere(dvec3(-1, -1, 5.5), 2, new TableMaterial(5000, dvec3(0.5), dvec3(0.5)), false));
+    objects.push_back(new Sphere(rvec3(-0.5, -4, 2), 2, new TableMaterial(5000, rvec3(0.05), rvec3(0.9)), false));
+    objects.push_back(new Sphere(rvec3(0, 0, 2), 2, new TableMaterial(5000, rvec3(0, 0, 0.75), rvec3(0.2)), false));
+    objects.push_back(new Sphere(rvec3(-4, -0.5, 2), 2, new TableMaterial(5000, rvec3(0.9, 0, 0), rvec3(0.05)), false));
+    objects.push_back(new Sphere(rvec3(-1, -1, 5.5), 2, new TableMaterial(5000, rvec3(0.5), rvec3(0.5)), false));
 
-    objects.push_back(new Sphere(dvec3(-2, -2, 8), 1, new LightMaterial(dvec3(4, 1, 2))));
-    objects.push_back(new Sphere(dvec3(-5, 0, 5), 0.4, new LightMaterial(dvec3(2, 1, 4))));
+    objects.push_back(new Sphere(rvec3(-2, -2, 8), 1, new LightMaterial(rvec3(4, 1, 2))));
+    objects.push_back(new Sphere(rvec3(-5, 0, 5), 0.4, new LightMaterial(rvec3(2, 1, 4))));
 
-    objects.push_back(new EnvMap(hdrFilename));
+    objects.push_back(new EnvMap(hdrFilename, jobManager));
 
-    camera.set(eyePos, dvec3(0, 0, 0), dvec3(0, 0, 1), 35.0 * M_PI / 180.0);
+    camera.set(eyePos, rvec3(0, 0, 0), rvec3(0, 0, 1), 35.0 * M_PI / 180.0);
 }
 
-void Scene::build(const char* hdrFilename)
+void Scene::buildMeshTest(const char* objFilename)
+{
+    rvec3 eyePos(-12, -12, 10);         // camera center
+
+    objects.push_back(new Rect(16, new TableMaterial(500, rvec3(0.5), rvec3(0.5))));
+
+    opt<IndexedVerticesMesh3D<u32>> mesh;
+    if (*objFilename) {
+        mesh = ResourceManager::LoadMesh3D_OBJ(objFilename);
+        if (!mesh)
+            MORPH_APP_LOG_WARN("cannot load {}, using a generated sphere", objFilename);
+    }
+    if (!mesh)
+        mesh = GeneratedResources::Sphere(512, 256, 1.0f);
+    // scale the model to fit into a box of size 8 standing on the table
+    AABB box;
+    for (const Mesh3DVertex& vertex : mesh->vertices) {
+        box.extend(rvec3(vertex.position));
+    }
+    rvec3 extent = box.extent();
+    real scale = 8.0 / std::max(std::max(extent.x, extent.y), std::max(extent.z, Globals::epsilon));
+    rvec3 translation = -box.center() * scale + rvec3(0, 0, extent.z * scale / 2);
+    objects.push_back(new TriangleMesh(*mesh, new TableMaterial(5000, rvec3(0.5), rvec3(0.3)), translation, scale));
+
+    objects.push_back(new Sphere(rvec3(-2, -2, 12), 1, new LightMaterial(rvec3(4, 1, 2))));
+    objects.push_back(new Sphere(rvec3(-8, 2, 8), 0.4, new LightMaterial(rvec3(2, 1, 4))));
+
+    camera.set(eyePos, rvec3(0, 0, 3), rvec3(0, 0, 1), 35.0 * M_PI / 180.0);
+}
+
+const char* sceneName(SceneType type)
+{
+    switch (type)
+    {
+    case HW1_3_SCENE:
+        return "hw1_3";
+    case HW2_SCENE:
+        return "hw2";
+    case HW4_SCENE:
+        return "hw4";
+    case MESH_SCENE:
+        return "mesh";
+    case SPHERES_SCENE:
+        return "spheres";
+    }
+    return "unknown";
+}
+
+void Scene::buildSpheresTest(int count, u32 seed)
+{
+    rvec3 eyePos(-12, -12, 10);         // camera center
+
+    objects.push_back(new Rect(16, new TableMaterial(500, rvec3(0.5), rvec3(0.5))));
+
+    Material* materials[] = {
+        new TableMaterial(5000, rvec3(0.05), rvec3(0.9)),
+        new TableMaterial(5000, rvec3(0, 0, 0.75), rvec3(0.2)),
+        new TableMaterial(5000, rvec3(0.9, 0, 0), rvec3(0.05)),
+        new TableMaterial(500, rvec3(0.5), rvec3(0.5))
+    };
+    PCG32 rng(seed, 0);
+    // keep the density of the spheres constant in a box standing on the table
+    real side = 8;
+    real radius = side / std::cbrt((real)count) * real(0.3);
+    for (int i = 0; i < count; ++i)
+    {
+        rvec3 center = rvec3(rng.uniform() - 0.5, rng.uniform() - 0.5, rng.uniform()) * side + rvec3(0, 0, radius);
+        objects.push_back(new Sphere(center, radius * real(0.5 + rng.uniform()), materials[rng.nextU32() % 4], false));
+    }
+
+    objects.push_back(new Sphere(rvec3(-2, -2, 12), 1, new LightMaterial(rvec3(4, 1, 2))));
+    objects.push_back(new Sphere(rvec3(-8, 2, 8), 0.4, new LightMaterial(rvec3(2, 1, 4))));
+
+    camera.set(eyePos, rvec3(0, 0, 3), rvec3(0, 0, 1), 35.0 * M_PI / 180.0);
+}
+
+void Scene::build(SceneType type, const char* filename)
 {
     for (Intersectable * obj : objects) {
         delete obj;
     }
     objects.clear();
-    // Create a simple scene
 
-    buildHw1_3Test();
-    //buildHw2Test(hdrFilename);
-    //buildHw4Test(hdrFilename);
+    switch (type)
+    {
+    case HW1_3_SCENE:
+        buildHw1_3Test();
+        break;
+    case HW2_SCENE:
+        buildHw2Test(filename ? filename : "raw013.hdr");
+        break;
+    case HW4_SCENE:
+        buildHw4Test(filename ? filename : "raw013.hdr");
+        break;
+    case MESH_SCENE:
+        buildMeshTest(filename ? filename : "model.obj");
+        break;
+    case SPHERES_SCENE:
+        buildSpheresTest(10000, 1);
+        break;
+    }
 
     totalPower = 0;
+    lights.clear();
+    std::vector<double> lightPowers;
     for (int i = 0; i < objects.size(); i++)
     {
-        totalPower += objects[i]->power; //  hit.t < 0 if no intersection
+        if (objects[i]->power <= 0)
+            continue;
+        totalPower += objects[i]->power;
+        // the light sources are spheres or the environment map derived from Sphere
+        lights.push_back((Sphere *)objects[i]);
+        lightPowers.push_back(objects[i]->power);
     }
+    lightTable.build(lightPowers);
+
+#if MORPH_LOG_ACTIVE_LEVEL <= MORPH_LOG_LEVEL_DEBUG
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+#endif
+    primitives.build(objects);
+#if MORPH_LOG_ACTIVE_LEVEL <= MORPH_LOG_LEVEL_DEBUG
+    MORPH_APP_LOG_DEBUG("store of {} spheres, {} rects and {} other objects with {} bvh nodes took {}[ms]", primitives.sphereCount(), primitives.rectCount(),
+        primitives.primitiveCount() - primitives.sphereCount() - primitives.rectCount(), primitives.nodeCount(),
+        std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - begin).count());
+#endif
 }
 
 void Scene::render()
 {
-    #ifdef ENABLE_MULTITHREADING
-    g_randomGenerators.clear();
-    for (int i = 0; i < omp_get_max_threads(); ++i)
-        g_randomGenerators.push_back(RandGen(i + 1));
-    #else
-    srand(1);
-    #endif
-
     std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
     for (int y = 0; y < Globals::screenSize.y; y++)
     {
@@ -137,9 +246,9 @@ void Scene::render()
             // For a primary ray at pixel (x,y) compute the color
             dvec3 color = dvec3(0);
             if (Globals::method == PATH_TRACING) {
-                color = pathTrace(camera.getRay(x, y));
+                color = pathTrace(camera.getRay(x, y), uvec2(x, y));
             } else {
-                color = trace(camera.getRay(x, y));
+                color = trace(camera.getRay(x, y), uvec2(x, y));
             }
             Globals::hdrImage(x, y) = color;
 
@@ -158,12 +267,19 @@ void Scene::render()
 
 void Scene::renderIteration()
 {
-    //printf("%d\r", Globals::currentNumSamples);
-    printf("%d\n", Globals::currentNumSamples);
     std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+    hasDeadline = Globals::frameBudget > 0;
+    deadline = begin + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(Globals::frameBudget));
+    scheduleTiles();
+    jobRays = 0;
+    jobSamples = 0;
+    jobPrimaryNanoseconds = 0;
+    jobShadingNanoseconds = 0;
+    jobStopped = false;
     if (!Globals::useMultithreading)
     {
-        RaytraceJob job(*this, uvec2(0, 0), Globals::screenSize);
+        jobResumeBlocks.resize(1, 0);
+        RaytraceJob job(*this, uvec2(0, 0), Globals::screenSize, 0);
         job.Run();
     }
     else
@@ -176,13 +292,14 @@ void Scene::renderIteration()
         int yJobCount = std::min(workersCount, bufferSize.y);
         int xBlockSize = bufferSize.x / xJobCount;
         int yBlockSize = bufferSize.y / yJobCount;
+        jobResumeBlocks.resize(xJobCount * yJobCount, 0);
         for (int yJobId = 0; yJobId < yJobCount; ++yJobId) {
             for (int xJobId = 0; xJobId < xJobCount; ++xJobId) {
                 int fromX = xJobId * xBlockSize;
                 int toX = ((xJobId == xJobCount - 1) ? bufferSize.x : (xJobId + 1) * xBlockSize);
                 int fromY = yJobId * yBlockSize;
                 int toY = ((yJobId == xJobCount - 1) ? bufferSize.y : (yJobId + 1) * yBlockSize);
-                RaytraceJob job(*this, uvec2(fromX, fromY), uvec2(toX, toY));
+                RaytraceJob job(*this, uvec2(fromX, fromY), uvec2(toX, toY), (int)jobs.size());
                 jobs.push_back(job);
             }
         }
@@ -192,49 +309,113 @@ void Scene::renderIteration()
         jobManager->WaitForJobsToFinish();
     }
     std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
-    std::cout << "Took " << std::chrono::duration_cast<std::chrono::milliseconds>(end - begin).count() << "[ms]" << std::endl;
+    iterationStats.seconds = std::chrono::duration<double>(end - begin).count();
+    iterationStats.rays = jobRays;
+    iterationStats.samples = jobSamples;
+    iterationStats.primarySeconds = jobPrimaryNanoseconds * 1e-9;
+    iterationStats.shadingSeconds = jobShadingNanoseconds * 1e-9;
+    iterationStats.stopped = jobStopped;
+    MORPH_APP_LOG_DEBUG("samples {} took {}[ms]", Globals::currentNumSamples, std::chrono::duration_cast<std::chrono::milliseconds>(end - begin).count());
     Globals::currentNumSamples += Globals::samplesPerFrame;
+    if (hasDeadline)
+        adaptSamplesPerFrame(iterationStats.seconds, iterationStats.stopped);
 }
 
-Hit Scene::firstIntersect(const Ray &ray, Intersectable *skip)
+void Scene::adaptSamplesPerFrame(double seconds, bool stopped)
 {
-    Hit bestHit;
-    for (int i = 0; i < objects.size(); i++)
+    int& samples = Globals::samplesPerFrame;
+    if (stopped)
+    {
+        // the scheduled work did not fit, halving backs off fast when the scene gets expensive
+        samples = std::max(1, samples / 2);
+        return;
+    }
+    // aim below the budget so the cost varying from frame to frame rarely hits the deadline, and
+    // at most double the samples, the time of an almost empty iteration says little about a full one
+    double scale = std::min(2.0, 0.8 * Globals::frameBudget / std::max(seconds, 1e-6));
+    samples = std::clamp((int)std::lround(samples * scale), 1, std::max(1, Globals::maxSamplesPerFrame));
+}
+
+bool Scene::finished() const
+{
+    if (!Globals::useAdaptiveSampling && Globals::maxSamples <= 0)
+        return false;
+    for (const PixelStats& stats : Globals::pixelStats.flattend())
+    {
+        if (!stats.converged && (Globals::maxSamples <= 0 || stats.samples < Globals::maxSamples))
+            return false;
+    }
+    return true;
+}
+
+void Scene::scheduleTiles()
+{
+    uvec2 tiles = (Globals::screenSize + uvec2(tileSize - 1)) / uvec2(tileSize);
+    tileSamples.assign(tiles, Globals::samplesPerFrame);
+    if (!Globals::useAdaptiveSampling)
+        return;
+    for (uint tileY = 0; tileY < tiles.y; ++tileY)
     {
-        if (objects[i] == skip)
-        continue;
-        Hit hit = objects[i]->intersect(ray); //  hit.t < 0 if no intersection
-        if (hit.t > Globals::epsilon)
+        for (uint tileX = 0; tileX < tiles.x; ++tileX)
         {
-        if (bestHit.t < 0 || hit.t < bestHit.t)
-            bestHit = hit;
+            // the worst pixel decides, pixels without enough samples count as just above the threshold
+            double error = 0;
+            bool active = false;
+            uint toX = std::min((tileX + 1) * tileSize, Globals::screenSize.x);
+            uint toY = std::min((tileY + 1) * tileSize, Globals::screenSize.y);
+            for (uint y = tileY * tileSize; y < toY; ++y)
+            {
+                for (uint x = tileX * tileSize; x < toX; ++x)
+                {
+                    const PixelStats& stats = Globals::pixelStats(x, y);
+                    if (stats.converged)
+                        continue;
+                    active = true;
+                    error = std::max(error, stats.samples < Globals::adaptiveMinSamples ? Globals::adaptiveThreshold : stats.relativeError());
+                }
+            }
+            int boost = 0;
+            if (active)
+                boost = (int)std::max(1.0, std::min(std::ceil(error / Globals::adaptiveThreshold), (double)Globals::adaptiveMaxBoost));
+            tileSamples(tileX, tileY) = Globals::samplesPerFrame * boost;
         }
     }
-    return bestHit;
 }
 
-LightSource Scene::sampleLightSource(const dvec3 &illuminatedPoint, int workerId) // the 3D point on an object
+int Scene::pixelSamples(int x, int y) const
 {
-    while (true)
-    { // if no light source is selected due to floating point inaccuracies, repeat
-        double threshold = totalPower * Globals::drandom(workerId);
-        double running = 0;
-        for (int i = 0; i < objects.size(); i++)
-        {
-        running += objects[i]->power; // select light source with the probability proportional to its power
-        if (running > threshold)
-        {
-            Sphere *sphere = (Sphere *)objects[i];
-            dvec3 point, normal;
-            // select a point on the visible half of the light source
-            ((Sphere *)objects[i])->samplePoint(illuminatedPoint, point, normal, workerId);
-            return LightSource(sphere, point, normal);
-        } // if
-        }   // for i
-    }     // for ever
+    const PixelStats& stats = Globals::pixelStats(x, y);
+    if (stats.converged)
+        return 0;
+    int samples = tileSamples(x / tileSize, y / tileSize);
+    if (Globals::maxSamples > 0)
+        samples = std::min(samples, Globals::maxSamples - stats.samples);
+    return std::max(samples, 0);
+}
+
+Hit Scene::firstIntersect(const Ray &ray, Intersectable *skip)
+{
+    threadRays++;
+    return primitives.intersect(ray, skip);
+}
+
+void Scene::firstIntersectPacket(const RayPacket4 &packet, Hit *hits)
+{
+    threadRays += std::bitset<RayPacket4::size>(packet.activeBits).count();
+    primitives.intersectPacket(packet, hits);
+}
+
+LightSource Scene::sampleLightSource(const rvec3 &illuminatedPoint, Sampler &sampler) // the 3D point on an object
+{
+    // select light source with the probability proportional to its power
+    Sphere *sphere = lights[lightTable.sample(sampler.uniform())];
+    rvec3 point, normal;
+    // select a point on the visible half of the light source
+    sphere->samplePoint(illuminatedPoint, point, normal, sampler);
+    return LightSource(sphere, point, normal);
 }
 
-dvec3 Scene::pathTrace(const Ray &primaryRay)
+dvec3 Scene::pathTrace(const Ray &primaryRay, uvec2 pixel)
 {
     Hit primaryHit = firstIntersect(primaryRay, nullptr);
     if (primaryHit.t < 0)
@@ -242,7 +423,7 @@ dvec3 Scene::pathTrace(const Ray &primaryRay)
 
     if (average(primaryHit.material->diffuseAlbedo) < Globals::epsilon &&
         average(primaryHit.material->specularAlbedo) < Globals::epsilon) {
-        return primaryHit.material->getLe(primaryRay.dir);
+        return dvec3(primaryHit.material->getLe(primaryRay.dir));
     }
 
     dvec3 radiance(0, 0, 0);
@@ -261,11 +442,17 @@ dvec3 Scene::pathTrace(const Ray &primaryRay)
     #endif
 
     dvec3 localRadiance(0, 0, 0);
+    #ifdef ENABLE_MULTITHREADING
+    int firstSample = omp_get_thread_num() * localSamples;
+    #else
+    int firstSample = 0;
+    #endif
 
     for (int i = 0; i < localSamples; i++)
     {
-        dvec3 radianceTraced = pathTraceSample(primaryRay, primaryHit, 0);
-        localRadiance += radianceTraced / (double)Globals::nTotalSamples;
+        Sampler sampler(Globals::sampler, pixel, firstSample + i);
+        rvec3 radianceTraced = pathTraceSample(primaryRay, primaryHit, sampler);
+        localRadiance += dvec3(radianceTraced) / (double)Globals::nTotalSamples;
     }
     #ifdef ENABLE_MULTITHREADING
     #pragma omp critical
@@ -278,10 +465,10 @@ dvec3 Scene::pathTrace(const Ray &primaryRay)
     return radiance;
 }
 
-dvec3 Scene::pathTraceSample(const Ray &primaryRay, const Hit& primaryHit, int workerId)
+rvec3 Scene::pathTraceSample(const Ray &primaryRay, const Hit& primaryHit, Sampler &sampler)
 {
-    dvec3 radianceTraced(0, 0, 0);
-    double factor = 1;
+    rvec3 radianceTraced(0, 0, 0);
+    real factor = 1;
     Ray r = primaryRay;
     Intersectable* ignore = nullptr;
     int depth = 0;
@@ -295,81 +482,84 @@ dvec3 Scene::pathTraceSample(const Ray &primaryRay, const Hit& primaryHit, int w
         if (hit.t < 0)
             break;
 
-        dvec3 radianceEmitted = hit.material->getLe(r.dir);
+        rvec3 radianceEmitted = hit.material->getLe(r.dir);
         radianceTraced += factor * radianceEmitted;
         if (average(hit.material->diffuseAlbedo) < Globals::epsilon &&
             average(hit.material->specularAlbedo) < Globals::epsilon) {
             break;
         }
-        dvec3 inDir = r.dir * (-1.0); // incident direction
+        rvec3 inDir = -r.dir; // incident direction
 
-        LightSource lightSample = sampleLightSource(hit.position, workerId); // generate a light sample
-        dvec3 outDir = lightSample.point - hit.position;            // compute direction towards sample
-        double distance2 = dot(outDir, outDir);
-        double distance = sqrt(distance2);
+        sampler.start(depth, Sampler::LIGHT_SELECTION);
+        LightSource lightSample = sampleLightSource(hit.position, sampler); // generate a light sample
+        rvec3 outDir = lightSample.point - hit.position;            // compute direction towards sample
+        real distance2 = dot(outDir, outDir);
+        real distance = sqrt(distance2);
         if (distance >= Globals::epsilon)
         {
             outDir = outDir / distance; // normalize the direction
-            double cosThetaLight = dot(lightSample.normal, outDir * (-1.0));
+            real cosThetaLight = dot(lightSample.normal, -outDir);
             if (cosThetaLight > Globals::epsilon)
             {
                 // visibility is not needed to handle, all lights are visible
-                double pdfLightSourceSampling = lightSample.sphere->pointSampleProb(totalPower, outDir) * distance2 / cosThetaLight;
-                double pdfBRDFSampling = hit.material->sampleProb(hit.normal, inDir, outDir);
+                real pdfLightSourceSampling = lightSample.sphere->pointSampleProb(totalPower, outDir) * distance2 / cosThetaLight;
+                real pdfBRDFSampling = hit.material->sampleProb(hit.normal, inDir, outDir);
                 // the theta angle on the surface between normal and light direction
-                double cosThetaSurface = dot(hit.normal, outDir);
+                real cosThetaSurface = dot(hit.normal, outDir);
                 if (cosThetaSurface > 0)
                 {
                     // yes, the light is visible and contributes to the output power
                     // The evaluation of rendering equation locally: (light power) * brdf * cos(theta)
-                    dvec3 f = lightSample.sphere->material->getLe(outDir) *
+                    rvec3 f = lightSample.sphere->material->getLe(outDir) *
                             hit.material->BRDF(hit.normal, inDir, outDir) * cosThetaSurface;
-                    double p = pdfLightSourceSampling + pdfBRDFSampling;
+                    real p = pdfLightSourceSampling + pdfBRDFSampling;
                     // importance sample = 1/n . \sum (f/prob)
-                    radianceTraced += 0.5 * factor * f / p;
+                    radianceTraced += real(0.5) * factor * f / p;
                 } // if
             }
         }
         
-        outDir = dvec3(0);
+        outDir = rvec3(0);
         // BRDF sampling with Russian roulette
-        if (!hit.material->sampleDirection(hit.normal, inDir, outDir, workerId)) {
+        sampler.start(depth, Sampler::BRDF_DIRECTION);
+        if (!hit.material->sampleDirection(hit.normal, inDir, outDir, sampler)) {
             break;
         }
-        double pdfBRDFSampling = hit.material->sampleProb(hit.normal, inDir, outDir);
-        double cosThetaSurface = dot(hit.normal, outDir);
+        real pdfBRDFSampling = hit.material->sampleProb(hit.normal, inDir, outDir);
+        real cosThetaSurface = dot(hit.normal, outDir);
         if (cosThetaSurface <= 0) {
             break;
         }
-        dvec3 brdf = hit.material->BRDF(hit.normal, inDir, outDir);
+        rvec3 brdf = hit.material->BRDF(hit.normal, inDir, outDir);
         // Trace a ray to the scene
         Hit lightSource = firstIntersect(Ray(hit.position, outDir), hit.object);
         // Do we hit a light source
         if (lightSource.t > 0 && average(lightSource.material->getLe(outDir)) > 0)
         {
-            dvec3 dirToLight = lightSource.position - hit.position;
+            rvec3 dirToLight = lightSource.position - hit.position;
             // squared distance between an illuminated point and light source
-            double distance2 = dot(dirToLight, dirToLight);
-            double cosThetaLight = dot(lightSource.normal, outDir * (-1.0));
+            real distance2 = dot(dirToLight, dirToLight);
+            real cosThetaLight = dot(lightSource.normal, -outDir);
             if (cosThetaLight > Globals::epsilon)
             {
-                double pdfLightSourceSampling = lightSource.object->pointSampleProb(totalPower, outDir) * distance2 / cosThetaLight;
+                real pdfLightSourceSampling = lightSource.object->pointSampleProb(totalPower, outDir) * distance2 / cosThetaLight;
                 // The evaluation of rendering equation locally: (light power) * brdf * cos(theta)
-                dvec3 f = lightSource.material->getLe(outDir) * brdf * cosThetaSurface;
-                double p = pdfBRDFSampling + pdfLightSourceSampling;
-                radianceTraced += 0.5 * factor * f / p;
+                rvec3 f = lightSource.material->getLe(outDir) * brdf * cosThetaSurface;
+                real p = pdfBRDFSampling + pdfLightSourceSampling;
+                radianceTraced += real(0.5) * factor * f / p;
             }
             else
                 printf("ERROR: Sphere hit from back\n");
         } else {
-            double continueProb = std::min(0.9, average(hit.material->specularAlbedo));
-            double e = Globals::drandom(workerId);
+            real continueProb = std::min(real(0.9), average(hit.material->specularAlbedo));
+            sampler.start(depth, Sampler::ROULETTE);
+            real e = sampler.uniform<real>();
             if (e >= continueProb)
                 break;
 
             r = Ray(hit.position, outDir);
             ignore = hit.object;
-            factor *= 0.5;
+            factor *= real(0.5);
         }
 
         depth++;
@@ -377,14 +567,14 @@ dvec3 Scene::pathTraceSample(const Ray &primaryRay, const Hit& primaryHit, int w
     return radianceTraced;
 }
 
-dvec3 Scene::trace(const Ray &r)
+dvec3 Scene::trace(const Ray &r, uvec2 pixel)
 {
     // error measures for the two combined techniques: used for adaptation
     Hit hit = firstIntersect(r, NULL); // find visible point
     if (hit.t < 0)
         return dvec3(0, 0, 0);
     // The energy emanated from the material
-    dvec3 radianceEmitted = hit.material->getLe(r.dir);
+    dvec3 radianceEmitted = dvec3(hit.material->getLe(r.dir));
     if (average(hit.material->diffuseAlbedo) < Globals::epsilon &&
         average(hit.material->specularAlbedo) < Globals::epsilon)
         return radianceEmitted; // if albedo is low, no energy can be reefleted
@@ -412,9 +602,15 @@ dvec3 Scene::trace(const Ray &r)
         #endif
 
         dvec3 localRadianceLightSourceSampling(0);
+        #ifdef ENABLE_MULTITHREADING
+        int firstSample = omp_get_thread_num() * localLighSamples;
+        #else
+        int firstSample = 0;
+        #endif
         for (int i = 0; i < localLighSamples; i++)
         {
-            localRadianceLightSourceSampling += traceLightSample(r, hit, 0) / (double)Globals::nTotalSamples;
+            Sampler sampler(Globals::sampler, pixel, firstSample + i);
+            localRadianceLightSourceSampling += dvec3(traceLightSample(r, hit, sampler)) / (double)Globals::nTotalSamples;
         } // for all the samples from light
         #ifdef ENABLE_MULTITHREADING
         #pragma omp critical
@@ -433,9 +629,16 @@ dvec3 Scene::trace(const Ray &r)
         #endif
 
         dvec3 localRadianceBRDFSampling(0);
+        #ifdef ENABLE_MULTITHREADING
+        int firstSample = omp_get_thread_num() * localBRDFSamples;
+        #else
+        int firstSample = 0;
+        #endif
         for (int i = 0; i < localBRDFSamples; i++)
         {
-            localRadianceBRDFSampling += traceBRDFSample(r, hit, 0) / (double)Globals::nTotalSamples;
+            // the BRDF and light samples use different dimensions of the sample
+            Sampler sampler(Globals::sampler, pixel, firstSample + i);
+            localRadianceBRDFSampling += dvec3(traceBRDFSample(r, hit, sampler)) / (double)Globals::nTotalSamples;
         } // for i
         #ifdef ENABLE_MULTITHREADING
         #pragma omp critical
@@ -450,31 +653,32 @@ dvec3 Scene::trace(const Ray &r)
 }
 
 
-dvec3 Scene::traceLightSample(const Ray &r, const Hit& hit, int workerId)
+rvec3 Scene::traceLightSample(const Ray &r, const Hit& hit, Sampler &sampler)
 {
-    dvec3 radiance = dvec3(0);
-    dvec3 inDir = r.dir * (-1.0); // incident direction
-    LightSource lightSample = sampleLightSource(hit.position, workerId); // generate a light sample
-    dvec3 outDir = lightSample.point - hit.position;            // compute direction towards sample
-    double distance2 = dot(outDir, outDir);
-    double distance = sqrt(distance2);
+    rvec3 radiance = rvec3(0);
+    rvec3 inDir = -r.dir; // incident direction
+    sampler.start(0, Sampler::LIGHT_SELECTION);
+    LightSource lightSample = sampleLightSource(hit.position, sampler); // generate a light sample
+    rvec3 outDir = lightSample.point - hit.position;            // compute direction towards sample
+    real distance2 = dot(outDir, outDir);
+    real distance = sqrt(distance2);
     if (distance >= Globals::epsilon)
     {
         outDir = outDir / distance; // normalize the direction
-        double cosThetaLight = dot(lightSample.normal, outDir * (-1.0));
+        real cosThetaLight = dot(lightSample.normal, -outDir);
         if (cosThetaLight > Globals::epsilon)
         {
             // visibility is not needed to handle, all lights are visible
-            double pdfLightSourceSampling = lightSample.sphere->pointSampleProb(totalPower, outDir) * distance2 / cosThetaLight;
-            double pdfBRDFSampling = hit.material->sampleProb(hit.normal, inDir, outDir);
+            real pdfLightSourceSampling = lightSample.sphere->pointSampleProb(totalPower, outDir) * distance2 / cosThetaLight;
+            real pdfBRDFSampling = hit.material->sampleProb(hit.normal, inDir, outDir);
             // the theta angle on the surface between normal and light direction
-            double cosThetaSurface = dot(hit.normal, outDir);
+            real cosThetaSurface = dot(hit.normal, outDir);
             if (cosThetaSurface > 0)
             {
                 // yes, the light is visible and contributes to the output power
                 // The evaluation of rendering equation locally: (light power) * brdf * cos(theta)
-                dvec3 f = lightSample.sphere->material->getLe(outDir) * hit.material->BRDF(hit.normal, inDir, outDir) * cosThetaSurface;
-                double p = pdfLightSourceSampling;
+                rvec3 f = lightSample.sphere->material->getLe(outDir) * hit.material->BRDF(hit.normal, inDir, outDir) * cosThetaSurface;
+                real p = pdfLightSourceSampling;
                 if (Globals::method == MULTIPLE_IMPORTANCE) {
                     p += pdfBRDFSampling;
                 }
@@ -486,35 +690,36 @@ dvec3 Scene::traceLightSample(const Ray &r, const Hit& hit, int workerId)
     return radiance;
 }
 
-dvec3 Scene::traceBRDFSample(const Ray &r, const Hit& hit, int workerId)
+rvec3 Scene::traceBRDFSample(const Ray &r, const Hit& hit, Sampler &sampler)
 {
-    dvec3 radiance = dvec3(0);
-    dvec3 inDir = r.dir * (-1.0); // incident direction
+    rvec3 radiance = rvec3(0);
+    rvec3 inDir = -r.dir; // incident direction
     // BRDF.cos(theta) sampling should be implemented first!
-    dvec3 outDir = dvec3(0);
+    rvec3 outDir = rvec3(0);
     // BRDF sampling with Russian roulette
-    if (hit.material->sampleDirection(hit.normal, inDir, outDir, workerId))
+    sampler.start(0, Sampler::BRDF_DIRECTION);
+    if (hit.material->sampleDirection(hit.normal, inDir, outDir, sampler))
     {
-        double pdfBRDFSampling = hit.material->sampleProb(hit.normal, inDir, outDir);
-        double cosThetaSurface = dot(hit.normal, outDir);
+        real pdfBRDFSampling = hit.material->sampleProb(hit.normal, inDir, outDir);
+        real cosThetaSurface = dot(hit.normal, outDir);
         if (cosThetaSurface > 0)
         {
-            dvec3 brdf = hit.material->BRDF(hit.normal, inDir, outDir);
+            rvec3 brdf = hit.material->BRDF(hit.normal, inDir, outDir);
             // Trace a ray to the scene
             Hit lightSource = firstIntersect(Ray(hit.position, outDir), hit.object);
             // Do we hit a light source
             if (lightSource.t > 0 && average(lightSource.material->getLe(outDir)) > 0)
             {
-                dvec3 dirToLight = lightSource.position - hit.position;
+                rvec3 dirToLight = lightSource.position - hit.position;
                 // squared distance between an illuminated point and light source
-                double distance2 = dot(dirToLight, dirToLight);
-                double cosThetaLight = dot(lightSource.normal, outDir * (-1.0));
+                real distance2 = dot(dirToLight, dirToLight);
+                real cosThetaLight = dot(lightSource.normal, -outDir);
                 if (cosThetaLight > Globals::epsilon)
                 {
-                    double pdfLightSourceSampling = lightSource.object->pointSampleProb(totalPower, outDir) * distance2 / cosThetaLight;
+                    real pdfLightSourceSampling = lightSource.object->pointSampleProb(totalPower, outDir) * distance2 / cosThetaLight;
                     // The evaluation of rendering equation locally: (light power) * brdf * cos(theta)
-                    dvec3 f = lightSource.material->getLe(outDir) * brdf * cosThetaSurface;
-                    double p = pdfBRDFSampling;
+                    rvec3 f = lightSource.material->getLe(outDir) * brdf * cosThetaSurface;
+                    real p = pdfBRDFSampling;
                     if (Globals::method == MULTIPLE_IMPORTANCE) {
                         p += pdfLightSourceSampling;
                     }
@@ -531,60 +736,156 @@ dvec3 Scene::traceBRDFSample(const Ray &r, const Hit& hit, int workerId)
 void Scene::testRay(int X, int Y)
 {
     nBRDFSamples = nLightSamples = 1000;
-    dvec3 current = trace(camera.getRay(X, Y));
+    dvec3 current = trace(camera.getRay(X, Y), uvec2(X, Y));
     printf("Pixel %d, %d Value = %f, %f, %f\n", X, Y, current.x, current.y, current.z);
 }
 
 void Scene::RaytraceJob::Run()
 {
-    bool computeLightSamples = Globals::weight > 0;
-    bool computeBRDFSamples = Globals::weight < 1;
-    for (int y = _chunkFrom.y; y < _chunkTo.y; y++)
+    using Clock = std::chrono::steady_clock;
+    u64 raysBefore = threadRays;
+    u64 samplesTaken = 0;
+    Clock::duration primaryTime(0), shadingTime(0);
+    // 2x2 pixel blocks in rows of strips, taken round robin from where the last stopped iteration was cut off
+    int blocksX = (_chunkTo.x - _chunkFrom.x + 1) / 2;
+    int blockCount = blocksX * ((_chunkTo.y - _chunkFrom.y + 1) / 2);
+    int& resumeBlock = _scene->jobResumeBlocks[_index];
+    int firstBlock = blockCount > 0 ? resumeBlock % blockCount : 0;
+    // the primary rays of a segment of a strip are traced before the shading, short segments waste
+    // little primary work when the deadline cuts the shading
+    const int segmentBlocks = 32;
+    std::vector<int> pixelX(4 * segmentBlocks), pixelY(4 * segmentBlocks), samples(4 * segmentBlocks), blockRays(segmentBlocks + 1);
+    std::vector<Ray> rays(4 * segmentBlocks);
+    std::vector<Hit> hits(4 * segmentBlocks);
+    for (int done = 0; done < blockCount;)
     {
-        for (int x = _chunkFrom.x; x < _chunkTo.x; x++)
+        int block = (firstBlock + done) % blockCount;
+        int y = _chunkFrom.y + 2 * (block / blocksX);
+        int fromBlockX = block % blocksX;
+        int toBlockX = std::min({blocksX, fromBlockX + segmentBlocks, fromBlockX + blockCount - done});
+        Clock::time_point primaryBegin = Clock::now();
+        if (_scene->hasDeadline && primaryBegin >= _scene->deadline)
         {
-            Ray ray = _scene->camera.getRay(x, y);
-            Hit hit = _scene->firstIntersect(ray, NULL); // find visible point
-            
-            int sampleMultiplier = 1;
-            dvec3 radiance = dvec3(0);
-            if (hit.t >= 0) {
-                for (int i = 0; i < Globals::samplesPerFrame; i++)
+            resumeBlock = block;
+            _scene->jobStopped = true;
+            break;
+        }
+
+        int rayCount = 0;
+        // primary rays of 2x2 pixel blocks are coherent, secondary rays are traced one by one
+        for (int bx = fromBlockX; bx < toBlockX; bx++)
+        {
+            int x = _chunkFrom.x + 2 * bx;
+            int blockBegin = rayCount;
+            blockRays[bx - fromBlockX] = blockBegin;
+            for (int dy = 0; dy < 2 && y + dy < (int)_chunkTo.y; dy++)
+            {
+                for (int dx = 0; dx < 2 && x + dx < (int)_chunkTo.x; dx++)
                 {
-                    // The energy emanated from the material
-                    dvec3 radianceEmitted = hit.material->getLe(ray.dir);
-                    if (average(hit.material->diffuseAlbedo) < Globals::epsilon && average(hit.material->specularAlbedo) < Globals::epsilon) {
-                        radiance += radianceEmitted; // if albedo is low, no energy can be reefleted
-                    }
-                    else if (Globals::method == PATH_TRACING) {
-                        radiance += _scene->pathTraceSample(ray, hit, GetWorkerId());
-                    } else {
-                        if (computeLightSamples && computeBRDFSamples) {
-                            sampleMultiplier = 2;
-                        }
-                        if (computeLightSamples) {
-                            radiance += _scene->traceLightSample(ray, hit, GetWorkerId());
-                        }
-                        if (computeBRDFSamples) {
-                            radiance += _scene->traceBRDFSample(ray, hit, GetWorkerId());
-                        }
-                    }
+                    // converged pixels are skipped
+                    samples[rayCount] = _scene->pixelSamples(x + dx, y + dy);
+                    if (samples[rayCount] == 0)
+                        continue;
+                    pixelX[rayCount] = x + dx;
+                    pixelY[rayCount] = y + dy;
+                    rays[rayCount++] = _scene->camera.getRay(x + dx, y + dy);
                 }
             }
-            Globals::radianceAccumulator(x, y) += radiance;
-            int numSamples = Globals::currentNumSamples * sampleMultiplier;
-            Globals::hdrImage(x, y) = Globals::radianceAccumulator(x, y) / (double)numSamples;
+            int blockRayCount = rayCount - blockBegin;
+            if (blockRayCount == 0)
+                continue;
 
-            // map HDR to LDR
-            vec3 hdrColor = Globals::hdrImage(x, y);
-            vec3 mapped = vec3(1.0) - glm::exp(-hdrColor * Globals::exposure);
-            // gamma correction 
-            mapped = glm::pow(mapped, vec3(1.0 / Globals::gamma));
-            Globals::ldrImage(x, y) = mapped;
+            if (Globals::usePacketTracing)
+            {
+                RayPacket4 packet(&rays[blockBegin], blockRayCount);
+                _scene->firstIntersectPacket(packet, &hits[blockBegin]);
+            }
+            else
+            {
+                for (int i = blockBegin; i < rayCount; i++)
+                    hits[i] = _scene->firstIntersect(rays[i], NULL); // find visible point
+            }
+        }
+        blockRays[toBlockX - fromBlockX] = rayCount;
+
+        Clock::time_point shadingBegin = Clock::now();
+        int stopBlock = -1;
+        for (int b = 0; b < toBlockX - fromBlockX; b++)
+        {
+            // a clock read every 4 blocks costs nothing next to the shading
+            if (_scene->hasDeadline && b > 0 && b % 4 == 0 && Clock::now() >= _scene->deadline)
+            {
+                stopBlock = block + b;
+                break;
+            }
+            for (int i = blockRays[b]; i < blockRays[b + 1]; i++)
+            {
+                shadePixel(pixelX[i], pixelY[i], samples[i], rays[i], hits[i]);
+                samplesTaken += samples[i];
+            }
+        }
+        Clock::time_point shadingEnd = Clock::now();
+        primaryTime += shadingBegin - primaryBegin;
+        shadingTime += shadingEnd - shadingBegin;
+        if (stopBlock >= 0)
+        {
+            resumeBlock = stopBlock;
+            _scene->jobStopped = true;
+            break;
+        }
+        done += toBlockX - fromBlockX;
+    }
+    _scene->jobRays += threadRays - raysBefore;
+    _scene->jobSamples += samplesTaken;
+    _scene->jobPrimaryNanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>(primaryTime).count();
+    _scene->jobShadingNanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>(shadingTime).count();
+}
+
+void Scene::RaytraceJob::shadePixel(int x, int y, int samples, const Ray& ray, const Hit& hit)
+{
+    bool computeLightSamples = Globals::weight > 0;
+    bool computeBRDFSamples = Globals::weight < 1;
+    // if albedo is low, no energy can be reflected and the emitted energy is the radiance
+    bool emissionOnly = hit.t < 0 ||
+        (average(hit.material->diffuseAlbedo) < Globals::epsilon && average(hit.material->specularAlbedo) < Globals::epsilon);
+    int sampleMultiplier = !emissionOnly && Globals::method != PATH_TRACING && computeLightSamples && computeBRDFSamples ? 2 : 1;
+    PixelStats& stats = Globals::pixelStats(x, y);
+    dvec3 radiance = dvec3(0);
+    for (int i = 0; i < samples; i++)
+    {
+        dvec3 sampleRadiance = dvec3(0);
+        if (hit.t >= 0) {
+            // samples of the previous iterations were numbered before this one
+            Sampler sampler(Globals::sampler, uvec2(x, y), stats.samples);
+            if (emissionOnly) {
+                // The energy emanated from the material
+                sampleRadiance = dvec3(hit.material->getLe(ray.dir));
+            }
+            else if (Globals::method == PATH_TRACING) {
+                sampleRadiance = dvec3(_scene->pathTraceSample(ray, hit, sampler));
+            } else {
+                if (computeLightSamples) {
+                    sampleRadiance += dvec3(_scene->traceLightSample(ray, hit, sampler));
+                }
+                if (computeBRDFSamples) {
+                    sampleRadiance += dvec3(_scene->traceBRDFSample(ray, hit, sampler));
+                }
+            }
         }
+        radiance += sampleRadiance;
+        stats.add(average(sampleRadiance) / sampleMultiplier);
     }
-    
-    //printf("job finished\n");
+    Globals::radianceAccumulator(x, y) += radiance;
+    Globals::hdrImage(x, y) = Globals::radianceAccumulator(x, y) / (double)(stats.samples * sampleMultiplier);
+    if (Globals::useAdaptiveSampling && stats.samples >= Globals::adaptiveMinSamples && stats.relativeError() < Globals::adaptiveThreshold)
+        stats.converged = true;
+
+    // map HDR to LDR
+    vec3 hdrColor = Globals::hdrImage(x, y);
+    vec3 mapped = vec3(1.0) - glm::exp(-hdrColor * Globals::exposure);
+    // gamma correction 
+    mapped = glm::pow(mapped, vec3(1.0 / Globals::gamma));
+    Globals::ldrImage(x, y) = mapped;
 }
 
 }
\ No newline at end of file
@@ -3,17 +3,52 @@
 
 #include <Core/JobManager.hpp>
 
+#include "AliasTable.hpp"
 #include "EnvMap.hpp"
+#include "PrimitiveStore.hpp"
+
+#include <atomic>
+#include <chrono>
 
 namespace Morph {
 
+// Test scenes of Scene::build
+enum SceneType
+{
+  HW1_3_SCENE,
+  // table with an environment map
+  HW2_SCENE,
+  // spheres on a table with an environment map
+  HW4_SCENE,
+  // OBJ model on a table
+  MESH_SCENE,
+  // 10k random spheres on a table
+  SPHERES_SCENE
+};
+
+const char* sceneName(SceneType type);
+
+// Cost of one Scene::renderIteration
+struct IterationStats
+{
+  double seconds = 0;
+  // primary, secondary and shadow rays
+  u64 rays = 0;
+  u64 samples = 0;
+  // time of the workers summed, in the primary rays and in the shading of the samples
+  double primarySeconds = 0;
+  double shadingSeconds = 0;
+  // the iteration ran into the deadline of Globals::frameBudget before every pixel had its samples
+  bool stopped = false;
+};
+
 // The light source represented by a sphere
 struct LightSource
 {
   Sphere *sphere;
-  dvec3 point;
-  dvec3 normal;
-  LightSource(Sphere *_sphere, dvec3 _point, dvec3 _normal)
+  rvec3 point;
+  rvec3 normal;
+  LightSource(Sphere *_sphere, rvec3 _point, rvec3 _normal)
   {
     sphere = _sphere, point = _point;
     normal = _normal;
@@ -24,10 +59,10 @@ struct LightSource
 class Camera
 {
   // center of projection and orthogonal basis of the camera
-  dvec3 eye, lookat, right, up;
+  rvec3 eye, lookat, right, up;
 
 public:
-  void set(const dvec3 &_eye, const dvec3 &_lookat, const dvec3 &_vup, double fov);
+  void set(const rvec3 &_eye, const rvec3 &_lookat, const rvec3 &_vup, real fov);
   Ray getRay(int X, int Y);
 };
 
@@ -36,7 +71,12 @@ class Scene
 {
 
   std::vector<Intersectable *> objects;
-  double totalPower;
+  // type sorted copy of the objects with their acceleration structures, rebuilt in build()
+  PrimitiveStore primitives;
+  real totalPower;
+  // the emitting objects and their selection proportional to the power, rebuilt in build()
+  std::vector<Sphere *> lights;
+  AliasTable lightTable;
   int nLightSamples, nBRDFSamples;
 
   JobManager* jobManager;
@@ -52,42 +92,86 @@ public:
 
   void buildHw4Test(const char* hdrFilename);
 
-  void build(const char* hdrFilename = "raw013.hdr");
+  // OBJ model on a table, falls back to a tessellated sphere when the file cannot be loaded or the name is empty
+  void buildMeshTest(const char* objFilename);
+
+  // many random spheres of a few shared materials above a table, the same for the same seed
+  void buildSpheresTest(int count, u32 seed);
+
+  // filename is the HDR environment map or the OBJ model of the scene, the default files when null
+  void build(SceneType type = HW1_3_SCENE, const char* filename = nullptr);
 
   // Render the scene
   void render();
+  // Samples of the pixels that are not converged yet, scheduled per tile by the error estimates.
+  // With Globals::frameBudget the iteration stops at the deadline and adapts Globals::samplesPerFrame.
   void renderIteration();
+  // every pixel converged or took Globals::maxSamples samples, the stop condition of headless renders
+  bool finished() const;
+  const IterationStats& lastIteration() const { return iterationStats; }
 
   // Compute intersection between a rady and primitive
   Hit firstIntersect(const Ray &ray, Intersectable *skip);
 
-  // Sample the light source from all the light sources in the scene
-  LightSource sampleLightSource(const dvec3 &illuminatedPoint, int workerId);
+  // Closest hits of the packet rays, used for the coherent primary rays
+  void firstIntersectPacket(const RayPacket4 &packet, Hit *hits);
 
-  dvec3 pathTrace(const Ray &primaryRay);
+  // Sample the light source from all the light sources in the scene in constant time
+  LightSource sampleLightSource(const rvec3 &illuminatedPoint, Sampler &sampler);
 
-  dvec3 pathTraceSample(const Ray &primaryRay, const Hit& primaryHit, int workerId);
+  // the samples of the pixel are drawn by samplers of the pixel and the sample number
+  dvec3 pathTrace(const Ray &primaryRay, uvec2 pixel);
+
+  // radiance of a single sample in the renderer precision, sums over many samples are kept in double
+  rvec3 pathTraceSample(const Ray &primaryRay, const Hit& primaryHit, Sampler &sampler);
 
   // Trace a primary ray towards the scene
-  dvec3 trace(const Ray &r);
+  dvec3 trace(const Ray &r, uvec2 pixel);
 
-  dvec3 traceLightSample(const Ray &r, const Hit& hit, int workerId);
+  rvec3 traceLightSample(const Ray &r, const Hit& hit, Sampler &sampler);
 
-  dvec3 traceBRDFSample(const Ray &r, const Hit& hit, int workerId);
+  rvec3 traceBRDFSample(const Ray &r, const Hit& hit, Sampler &sampler);
 
   // Only testing routine for debugging
   void testRay(int X, int Y);
 
 private:
+  // side of the square tiles that adaptive sampling schedules samples for
+  static const int tileSize = 16;
+  // samples of each tile in the current iteration
+  vector2d<int> tileSamples;
+  IterationStats iterationStats;
+  // rays and samples of the finished jobs of the current iteration
+  std::atomic<u64> jobRays{0};
+  std::atomic<u64> jobSamples{0};
+  std::atomic<u64> jobPrimaryNanoseconds{0};
+  std::atomic<u64> jobShadingNanoseconds{0};
+  std::atomic<bool> jobStopped{false};
+  // end of the current iteration when Globals::frameBudget is set
+  bool hasDeadline = false;
+  std::chrono::steady_clock::time_point deadline;
+  // 2x2 block of each job where the next iteration starts, a stopped job continues where it was cut off
+  std::vector<int> jobResumeBlocks;
+
+  void scheduleTiles();
+  // samplesPerFrame that fills most of the frame budget, from the time and the stop of the last iteration
+  void adaptSamplesPerFrame(double seconds, bool stopped);
+  // samples of the pixel in the current iteration, 0 when it is done
+  int pixelSamples(int x, int y) const;
+
   class RaytraceJob : public Job
   {
   public:
-      RaytraceJob(Scene& scene, uvec2 chunkFrom, uvec2 chunkTo) : _scene(&scene), _chunkFrom(chunkFrom), _chunkTo(chunkTo) {}
+      RaytraceJob(Scene& scene, uvec2 chunkFrom, uvec2 chunkTo, int index) : _scene(&scene), _chunkFrom(chunkFrom), _chunkTo(chunkTo), _index(index) {}
       void Run() override;
   private:
+      void shadePixel(int x, int y, int samples, const Ray& ray, const Hit& hit);
+
       Scene* _scene;
       uvec2 _chunkFrom;
       uvec2 _chunkTo;
+      // position in jobResumeBlocks
+      int _index;
   };
   
   std::vector<RaytraceJob> jobs;
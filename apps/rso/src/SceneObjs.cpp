@@ -1,15 +1,16 @@
 #include "SceneObjs.hpp"
+#include "RayPacket.hpp"
 
 #define _USE_MATH_DEFINES
 #include <math.h>
 
 namespace Morph {
 
-Rect::Rect(dvec3 _r0, dvec3 _r1, dvec3 _r2, double _width, double _height, Material *mat)
+Rect::Rect(rvec3 _r0, rvec3 _r1, rvec3 _r2, real _width, real _height, Material *mat)
 {
     r0 = _r0;
-    dvec3 L = _r1 - r0;
-    dvec3 V = _r2 - r0;
+    rvec3 L = _r1 - r0;
+    rvec3 V = _r2 - r0;
     // compute normal
     normal = normalize(normalize(L) + normalize(V));
     material = mat;
@@ -17,37 +18,37 @@ Rect::Rect(dvec3 _r0, dvec3 _r1, dvec3 _r2, double _width, double _height, Mater
     width = _width;
     height = _height;
     // recompute directions to get rectangle
-    right = normalize(cross(dvec3(0, 0, 1), normal));
+    right = normalize(cross(rvec3(0, 0, 1), normal));
     forward = normalize(cross(normal, right));
 }
 
-Rect::Rect(double _size, Material *mat)
+Rect::Rect(real _size, Material *mat)
 {
-    r0 = dvec3(0, 0, 0);
+    r0 = rvec3(0, 0, 0);
     // compute normal
-    normal = dvec3(0, 0, 1);
+    normal = rvec3(0, 0, 1);
     material = mat;
     power = 0; // default - does not emit light
     width = _size / 2;
     height = _size / 2;
     // recompute directions to get rectangle
-    right = dvec3(1, 0, 0);
-    forward = dvec3(0, 1, 0);
+    right = rvec3(1, 0, 0);
+    forward = rvec3(0, 1, 0);
 }
 
 Hit Rect::intersect(const Ray &ray)
 {
     Hit hit;
-    double denom = dot(normal, ray.dir);
-    if (fabs(denom) > Globals::epsilon)
+    real denom = dot(normal, ray.dir);
+    if (std::abs(denom) > Globals::epsilon)
     {
         hit.t = dot(normal, r0 - ray.start) / denom;
         if (hit.t < 0)
         return hit;
         hit.position = ray.start + ray.dir * hit.t;
-        double x = dot(hit.position - r0, right);
-        double y = dot(hit.position - r0, forward);
-        if (fabs(x) > width || fabs(y) > height)
+        real x = dot(hit.position - r0, right);
+        real y = dot(hit.position - r0, forward);
+        if (std::abs(x) > width || std::abs(y) > height)
         {
         hit.t = -1;
         return hit;
@@ -60,14 +61,25 @@ Hit Rect::intersect(const Ray &ray)
     return hit;
 }
 
-Sphere::Sphere(const dvec3 &cent, double rad, Material *mat, bool emit, const double targetPower)
+AABB Rect::bounds()
+{
+    AABB box;
+    for (real sx : {-width, width}) {
+        for (real sy : {-height, height}) {
+            box.extend(r0 + right * sx + forward * sy);
+        }
+    }
+    return box;
+}
+
+Sphere::Sphere(const rvec3 &cent, real rad, Material *mat, bool emit, const real targetPower)
 {
     center = cent;
     radius = rad;
     material = mat;
     if (emit)
     {
-        power = average(material->Le) * (4 * radius * radius * M_PI) * M_PI;
+        power = average(material->Le) * (4 * radius * radius * glm::pi<real>()) * glm::pi<real>();
         material->Le = material->Le * (targetPower / power);
         power = targetPower;
     }
@@ -76,26 +88,9 @@ Sphere::Sphere(const dvec3 &cent, double rad, Material *mat, bool emit, const do
 Hit Sphere::intersect(const Ray &r)
 {
     Hit hit;
-    dvec3 dist = r.start - center;
-    double b = dot(dist, r.dir) * 2.0;
-    double a = dot(r.dir, r.dir);
-    double c = dot(dist, dist) - radius * radius;
-    double discr = b * b - 4.0 * a * c;
-    if (discr < 0)
-        return hit;
-    double sqrt_discr = sqrt(discr);
-    double t1 = (-b + sqrt_discr) / 2.0 / a;
-    double t2 = (-b - sqrt_discr) / 2.0 / a;
-    if (t1 <= 0 && t2 <= 0)
+    hit.t = intersectSphere(center, radius, r);
+    if (hit.t < 0)
         return hit;
-    if (t1 <= 0 && t2 > 0)
-        hit.t = t2;
-    else if (t2 <= 0 && t1 > 0)
-        hit.t = t1;
-    else if (t1 < t2)
-        hit.t = t1;
-    else
-        hit.t = t2;
     hit.position = r.start + r.dir * hit.t;
     hit.normal = (hit.position - center) / radius;
     hit.material = material;
@@ -103,28 +98,48 @@ Hit Sphere::intersect(const Ray &r)
     return hit;
 }
 
-void Sphere::samplePoint(const dvec3 &illuminatedPoint, dvec3 &point, dvec3 &normal, int workerId)
+AABB Sphere::bounds()
 {
-    return sampleUniformPoint(illuminatedPoint, point, normal, workerId);
+    return AABB(center - rvec3(radius), center + rvec3(radius));
 }
 
-void Sphere::sampleUniformPoint(const dvec3 &illuminatedPoint, dvec3 &point, dvec3 &normal, int workerId)
+void Sphere::intersectPacket(const RayPacket4 &packet, const mask4 &active, PacketHit4 &hit)
 {
-    normal = dvec3(2);
-    while (dot(normal, normal) > 1)
+    mask4 valid = active;
+    dpack4 t = intersectSphere4(packet, broadcast(center.x), broadcast(center.y), broadcast(center.z), broadcast(radius), valid);
+    if (!movemask(valid))
+        return;
+    valid = valid & (t > broadcast(Globals::epsilon)) & (t < hit.t);
+    int bits = movemask(valid);
+    if (!bits)
+        return;
+    hit.t = select(valid, t, hit.t);
+    for (int i = 0; i < RayPacket4::size; ++i)
     {
-        // uniform in a cube of edge size 2
-        normal = dvec3(Globals::drandom(workerId) * 2 - 1, Globals::drandom(workerId) * 2 - 1, Globals::drandom(workerId) * 2 - 1);
-        if (dot(illuminatedPoint - center, normal) < 0)
-        continue;                      // ignore surely non visible points
-    } // finish if the point is in the unit sphere
-    normal = normalize(normal);       // project points onto the surface of the unit sphere
+        if (bits & (1 << i))
+            hit.object[i] = this;
+    }
+}
+
+void Sphere::samplePoint(const rvec3 &illuminatedPoint, rvec3 &point, rvec3 &normal, Sampler &sampler)
+{
+    return sampleUniformPoint(illuminatedPoint, point, normal, sampler);
+}
+
+void Sphere::sampleUniformPoint(const rvec3 &illuminatedPoint, rvec3 &point, rvec3 &normal, Sampler &sampler)
+{
+    // the rejection sampling in a cube used a varying count of numbers, which low discrepancy
+    // sequences cannot provide, the area preserving map from the cylinder draws exactly two
+    real z = 1 - 2 * sampler.uniform<real>();
+    real phi = 2 * glm::pi<real>() * sampler.uniform<real>();
+    real r = std::sqrt(std::max(real(0), 1 - z * z));
+    normal = rvec3(r * std::cos(phi), r * std::sin(phi), z);
     point = center + normal * radius;  // project onto the real sphere
 }
 
-double Sphere::pointSampleProb(double totalPower, dvec3 dir)
+real Sphere::pointSampleProb(real totalPower, rvec3 dir)
 {
-    return power / totalPower / (4 * radius * radius * M_PI);
+    return power / totalPower / (4 * radius * radius * glm::pi<real>());
 }
 
 }
\ No newline at end of file
@@ -5,41 +5,82 @@
 
 namespace Morph {
 
+// Distance to the nearer sphere intersection in front of the ray start, negative when there is none.
+// The discriminant comes from the distance of the center to the ray line instead of b^2 - 4ac,
+// which cancels out for small or distant spheres, especially in float.
+template<typename T>
+T intersectSphere(const tvec3<T> &center, T radius, const RayT<T> &r)
+{
+  // spelled out per component like the packet version, it keeps the compiler from spilling vector temporaries
+  T distX = r.start.x - center.x;
+  T distY = r.start.y - center.y;
+  T distZ = r.start.z - center.z;
+  T a = r.dir.x * r.dir.x + r.dir.y * r.dir.y + r.dir.z * r.dir.z;
+  T b = -(distX * r.dir.x + distY * r.dir.y + distZ * r.dir.z);
+  T ba = b / a;
+  T lineX = distX + r.dir.x * ba;
+  T lineY = distY + r.dir.y * ba;
+  T lineZ = distZ + r.dir.z * ba;
+  T discr = radius * radius - (lineX * lineX + lineY * lineY + lineZ * lineZ);
+  if (discr < 0)
+    return -1;
+  // roots without subtracting numbers of similar magnitude
+  T q = b + std::copysign(std::sqrt(a * discr), b);
+  if (q == 0)
+    return -1;
+  T t1 = (distX * distX + distY * distY + distZ * distZ - radius * radius) / q;
+  T t2 = q / a;
+  if (t1 <= 0 && t2 <= 0)
+    return -1;
+  if (t1 <= 0 && t2 > 0)
+    return t2;
+  if (t2 <= 0 && t1 > 0)
+    return t1;
+  return t1 < t2 ? t1 : t2;
+}
+
 // Rectangle 2D in 3D space
 class Rect : public Intersectable
 {
+  friend class PrimitiveStore;
   // anchor point, normal,
-  dvec3 r0 = dvec3(0);
-  dvec3 normal = dvec3(0);
-  dvec3 right = dvec3(0);
-  dvec3 forward = dvec3(0);
-  double width = 0;
-  double height = 0; // size
+  rvec3 r0 = rvec3(0);
+  rvec3 normal = rvec3(0);
+  rvec3 right = rvec3(0);
+  rvec3 forward = rvec3(0);
+  real width = 0;
+  real height = 0; // size
 public:
-  Rect(dvec3 _r0, dvec3 _r1, dvec3 _r2, double _width, double _height, Material *mat);
+  Rect(rvec3 _r0, rvec3 _r1, rvec3 _r2, real _width, real _height, Material *mat);
 
-  Rect(double _size, Material *mat);
+  Rect(real _size, Material *mat);
 
   // Compute intersection between a ray and the rectangle
   virtual Hit intersect(const Ray &ray) override;
+
+  virtual AABB bounds() override;
 };
 
 // Sphere used as light source
 struct Sphere : public Intersectable
 {
-  dvec3 center = dvec3(0);
-  double radius = 0;
+  rvec3 center = rvec3(0);
+  real radius = 0;
 
-  Sphere(const dvec3 &cent, double rad, Material *mat, bool emit = true, const double targetPower = 60);
+  Sphere(const rvec3 &cent, real rad, Material *mat, bool emit = true, const real targetPower = 60);
 
   virtual Hit intersect(const Ray &r) override;
 
-  virtual void samplePoint(const dvec3 &illuminatedPoint, dvec3 &point, dvec3 &normal, int workerId);
+  virtual AABB bounds() override;
+
+  virtual void intersectPacket(const RayPacket4 &packet, const mask4 &active, PacketHit4 &hit) override;
+
+  virtual void samplePoint(const rvec3 &illuminatedPoint, rvec3 &point, rvec3 &normal, Sampler &sampler);
 
-  // find a random point with uniform distribution on that half sphere, which can be visible
-  void sampleUniformPoint(const dvec3 &illuminatedPoint, dvec3 &point, dvec3 &normal, int workerId);
+  // find a random point with uniform distribution on the sphere from two numbers of the sampler
+  void sampleUniformPoint(const rvec3 &illuminatedPoint, rvec3 &point, rvec3 &normal, Sampler &sampler);
 
-  virtual double pointSampleProb(double totalPower, dvec3 dir) override;
+  virtual real pointSampleProb(real totalPower, rvec3 dir) override;
 };
 
 }
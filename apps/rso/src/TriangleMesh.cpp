@@ -0,0 +1,93 @@
+#include "TriangleMesh.hpp"
+
+#include <Profile/MemoryTracker.hpp>
+
+namespace Morph {
+
+TriangleMesh::TriangleMesh(const IndexedVerticesMesh3D<u32> &mesh, Material *mat, const rvec3 &translation, real scale)
+{
+    MORPH_MEMORY_TAG("rso.mesh");
+    material = mat;
+    power = 0; // default - does not emit light
+
+    size_t count = mesh.indices.size() / 3;
+    std::vector<MeshTriangle> sourceTriangles(count);
+    std::vector<AABB> boxes(count);
+    bool hasNormals = false;
+    for (size_t i = 0; i < count; ++i)
+    {
+        MeshTriangle &tri = sourceTriangles[i];
+        vec3 *v[3] = {&tri.v0, &tri.v1, &tri.v2};
+        for (int c = 0; c < 3; ++c)
+        {
+            const Mesh3DVertex &vertex = mesh.vertices[mesh.indices[3 * i + c]];
+            rvec3 position = rvec3(vertex.position) * scale + translation;
+            *v[c] = vec3(position);
+            boxes[i].extend(rvec3(*v[c]));
+            hasNormals = hasNormals || dot(vertex.normal, vertex.normal) > 0;
+        }
+        tri.index = (u32)i;
+    }
+
+    std::vector<u32> order = tree.build(boxes);
+    triangles.reserve(count);
+    for (u32 i : order)
+        triangles.push_back(sourceTriangles[i]);
+
+    if (hasNormals)
+    {
+        cornerNormals.resize(3 * count);
+        for (size_t i = 0; i < 3 * count; ++i)
+            cornerNormals[i] = mesh.vertices[mesh.indices[i]].normal;
+    }
+
+    if (!tree.empty())
+        rayOffset = PrecisionTraits<real>::relativeOffset * length(tree.bounds().extent());
+}
+
+Hit TriangleMesh::intersect(const Ray &ray)
+{
+    Hit hit;
+    WatertightRay wray(ray.dir);
+    real tMin = std::max(rayOffset, Globals::epsilon);
+    real tMax = std::numeric_limits<real>::infinity();
+    const MeshTriangle *hitTriangle = nullptr;
+    real hitB1 = 0, hitB2 = 0;
+    tree.traverse(ray, tMax, [&](u32 first, u32 count, real &tMax) {
+        for (u32 i = first; i < first + count; ++i)
+        {
+            real t, b1, b2;
+            if (intersectTriangle(triangles[i], ray.start, wray, tMin, tMax, t, b1, b2))
+            {
+                tMax = t;
+                hitTriangle = &triangles[i];
+                hitB1 = b1;
+                hitB2 = b2;
+            }
+        }
+    });
+    if (!hitTriangle)
+        return hit;
+
+    hit.t = tMax;
+    hit.position = ray.start + ray.dir * hit.t;
+    if (!cornerNormals.empty())
+    {
+        const vec3 *n = &cornerNormals[3 * hitTriangle->index];
+        hit.normal = normalize(rvec3(n[0]) * (1 - hitB1 - hitB2) + rvec3(n[1]) * hitB1 + rvec3(n[2]) * hitB2);
+    }
+    else
+    {
+        hit.normal = normalize(cross(rvec3(hitTriangle->v1 - hitTriangle->v0), rvec3(hitTriangle->v2 - hitTriangle->v0)));
+    }
+    hit.material = material;
+    hit.object = this;
+    return hit;
+}
+
+AABB TriangleMesh::bounds()
+{
+    return tree.empty() ? AABB() : tree.bounds();
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,120 @@
+#ifndef RSO_TRIANGLE_MESH_HPP
+#define RSO_TRIANGLE_MESH_HPP
+
+#include <Data/Mesh.hpp>
+
+#include "BVH.hpp"
+
+namespace Morph {
+
+// Triangle vertices stored in the leaf order of the mesh BVH, 48 bytes per triangle
+struct alignas(16) MeshTriangle
+{
+  vec3 v0, v1, v2;
+  // index of the triangle in the source mesh
+  u32 index;
+};
+
+// Per ray constants of the watertight ray-triangle test
+template<typename T>
+struct WatertightRayT
+{
+  int kx, ky, kz;
+  T sx, sy, sz;
+
+  WatertightRayT(const tvec3<T> &dir)
+  {
+    // the dimension where the ray direction is maximal becomes z
+    kz = 0;
+    if (std::abs(dir.y) > std::abs(dir[kz]))
+      kz = 1;
+    if (std::abs(dir.z) > std::abs(dir[kz]))
+      kz = 2;
+    kx = (kz + 1) % 3;
+    ky = (kx + 1) % 3;
+    // keep the winding of the triangles
+    if (dir[kz] < 0)
+      std::swap(kx, ky);
+    sx = dir[kx] / dir[kz];
+    sy = dir[ky] / dir[kz];
+    sz = 1 / dir[kz];
+  }
+};
+
+using WatertightRay = WatertightRayT<real>;
+
+// Watertight test (Woop, Benthin, Wald 2013): rays through shared edges and vertices
+// always hit one of the adjacent triangles. Returns false or the distance and barycentrics.
+template<typename T>
+bool intersectTriangle(const MeshTriangle &tri, const tvec3<T> &origin, const WatertightRayT<T> &wray,
+                       T tMin, T tMax, T &t, T &b1, T &b2)
+{
+  // vertices relative to the ray origin, only the needed components to avoid vector temporaries
+  T az = (T)tri.v0[wray.kz] - origin[wray.kz];
+  T bz = (T)tri.v1[wray.kz] - origin[wray.kz];
+  T cz = (T)tri.v2[wray.kz] - origin[wray.kz];
+
+  // shear and scale the vertices, the ray becomes the positive z axis
+  T ax = ((T)tri.v0[wray.kx] - origin[wray.kx]) - wray.sx * az;
+  T ay = ((T)tri.v0[wray.ky] - origin[wray.ky]) - wray.sy * az;
+  T bx = ((T)tri.v1[wray.kx] - origin[wray.kx]) - wray.sx * bz;
+  T by = ((T)tri.v1[wray.ky] - origin[wray.ky]) - wray.sy * bz;
+  T cx = ((T)tri.v2[wray.kx] - origin[wray.kx]) - wray.sx * cz;
+  T cy = ((T)tri.v2[wray.ky] - origin[wray.ky]) - wray.sy * cz;
+
+  // scaled barycentrics, the edge functions have consistent signs on shared edges
+  T u = cx * by - cy * bx;
+  T v = ax * cy - ay * cx;
+  T w = bx * ay - by * ax;
+  if constexpr (sizeof(T) < sizeof(double))
+  {
+    // float edge functions can round to zero, double keeps the signs consistent
+    if (u == 0 || v == 0 || w == 0)
+    {
+      u = (T)((double)cx * by - (double)cy * bx);
+      v = (T)((double)ax * cy - (double)ay * cx);
+      w = (T)((double)bx * ay - (double)by * ax);
+    }
+  }
+  if ((u < 0 || v < 0 || w < 0) && (u > 0 || v > 0 || w > 0))
+    return false;
+  T det = u + v + w;
+  if (det == 0)
+    return false;
+
+  T invDet = 1 / det;
+  t = (u * az + v * bz + w * cz) * wray.sz * invDet;
+  if (t <= tMin || t >= tMax)
+    return false;
+  b1 = v * invDet;
+  b2 = w * invDet;
+  return true;
+}
+
+// Indexed triangle mesh with its own BVH, e.g. loaded by ResourceManager::LoadMesh3D_OBJ
+class TriangleMesh : public Intersectable
+{
+  BVHTree tree;
+  std::vector<MeshTriangle> triangles;
+  // normals of the source triangle corners, empty when the mesh has none
+  std::vector<vec3> cornerNormals;
+  // offset of secondary rays from the surface, relative to the mesh size
+  real rayOffset = 0;
+
+public:
+  // vertex positions are scaled and then translated to the scene
+  TriangleMesh(const IndexedVerticesMesh3D<u32> &mesh, Material *mat, const rvec3 &translation = rvec3(0), real scale = 1);
+
+  virtual Hit intersect(const Ray &ray) override;
+
+  virtual AABB bounds() override;
+
+  virtual bool canOccludeItself() override { return true; }
+
+  size_t triangleCount() const { return triangles.size(); }
+  size_t nodeCount() const { return tree.nodeCount(); }
+};
+
+}
+
+#endif // RSO_TRIANGLE_MESH_HPP
\ No newline at end of file
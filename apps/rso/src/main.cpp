@@ -1,7 +1,39 @@
 #include "App.hpp"
+#include "BVHBenchmark.hpp"
+#include "Convergence.hpp"
+#include "Headless.hpp"
+#include "PrecisionBenchmark.hpp"
+#include "RenderBenchmark.hpp"
 
-int main(int, char**) {
+#include <cstring>
+
+int main(int argc, char** argv) {
     using namespace Morph;
+    if(argc > 1 && strcmp(argv[1], "--bvh-benchmark") == 0) {
+        return runBVHBenchmark();
+    }
+    if(argc > 1 && strcmp(argv[1], "--precision-benchmark") == 0) {
+        return runPrecisionBenchmark();
+    }
+    if(argc > 1 && strcmp(argv[1], "--render-benchmark") == 0) {
+        Log::Init();
+        int result = runRenderBenchmark(argc - 2, argv + 2);
+        Log::Shutdown();
+        return result;
+    }
+    if(argc > 1 && strcmp(argv[1], "--headless") == 0) {
+        Log::Init();
+        int result = runHeadless(argc - 2, argv + 2);
+        Log::Shutdown();
+        return result;
+    }
+    if(argc > 1 && strcmp(argv[1], "--convergence") == 0) {
+        Log::Init();
+        int result = runConvergence(argc - 2, argv + 2);
+        Log::Shutdown();
+        return result;
+    }
+    Log::Init(LogMode::ASYNC);
     WindowAppConfig appConfig = {
         ivec2(600,600),
         "rso",
@@ -9,4 +41,5 @@ int main(int, char**) {
     };
     Application app(appConfig);
     app.Run();
+    Log::Shutdown();
 }
\ No newline at end of file
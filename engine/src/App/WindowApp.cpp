@@ -1,5 +1,7 @@
 #include "WindowApp.hpp"
 
+#include <Profile/Profiler.hpp>
+
 #include <thread>
 
 namespace Morph {
@@ -25,10 +27,14 @@ WindowApp::WindowApp(const WindowAppConfig& config)
 void WindowApp::Run()
 {
     DefaultFramebuffer& defaultFramebuffer = context().GetDefaultFramebuffer();
+    MORPH_PROFILE_THREAD("main");
 
     while(!window().ShouldClose() && !m_shouldClose)
     {
         Timer lastIterTimer(m_lastIterTime);
+        if(m_numberOfFramesExecuted > 0) {
+            m_iterTimeStats.Record(m_lastIterTime);
+        }
         if(m_numberOfFramesExecuted == 1) {
             m_firstFrameRunTime = m_lastIterTime.GetSeconds();
         }
@@ -36,8 +42,13 @@ void WindowApp::Run()
 
         {
             Timer lastFrameTimer(m_lastFrameTime);
+            MORPH_PROFILE_SCOPE("RunFrame");
             RunFrame(m_lastIterTime.GetSeconds(), m_lastFrameTime.GetSeconds());
         }
+        if(m_frameTimeStats.Record(m_lastFrameTime)) {
+            MORPH_LOG_DEBUG("frame {} took {:.3f} ms, average {:.3f} ms",
+                m_numberOfFramesExecuted, m_lastFrameTime.GetMiliSeconds(), m_frameTimeStats.GetAverage() * 1000.0);
+        }
 
         defaultFramebuffer.SwapBuffers();
 
@@ -96,7 +107,13 @@ void WindowApp::Run()
                 }
             }
         );
+        MORPH_PROFILE_FRAME();
     }
+    #ifdef MORPH_PROFILE
+        if(Profiler::WriteChromeTrace(MORPH_PROFILE_TRACE_FILE)) {
+            MORPH_LOG_INFO("profile trace written to {}", MORPH_PROFILE_TRACE_FILE);
+        }
+    #endif
 }
 
 void WindowApp::UpdateExecutionType()
@@ -4,6 +4,7 @@
 #include <Window/Manager.hpp>
 #include <Graphics/Context.hpp>
 #include <Profile/Timer.hpp>
+#include <Profile/TimerStats.hpp>
 
 #include "App.hpp"
 #include "WindowAppConfig.hpp"
@@ -25,6 +26,8 @@ private:
     bool m_shouldClose = false;
     TimerResult m_lastIterTime;
     TimerResult m_lastFrameTime;
+    TimerStats m_iterTimeStats;
+    TimerStats m_frameTimeStats;
     Void d_updateExecutionType;
 public:
     WindowApp(const WindowAppConfig& config);
@@ -43,6 +46,9 @@ protected:
     inline u64 GetNumberOfFramesExecuted() const { return m_numberOfFramesExecuted; }
     // time is in seconds
     inline f64 GetRunTime() const { return m_runTime; }
+    // statistics of lastIterTime and lastFrameTime passed to RunFrame, usable to find frame pacing problems
+    inline const TimerStats& GetIterTimeStats() const { return m_iterTimeStats; }
+    inline const TimerStats& GetFrameTimeStats() const { return m_frameTimeStats; }
 
     inline       WindowManager& windowManager()       { return *m_windowManager; }
     inline const WindowManager& windowManager() const { return *m_windowManager; }
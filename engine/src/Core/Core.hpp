@@ -7,5 +7,6 @@
 #include "Bounds.hpp"
 #include "Utils.hpp"
 #include "Arrays.hpp"
+#include "Log.hpp"
 
 #endif // MORPH_CORE_HPP
\ No newline at end of file
@@ -1,10 +1,12 @@
 #include "JobManager.hpp"
 
+#include <Profile/Profiler.hpp>
+
 namespace Morph {
 
-JobManager::JobManager()
+JobManager::JobManager(int maxWorkers)
 {
-    _maxWorkers = std::max(1, (int)std::thread::hardware_concurrency());
+    _maxWorkers = maxWorkers > 0 ? maxWorkers : std::max(1, (int)std::thread::hardware_concurrency());
     _workers.resize(_maxWorkers);
     for (int i = 0; i < _maxWorkers; i++) {
         _workers[i] = std::thread(&JobManager::WorkerLoop, this, i);
@@ -54,6 +56,7 @@ void JobManager::WaitForJobsToFinish()
 
 void JobManager::WorkerLoop(int workerId)
 {
+    MORPH_PROFILE_THREAD("worker " + std::to_string(workerId));
     while (!_shutdown)
     {
         Job* job;
@@ -68,7 +71,10 @@ void JobManager::WorkerLoop(int workerId)
             _jobsQueue.pop();
         }
         job->_workerId = workerId;
-        job->Run();
+        {
+            MORPH_PROFILE_SCOPE("Job");
+            job->Run();
+        }
         job->_workerId = -1;
         job->MarkAsFinished();
         {
@@ -28,7 +28,8 @@ private:
 class JobManager
 {
 public:
-    JobManager();
+    // one worker per hardware thread when maxWorkers is not positive
+    explicit JobManager(int maxWorkers = 0);
     ~JobManager();
 
     inline int GetMaxNumberOfWorkers() const { return _maxWorkers; }
@@ -4,30 +4,149 @@
 #include <spdlog/sinks/stdout_color_sinks.h>
 #include <spdlog/sinks/basic_file_sink.h>
 
+#include <thread>
+#include <chrono>
+
 namespace Morph {
 
 
 	shared<spdlog::logger> Log::s_EngineLogger;
 	shared<spdlog::logger> Log::s_ClientLogger;
+	std::atomic<RingBuffer<LogRecord>*> Log::s_Queue = nullptr;
+
+	namespace {
+		constexpr usize LOG_QUEUE_CAPACITY = 8192;
+
+		std::thread s_Worker;
+		std::atomic<bool> s_Running = false;
+		// records written by the worker, compared against pushed count in Flush
+		std::atomic<usize> s_Written = 0;
+
+		void WriteRecord(LogRecord& record)
+		{
+			fmt::memory_buffer buffer;
+			record.format(record.payload, buffer);
+			spdlog::details::log_msg msg(
+				record.time,
+				spdlog::source_loc{},
+				record.logger->name(),
+				record.level,
+				spdlog::string_view_t(buffer.data(), buffer.size())
+			);
+			msg.thread_id = record.threadId;
+			for(auto& sink : record.logger->sinks()) {
+				if(sink->should_log(record.level)) {
+					sink->log(msg);
+				}
+			}
+		}
+
+		void FlushSinks(spdlog::logger* logger)
+		{
+			for(auto& sink : logger->sinks()) {
+				sink->flush();
+			}
+		}
 
-	void Log::Init()
+		// writes the queued records and returns their number
+		usize DrainQueue(RingBuffer<LogRecord>* queue)
+		{
+			spdlog::logger* lastLogger = nullptr;
+			usize count = 0;
+			while(queue->TryPop([&](LogRecord& record) {
+				WriteRecord(record);
+				lastLogger = record.logger;
+			})) {
+				++count;
+				s_Written.fetch_add(1, std::memory_order_release);
+			}
+			if(lastLogger != nullptr) {
+				FlushSinks(lastLogger);
+			}
+			return count;
+		}
+
+		void WorkerLoop(RingBuffer<LogRecord>* queue)
+		{
+			// stops only after the queue is drained
+			while(true) {
+				if(DrainQueue(queue) > 0) {
+					continue;
+				}
+				if(!s_Running.load(std::memory_order_acquire) && queue->PoppedCount() == queue->PushedCount()) {
+					break;
+				}
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			}
+		}
+	}
+
+	void Log::Init(LogMode mode, const char* filename)
 	{
 		std::vector<spdlog::sink_ptr> logSinks;
 		logSinks.emplace_back(std::make_shared<spdlog::sinks::stdout_color_sink_mt>());
-		logSinks.emplace_back(std::make_shared<spdlog::sinks::basic_file_sink_mt>("log.txt", true));
-
 		logSinks[0]->set_pattern("%^[%T] %n: %v%$");
-		logSinks[1]->set_pattern("[%T] [%l] %n: %v");
+		if(filename != nullptr) {
+			logSinks.emplace_back(std::make_shared<spdlog::sinks::basic_file_sink_mt>(filename, true));
+			logSinks[1]->set_pattern("[%T] [%l] %n: %v");
+		}
 
 		s_EngineLogger = std::make_shared<spdlog::logger>("ENGINE", begin(logSinks), end(logSinks));
 		spdlog::register_logger(s_EngineLogger);
-		s_EngineLogger->set_level(spdlog::level::trace);
-		s_EngineLogger->flush_on(spdlog::level::trace);
+		// the level of the default logger, spdlog::set_level changes it for every registered logger
+		s_EngineLogger->set_level(spdlog::get_level());
+		s_EngineLogger->flush_on(mode == LogMode::ASYNC ? spdlog::level::err : spdlog::level::trace);
 
 		s_ClientLogger = std::make_shared<spdlog::logger>("APP", begin(logSinks), end(logSinks));
 		spdlog::register_logger(s_ClientLogger);
-		s_ClientLogger->set_level(spdlog::level::trace);
-		s_ClientLogger->flush_on(spdlog::level::trace);
+		s_ClientLogger->set_level(spdlog::get_level());
+		s_ClientLogger->flush_on(mode == LogMode::ASYNC ? spdlog::level::err : spdlog::level::trace);
+
+		if(mode == LogMode::ASYNC && !IsAsync()) {
+			// the queue is kept alive until exit, producers may still hold its pointer after Shutdown
+			static RingBuffer<LogRecord>* queue = new RingBuffer<LogRecord>(LOG_QUEUE_CAPACITY);
+			s_Written.store(queue->PoppedCount(), std::memory_order_relaxed);
+			s_Running.store(true, std::memory_order_release);
+			s_Worker = std::thread(WorkerLoop, queue);
+			s_Queue.store(queue, std::memory_order_release);
+		}
+	}
+
+	void Log::Shutdown()
+	{
+		if(!IsAsync()) {
+			return;
+		}
+		RingBuffer<LogRecord>* queue = s_Queue.load(std::memory_order_acquire);
+		Flush();
+		s_Queue.store(nullptr, std::memory_order_seq_cst);
+		s_Running.store(false, std::memory_order_release);
+		s_Worker.join();
+		// a producer which loaded the queue before it was cleared may have pushed after the worker stopped
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		DrainQueue(queue);
+	}
+
+	void Log::DrainStopped(RingBuffer<LogRecord>* queue)
+	{
+		DrainQueue(queue);
+	}
+
+	void Log::Flush()
+	{
+		RingBuffer<LogRecord>* queue = s_Queue.load(std::memory_order_acquire);
+		if(queue != nullptr) {
+			usize target = queue->PushedCount();
+			while(s_Written.load(std::memory_order_acquire) < target) {
+				std::this_thread::yield();
+			}
+		}
+		if(s_EngineLogger) {
+			s_EngineLogger->flush();
+		}
+		if(s_ClientLogger) {
+			s_ClientLogger->flush();
+		}
 	}
 
 }
\ No newline at end of file
@@ -3,24 +3,193 @@
 #define MORPH_LOG_HPP
 
 #include "Types.hpp"
+#include "RingBuffer.hpp"
 
 #include <spdlog/spdlog.h>
 #include <spdlog/fmt/ostr.h>
+#include <spdlog/details/os.h>
+
+#include <atomic>
+#include <new>
+#include <tuple>
+#include <string_view>
+#include <type_traits>
+
+// levels below MORPH_LOG_ACTIVE_LEVEL are removed at compile time
+#define MORPH_LOG_LEVEL_TRACE 0
+#define MORPH_LOG_LEVEL_DEBUG 1
+#define MORPH_LOG_LEVEL_INFO 2
+#define MORPH_LOG_LEVEL_WARN 3
+#define MORPH_LOG_LEVEL_ERROR 4
+#define MORPH_LOG_LEVEL_CRITICAL 5
+#define MORPH_LOG_LEVEL_OFF 6
+
+#ifndef MORPH_LOG_ACTIVE_LEVEL
+	#ifdef MORPH_DEBUG
+		#define MORPH_LOG_ACTIVE_LEVEL MORPH_LOG_LEVEL_TRACE
+	#else
+		#define MORPH_LOG_ACTIVE_LEVEL MORPH_LOG_LEVEL_INFO
+	#endif
+#endif
 
 namespace Morph {
 
+	enum class LogMode
+	{
+		SYNC,
+		ASYNC
+	};
+
+	// Log record as it travels through the async queue, arguments are stored in binary form and formatted by the logging thread.
+	struct LogRecord
+	{
+		static constexpr usize PAYLOAD_SIZE = 192;
+		using FormatFunc = void (*)(void* payload, fmt::memory_buffer& out);
+
+		spdlog::logger* logger;
+		spdlog::level::level_enum level;
+		spdlog::log_clock::time_point time;
+		usize threadId;
+		FormatFunc format;
+		alignas(std::max_align_t) unsigned char payload[PAYLOAD_SIZE];
+	};
+
+	namespace LogDetail {
+		// strings may not outlive the call, so they are copied into the record
+		template<typename T>
+		using Stored = std::conditional_t<
+			std::is_convertible_v<const std::decay_t<T>&, std::string_view>,
+			string,
+			std::decay_t<T>
+		>;
+
+		template<typename ...Args>
+		struct Payload
+		{
+			const char* fmt;
+			std::tuple<Stored<Args>...> args;
+		};
+
+		template<typename ...Args>
+		void FormatPayload(void* data, fmt::memory_buffer& out) {
+			Payload<Args...>* payload = std::launder(reinterpret_cast<Payload<Args...>*>(data));
+			std::apply([&](auto& ...args) {
+				fmt::vformat_to(std::back_inserter(out), fmt::string_view(payload->fmt), fmt::make_format_args(args...));
+			}, payload->args);
+			payload->~Payload<Args...>();
+		}
+	}
+
 	class Log
 	{
 	public:
-		static void Init();
+		// ASYNC starts a background thread which formats and writes queued records,
+		// the records are also written to the file when a filename is given
+		static void Init(LogMode mode = LogMode::SYNC, const char* filename = nullptr);
+		// drains the queue and stops the background thread
+		static void Shutdown();
+		// blocks until every record queued before the call is written
+		static void Flush();
+		static bool IsAsync() { return s_Queue.load(std::memory_order_acquire) != nullptr; }
 
 		static shared<spdlog::logger>& engine() { return s_EngineLogger; }
 		static shared<spdlog::logger>& client() { return s_ClientLogger; }
+
+		// fmt has to be a string literal, it is kept by pointer until the record is formatted
+		template<typename ...Args>
+		static void Write(spdlog::logger* logger, spdlog::level::level_enum level, const char* fmt, Args&& ...args) {
+			if(logger == nullptr) {
+				logger = spdlog::default_logger_raw();
+			}
+			if(!logger->should_log(level)) {
+				return;
+			}
+			using Payload = LogDetail::Payload<Args...>;
+			if constexpr(sizeof(Payload) <= LogRecord::PAYLOAD_SIZE && alignof(Payload) <= alignof(std::max_align_t)) {
+				RingBuffer<LogRecord>* queue = s_Queue.load(std::memory_order_acquire);
+				if(queue != nullptr) {
+					bool pushed = queue->TryPush([&](LogRecord& record) {
+						record.logger = logger;
+						record.level = level;
+						record.time = spdlog::log_clock::now();
+						record.threadId = spdlog::details::os::thread_id();
+						record.format = &LogDetail::FormatPayload<Args...>;
+						new (record.payload) Payload{ fmt, { LogDetail::Stored<Args>(std::forward<Args>(args))... } };
+					});
+					if(pushed) {
+						// Shutdown cleared the queue meanwhile and its last drain may have missed the record
+						std::atomic_thread_fence(std::memory_order_seq_cst);
+						if(s_Queue.load(std::memory_order_relaxed) == nullptr) {
+							DrainStopped(queue);
+						}
+						return;
+					}
+				}
+			}
+			// queue full, too large record or sync mode
+			fmt::memory_buffer buffer;
+			fmt::vformat_to(std::back_inserter(buffer), fmt::string_view(fmt), fmt::make_format_args(args...));
+			logger->log(level, "{}", std::string_view(buffer.data(), buffer.size()));
+		}
 	private:
+		// writes the records left in the queue after Shutdown
+		static void DrainStopped(RingBuffer<LogRecord>* queue);
+
+		static std::atomic<RingBuffer<LogRecord>*> s_Queue;
 		static shared<spdlog::logger> s_EngineLogger;
 		static shared<spdlog::logger> s_ClientLogger;
 	};
 
 }
 
+#define MORPH_LOG_IMPL(logger, level, ...) ::Morph::Log::Write(logger, level, __VA_ARGS__)
+
+#if MORPH_LOG_ACTIVE_LEVEL <= MORPH_LOG_LEVEL_TRACE
+	#define MORPH_LOG_TRACE(...) MORPH_LOG_IMPL(::Morph::Log::engine().get(), spdlog::level::trace, __VA_ARGS__)
+	#define MORPH_APP_LOG_TRACE(...) MORPH_LOG_IMPL(::Morph::Log::client().get(), spdlog::level::trace, __VA_ARGS__)
+#else
+	#define MORPH_LOG_TRACE(...) (void)0
+	#define MORPH_APP_LOG_TRACE(...) (void)0
+#endif
+
+#if MORPH_LOG_ACTIVE_LEVEL <= MORPH_LOG_LEVEL_DEBUG
+	#define MORPH_LOG_DEBUG(...) MORPH_LOG_IMPL(::Morph::Log::engine().get(), spdlog::level::debug, __VA_ARGS__)
+	#define MORPH_APP_LOG_DEBUG(...) MORPH_LOG_IMPL(::Morph::Log::client().get(), spdlog::level::debug, __VA_ARGS__)
+#else
+	#define MORPH_LOG_DEBUG(...) (void)0
+	#define MORPH_APP_LOG_DEBUG(...) (void)0
+#endif
+
+#if MORPH_LOG_ACTIVE_LEVEL <= MORPH_LOG_LEVEL_INFO
+	#define MORPH_LOG_INFO(...) MORPH_LOG_IMPL(::Morph::Log::engine().get(), spdlog::level::info, __VA_ARGS__)
+	#define MORPH_APP_LOG_INFO(...) MORPH_LOG_IMPL(::Morph::Log::client().get(), spdlog::level::info, __VA_ARGS__)
+#else
+	#define MORPH_LOG_INFO(...) (void)0
+	#define MORPH_APP_LOG_INFO(...) (void)0
+#endif
+
+#if MORPH_LOG_ACTIVE_LEVEL <= MORPH_LOG_LEVEL_WARN
+	#define MORPH_LOG_WARN(...) MORPH_LOG_IMPL(::Morph::Log::engine().get(), spdlog::level::warn, __VA_ARGS__)
+	#define MORPH_APP_LOG_WARN(...) MORPH_LOG_IMPL(::Morph::Log::client().get(), spdlog::level::warn, __VA_ARGS__)
+#else
+	#define MORPH_LOG_WARN(...) (void)0
+	#define MORPH_APP_LOG_WARN(...) (void)0
+#endif
+
+#if MORPH_LOG_ACTIVE_LEVEL <= MORPH_LOG_LEVEL_ERROR
+	#define MORPH_LOG_ERROR(...) MORPH_LOG_IMPL(::Morph::Log::engine().get(), spdlog::level::err, __VA_ARGS__)
+	#define MORPH_APP_LOG_ERROR(...) MORPH_LOG_IMPL(::Morph::Log::client().get(), spdlog::level::err, __VA_ARGS__)
+#else
+	#define MORPH_LOG_ERROR(...) (void)0
+	#define MORPH_APP_LOG_ERROR(...) (void)0
+#endif
+
+#if MORPH_LOG_ACTIVE_LEVEL <= MORPH_LOG_LEVEL_CRITICAL
+	#define MORPH_LOG_CRITICAL(...) MORPH_LOG_IMPL(::Morph::Log::engine().get(), spdlog::level::critical, __VA_ARGS__)
+	#define MORPH_APP_LOG_CRITICAL(...) MORPH_LOG_IMPL(::Morph::Log::client().get(), spdlog::level::critical, __VA_ARGS__)
+#else
+	#define MORPH_LOG_CRITICAL(...) (void)0
+	#define MORPH_APP_LOG_CRITICAL(...) (void)0
+#endif
+
 #endif // MORPH_LOG_HPP
\ No newline at end of file
@@ -0,0 +1,97 @@
+#ifndef MORPH_RING_BUFFER_HPP
+#define MORPH_RING_BUFFER_HPP
+
+#include "Types.hpp"
+
+#include <atomic>
+
+namespace Morph {
+
+// Bounded lock-free queue for multiple producers and consumers, elements are filled and consumed in place.
+// Each cell has a sequence number telling whether it is ready to be written or read in the current lap.
+template<typename T>
+class RingBuffer
+{
+private:
+    struct alignas(64) Cell
+    {
+        std::atomic<usize> sequence;
+        T value;
+    };
+    unique<Cell[]> m_cells;
+    usize m_mask;
+    alignas(64) std::atomic<usize> m_enqueuePos;
+    alignas(64) std::atomic<usize> m_dequeuePos;
+public:
+    // capacity is rounded up to a power of two
+    RingBuffer(usize capacity) : m_enqueuePos(0), m_dequeuePos(0) {
+        usize size = 2;
+        while(size < capacity) {
+            size <<= 1;
+        }
+        m_cells = unique<Cell[]>(new Cell[size]);
+        m_mask = size - 1;
+        for(usize i = 0; i < size; ++i) {
+            m_cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+    RingBuffer(const RingBuffer& other) = delete;
+    RingBuffer& operator=(const RingBuffer& other) = delete;
+
+    // calls fill(T&) on a free cell, returns false when the buffer is full
+    template<typename FillFunc>
+    bool TryPush(FillFunc&& fill) {
+        Cell* cell;
+        usize pos = m_enqueuePos.load(std::memory_order_relaxed);
+        while(true) {
+            cell = &m_cells[pos & m_mask];
+            usize sequence = cell->sequence.load(std::memory_order_acquire);
+            isize diff = (isize)sequence - (isize)pos;
+            if(diff == 0) {
+                if(m_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if(diff < 0) {
+                return false;
+            } else {
+                pos = m_enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+        fill(cell->value);
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    // calls consume(T&) on the oldest filled cell, returns false when the buffer is empty
+    template<typename ConsumeFunc>
+    bool TryPop(ConsumeFunc&& consume) {
+        Cell* cell;
+        usize pos = m_dequeuePos.load(std::memory_order_relaxed);
+        while(true) {
+            cell = &m_cells[pos & m_mask];
+            usize sequence = cell->sequence.load(std::memory_order_acquire);
+            isize diff = (isize)sequence - (isize)(pos + 1);
+            if(diff == 0) {
+                if(m_dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if(diff < 0) {
+                return false;
+            } else {
+                pos = m_dequeuePos.load(std::memory_order_relaxed);
+            }
+        }
+        consume(cell->value);
+        cell->sequence.store(pos + m_mask + 1, std::memory_order_release);
+        return true;
+    }
+
+    inline usize capacity() const { return m_mask + 1; }
+    // number of pushes started so far, used to wait until everything pushed before some point is consumed
+    inline usize PushedCount() const { return m_enqueuePos.load(std::memory_order_acquire); }
+    inline usize PoppedCount() const { return m_dequeuePos.load(std::memory_order_acquire); }
+};
+
+}
+
+#endif // MORPH_RING_BUFFER_HPP
\ No newline at end of file
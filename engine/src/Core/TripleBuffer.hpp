@@ -0,0 +1,50 @@
+#ifndef MORPH_TRIPLE_BUFFER_HPP
+#define MORPH_TRIPLE_BUFFER_HPP
+
+#include "Types.hpp"
+
+#include <atomic>
+
+namespace Morph {
+
+// Lock-free handoff of the newest value from one producer thread to one consumer thread, e.g. finished frames.
+// The producer fills its own buffer and swaps it with the shared middle one, the consumer swaps the middle one
+// with its own when it was published since its last swap. Neither side ever waits, older values are dropped.
+template<typename T>
+class TripleBuffer
+{
+private:
+    static constexpr u32 INDEX_MASK = 3;
+    // the middle buffer was published and not taken by the consumer yet
+    static constexpr u32 FRESH_BIT = 4;
+
+    T m_buffers[3];
+    u32 m_writeIndex = 0;
+    alignas(64) std::atomic<u32> m_middle;
+    alignas(64) u32 m_readIndex = 2;
+public:
+    TripleBuffer() : m_middle(1) {}
+    TripleBuffer(const T& value) : m_buffers{value, value, value}, m_middle(1) {}
+    TripleBuffer(const TripleBuffer& other) = delete;
+    TripleBuffer& operator=(const TripleBuffer& other) = delete;
+
+    // producer side, the buffer keeps the contents of an older publish
+    inline T& WriteBuffer() { return m_buffers[m_writeIndex]; }
+    void Publish() {
+        m_writeIndex = m_middle.exchange(m_writeIndex | FRESH_BIT, std::memory_order_acq_rel) & INDEX_MASK;
+    }
+
+    // consumer side, takes the newest published buffer and returns false when nothing was published since the last call
+    bool Update() {
+        if(!(m_middle.load(std::memory_order_relaxed) & FRESH_BIT)) {
+            return false;
+        }
+        m_readIndex = m_middle.exchange(m_readIndex, std::memory_order_acq_rel) & INDEX_MASK;
+        return true;
+    }
+    inline const T& ReadBuffer() const { return m_buffers[m_readIndex]; }
+};
+
+}
+
+#endif // MORPH_TRIPLE_BUFFER_HPP
\ No newline at end of file
@@ -71,15 +71,15 @@ Result<GraphicsContext*, MakeCurrentError> GraphicsContext::MakeCurrent(const Wi
         s_contexts.insert(window.id());
         
         #ifdef MORPH_DEBUG
-            spdlog::debug("OpenGL Info:");
-            spdlog::debug("  Vendor: {0}", (const char*)glGetString(GL_VENDOR));
-            spdlog::debug("  Renderer: {0}", (const char*)glGetString(GL_RENDERER));
-            spdlog::debug("  Version: {0}", (const char*)glGetString(GL_VERSION));
+            MORPH_LOG_DEBUG("OpenGL Info:");
+            MORPH_LOG_DEBUG("  Vendor: {0}", (const char*)glGetString(GL_VENDOR));
+            MORPH_LOG_DEBUG("  Renderer: {0}", (const char*)glGetString(GL_RENDERER));
+            MORPH_LOG_DEBUG("  Version: {0}", (const char*)glGetString(GL_VERSION));
             int versionMajor;
             int versionMinor;
             GL(GetIntegerv(GL_MAJOR_VERSION, &versionMajor));
             GL(GetIntegerv(GL_MINOR_VERSION, &versionMinor));
-            spdlog::debug("OpenGL version: {0}.{1}", versionMajor, versionMinor);
+            MORPH_LOG_DEBUG("OpenGL version: {0}.{1}", versionMajor, versionMinor);
         #endif
     }
     GraphicsContext* res = new GraphicsContext(window);
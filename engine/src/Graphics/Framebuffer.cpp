@@ -1,6 +1,7 @@
 #include "Framebuffer.hpp"
 
 #include "OpenGL.hpp"
+#include <Profile/Profiler.hpp>
 
 namespace Morph {
 
@@ -20,6 +21,7 @@ void DefaultFramebuffer::SetSwapWaitInterval(int screenUpdatesCount)
 }
 void DefaultFramebuffer::SwapBuffers()
 {
+    MORPH_PROFILE_FUNCTION();
     const Window& window = m_window;
     glfwSwapBuffers(window.id());
 }
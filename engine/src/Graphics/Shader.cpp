@@ -1,6 +1,7 @@
 #include "Shader.hpp"
 
 #include "OpenGL.hpp"
+#include <Profile/Profiler.hpp>
 
 namespace Morph {
 
@@ -32,6 +33,7 @@ void Shader::CreateID()
 
  opt<ShaderCompileError> Shader::Compile(const string& source)
 {
+    MORPH_PROFILE_FUNCTION();
     const char* cSource = source.c_str();
     GL(ShaderSource(m_id, 1, &cSource, 0));
     GL(CompileShader(m_id));
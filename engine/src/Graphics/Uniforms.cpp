@@ -13,7 +13,7 @@ int IUniformSingle::GetLocation(const GraphicsProgramBinder& programBinder) cons
         m_locs.insert_or_assign(programBinder.id(), loc);
         #ifdef MORPH_DEBUG
             if(loc == -1) {
-                spdlog::debug("uniform {} not set in program {}", m_name, programBinder.id());
+                MORPH_LOG_DEBUG("uniform {} not set in program {}", m_name, programBinder.id());
             }
         #endif
     } else {
@@ -0,0 +1,52 @@
+#include "MemoryPanel.hpp"
+
+#include <Profile/MemoryTracker.hpp>
+
+namespace Morph {
+
+namespace {
+    void TextBytes(u64 bytes)
+    {
+        if(bytes >= (1ull << 30)) {
+            ImGui::Text("%.2f GB", (f64)bytes / (1ull << 30));
+        } else if(bytes >= (1ull << 20)) {
+            ImGui::Text("%.2f MB", (f64)bytes / (1ull << 20));
+        } else if(bytes >= (1ull << 10)) {
+            ImGui::Text("%.2f KB", (f64)bytes / (1ull << 10));
+        } else {
+            ImGui::Text("%llu B", (unsigned long long)bytes);
+        }
+    }
+}
+
+void ImGuiMemoryPanel::Draw(bool* open)
+{
+    if(!ImGui::Begin("Memory", open)) {
+        ImGui::End();
+        return;
+    }
+    if(!MemoryTracker::IsEnabled()) {
+        ImGui::Text("allocation tracking requires MORPH_PROFILE");
+        ImGui::End();
+        return;
+    }
+    ImGui::Columns(5, "memory_tags");
+    ImGui::Separator();
+    ImGui::Text("tag"); ImGui::NextColumn();
+    ImGui::Text("live"); ImGui::NextColumn();
+    ImGui::Text("peak"); ImGui::NextColumn();
+    ImGui::Text("live allocs"); ImGui::NextColumn();
+    ImGui::Text("total allocs"); ImGui::NextColumn();
+    ImGui::Separator();
+    for(const MemoryTagStats& stats : MemoryTracker::GetAllStats()) {
+        ImGui::TextUnformatted(stats.name); ImGui::NextColumn();
+        TextBytes(stats.liveBytes); ImGui::NextColumn();
+        TextBytes(stats.peakBytes); ImGui::NextColumn();
+        ImGui::Text("%llu", (unsigned long long)stats.liveCount); ImGui::NextColumn();
+        ImGui::Text("%llu", (unsigned long long)stats.totalCount); ImGui::NextColumn();
+    }
+    ImGui::Columns(1);
+    ImGui::End();
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,17 @@
+#ifndef MORPH_IMGUI_MEMORY_PANEL_HPP
+#define MORPH_IMGUI_MEMORY_PANEL_HPP
+
+#include "ImGui.hpp"
+
+namespace Morph {
+
+// Window with live/peak bytes and allocation counts of every memory tracker tag, call between ImGuiDraw construction and destruction.
+class ImGuiMemoryPanel
+{
+public:
+    static void Draw(bool* open = nullptr);
+};
+
+}
+
+#endif // MORPH_IMGUI_MEMORY_PANEL_HPP
\ No newline at end of file
@@ -0,0 +1,125 @@
+#include "BenchmarkBaseline.hpp"
+
+#include <Resource/Storage.hpp>
+
+#include <algorithm>
+#include <regex>
+
+namespace Morph {
+
+namespace {
+    std::regex NumberRegex(const string& key)
+    {
+        return std::regex("\"" + key + "\"\\s*:\\s*([0-9.eE+-]+)");
+    }
+}
+
+opt<BenchmarkBaseline> BenchmarkBaseline::Read(const string& path, const string& valueKey, opt<f64> tolerance)
+{
+    opt<string> contents = ResourceStorage::ReadFile(path);
+    if(!contents) {
+        return {};
+    }
+    return Parse(contents.value(), valueKey, tolerance);
+}
+
+opt<BenchmarkBaseline> BenchmarkBaseline::Parse(const string& json, const string& valueKey, opt<f64> tolerance)
+{
+    usize benchmarksPos = json.find("\"benchmarks\"");
+    if(benchmarksPos == string::npos) {
+        return {};
+    }
+    BenchmarkBaseline baseline;
+    baseline.m_header = json.substr(0, benchmarksPos);
+    const std::regex toleranceRegex = NumberRegex("tolerance");
+    const std::regex nameRegex("\"name\"\\s*:\\s*\"([^\"]*)\"");
+    const std::regex valueRegex = NumberRegex(valueKey);
+    std::smatch match;
+
+    // file wide tolerance is written before the benchmarks array
+    f64 defaultTolerance = baseline.GetSetting("tolerance").value_or(DEFAULT_TOLERANCE);
+
+    usize pos = benchmarksPos;
+    while((pos = json.find('{', pos)) != string::npos) {
+        usize end = json.find('}', pos);
+        if(end == string::npos) {
+            return {};
+        }
+        string entry = json.substr(pos, end - pos);
+        pos = end;
+        std::smatch nameMatch;
+        std::smatch valueMatch;
+        if(!std::regex_search(entry, nameMatch, nameRegex) || !std::regex_search(entry, valueMatch, valueRegex)) {
+            continue;
+        }
+        f64 entryTolerance = defaultTolerance;
+        if(tolerance) {
+            entryTolerance = tolerance.value();
+        } else if(std::regex_search(entry, match, toleranceRegex)) {
+            entryTolerance = std::stod(match[1].str());
+        }
+        baseline.m_entries.push_back({nameMatch[1].str(), std::stod(valueMatch[1].str()), entryTolerance});
+    }
+    return baseline;
+}
+
+opt<f64> BenchmarkBaseline::GetSetting(const string& key) const
+{
+    std::smatch match;
+    if(!std::regex_search(m_header, match, NumberRegex(key))) {
+        return {};
+    }
+    return std::stod(match[1].str());
+}
+
+vector<BenchmarkComparison> BenchmarkBaseline::Compare(const vector<pair<string, f64>>& results, const string& unit, bool higherIsFaster,
+    const string& filter) const
+{
+    usize nameWidth = 0;
+    for(const auto& [name, value] : results) {
+        nameWidth = std::max(nameWidth, name.size());
+    }
+    for(const BenchmarkBaselineEntry& entry : m_entries) {
+        nameWidth = std::max(nameWidth, entry.name.size());
+    }
+    vector<BenchmarkComparison> comparisons;
+    for(const auto& [name, value] : results) {
+        BenchmarkComparison comparison;
+        comparison.name = name;
+        comparison.value = value;
+        auto it = std::find_if(m_entries.begin(), m_entries.end(),
+            [&](const BenchmarkBaselineEntry& entry) { return entry.name == name; }
+        );
+        if(it == m_entries.end()) {
+            comparison.message = fmt::format("{:<{}} no baseline", name, nameWidth);
+            comparisons.push_back(comparison);
+            continue;
+        }
+        comparison.hasBaseline = true;
+        comparison.baseline = it->value;
+        f64 faster = higherIsFaster ? value : it->value;
+        f64 slower = higherIsFaster ? it->value : value;
+        comparison.slowdown = faster > 0 ? slower / faster : 1.0;
+        comparison.allowed = 1.0 + it->tolerance;
+        comparison.failed = comparison.slowdown > comparison.allowed;
+        comparison.message = fmt::format("{:<{}} {:>14.1f} {} vs baseline {:>14.1f} {} ({:.2f}x the time, allowed {:.2f}x)",
+            name, nameWidth, value, unit, it->value, unit, comparison.slowdown, comparison.allowed);
+        comparisons.push_back(comparison);
+    }
+    for(const BenchmarkBaselineEntry& entry : m_entries) {
+        bool selected = entry.name.find(filter) != string::npos;
+        bool run = std::any_of(results.begin(), results.end(), [&](const auto& result) { return result.first == entry.name; });
+        if(selected && !run) {
+            BenchmarkComparison comparison;
+            comparison.name = entry.name;
+            comparison.baseline = entry.value;
+            comparison.hasBaseline = true;
+            comparison.failed = true;
+            comparison.message = fmt::format("{:<{}} in the baseline but not run", entry.name, nameWidth);
+            comparisons.push_back(comparison);
+        }
+    }
+    return comparisons;
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,59 @@
+#ifndef MORPH_PROFILE_BENCHMARK_BASELINE_HPP
+#define MORPH_PROFILE_BENCHMARK_BASELINE_HPP
+
+#include <Core/Core.hpp>
+
+namespace Morph {
+
+struct BenchmarkBaselineEntry
+{
+    string name;
+    f64 value;
+    // allowed relative slowdown, e.g. 0.5 fails when the benchmark takes more than 1.5x the time of the baseline
+    f64 tolerance;
+};
+
+// one result against its baseline entry
+struct BenchmarkComparison
+{
+    string name;
+    f64 value = 0;
+    f64 baseline = 0;
+    // time of the result relative to the baseline, above 1 is slower
+    f64 slowdown = 1;
+    f64 allowed = 1;
+    bool hasBaseline = false;
+    bool failed = false;
+    // printable line with the values and the slowdown
+    string message;
+};
+
+// Results of an earlier run in a JSON file, as written by morph_benchmarks --out and rso --render-benchmark --out.
+// Settings of the run and a file wide "tolerance" come before the "benchmarks" array, whose objects have a "name",
+// the compared value and optionally their own "tolerance".
+class BenchmarkBaseline
+{
+public:
+    static constexpr f64 DEFAULT_TOLERANCE = 0.5;
+private:
+    string m_header;
+    vector<BenchmarkBaselineEntry> m_entries;
+public:
+    // valueKey is the compared field of the benchmarks, a given tolerance overrides the ones of the file
+    static opt<BenchmarkBaseline> Read(const string& path, const string& valueKey, opt<f64> tolerance = {});
+    static opt<BenchmarkBaseline> Parse(const string& json, const string& valueKey, opt<f64> tolerance = {});
+
+    // number written before the benchmarks array, e.g. a setting of the run
+    opt<f64> GetSetting(const string& key) const;
+    inline const vector<BenchmarkBaselineEntry>& GetEntries() const { return m_entries; }
+
+    // results are names and values in the unit, higherIsFaster for rates and false for times. Entries of the baseline
+    // whose name contains the filter of the run but which have no result fail, so renaming or removing a benchmark
+    // cannot turn the comparison into a pass that compared nothing.
+    vector<BenchmarkComparison> Compare(const vector<pair<string, f64>>& results, const string& unit, bool higherIsFaster,
+        const string& filter = "") const;
+};
+
+}
+
+#endif // MORPH_PROFILE_BENCHMARK_BASELINE_HPP
\ No newline at end of file
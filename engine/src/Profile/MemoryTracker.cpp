@@ -0,0 +1,182 @@
+#include "MemoryTracker.hpp"
+
+#include "Profiler.hpp"
+
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+namespace Morph {
+
+array<MemoryTracker::TagCounters, MemoryTracker::MAX_TAGS> MemoryTracker::s_tags;
+std::atomic<u32> MemoryTracker::s_tagCount = 1;
+
+namespace {
+    mutex& RegisterMutex()
+    {
+        static mutex registerMutex;
+        return registerMutex;
+    }
+}
+
+MemoryTag MemoryTracker::RegisterTag(const char* name)
+{
+    std::lock_guard<mutex> lock(RegisterMutex());
+    u32 count = s_tagCount.load(std::memory_order_acquire);
+    for(u32 i = 1; i < count; ++i) {
+        if(std::strcmp(s_tags[i].name.load(std::memory_order_relaxed), name) == 0) {
+            return i;
+        }
+    }
+    if(count == MAX_TAGS) {
+        return UNTAGGED;
+    }
+    s_tags[count].name.store(name, std::memory_order_relaxed);
+    s_tagCount.store(count + 1, std::memory_order_release);
+    return count;
+}
+
+void MemoryTracker::OnAllocate(MemoryTag tag, u64 size)
+{
+    TagCounters& counters = s_tags[tag];
+    u64 live = counters.liveBytes.fetch_add(size, std::memory_order_relaxed) + size;
+    u64 peak = counters.peakBytes.load(std::memory_order_relaxed);
+    while(live > peak && !counters.peakBytes.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {}
+    counters.liveCount.fetch_add(1, std::memory_order_relaxed);
+    counters.totalCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+void MemoryTracker::OnFree(MemoryTag tag, u64 size)
+{
+    TagCounters& counters = s_tags[tag];
+    counters.liveBytes.fetch_sub(size, std::memory_order_relaxed);
+    counters.liveCount.fetch_sub(1, std::memory_order_relaxed);
+}
+
+MemoryTagStats MemoryTracker::GetStats(MemoryTag tag)
+{
+    const TagCounters& counters = s_tags[tag];
+    const char* name = counters.name.load(std::memory_order_relaxed);
+    return {
+        tag == UNTAGGED ? "untagged" : name,
+        counters.liveBytes.load(std::memory_order_relaxed),
+        counters.peakBytes.load(std::memory_order_relaxed),
+        counters.liveCount.load(std::memory_order_relaxed),
+        counters.totalCount.load(std::memory_order_relaxed)
+    };
+}
+
+vector<MemoryTagStats> MemoryTracker::GetAllStats()
+{
+    u32 count = s_tagCount.load(std::memory_order_acquire);
+    vector<MemoryTagStats> stats;
+    stats.reserve(count);
+    for(u32 i = 0; i < count; ++i) {
+        stats.push_back(GetStats(i));
+    }
+    return stats;
+}
+
+void MemoryTracker::RecordCounters()
+{
+    u32 count = s_tagCount.load(std::memory_order_acquire);
+    u64 now = Profiler::Now();
+    for(u32 i = 0; i < count; ++i) {
+        MemoryTagStats stats = GetStats(i);
+        Profiler::RecordCounter(stats.name, now, stats.liveBytes);
+    }
+}
+
+bool MemoryTracker::IsEnabled()
+{
+    #ifdef MORPH_PROFILE
+        return true;
+    #else
+        return false;
+    #endif
+}
+
+}
+
+#ifdef MORPH_PROFILE
+
+namespace {
+    using namespace Morph;
+
+    // stored right before the returned pointer, keeps 16 byte alignment of the user block
+    struct alignas(16) AllocationHeader
+    {
+        u64 size;
+        MemoryTag tag;
+        u32 offset;
+    };
+    static_assert(sizeof(AllocationHeader) == 16);
+
+    void* TrackedAlloc(usize size, usize alignment)
+    {
+        alignment = std::max<usize>(alignment, alignof(AllocationHeader));
+        // malloc is at least 16 aligned, bigger alignments need padding to move the block forward
+        usize padding = sizeof(AllocationHeader) + (alignment > alignof(std::max_align_t) ? alignment : 0);
+        unsigned char* raw = (unsigned char*)std::malloc(size + padding);
+        if(raw == nullptr) {
+            return nullptr;
+        }
+        uintptr_t user = ((uintptr_t)raw + sizeof(AllocationHeader) + alignment - 1) & ~(uintptr_t)(alignment - 1);
+        AllocationHeader* header = (AllocationHeader*)(user - sizeof(AllocationHeader));
+        MemoryTag tag = MemoryTracker::GetCurrentTag();
+        header->size = size;
+        header->tag = tag;
+        header->offset = (u32)(user - (uintptr_t)raw);
+        MemoryTracker::OnAllocate(tag, size);
+        return (void*)user;
+    }
+
+    void* TrackedAllocOrThrow(usize size, usize alignment)
+    {
+        // operator new has to return a unique pointer for zero size
+        void* ptr = TrackedAlloc(size == 0 ? 1 : size, alignment);
+        while(ptr == nullptr) {
+            std::new_handler handler = std::get_new_handler();
+            if(handler == nullptr) {
+                throw std::bad_alloc();
+            }
+            handler();
+            ptr = TrackedAlloc(size == 0 ? 1 : size, alignment);
+        }
+        return ptr;
+    }
+
+    void TrackedFree(void* ptr)
+    {
+        if(ptr == nullptr) {
+            return;
+        }
+        AllocationHeader* header = (AllocationHeader*)((unsigned char*)ptr - sizeof(AllocationHeader));
+        MemoryTracker::OnFree(header->tag, header->size);
+        std::free((unsigned char*)ptr - header->offset);
+    }
+}
+
+void* operator new(std::size_t size) { return TrackedAllocOrThrow(size, alignof(std::max_align_t)); }
+void* operator new[](std::size_t size) { return TrackedAllocOrThrow(size, alignof(std::max_align_t)); }
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept { return TrackedAlloc(size == 0 ? 1 : size, alignof(std::max_align_t)); }
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept { return TrackedAlloc(size == 0 ? 1 : size, alignof(std::max_align_t)); }
+void* operator new(std::size_t size, std::align_val_t alignment) { return TrackedAllocOrThrow(size, (usize)alignment); }
+void* operator new[](std::size_t size, std::align_val_t alignment) { return TrackedAllocOrThrow(size, (usize)alignment); }
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept { return TrackedAlloc(size == 0 ? 1 : size, (usize)alignment); }
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept { return TrackedAlloc(size == 0 ? 1 : size, (usize)alignment); }
+
+void operator delete(void* ptr) noexcept { TrackedFree(ptr); }
+void operator delete[](void* ptr) noexcept { TrackedFree(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept { TrackedFree(ptr); }
+void operator delete[](void* ptr, std::size_t) noexcept { TrackedFree(ptr); }
+void operator delete(void* ptr, const std::nothrow_t&) noexcept { TrackedFree(ptr); }
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept { TrackedFree(ptr); }
+void operator delete(void* ptr, std::align_val_t) noexcept { TrackedFree(ptr); }
+void operator delete[](void* ptr, std::align_val_t) noexcept { TrackedFree(ptr); }
+void operator delete(void* ptr, std::size_t, std::align_val_t) noexcept { TrackedFree(ptr); }
+void operator delete[](void* ptr, std::size_t, std::align_val_t) noexcept { TrackedFree(ptr); }
+void operator delete(void* ptr, std::align_val_t, const std::nothrow_t&) noexcept { TrackedFree(ptr); }
+void operator delete[](void* ptr, std::align_val_t, const std::nothrow_t&) noexcept { TrackedFree(ptr); }
+
+#endif
\ No newline at end of file
@@ -0,0 +1,86 @@
+#ifndef MORPH_PROFILE_MEMORY_TRACKER_HPP
+#define MORPH_PROFILE_MEMORY_TRACKER_HPP
+
+#include <Morph.hpp>
+
+#include <atomic>
+
+namespace Morph {
+
+using MemoryTag = u32;
+
+struct MemoryTagStats
+{
+    const char* name;
+    u64 liveBytes;
+    u64 peakBytes;
+    u64 liveCount;
+    u64 totalCount;
+};
+
+// Counts heap allocations per tag. With MORPH_PROFILE the global operator new/delete are replaced
+// and every allocation is attributed to the tag active on the allocating thread (MORPH_MEMORY_TAG).
+class MemoryTracker
+{
+public:
+    static constexpr MemoryTag UNTAGGED = 0;
+    static constexpr usize MAX_TAGS = 64;
+private:
+    struct TagCounters
+    {
+        std::atomic<const char*> name = nullptr;
+        std::atomic<u64> liveBytes = 0;
+        std::atomic<u64> peakBytes = 0;
+        std::atomic<u64> liveCount = 0;
+        std::atomic<u64> totalCount = 0;
+    };
+    static array<TagCounters, MAX_TAGS> s_tags;
+    static std::atomic<u32> s_tagCount;
+
+    static MemoryTag& CurrentTagRef() {
+        thread_local MemoryTag tag = UNTAGGED;
+        return tag;
+    }
+public:
+    // name has to outlive the tracker, returns the existing tag when the name is already registered
+    // and UNTAGGED when all tags are used
+    static MemoryTag RegisterTag(const char* name);
+    static inline MemoryTag GetCurrentTag() { return CurrentTagRef(); }
+    static inline void SetCurrentTag(MemoryTag tag) { CurrentTagRef() = tag; }
+
+    static void OnAllocate(MemoryTag tag, u64 size);
+    static void OnFree(MemoryTag tag, u64 size);
+
+    static MemoryTagStats GetStats(MemoryTag tag);
+    static vector<MemoryTagStats> GetAllStats();
+    // adds live bytes of every tag to the profiler trace as counters
+    static void RecordCounters();
+    // true when the global allocation hooks are compiled in
+    static bool IsEnabled();
+};
+
+class MemoryTagScope
+{
+private:
+    MemoryTag m_previous;
+public:
+    MemoryTagScope(MemoryTag tag) : m_previous(MemoryTracker::GetCurrentTag()) { MemoryTracker::SetCurrentTag(tag); }
+    MemoryTagScope(const MemoryTagScope& other) = delete;
+    MemoryTagScope& operator=(const MemoryTagScope& other) = delete;
+    ~MemoryTagScope() { MemoryTracker::SetCurrentTag(m_previous); }
+};
+
+}
+
+#ifdef MORPH_PROFILE
+    #define MORPH_MEMORY_TAG(name) \
+        static const ::Morph::MemoryTag MORPH_MEMORY_TAG_CONCAT(morphMemoryTag, __LINE__) = ::Morph::MemoryTracker::RegisterTag(name); \
+        ::Morph::MemoryTagScope MORPH_MEMORY_TAG_CONCAT(morphMemoryTagScope, __LINE__)(MORPH_MEMORY_TAG_CONCAT(morphMemoryTag, __LINE__))
+#else
+    #define MORPH_MEMORY_TAG(name) (void)0
+#endif
+
+#define MORPH_MEMORY_TAG_CONCAT_IMPL(a, b) a##b
+#define MORPH_MEMORY_TAG_CONCAT(a, b) MORPH_MEMORY_TAG_CONCAT_IMPL(a, b)
+
+#endif // MORPH_PROFILE_MEMORY_TRACKER_HPP
\ No newline at end of file
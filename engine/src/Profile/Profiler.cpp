@@ -0,0 +1,125 @@
+#include "Profiler.hpp"
+
+#include "MemoryTracker.hpp"
+
+#include <Resource/Storage.hpp>
+
+#include <sstream>
+
+namespace Morph {
+
+namespace {
+    // buffers are never freed, events of finished threads stay available for export
+    mutex s_buffersMutex;
+    vector<ProfileThreadBuffer*> s_buffers;
+
+    void WriteJsonString(std::ostream& out, const char* str)
+    {
+        out << '"';
+        for(; *str != '\0'; ++str) {
+            if(*str == '"' || *str == '\\') {
+                out << '\\';
+            }
+            out << *str;
+        }
+        out << '"';
+    }
+}
+
+const std::chrono::steady_clock::time_point Profiler::s_start = std::chrono::steady_clock::now();
+std::atomic<u64> Profiler::s_frameCount = 0;
+
+vector<ProfileEvent> ProfileThreadBuffer::Snapshot() const
+{
+    u64 written = m_written.load(std::memory_order_acquire);
+    u64 first = OldestIntact(written);
+    vector<ProfileEvent> events;
+    events.reserve(written - first);
+    for(u64 i = first; i < written; ++i) {
+        events.push_back(m_events[i & (CAPACITY - 1)]);
+    }
+    // drop events the owning thread overwrote while copying, the copies must not move past the check
+    std::atomic_thread_fence(std::memory_order_acquire);
+    u64 overwritten = OldestIntact(m_written.load(std::memory_order_relaxed));
+    if(overwritten > first) {
+        events.erase(events.begin(), events.begin() + std::min<u64>(overwritten - first, events.size()));
+    }
+    return events;
+}
+
+ProfileThreadBuffer* Profiler::CreateThreadBuffer()
+{
+    std::lock_guard<mutex> lock(s_buffersMutex);
+    ProfileThreadBuffer* buffer = new ProfileThreadBuffer((u32)s_buffers.size());
+    s_buffers.push_back(buffer);
+    return buffer;
+}
+
+void Profiler::MarkFrame()
+{
+    thread_local u64 frameStart = 0;
+    u64 now = Now();
+    if(frameStart != 0) {
+        Record("Frame", frameStart, now);
+    }
+    frameStart = now;
+    if(MemoryTracker::IsEnabled()) {
+        MemoryTracker::RecordCounters();
+    }
+    s_frameCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+void Profiler::SetThreadName(const string& name)
+{
+    ProfileThreadBuffer& buffer = GetThreadBuffer();
+    std::lock_guard<mutex> lock(s_buffersMutex);
+    buffer.SetThreadName(name);
+}
+
+string Profiler::ChromeTraceJson()
+{
+    vector<ProfileThreadBuffer*> buffers;
+    vector<string> threadNames;
+    {
+        std::lock_guard<mutex> lock(s_buffersMutex);
+        buffers = s_buffers;
+        for(ProfileThreadBuffer* buffer : buffers) {
+            threadNames.push_back(buffer->GetThreadName());
+        }
+    }
+
+    std::ostringstream out;
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool first = true;
+    for(usize i = 0; i < buffers.size(); ++i) {
+        u32 tid = buffers[i]->GetThreadIndex();
+        if(!threadNames[i].empty()) {
+            out << (first ? "" : ",") << "\n{\"ph\":\"M\",\"pid\":0,\"tid\":" << tid << ",\"name\":\"thread_name\",\"args\":{\"name\":";
+            WriteJsonString(out, threadNames[i].c_str());
+            out << "}}";
+            first = false;
+        }
+        for(const ProfileEvent& event : buffers[i]->Snapshot()) {
+            // timestamps are in microseconds
+            out << (first ? "" : ",") << "\n{\"ph\":\"" << (event.type == ProfileEventType::COUNTER ? 'C' : 'X')
+                << "\",\"pid\":0,\"tid\":" << tid << ",\"name\":";
+            WriteJsonString(out, event.name);
+            out << ",\"ts\":" << event.start / 1000 << '.' << (event.start % 1000) / 100;
+            if(event.type == ProfileEventType::COUNTER) {
+                out << ",\"args\":{\"bytes\":" << event.duration << "}}";
+            } else {
+                out << ",\"dur\":" << event.duration / 1000 << '.' << (event.duration % 1000) / 100 << "}";
+            }
+            first = false;
+        }
+    }
+    out << "\n]}\n";
+    return out.str();
+}
+
+bool Profiler::WriteChromeTrace(const string& path)
+{
+    return ResourceStorage::WriteToFile(path, ChromeTraceJson());
+}
+
+}
\ No newline at end of file
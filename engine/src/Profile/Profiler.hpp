@@ -0,0 +1,134 @@
+#ifndef MORPH_PROFILE_PROFILER_HPP
+#define MORPH_PROFILE_PROFILER_HPP
+
+#include <Morph.hpp>
+
+#include <atomic>
+#include <chrono>
+
+namespace Morph {
+
+enum class ProfileEventType : u32
+{
+    SCOPE,
+    COUNTER
+};
+
+struct ProfileEvent
+{
+    // name has to outlive the profiler, macros pass string literals or __FUNCTION__
+    const char* name;
+    // nanoseconds since profiler start
+    u64 start;
+    // value of the counter for COUNTER events
+    u64 duration;
+    ProfileEventType type;
+};
+
+// Events of one thread, written only by the owning thread and read by the exporter.
+// When full the oldest events are overwritten.
+class ProfileThreadBuffer
+{
+public:
+    static constexpr usize CAPACITY = 1 << 16;
+private:
+    array<ProfileEvent, CAPACITY> m_events;
+    std::atomic<u64> m_written = 0;
+    u32 m_threadIndex;
+    string m_threadName;
+
+    // index of the oldest event not being overwritten when written events are counted, the slot of
+    // the next event is still the oldest one until the owning thread increments the count
+    static inline u64 OldestIntact(u64 written) {
+        return written + 1 > CAPACITY ? written + 1 - CAPACITY : 0;
+    }
+public:
+    ProfileThreadBuffer(u32 threadIndex) : m_threadIndex(threadIndex) {}
+
+    inline void Push(const char* name, u64 start, u64 end) {
+        u64 written = m_written.load(std::memory_order_relaxed);
+        m_events[written & (CAPACITY - 1)] = { name, start, end - start, ProfileEventType::SCOPE };
+        m_written.store(written + 1, std::memory_order_release);
+    }
+    inline void PushCounter(const char* name, u64 time, u64 value) {
+        u64 written = m_written.load(std::memory_order_relaxed);
+        m_events[written & (CAPACITY - 1)] = { name, time, value, ProfileEventType::COUNTER };
+        m_written.store(written + 1, std::memory_order_release);
+    }
+    // copies events which are not overwritten during the copy, at most CAPACITY - 1 of them
+    vector<ProfileEvent> Snapshot() const;
+
+    inline u32 GetThreadIndex() const { return m_threadIndex; }
+    inline const string& GetThreadName() const { return m_threadName; }
+    inline void SetThreadName(const string& name) { m_threadName = name; }
+};
+
+class Profiler
+{
+private:
+    static ProfileThreadBuffer* CreateThreadBuffer();
+    static ProfileThreadBuffer& GetThreadBuffer() {
+        thread_local ProfileThreadBuffer* buffer = CreateThreadBuffer();
+        return *buffer;
+    }
+public:
+    // nanoseconds since profiler start
+    static inline u64 Now() {
+        using namespace std::chrono;
+        return duration_cast<nanoseconds>(steady_clock::now() - s_start).count();
+    }
+    static inline void Record(const char* name, u64 start, u64 end) {
+        GetThreadBuffer().Push(name, start, end);
+    }
+    static inline void RecordCounter(const char* name, u64 time, u64 value) {
+        GetThreadBuffer().PushCounter(name, time, value);
+    }
+    // closes the current frame on the calling thread, frames show as "Frame" events in the trace
+    // and memory tracker counters are sampled at every frame
+    static void MarkFrame();
+    static inline u64 GetFrameCount() { return s_frameCount.load(std::memory_order_relaxed); }
+    static void SetThreadName(const string& name);
+
+    // writes all recorded events in Chrome trace event format (chrome://tracing, Perfetto)
+    static string ChromeTraceJson();
+    static bool WriteChromeTrace(const string& path);
+private:
+    static const std::chrono::steady_clock::time_point s_start;
+    static std::atomic<u64> s_frameCount;
+};
+
+class ProfileScope
+{
+private:
+    const char* m_name;
+    u64 m_start;
+public:
+    ProfileScope(const char* name) : m_name(name), m_start(Profiler::Now()) {}
+    ProfileScope(const ProfileScope& other) = delete;
+    ProfileScope& operator=(const ProfileScope& other) = delete;
+    ~ProfileScope() { Profiler::Record(m_name, m_start, Profiler::Now()); }
+};
+
+}
+
+#define MORPH_PROFILE_CONCAT_IMPL(a, b) a##b
+#define MORPH_PROFILE_CONCAT(a, b) MORPH_PROFILE_CONCAT_IMPL(a, b)
+
+// WindowApp::Run writes the trace here when it returns
+#ifndef MORPH_PROFILE_TRACE_FILE
+    #define MORPH_PROFILE_TRACE_FILE "trace.json"
+#endif
+
+#ifdef MORPH_PROFILE
+    #define MORPH_PROFILE_SCOPE(name) ::Morph::ProfileScope MORPH_PROFILE_CONCAT(morphProfileScope, __LINE__)(name)
+    #define MORPH_PROFILE_FUNCTION() MORPH_PROFILE_SCOPE(__FUNCTION__)
+    #define MORPH_PROFILE_FRAME() ::Morph::Profiler::MarkFrame()
+    #define MORPH_PROFILE_THREAD(name) ::Morph::Profiler::SetThreadName(name)
+#else
+    #define MORPH_PROFILE_SCOPE(name) (void)0
+    #define MORPH_PROFILE_FUNCTION() (void)0
+    #define MORPH_PROFILE_FRAME() (void)0
+    #define MORPH_PROFILE_THREAD(name) (void)0
+#endif
+
+#endif // MORPH_PROFILE_PROFILER_HPP
\ No newline at end of file
@@ -14,8 +14,8 @@ public:
     TimerResult() : m_duration(0) {}
     TimerResult(std::chrono::duration<f64> duration) : m_duration(duration) {}
     inline void Set(std::chrono::duration<f64> duration) { m_duration = duration; }
-    inline f64 GetSeconds() { return m_duration.count(); }
-    inline f64 GetMiliSeconds() { return std::chrono::duration<f64, std::ratio<1, 1000>>(m_duration).count(); }
+    inline f64 GetSeconds() const { return m_duration.count(); }
+    inline f64 GetMiliSeconds() const { return std::chrono::duration<f64, std::ratio<1, 1000>>(m_duration).count(); }
 };
 
 class Timer
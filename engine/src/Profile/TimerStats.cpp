@@ -0,0 +1,201 @@
+#include "TimerStats.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace Morph {
+
+namespace {
+    u32 HighestBit(u64 value)
+    {
+        u32 bit = 0;
+        while(value >>= 1) {
+            ++bit;
+        }
+        return bit;
+    }
+
+    // nearest rank percentile of sorted values
+    u64 Percentile(const vector<u64>& sorted, f64 p)
+    {
+        usize rank = (usize)std::ceil(p * sorted.size());
+        return sorted[std::min(sorted.size() - 1, rank > 0 ? rank - 1 : 0)];
+    }
+}
+
+TimerHistogram::TimerHistogram()
+{
+    Reset();
+}
+
+void TimerHistogram::Record(u64 nanoseconds)
+{
+    m_buckets[GetBucket(nanoseconds)].fetch_add(1, std::memory_order_relaxed);
+    m_count.fetch_add(1, std::memory_order_relaxed);
+}
+
+void TimerHistogram::Reset()
+{
+    for(std::atomic<u64>& bucket : m_buckets) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+    m_count.store(0, std::memory_order_relaxed);
+}
+
+u64 TimerHistogram::GetPercentile(f64 p) const
+{
+    u64 count = GetCount();
+    if(count == 0) {
+        return 0;
+    }
+    u64 rank = std::max<u64>(1, (u64)std::ceil(p * count));
+    u64 seen = 0;
+    for(u32 bucket = 0; bucket < BUCKET_COUNT; ++bucket) {
+        seen += GetBucketCount(bucket);
+        if(seen >= rank) {
+            return GetBucketUpperBound(bucket);
+        }
+    }
+    return GetBucketUpperBound(BUCKET_COUNT - 1);
+}
+
+u32 TimerHistogram::GetBucket(u64 nanoseconds)
+{
+    if(nanoseconds < 2 * SUB_BUCKETS) {
+        return (u32)nanoseconds;
+    }
+    u32 exponent = HighestBit(nanoseconds);
+    if(exponent > MAX_EXPONENT) {
+        return BUCKET_COUNT - 1;
+    }
+    u32 shift = exponent - SUB_BUCKET_BITS;
+    u32 subBucket = (u32)(nanoseconds >> shift) - SUB_BUCKETS;
+    return (shift + 1) * SUB_BUCKETS + subBucket;
+}
+
+u64 TimerHistogram::GetBucketLowerBound(u32 bucket)
+{
+    if(bucket < 2 * SUB_BUCKETS) {
+        return bucket;
+    }
+    u32 shift = bucket / SUB_BUCKETS - 1;
+    u64 mantissa = bucket % SUB_BUCKETS + SUB_BUCKETS;
+    return mantissa << shift;
+}
+
+u64 TimerHistogram::GetBucketUpperBound(u32 bucket)
+{
+    if(bucket < 2 * SUB_BUCKETS) {
+        return bucket;
+    }
+    u32 shift = bucket / SUB_BUCKETS - 1;
+    u64 mantissa = bucket % SUB_BUCKETS + SUB_BUCKETS;
+    return ((mantissa + 1) << shift) - 1;
+}
+
+TimerStats::TimerStats(usize windowSize, f64 spikeFactor)
+    : m_windowSize(std::max<usize>(windowSize, 1)),
+    m_window(new std::atomic<u64>[std::max<usize>(windowSize, 1)]),
+    m_spikeFactor(spikeFactor)
+{
+    for(usize i = 0; i < m_windowSize; ++i) {
+        m_window[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+bool TimerStats::Record(f64 seconds)
+{
+    u64 ns = (u64)std::max(0.0, seconds * 1e9);
+    u64 index = m_written.fetch_add(1, std::memory_order_acq_rel);
+    m_window[index % m_windowSize].store(ns, std::memory_order_release);
+
+    u64 count = m_count.fetch_add(1, std::memory_order_relaxed) + 1;
+    m_sum.fetch_add(ns, std::memory_order_relaxed);
+    u64 min = m_min.load(std::memory_order_relaxed);
+    while(ns < min && !m_min.compare_exchange_weak(min, ns, std::memory_order_relaxed)) {}
+    u64 max = m_max.load(std::memory_order_relaxed);
+    while(ns > max && !m_max.compare_exchange_weak(max, ns, std::memory_order_relaxed)) {}
+    m_histogram.Record(ns);
+
+    // the average needs some samples before spikes are meaningful, spikes only slightly move it
+    f64 average = m_average.load(std::memory_order_relaxed);
+    bool spike = count > 16 && ns > average * m_spikeFactor;
+    f64 weight = count <= 16 ? 1.0 / count : (spike ? 0.01 : 0.05);
+    m_average.store(average + (ns - average) * weight, std::memory_order_relaxed);
+    if(spike) {
+        m_spikeCount.fetch_add(1, std::memory_order_relaxed);
+        m_lastSpike.store(ns, std::memory_order_relaxed);
+    }
+    return spike;
+}
+
+void TimerStats::Reset()
+{
+    m_written.store(0, std::memory_order_relaxed);
+    m_count.store(0, std::memory_order_relaxed);
+    m_sum.store(0, std::memory_order_relaxed);
+    m_min.store(UINT64_MAX, std::memory_order_relaxed);
+    m_max.store(0, std::memory_order_relaxed);
+    m_histogram.Reset();
+    m_average.store(0, std::memory_order_relaxed);
+    m_spikeCount.store(0, std::memory_order_relaxed);
+    m_lastSpike.store(0, std::memory_order_relaxed);
+}
+
+vector<f64> TimerStats::GetWindow() const
+{
+    u64 written = m_written.load(std::memory_order_acquire);
+    u64 first = written > m_windowSize ? written - m_windowSize : 0;
+    vector<f64> window;
+    window.reserve(written - first);
+    for(u64 i = first; i < written; ++i) {
+        window.push_back(m_window[i % m_windowSize].load(std::memory_order_acquire) * 1e-9);
+    }
+    return window;
+}
+
+TimerStatsSummary TimerStats::GetWindowSummary() const
+{
+    u64 written = m_written.load(std::memory_order_acquire);
+    u64 first = written > m_windowSize ? written - m_windowSize : 0;
+    vector<u64> values;
+    values.reserve(written - first);
+    for(u64 i = first; i < written; ++i) {
+        values.push_back(m_window[i % m_windowSize].load(std::memory_order_acquire));
+    }
+    TimerStatsSummary summary;
+    if(values.empty()) {
+        return summary;
+    }
+    std::sort(values.begin(), values.end());
+    u64 sum = 0;
+    for(u64 value : values) {
+        sum += value;
+    }
+    summary.count = values.size();
+    summary.min = values.front() * 1e-9;
+    summary.max = values.back() * 1e-9;
+    summary.mean = (f64)sum / values.size() * 1e-9;
+    summary.p50 = Percentile(values, 0.50) * 1e-9;
+    summary.p95 = Percentile(values, 0.95) * 1e-9;
+    summary.p99 = Percentile(values, 0.99) * 1e-9;
+    return summary;
+}
+
+TimerStatsSummary TimerStats::GetTotalSummary() const
+{
+    TimerStatsSummary summary;
+    summary.count = m_count.load(std::memory_order_relaxed);
+    if(summary.count == 0) {
+        return summary;
+    }
+    summary.min = m_min.load(std::memory_order_relaxed) * 1e-9;
+    summary.max = m_max.load(std::memory_order_relaxed) * 1e-9;
+    summary.mean = (f64)m_sum.load(std::memory_order_relaxed) / summary.count * 1e-9;
+    summary.p50 = m_histogram.GetPercentile(0.50) * 1e-9;
+    summary.p95 = m_histogram.GetPercentile(0.95) * 1e-9;
+    summary.p99 = m_histogram.GetPercentile(0.99) * 1e-9;
+    return summary;
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,99 @@
+#ifndef MORPH_PROFILE_TIMER_STATS_HPP
+#define MORPH_PROFILE_TIMER_STATS_HPP
+
+#include "Timer.hpp"
+
+#include <atomic>
+
+namespace Morph {
+
+// times are in seconds
+struct TimerStatsSummary
+{
+    u64 count = 0;
+    f64 min = 0;
+    f64 mean = 0;
+    f64 max = 0;
+    f64 p50 = 0;
+    f64 p95 = 0;
+    f64 p99 = 0;
+};
+
+// Log-linear histogram of durations in nanoseconds. Values below 32 ns are exact, above that every power of two
+// is split into 16 buckets, so the relative error of a bucket is at most 1/16. Durations are clamped to about an hour.
+class TimerHistogram
+{
+public:
+    static constexpr u32 SUB_BUCKET_BITS = 4;
+    static constexpr u32 SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+    static constexpr u32 MAX_EXPONENT = 41;
+    static constexpr u32 BUCKET_COUNT = (MAX_EXPONENT - SUB_BUCKET_BITS + 2) * SUB_BUCKETS;
+private:
+    array<std::atomic<u64>, BUCKET_COUNT> m_buckets;
+    std::atomic<u64> m_count = 0;
+public:
+    TimerHistogram();
+
+    void Record(u64 nanoseconds);
+    void Reset();
+
+    inline u64 GetCount() const { return m_count.load(std::memory_order_relaxed); }
+    inline u64 GetBucketCount(u32 bucket) const { return m_buckets[bucket].load(std::memory_order_relaxed); }
+    // p in [0, 1], upper bound of the bucket which contains the percentile, in nanoseconds
+    u64 GetPercentile(f64 p) const;
+
+    static u32 GetBucket(u64 nanoseconds);
+    // lowest value of the bucket, in nanoseconds
+    static u64 GetBucketLowerBound(u32 bucket);
+    static u64 GetBucketUpperBound(u32 bucket);
+};
+
+// Accumulates durations from any thread without locks. Keeps totals, a rolling window of the last samples
+// for percentiles, a histogram of all samples and detects spikes against a moving average.
+class TimerStats
+{
+public:
+    static constexpr usize DEFAULT_WINDOW_SIZE = 240;
+    static constexpr f64 DEFAULT_SPIKE_FACTOR = 2.0;
+private:
+    usize m_windowSize;
+    unique<std::atomic<u64>[]> m_window;
+    std::atomic<u64> m_written = 0;
+    std::atomic<u64> m_count = 0;
+    std::atomic<u64> m_sum = 0;
+    std::atomic<u64> m_min = UINT64_MAX;
+    std::atomic<u64> m_max = 0;
+    TimerHistogram m_histogram;
+    // exponential moving average in nanoseconds, spikes are compared against it
+    std::atomic<f64> m_average = 0;
+    f64 m_spikeFactor;
+    std::atomic<u64> m_spikeCount = 0;
+    std::atomic<u64> m_lastSpike = 0;
+public:
+    TimerStats(usize windowSize = DEFAULT_WINDOW_SIZE, f64 spikeFactor = DEFAULT_SPIKE_FACTOR);
+    TimerStats(const TimerStats& other) = delete;
+    TimerStats& operator=(const TimerStats& other) = delete;
+
+    // returns true when the duration is a spike, longer than spikeFactor times the moving average
+    bool Record(f64 seconds);
+    inline bool Record(const TimerResult& result) { return Record(result.GetSeconds()); }
+    void Reset();
+
+    // statistics of the last windowSize samples
+    TimerStatsSummary GetWindowSummary() const;
+    // totals of all samples, percentiles come from the histogram
+    TimerStatsSummary GetTotalSummary() const;
+    // last samples in seconds, oldest first
+    vector<f64> GetWindow() const;
+
+    inline const TimerHistogram& GetHistogram() const { return m_histogram; }
+    inline u64 GetCount() const { return m_count.load(std::memory_order_relaxed); }
+    inline u64 GetSpikeCount() const { return m_spikeCount.load(std::memory_order_relaxed); }
+    inline f64 GetLastSpike() const { return m_lastSpike.load(std::memory_order_relaxed) * 1e-9; }
+    inline f64 GetAverage() const { return m_average.load(std::memory_order_relaxed) * 1e-9; }
+    inline usize GetWindowSize() const { return m_windowSize; }
+};
+
+}
+
+#endif // MORPH_PROFILE_TIMER_STATS_HPP
\ No newline at end of file
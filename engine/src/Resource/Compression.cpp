@@ -0,0 +1,142 @@
+#include "Compression.hpp"
+
+#include <cstring>
+
+namespace Morph {
+
+static constexpr usize s_minMatch = 4;
+// the block format requires the last literals and the last match start to stay clear of the end
+static constexpr usize s_lastLiterals = 5;
+static constexpr usize s_matchSafeDistance = 12;
+static constexpr usize s_maxOffset = 65535;
+static constexpr int s_hashBits = 14;
+
+static inline u32 ReadU32(const char* p)
+{
+    u32 v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline u32 Hash(u32 sequence)
+{
+    return (sequence * 2654435761u) >> (32 - s_hashBits);
+}
+
+static inline void WriteLength(string& dst, usize length)
+{
+    while(length >= 255) {
+        dst.push_back((char)255);
+        length -= 255;
+    }
+    dst.push_back((char)length);
+}
+
+static inline void WriteSequence(string& dst, const char* literals, usize literalsSize, usize offset, usize matchSize)
+{
+    usize matchCode = matchSize >= s_minMatch ? matchSize - s_minMatch : 0;
+    u8 token = (u8)((std::min<usize>(literalsSize, 15) << 4) | std::min<usize>(matchCode, 15));
+    dst.push_back((char)token);
+    if(literalsSize >= 15) {
+        WriteLength(dst, literalsSize - 15);
+    }
+    dst.append(literals, literalsSize);
+    if(matchSize >= s_minMatch) {
+        dst.push_back((char)(offset & 0xFF));
+        dst.push_back((char)(offset >> 8));
+        if(matchCode >= 15) {
+            WriteLength(dst, matchCode - 15);
+        }
+    }
+}
+
+string LZ4Compression::Compress(const char* src, usize srcSize)
+{
+    string dst;
+    dst.reserve(srcSize + srcSize / 255 + 16);
+    usize anchor = 0;
+    if(srcSize > s_matchSafeDistance) {
+        vector<u32> hashTable(usize(1) << s_hashBits, 0);
+        usize matchLimit = srcSize - s_lastLiterals;
+        usize pos = 0;
+        while(pos + s_matchSafeDistance <= srcSize) {
+            u32 sequence = ReadU32(src + pos);
+            u32 h = Hash(sequence);
+            usize candidate = hashTable[h];
+            hashTable[h] = (u32)pos;
+            if(candidate < pos && pos - candidate <= s_maxOffset && ReadU32(src + candidate) == sequence) {
+                usize matchSize = s_minMatch;
+                while(pos + matchSize < matchLimit && src[candidate + matchSize] == src[pos + matchSize]) {
+                    ++matchSize;
+                }
+                WriteSequence(dst, src + anchor, pos - anchor, pos - candidate, matchSize);
+                pos += matchSize;
+                anchor = pos;
+            } else {
+                ++pos;
+            }
+        }
+    }
+    WriteSequence(dst, src + anchor, srcSize - anchor, 0, 0);
+    return dst;
+}
+
+bool LZ4Compression::Decompress(const char* src, usize srcSize, char* dst, usize dstSize)
+{
+    const u8* in = (const u8*)src;
+    const u8* inEnd = in + srcSize;
+    usize out = 0;
+    auto readLength = [&](usize length) -> opt<usize> {
+        if(length != 15) {
+            return length;
+        }
+        u8 b;
+        do {
+            if(in >= inEnd) {
+                return {};
+            }
+            b = *in++;
+            length += b;
+        } while(b == 255);
+        return length;
+    };
+    while(in < inEnd) {
+        u8 token = *in++;
+        opt<usize> literalsSize = readLength(token >> 4);
+        if(!literalsSize || literalsSize.value() > (usize)(inEnd - in) || literalsSize.value() > dstSize - out) {
+            return false;
+        }
+        std::memcpy(dst + out, in, literalsSize.value());
+        in += literalsSize.value();
+        out += literalsSize.value();
+        if(in == inEnd) {
+            break;
+        }
+        if(inEnd - in < 2) {
+            return false;
+        }
+        usize offset = (usize)in[0] | ((usize)in[1] << 8);
+        in += 2;
+        opt<usize> matchCode = readLength(token & 15);
+        if(!matchCode || offset == 0 || offset > out) {
+            return false;
+        }
+        usize matchSize = matchCode.value() + s_minMatch;
+        if(matchSize > dstSize - out) {
+            return false;
+        }
+        // matches can overlap the output being written, so copy byte by byte when they do
+        const char* match = dst + out - offset;
+        if(offset >= matchSize) {
+            std::memcpy(dst + out, match, matchSize);
+        } else {
+            for(usize i = 0; i < matchSize; ++i) {
+                dst[out + i] = match[i];
+            }
+        }
+        out += matchSize;
+    }
+    return out == dstSize;
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,19 @@
+#ifndef MORPH_RESOURCE_COMPRESSION_HPP
+#define MORPH_RESOURCE_COMPRESSION_HPP
+
+#include <Core/Core.hpp>
+
+namespace Morph {
+
+// Byte oriented LZ77 compression producing the LZ4 block format, fast to decompress.
+class LZ4Compression
+{
+public:
+    static string Compress(const char* src, usize srcSize);
+    // dstSize must be the exact size of the uncompressed data, returns false for malformed input
+    static bool Decompress(const char* src, usize srcSize, char* dst, usize dstSize);
+};
+
+}
+
+#endif // MORPH_RESOURCE_COMPRESSION_HPP
\ No newline at end of file
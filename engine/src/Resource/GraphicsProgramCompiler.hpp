@@ -6,22 +6,10 @@
 #include <Graphics/Context.hpp>
 
 #include "Storage.hpp"
+#include "GraphicsProgramPreprocessor.hpp"
 
 namespace Morph {
 
-class GraphicsProgramPreprocessorError
-{
-private:
-    string m_message;
-public:
-    GraphicsProgramPreprocessorError(string message) : m_message(message) {}
-    const string& message() { return m_message; }
-    inline friend std::ostream& operator<<(std::ostream& os, const GraphicsProgramPreprocessorError& error) {
-        os << "graphics program preprocessor error: " << error.m_message;
-        return os;
-    }
-};
-
 using GraphicsProgramCompileErrorVar = variant<ShaderCompileError, GraphicsProgramLinkError, GraphicsProgramPreprocessorError>;
 
 class GraphicsProgramCompileError
@@ -48,25 +36,12 @@ public:
     }
 };
 
-struct GraphicsProgramDefine
-{
-    string str;
-    GraphicsProgramDefine(string a_str) : str("#define " + a_str + "\n") {}
-    GraphicsProgramDefine(string name, string value) : GraphicsProgramDefine(name + " " + value) {}
-    GraphicsProgramDefine(string name, int value) : GraphicsProgramDefine(name, std::to_string(value)) {}
-    GraphicsProgramDefine(string name, float value) : GraphicsProgramDefine(name, std::to_string(value)) {}
-};
-
 class GraphicsProgramCompiler
 {
 private:
-    static string s_shaderTypeDirective;
-    static unord_map<string, RenderShaderType> s_shaderNamesToTypes;
     ref<GraphicsContext> m_context;
     cref<ResourceStorage> m_storage;
-    vector<GraphicsProgramDefine> m_defines;
-    unord_set<string> m_tempIncludes;
-    vector<string> m_stackIncludes;
+    GraphicsProgramPreprocessor m_preprocessor;
 public:
     GraphicsProgramCompiler(GraphicsContext& context, const ResourceStorage& storage);
     GraphicsProgramCompiler(GraphicsContext& context, const ResourceStorage& storage, const vector<GraphicsProgramDefine>& defines);
@@ -76,11 +51,8 @@ public:
     Result<RenderProgram, GraphicsProgramCompileError> CompileRenderProgramRes(const string& resFolderRelPath);
     Result<RenderProgram, GraphicsProgramCompileError> CompileRenderProgram(const string& path);
 
-    void SetDefines(const vector<GraphicsProgramDefine>& defines) { m_defines = defines; }
-
+    void SetDefines(const vector<GraphicsProgramDefine>& defines) { m_preprocessor.SetDefines(defines); }
 private:
-    Result<string, GraphicsProgramPreprocessorError> PreprocessComputeProgram(const string& path);
-    Result<array<string, enum_count<RenderShaderType>()>, GraphicsProgramPreprocessorError> PreprocessRenderProgram(const string& path);
     template<typename RenderShaderVarType>
     inline Result<RenderShaderVar, ShaderCompileError> ShaderCompileResVar(Result<RenderShaderVarType, ShaderCompileError> res) {
         using ShaderCompileRes = Result<RenderShaderVar, ShaderCompileError>;
@@ -89,10 +61,6 @@ private:
             [](ShaderCompileError error) -> ShaderCompileRes { return error; }
         );
     }
-    opt<GraphicsProgramPreprocessorError> ProcessLine(std::stringstream& outStream, const string& line, const string& programDir);
-    opt<GraphicsProgramPreprocessorError> ReadInclude(std::stringstream& outStream, const string& path, const string& programDir);
-    opt<string> GetIncludePath(const string& includeLine, const string& programDir) const;
-    string GetParentDir(const string& path) const;
 };
 
 }
@@ -0,0 +1,245 @@
+#include "GraphicsProgramPreprocessor.hpp"
+
+#include <Core/StringUtils.hpp>
+#include <Profile/Profiler.hpp>
+#include <Profile/MemoryTracker.hpp>
+
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+namespace Morph {
+
+string GraphicsProgramPreprocessor::s_shaderTypeDirective = "#type";
+
+unord_map<string, RenderShaderType> GraphicsProgramPreprocessor::s_shaderNamesToTypes = {
+    pair<string, RenderShaderType>("fs", RenderShaderType::FRAGMENT),
+    pair<string, RenderShaderType>("frag", RenderShaderType::FRAGMENT),
+    pair<string, RenderShaderType>("fragment", RenderShaderType::FRAGMENT),
+    pair<string, RenderShaderType>("vs", RenderShaderType::VERTEX),
+    pair<string, RenderShaderType>("vert", RenderShaderType::VERTEX),
+    pair<string, RenderShaderType>("vertex", RenderShaderType::VERTEX),
+    pair<string, RenderShaderType>("gs", RenderShaderType::GEOMETRY),
+    pair<string, RenderShaderType>("geom", RenderShaderType::GEOMETRY),
+    pair<string, RenderShaderType>("geometry", RenderShaderType::GEOMETRY),
+    pair<string, RenderShaderType>("tesc", RenderShaderType::TESS_CONTROL),
+    pair<string, RenderShaderType>("tess_control", RenderShaderType::TESS_CONTROL),
+    pair<string, RenderShaderType>("tessellation_control", RenderShaderType::TESS_CONTROL),
+    pair<string, RenderShaderType>("tese", RenderShaderType::TESS_EVALUATION),
+    pair<string, RenderShaderType>("tess_evaluation", RenderShaderType::TESS_EVALUATION),
+    pair<string, RenderShaderType>("tessellation_evaluation", RenderShaderType::TESS_EVALUATION),
+};
+
+GraphicsProgramPreprocessor::GraphicsProgramPreprocessor(const ResourceStorage& storage)
+    : m_storage(storage)
+{
+
+}
+
+GraphicsProgramPreprocessor::GraphicsProgramPreprocessor(const ResourceStorage& storage, const vector<GraphicsProgramDefine>& defines)
+    : m_storage(storage), m_defines(defines)
+{
+
+}
+
+Result<string, GraphicsProgramPreprocessorError> GraphicsProgramPreprocessor::PreprocessComputeProgram(const string& path)
+{
+    MORPH_PROFILE_FUNCTION();
+    MORPH_MEMORY_TAG("shader");
+    opt<string> programSrc = ReadSource(path);
+    string programDir = GetParentDir(path);
+    m_tempIncludes.clear();
+    m_stackIncludes.clear();
+    m_stackIncludes.push_back(path);
+    if(programSrc) {
+        std::istringstream programFile(programSrc.value());
+        std::stringstream programPreprocessedSrc;
+        bool isShader = false;
+        string line;
+        uint lineNum = 1;
+        while(ReadLine(programFile, line)) {
+            string trimedLine = trim_copy(line);
+            if(lineNum == 1) {
+                if(string_starts_with(trimedLine, "#version")) {
+                    programPreprocessedSrc << line << '\n';
+                    for(GraphicsProgramDefine& define: m_defines) {
+                        programPreprocessedSrc << define.str;
+                    }
+                } else {
+                    return GraphicsProgramPreprocessorError("first line must contain #version");
+                }
+            } else {
+                opt<GraphicsProgramPreprocessorError> optError = ProcessLine(programPreprocessedSrc, line, programDir);
+                if(optError) { return optError.value(); }
+            }
+            lineNum++;
+        }
+        return programPreprocessedSrc.str();
+    }
+    return GraphicsProgramPreprocessorError("cannot read file");
+}
+Result<array<string, enum_count<RenderShaderType>()>, GraphicsProgramPreprocessorError> GraphicsProgramPreprocessor::PreprocessRenderProgram(const string& path)
+{
+    MORPH_PROFILE_FUNCTION();
+    MORPH_MEMORY_TAG("shader");
+    array<string, enum_count<RenderShaderType>()> shadersSrc;
+    opt<string> programSrc = ReadSource(path);
+    string programDir = GetParentDir(path);
+    m_tempIncludes.clear();
+    m_stackIncludes.clear();
+    m_stackIncludes.push_back(path);
+    if(programSrc) {
+        std::istringstream programFile(programSrc.value());
+        std::stringstream programSharedSrcPart;
+        array<std::stringstream, enum_count<RenderShaderType>()> shadersSrc;
+        RenderShaderType actualShader = RenderShaderType::FRAGMENT;
+        bool isShader = false;
+        string line;
+        uint lineNum = 1;
+        while(ReadLine(programFile, line)) {
+            string trimedLine = trim_copy(line);
+            if(string_starts_with(trimedLine, s_shaderTypeDirective)) {
+                m_tempIncludes.clear();
+                if(lineNum == 1) {
+                    return GraphicsProgramPreprocessorError("first line must contain #version");
+                }
+                string shaderName = trim_copy(trimedLine.substr(s_shaderTypeDirective.size()));
+                auto shaderNamesToTypesPairIt = s_shaderNamesToTypes.find(shaderName);
+                if(shaderNamesToTypesPairIt == s_shaderNamesToTypes.end()) {
+                    return GraphicsProgramPreprocessorError("invalid shader type: " + shaderName);
+                }
+                isShader = true;
+                actualShader = shaderNamesToTypesPairIt->second;
+                std::stringstream& actualShaderSrc = shadersSrc[enum_index(actualShader).value()];
+                actualShaderSrc << programSharedSrcPart.str();
+            } else if(isShader) {
+                if(lineNum == 1) {
+                    return GraphicsProgramPreprocessorError("first line must contain #version");
+                }
+                std::stringstream& actualShaderSrc = shadersSrc[enum_index(actualShader).value()];
+                opt<GraphicsProgramPreprocessorError> optError = ProcessLine(actualShaderSrc, line, programDir);
+                if(optError) { return optError.value(); }
+            } else {
+                if(lineNum == 1) {
+                    if(string_starts_with(trimedLine, "#version")) {
+                        programSharedSrcPart << line << '\n';
+                        for(GraphicsProgramDefine& define: m_defines) {
+                            programSharedSrcPart << define.str;
+                        }
+                    } else {
+                        return GraphicsProgramPreprocessorError("first line must contain #version");
+                    }
+                } else {
+                    opt<GraphicsProgramPreprocessorError> optError = ProcessLine(programSharedSrcPart, line, programDir);
+                    if(optError) { return optError.value(); }
+                }
+            }
+            lineNum++;
+        }
+        array<string, enum_count<RenderShaderType>()> shadersSrcRes;
+        std::transform(shadersSrc.begin(), shadersSrc.end(), shadersSrcRes.begin(),
+            [](const std::stringstream& src) -> string { return src.str(); }
+        );
+        return shadersSrcRes;
+    }
+    return GraphicsProgramPreprocessorError("cannot read file");
+}
+
+opt<GraphicsProgramPreprocessorError> GraphicsProgramPreprocessor::ProcessLine(std::stringstream& outStream, const string& line, const string& programDir)
+{
+    string trimedLine = trim_copy(line);
+    if(string_starts_with(trimedLine, s_shaderTypeDirective)) {
+        return GraphicsProgramPreprocessorError("#type directive is not alowed here");
+    } if(string_starts_with(trimedLine, "#include")) {
+        opt<string> optPath = GetIncludePath(trimedLine, programDir);
+        if(!optPath) {
+            return GraphicsProgramPreprocessorError("include path does not exist");
+        }
+        string& path = optPath.value();
+        for(string& includePath: m_stackIncludes) {
+            if(includePath == path) {
+                return GraphicsProgramPreprocessorError("recursive include is not alowed");
+            }
+        }
+        if(m_tempIncludes.count(path) > 0) {
+            return {};
+        }
+        m_tempIncludes.insert(path);
+        m_stackIncludes.push_back(path);
+        opt<GraphicsProgramPreprocessorError> optError = ReadInclude(outStream, path, programDir);
+        m_stackIncludes.pop_back();
+        return optError;
+    }
+    outStream << line << '\n';
+    return {};
+}
+opt<GraphicsProgramPreprocessorError> GraphicsProgramPreprocessor::ReadInclude(std::stringstream& outStream, const string& path, const string& programDir)
+{
+    opt<string> includeSrc = ReadSource(path);
+    if(includeSrc) {
+        std::istringstream includeFile(includeSrc.value());
+        string line;
+        uint lineNum = 1;
+        while(ReadLine(includeFile, line)) {
+            opt<GraphicsProgramPreprocessorError> optError = ProcessLine(outStream, line, programDir);
+            if(optError) { return optError; }
+            lineNum++;
+        }
+        return {};
+    }
+    return GraphicsProgramPreprocessorError("cannot read include file");
+}
+opt<string> GraphicsProgramPreprocessor::GetIncludePath(const string& includeLine, const string& programDir) const
+{
+    string includeDirective = "#include";
+    string closedPathStr = trim_copy(includeLine.substr(includeDirective.size()));
+    if(closedPathStr.size() < 3) {
+        return {};
+    }
+    if(closedPathStr[0] == '\"' && closedPathStr[closedPathStr.size()-1] == '\"') {
+        string pathText = closedPathStr.substr(1, closedPathStr.size() - 2);
+        return programDir + "/" + pathText;
+    }
+    if(closedPathStr[0] == '<' && closedPathStr[closedPathStr.size()-1] == '>') {
+        string pathText = closedPathStr.substr(1, closedPathStr.size() - 2);
+        const ResourceStorage& storage = m_storage;
+        if(storage.IsResPath(pathText)) {
+            return pathText;
+        }
+    }
+    return {};
+}
+string GraphicsProgramPreprocessor::GetParentDir(const string& path) const
+{
+    const ResourceStorage& storage = m_storage;
+    if(storage.IsResPath(path)) {
+        string::size_type sepEnd = path.find(storage.GetResSeparator()) + storage.GetResSeparator().size();
+        string::size_type slashPos = path.find_last_of('/');
+        if(slashPos == string::npos || slashPos < sepEnd) {
+            return path.substr(0, sepEnd);
+        }
+        return path.substr(0, slashPos);
+    }
+    std::filesystem::path filePath = path;
+    return filePath.parent_path().string();
+}
+opt<string> GraphicsProgramPreprocessor::ReadSource(const string& path) const
+{
+    const ResourceStorage& storage = m_storage;
+    if(storage.IsResPath(path)) {
+        return storage.ReadFileRes(path);
+    }
+    return ResourceStorage::ReadFile(path);
+}
+bool GraphicsProgramPreprocessor::ReadLine(std::istream& stream, string& line)
+{
+    if(!std::getline(stream, line)) {
+        return false;
+    }
+    if(!line.empty() && line.back() == '\r') {
+        line.pop_back();
+    }
+    return true;
+}
+
+}
\ No newline at end of file
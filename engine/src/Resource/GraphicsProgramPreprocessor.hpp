@@ -0,0 +1,64 @@
+#ifndef MORPH_GRAPHICS_PROGRAM_PREPROCESSOR_HPP
+#define MORPH_GRAPHICS_PROGRAM_PREPROCESSOR_HPP
+
+#include <Core/Core.hpp>
+#include <Graphics/Enums.hpp>
+
+#include "Storage.hpp"
+
+namespace Morph {
+
+class GraphicsProgramPreprocessorError
+{
+private:
+    string m_message;
+public:
+    GraphicsProgramPreprocessorError(string message) : m_message(message) {}
+    const string& message() { return m_message; }
+    inline friend std::ostream& operator<<(std::ostream& os, const GraphicsProgramPreprocessorError& error) {
+        os << "graphics program preprocessor error: " << error.m_message;
+        return os;
+    }
+};
+
+struct GraphicsProgramDefine
+{
+    string str;
+    GraphicsProgramDefine(string a_str) : str("#define " + a_str + "\n") {}
+    GraphicsProgramDefine(string name, string value) : GraphicsProgramDefine(name + " " + value) {}
+    GraphicsProgramDefine(string name, int value) : GraphicsProgramDefine(name, std::to_string(value)) {}
+    GraphicsProgramDefine(string name, float value) : GraphicsProgramDefine(name, std::to_string(value)) {}
+};
+
+// Resolves #include directives, injects defines after #version and splits render programs by #type directives.
+// Does not need a graphics context, so it can be used by tools and benchmarks.
+class GraphicsProgramPreprocessor
+{
+private:
+    static string s_shaderTypeDirective;
+    static unord_map<string, RenderShaderType> s_shaderNamesToTypes;
+    cref<ResourceStorage> m_storage;
+    vector<GraphicsProgramDefine> m_defines;
+    unord_set<string> m_tempIncludes;
+    vector<string> m_stackIncludes;
+public:
+    GraphicsProgramPreprocessor(const ResourceStorage& storage);
+    GraphicsProgramPreprocessor(const ResourceStorage& storage, const vector<GraphicsProgramDefine>& defines);
+
+    Result<string, GraphicsProgramPreprocessorError> PreprocessComputeProgram(const string& path);
+    Result<array<string, enum_count<RenderShaderType>()>, GraphicsProgramPreprocessorError> PreprocessRenderProgram(const string& path);
+
+    void SetDefines(const vector<GraphicsProgramDefine>& defines) { m_defines = defines; }
+private:
+    opt<GraphicsProgramPreprocessorError> ProcessLine(std::stringstream& outStream, const string& line, const string& programDir);
+    opt<GraphicsProgramPreprocessorError> ReadInclude(std::stringstream& outStream, const string& path, const string& programDir);
+    opt<string> GetIncludePath(const string& includeLine, const string& programDir) const;
+    string GetParentDir(const string& path) const;
+    // res paths are read through the storage, so they can come from the mounted pack
+    opt<string> ReadSource(const string& path) const;
+    static bool ReadLine(std::istream& stream, string& line);
+};
+
+}
+
+#endif // MORPH_GRAPHICS_PROGRAM_PREPROCESSOR_HPP
\ No newline at end of file
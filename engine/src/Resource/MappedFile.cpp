@@ -0,0 +1,107 @@
+#include "MappedFile.hpp"
+
+#ifdef MORPH_WINDOWS
+    #define WIN32_LEAN_AND_MEAN
+    #define NOMINMAX
+    #include <windows.h>
+#else
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
+
+namespace Morph {
+
+class MappedFile::Mapping
+{
+public:
+    void* address = nullptr;
+    usize size = 0;
+    string buffer;
+#ifdef MORPH_WINDOWS
+    HANDLE mappingHandle = NULL;
+#endif
+
+    Mapping() {}
+    Mapping(const Mapping& other) = delete;
+    Mapping& operator=(const Mapping& other) = delete;
+    ~Mapping() {
+#ifdef MORPH_WINDOWS
+        if(address) {
+            UnmapViewOfFile(address);
+        }
+        if(mappingHandle) {
+            CloseHandle(mappingHandle);
+        }
+#else
+        if(address) {
+            munmap(address, size);
+        }
+#endif
+    }
+};
+
+opt<MappedFile> MappedFile::Map(const string& path)
+{
+    shared<Mapping> mapping = std::make_shared<Mapping>();
+#ifdef MORPH_WINDOWS
+    HANDLE fileHandle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if(fileHandle == INVALID_HANDLE_VALUE) {
+        return {};
+    }
+    LARGE_INTEGER fileSize;
+    if(!GetFileSizeEx(fileHandle, &fileSize)) {
+        CloseHandle(fileHandle);
+        return {};
+    }
+    mapping->size = (usize)fileSize.QuadPart;
+    if(mapping->size > 0) {
+        mapping->mappingHandle = CreateFileMappingA(fileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+        if(mapping->mappingHandle) {
+            mapping->address = MapViewOfFile(mapping->mappingHandle, FILE_MAP_READ, 0, 0, 0);
+        }
+    }
+    CloseHandle(fileHandle);
+#else
+    int fd = open(path.c_str(), O_RDONLY);
+    if(fd < 0) {
+        return {};
+    }
+    struct stat fileStat;
+    if(fstat(fd, &fileStat) != 0 || !S_ISREG(fileStat.st_mode)) {
+        close(fd);
+        return {};
+    }
+    mapping->size = (usize)fileStat.st_size;
+    if(mapping->size > 0) {
+        void* address = mmap(nullptr, mapping->size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(address != MAP_FAILED) {
+            mapping->address = address;
+            madvise(address, mapping->size, MADV_SEQUENTIAL);
+        }
+    }
+    // the mapping keeps its own reference to the file
+    close(fd);
+#endif
+    if(mapping->size > 0 && !mapping->address) {
+        return {};
+    }
+    return MappedFile(mapping, (const char*)mapping->address, mapping->size);
+}
+
+MappedFile MappedFile::FromBuffer(string contents)
+{
+    shared<Mapping> mapping = std::make_shared<Mapping>();
+    mapping->buffer = std::move(contents);
+    return MappedFile(mapping, mapping->buffer.data(), mapping->buffer.size());
+}
+
+MappedFile MappedFile::Sub(usize offset, usize size) const
+{
+    offset = std::min(offset, m_size);
+    size = std::min(size, m_size - offset);
+    return MappedFile(m_mapping, m_data + offset, size);
+}
+
+}
\ No newline at end of file
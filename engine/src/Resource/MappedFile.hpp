@@ -0,0 +1,45 @@
+#ifndef MORPH_RESOURCE_MAPPED_FILE_HPP
+#define MORPH_RESOURCE_MAPPED_FILE_HPP
+
+#include <Core/Core.hpp>
+
+#include <string_view>
+
+namespace Morph {
+
+// Read-only view of a memory mapped file. Copies share the mapping, which is released with the last copy.
+class MappedFile
+{
+private:
+    class Mapping;
+    shared<const Mapping> m_mapping;
+    const char* m_data = nullptr;
+    usize m_size = 0;
+public:
+    MappedFile() {}
+
+    // maps the whole file into memory without copying it
+    static opt<MappedFile> Map(const string& path);
+    // view owning the given contents, used where the data cannot be mapped directly (decompressed data etc.)
+    static MappedFile FromBuffer(string contents);
+
+    // view of the part of this file, shares the mapping
+    MappedFile Sub(usize offset, usize size) const;
+
+    inline const char* data() const { return m_data; }
+    inline usize size() const { return m_size; }
+    inline bool empty() const { return m_size == 0; }
+    inline std::string_view view() const { return std::string_view(m_data, m_size); }
+    inline string str() const { return string(m_data, m_size); }
+
+    inline const char* begin() const { return m_data; }
+    inline const char* end() const { return m_data + m_size; }
+    inline const char& operator[](usize i) const { return m_data[i]; }
+private:
+    MappedFile(shared<const Mapping> mapping, const char* data, usize size)
+        : m_mapping(mapping), m_data(data), m_size(size) {}
+};
+
+}
+
+#endif // MORPH_RESOURCE_MAPPED_FILE_HPP
\ No newline at end of file
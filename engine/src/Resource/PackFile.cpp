@@ -0,0 +1,207 @@
+#include "PackFile.hpp"
+
+#include "Compression.hpp"
+#include "Storage.hpp"
+
+#include <filesystem>
+#include <fstream>
+#include <cstring>
+
+namespace Morph {
+
+opt<PackFile> PackFile::Open(const string& path)
+{
+    opt<MappedFile> maybeFile = MappedFile::Map(path);
+    if(!maybeFile) {
+        return {};
+    }
+    PackFile pack;
+    pack.m_file = std::move(maybeFile.value());
+    const MappedFile& file = pack.m_file;
+    if(file.size() < sizeof(PackFileHeader)) {
+        return {};
+    }
+    pack.m_header = (const PackFileHeader*)file.data();
+    const PackFileHeader& header = *pack.m_header;
+    if(header.magic != PackFileHeader::s_magic || header.version != PackFileHeader::s_version) {
+        return {};
+    }
+    usize entriesEnd = sizeof(PackFileHeader) + (usize)header.entryCount * sizeof(PackFileEntry);
+    if(entriesEnd > file.size() || header.namesOffset + header.namesSize > file.size()) {
+        return {};
+    }
+    pack.m_entries = (const PackFileEntry*)(file.data() + sizeof(PackFileHeader));
+    for(usize i = 0; i < header.entryCount; ++i) {
+        const PackFileEntry& entry = pack.m_entries[i];
+        if(entry.nameOffset + entry.nameSize > header.namesSize || entry.dataOffset + entry.storedSize > file.size()) {
+            return {};
+        }
+    }
+    return pack;
+}
+
+string PackFile::EntryName(const string& resFolder, const string& relPath)
+{
+    string normalPath = std::filesystem::path(relPath).lexically_normal().generic_string();
+    usize start = normalPath.find_first_not_of('/');
+    return resFolder + "/" + (start == string::npos ? "" : normalPath.substr(start));
+}
+
+opt<MappedFile> PackFile::Map(const string& entryName) const
+{
+    const PackFileEntry* entry = Find(entryName);
+    if(!entry) {
+        return {};
+    }
+    if(entry->compression == PackCompression::LZ4) {
+        string contents;
+        contents.resize(entry->size);
+        if(!LZ4Compression::Decompress(m_file.data() + entry->dataOffset, entry->storedSize, contents.data(), contents.size())) {
+            return {};
+        }
+        return MappedFile::FromBuffer(std::move(contents));
+    }
+    return m_file.Sub(entry->dataOffset, entry->size);
+}
+
+bool PackFile::Contains(const string& entryName) const
+{
+    return Find(entryName) != nullptr;
+}
+
+std::string_view PackFile::GetEntryName(usize index) const
+{
+    const PackFileEntry& entry = m_entries[index];
+    return std::string_view(m_file.data() + m_header->namesOffset + entry.nameOffset, entry.nameSize);
+}
+
+const PackFileEntry* PackFile::Find(const string& entryName) const
+{
+    if(!m_header) {
+        return nullptr;
+    }
+    const PackFileEntry* entriesEnd = m_entries + m_header->entryCount;
+    const char* names = m_file.data() + m_header->namesOffset;
+    const PackFileEntry* it = std::lower_bound(m_entries, entriesEnd, entryName,
+        [&](const PackFileEntry& entry, const string& name) {
+            return std::string_view(names + entry.nameOffset, entry.nameSize) < name;
+        }
+    );
+    if(it != entriesEnd && std::string_view(names + it->nameOffset, it->nameSize) == entryName) {
+        return it;
+    }
+    return nullptr;
+}
+
+
+void PackFileWriter::AddFile(const string& resFolder, const string& relPath, string contents)
+{
+    m_files.insert_or_assign(PackFile::EntryName(resFolder, relPath), std::move(contents));
+}
+
+bool PackFileWriter::AddDirectory(const string& resFolder, const string& dirPath)
+{
+    std::filesystem::path rootPath = std::filesystem::path(dirPath).lexically_normal();
+    if(!rootPath.has_filename()) {
+        rootPath = rootPath.parent_path();
+    }
+    std::error_code error;
+    std::filesystem::recursive_directory_iterator dirIt(rootPath, error);
+    if(error) {
+        return false;
+    }
+    for(const std::filesystem::directory_entry& dirEntry : dirIt) {
+        if(!dirEntry.is_regular_file()) {
+            continue;
+        }
+        opt<string> contents = ResourceStorage::ReadFile(dirEntry.path().string());
+        if(!contents) {
+            return false;
+        }
+        string relPath = dirEntry.path().lexically_relative(rootPath).generic_string();
+        AddFile(resFolder, relPath, std::move(contents.value()));
+    }
+    return true;
+}
+
+static inline u64 AlignUp(u64 value, u64 alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+bool PackFileWriter::Write(const string& path, bool compress, u32 alignment) const
+{
+    alignment = std::max<u32>(alignment, 1);
+    vector<PackFileEntry> entries;
+    vector<string> storedData;
+    string names;
+    entries.reserve(m_files.size());
+    storedData.reserve(m_files.size());
+    // map is ordered, so the entries end up sorted by name for the binary search
+    for(const auto& [name, contents] : m_files) {
+        PackFileEntry entry = {};
+        entry.nameOffset = names.size();
+        entry.nameSize = (u32)name.size();
+        entry.size = contents.size();
+        entry.compression = PackCompression::NONE;
+        names += name;
+        string stored;
+        if(compress && !contents.empty()) {
+            stored = LZ4Compression::Compress(contents.data(), contents.size());
+            if(stored.size() < contents.size() - contents.size() / 8) {
+                entry.compression = PackCompression::LZ4;
+            } else {
+                stored.clear();
+            }
+        }
+        entry.storedSize = entry.compression == PackCompression::NONE ? contents.size() : stored.size();
+        entries.push_back(entry);
+        storedData.push_back(std::move(stored));
+    }
+
+    PackFileHeader header = {};
+    header.magic = PackFileHeader::s_magic;
+    header.version = PackFileHeader::s_version;
+    header.entryCount = (u32)entries.size();
+    header.alignment = alignment;
+    header.namesOffset = sizeof(PackFileHeader) + entries.size() * sizeof(PackFileEntry);
+    header.namesSize = names.size();
+    u64 dataOffset = AlignUp(header.namesOffset + header.namesSize, alignment);
+    for(PackFileEntry& entry : entries) {
+        entry.dataOffset = dataOffset;
+        dataOffset = AlignUp(dataOffset + entry.storedSize, alignment);
+    }
+
+    std::ofstream file(path, std::ios::binary);
+    if(!file) {
+        return false;
+    }
+    u64 written = 0;
+    auto write = [&](const char* data, usize size) {
+        file.write(data, size);
+        written += size;
+    };
+    auto pad = [&](u64 offset) {
+        static const array<char, 64> zeros = {};
+        while(written < offset) {
+            write(zeros.data(), (usize)std::min<u64>(offset - written, zeros.size()));
+        }
+    };
+    write((const char*)&header, sizeof(header));
+    write((const char*)entries.data(), entries.size() * sizeof(PackFileEntry));
+    write(names.data(), names.size());
+    usize i = 0;
+    for(const auto& [name, contents] : m_files) {
+        const PackFileEntry& entry = entries[i];
+        pad(entry.dataOffset);
+        if(entry.compression == PackCompression::NONE) {
+            write(contents.data(), contents.size());
+        } else {
+            write(storedData[i].data(), storedData[i].size());
+        }
+        ++i;
+    }
+    return (bool)file;
+}
+
+}
\ No newline at end of file
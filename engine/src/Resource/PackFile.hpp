@@ -0,0 +1,81 @@
+#ifndef MORPH_RESOURCE_PACK_FILE_HPP
+#define MORPH_RESOURCE_PACK_FILE_HPP
+
+#include <Core/Core.hpp>
+
+#include "MappedFile.hpp"
+
+namespace Morph {
+
+enum class PackCompression : u32
+{
+    NONE,
+    LZ4
+};
+
+// Layout of the pack file: header, entries sorted by name, names, entries data (each entry aligned).
+struct PackFileHeader
+{
+    static constexpr array<char, 4> s_magic = {'M', 'P', 'A', 'K'};
+    static constexpr u32 s_version = 1;
+
+    array<char, 4> magic;
+    u32 version;
+    u32 entryCount;
+    u32 alignment;
+    u64 namesOffset;
+    u64 namesSize;
+};
+
+struct PackFileEntry
+{
+    u64 nameOffset;
+    u32 nameSize;
+    PackCompression compression;
+    u64 dataOffset;
+    u64 size;
+    u64 storedSize;
+};
+
+// Archive of resources mapped with a single mapping, entries are named "folder/relative/path".
+class PackFile
+{
+private:
+    MappedFile m_file;
+    const PackFileHeader* m_header = nullptr;
+    const PackFileEntry* m_entries = nullptr;
+public:
+    PackFile() {}
+
+    static opt<PackFile> Open(const string& path);
+
+    static string EntryName(const string& resFolder, const string& relPath);
+
+    // uncompressed entries are returned without copying, they share the mapping of the pack file
+    opt<MappedFile> Map(const string& entryName) const;
+    bool Contains(const string& entryName) const;
+
+    inline usize GetEntryCount() const { return m_header ? m_header->entryCount : 0; }
+    std::string_view GetEntryName(usize index) const;
+private:
+    const PackFileEntry* Find(const string& entryName) const;
+};
+
+class PackFileWriter
+{
+private:
+    map<string, string> m_files;
+public:
+    void AddFile(const string& resFolder, const string& relPath, string contents);
+    // adds all files from the directory recursively as entries of the given res folder
+    bool AddDirectory(const string& resFolder, const string& dirPath);
+
+    // entries are compressed only when it makes them noticeably smaller
+    bool Write(const string& path, bool compress = true, u32 alignment = 16) const;
+
+    inline usize GetFileCount() const { return m_files.size(); }
+};
+
+}
+
+#endif // MORPH_RESOURCE_PACK_FILE_HPP
\ No newline at end of file
@@ -1,5 +1,11 @@
 #include "ResourceManager.hpp"
 
+#include <Core/JobManager.hpp>
+#include <Profile/Profiler.hpp>
+#include <Profile/MemoryTracker.hpp>
+
+#include "MappedFile.hpp"
+
 #include <stb/stb_image_write.h>
 #include <stb/stb_image.h>
 
@@ -9,12 +15,20 @@
 #include <tuple>
 #include <algorithm>
 #include <sstream>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#endif
 
 namespace Morph {
 
 
 opt<Image2D> ResourceManager::LoadImage2D_PNG(string filename)
 {
+    MORPH_PROFILE_FUNCTION();
+    MORPH_MEMORY_TAG("resource");
     uvec2 dim = uvec2(0);
     TextureSizedFormat format = TextureSizedFormat::RGB8;
     int channels = 0;
@@ -38,6 +52,266 @@ opt<Image2D> ResourceManager::LoadImage2D_PNG(string filename)
 
 }
 
+namespace {
+
+// One scanline of RGBE pixels, decoded into out when Write is true and only skipped otherwise.
+// Returns the position after the scanline or nullptr when the data is broken.
+template<bool Write>
+const u8* DecodeHDRScanline(const u8* in, const u8* end, u32 width, u8* out)
+{
+    // new style run length encoding: 2, 2, width, then the four components one after another,
+    // each as runs (count > 128 repeats the next byte count - 128 times) and literal spans
+    if(width >= 8 && width < 32768 && end - in >= 4 && in[0] == 2 && in[1] == 2 && !(in[2] & 0x80)) {
+        if((((u32)in[2] << 8) | in[3]) != width) {
+            return nullptr;
+        }
+        in += 4;
+        for(u32 c = 0; c < 4; ++c) {
+            u32 x = 0;
+            while(x < width) {
+                if(in >= end) {
+                    return nullptr;
+                }
+                u32 count = *in++;
+                if(count > 128) {
+                    count -= 128;
+                    if(count > width - x || in >= end) {
+                        return nullptr;
+                    }
+                    if(Write) {
+                        u8 value = *in;
+                        for(u32 i = 0; i < count; ++i) {
+                            out[(x + i) * 4 + c] = value;
+                        }
+                    }
+                    in++;
+                } else {
+                    if(count == 0 || count > width - x || (usize)(end - in) < count) {
+                        return nullptr;
+                    }
+                    if(Write) {
+                        for(u32 i = 0; i < count; ++i) {
+                            out[(x + i) * 4 + c] = in[i];
+                        }
+                    }
+                    in += count;
+                }
+                x += count;
+            }
+        }
+        return in;
+    }
+    // flat pixels, with the old style runs 1, 1, 1, count repeating the previous pixel
+    u32 shift = 0;
+    u32 x = 0;
+    while(x < width) {
+        if(end - in < 4) {
+            return nullptr;
+        }
+        if(in[0] == 1 && in[1] == 1 && in[2] == 1) {
+            // a fifth run in a row would shift its count past the 32 bits
+            if(shift > 24) {
+                return nullptr;
+            }
+            u32 count = (u32)in[3] << shift;
+            if(x == 0 || count > width - x) {
+                return nullptr;
+            }
+            if(Write) {
+                for(u32 i = 0; i < count; ++i) {
+                    memcpy(out + (x + i) * 4, out + (x - 1) * 4, 4);
+                }
+            }
+            x += count;
+            shift += 8;
+        } else {
+            if(Write) {
+                memcpy(out + x * 4, in, 4);
+            }
+            x++;
+            shift = 0;
+        }
+        in += 4;
+    }
+    return in;
+}
+
+void ConvertRGBE(const u8* rgbe, u32 width, f32* out)
+{
+    const f32* scale = ResourceManager::RGBEScales().data();
+    u32 x = 0;
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    // four pixels at once, each stored as four floats over the red of the next pixel,
+    // so the last group leaves one pixel for the scalar loop to stay in the row
+    const __m128i zero = _mm_setzero_si128();
+    for(; x + 4 < width; x += 4) {
+        const u8* p = rgbe + x * 4;
+        __m128i bytes = _mm_loadu_si128((const __m128i*)p);
+        __m128i lo = _mm_unpacklo_epi8(bytes, zero);
+        __m128i hi = _mm_unpackhi_epi8(bytes, zero);
+        f32* o = out + x * 3;
+        _mm_storeu_ps(o, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(lo, zero)), _mm_set1_ps(scale[p[3]])));
+        _mm_storeu_ps(o + 3, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(lo, zero)), _mm_set1_ps(scale[p[7]])));
+        _mm_storeu_ps(o + 6, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(hi, zero)), _mm_set1_ps(scale[p[11]])));
+        _mm_storeu_ps(o + 9, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(hi, zero)), _mm_set1_ps(scale[p[15]])));
+    }
+#endif
+    for(; x < width; ++x) {
+        const u8* p = rgbe + x * 4;
+        f32 s = scale[p[3]];
+        out[x * 3 + 0] = p[0] * s;
+        out[x * 3 + 1] = p[1] * s;
+        out[x * 3 + 2] = p[2] * s;
+    }
+}
+
+// Decodes the scanlines [from, to) of an HDR file into RGB32F rows, or into RGBE rows when convert is false
+class HDRScanlinesJob : public Job
+{
+public:
+    HDRScanlinesJob(const vector<const u8*>& scanlines, const u8* end, u32 width, u32 height, bool bottomUp, bool convert, u8* out, u32 from, u32 to)
+        : m_scanlines(&scanlines), m_end(end), m_width(width), m_height(height), m_bottomUp(bottomUp), m_convert(convert), m_out(out), m_from(from), m_to(to) {}
+
+    void Run() override
+    {
+        vector<u8> rgbe(m_convert ? m_width * 4 : 0);
+        for(u32 s = m_from; s < m_to; ++s) {
+            u32 row = m_bottomUp ? s : m_height - 1 - s;
+            // the scanlines were validated when they were indexed
+            if(m_convert) {
+                DecodeHDRScanline<true>((*m_scanlines)[s], m_end, m_width, rgbe.data());
+                ConvertRGBE(rgbe.data(), m_width, (f32*)m_out + (usize)row * m_width * 3);
+            } else {
+                DecodeHDRScanline<true>((*m_scanlines)[s], m_end, m_width, m_out + (usize)row * m_width * 4);
+            }
+        }
+    }
+private:
+    const vector<const u8*>* m_scanlines;
+    const u8* m_end;
+    u32 m_width;
+    u32 m_height;
+    bool m_bottomUp;
+    bool m_convert;
+    u8* m_out;
+    u32 m_from;
+    u32 m_to;
+};
+
+opt<Image2D> LoadHDR(const string& filename, JobManager* jobManager, bool convert)
+{
+    opt<MappedFile> file = MappedFile::Map(filename);
+    if(!file) {
+        return {};
+    }
+    const u8* in = (const u8*)file->data();
+    const u8* end = in + file->size();
+
+    auto readLine = [&](std::string_view& line) {
+        const u8* newline = (const u8*)memchr(in, '\n', end - in);
+        if(!newline) {
+            return false;
+        }
+        line = std::string_view((const char*)in, newline - in);
+        in = newline + 1;
+        return true;
+    };
+
+    // "#?RADIANCE" or "#?RGBE", variables up to an empty line, then the resolution
+    std::string_view line;
+    if(!readLine(line) || line.substr(0, 2) != "#?") {
+        return {};
+    }
+    while(true) {
+        if(!readLine(line)) {
+            return {};
+        }
+        if(line.empty()) {
+            break;
+        }
+        // EXPOSURE and the other variables only describe how the values were produced
+        if(line.substr(0, 7) == "FORMAT=" && line != "FORMAT=32-bit_rle_rgbe") {
+            return {};
+        }
+    }
+    if(!readLine(line)) {
+        return {};
+    }
+    char ySign = 0;
+    char xSign = 0;
+    uint height = 0;
+    uint width = 0;
+    string resolution(line);
+    if(sscanf(resolution.c_str(), "%cY %u %cX %u", &ySign, &height, &xSign, &width) != 4 ||
+        (ySign != '-' && ySign != '+') || xSign != '+' || width == 0 || height == 0) {
+        return {};
+    }
+    // -Y lists the scanlines from the top, +Y from the bottom
+    bool bottomUp = ySign == '+';
+
+    // the run length encoded scanlines have different sizes, so they are found one after another first
+    vector<const u8*> scanlines(height);
+    for(uint s = 0; s < height; ++s) {
+        scanlines[s] = in;
+        in = DecodeHDRScanline<false>(in, end, width, nullptr);
+        if(!in) {
+            return {};
+        }
+    }
+
+    Image2D image;
+    image.dim = uvec2(width, height);
+    image.format = convert ? TextureSizedFormat::RGB32F : TextureSizedFormat::RGBA8;
+    image.data.resize((usize)width * height * (convert ? 3 * sizeof(f32) : 4));
+    u8* out = image.data.data();
+    if(!jobManager) {
+        HDRScanlinesJob(scanlines, end, width, height, bottomUp, convert, out, 0, height).Run();
+        return image;
+    }
+    // a few jobs per worker to even out the scanlines of different cost
+    uint jobCount = std::min(height, (uint)jobManager->GetMaxNumberOfWorkers() * 4);
+    vector<HDRScanlinesJob> jobs;
+    jobs.reserve(jobCount);
+    for(uint j = 0; j < jobCount; ++j) {
+        jobs.emplace_back(scanlines, end, width, height, bottomUp, convert, out, height * j / jobCount, height * (j + 1) / jobCount);
+    }
+    for(HDRScanlinesJob& job : jobs) {
+        jobManager->SubmitJob(&job);
+    }
+    jobManager->WaitForJobsToFinish();
+    return image;
+}
+
+}
+
+opt<Image2D> ResourceManager::LoadImage2D_HDR(string filename, JobManager* jobManager)
+{
+    MORPH_PROFILE_FUNCTION();
+    MORPH_MEMORY_TAG("resource");
+    return LoadHDR(filename, jobManager, true);
+}
+
+opt<Image2D> ResourceManager::LoadImage2D_HDR_RGBE(string filename, JobManager* jobManager)
+{
+    MORPH_PROFILE_FUNCTION();
+    MORPH_MEMORY_TAG("resource");
+    return LoadHDR(filename, jobManager, false);
+}
+
+const array<f32, 256>& ResourceManager::RGBEScales()
+{
+    // 2^(e - 136), the mantissas are bytes with the exponent biased by 128
+    static const array<f32, 256> s_scales = []() {
+        array<f32, 256> scales;
+        scales[0] = 0;
+        for(int e = 1; e < 256; ++e) {
+            scales[e] = std::ldexp(1.0f, e - 136);
+        }
+        return scales;
+    }();
+    return s_scales;
+}
+
 void ResourceManager::SaveImage2D_PNG(const Image2D& image, string filename)
 {
     TextureDataFormat dataFormat = GraphicsEnums::GetTextureDataFormat(image.format);
@@ -60,6 +334,8 @@ void ResourceManager::SaveTexture2D_PNG(const Texture2D& texture, string filenam
 
 opt<IndexedVerticesMesh3D<u32>> ResourceManager::LoadMesh3D_OBJ(string filename)
 {
+    MORPH_PROFILE_FUNCTION();
+    MORPH_MEMORY_TAG("resource");
     std::ifstream ifs(filename);
     if(!ifs) {
         return {};
@@ -10,10 +10,19 @@
 
 namespace Morph {
 
+class JobManager;
+
 class ResourceManager
 {
 public:
     static opt<Image2D> LoadImage2D_PNG(string filename);
+    // Radiance RGBE file with flat or run length encoded scanlines, loaded as RGB32F with the rows
+    // bottom-up like the PNG loader. The scanlines are decoded on the job manager when it is given.
+    static opt<Image2D> LoadImage2D_HDR(string filename, JobManager* jobManager = nullptr);
+    // the same pixels undecoded, RGBA8 with the shared exponent in alpha, a third of the RGB32F size
+    static opt<Image2D> LoadImage2D_HDR_RGBE(string filename, JobManager* jobManager = nullptr);
+    // value of a mantissa of 1 for every RGBE exponent byte, 0 for the exponent 0
+    static const array<f32, 256>& RGBEScales();
     static void SaveImage2D_PNG(const Image2D& image, string filename);
     static void SaveTexture2D_PNG(const Texture2D& texture, string filename);
     static opt<IndexedVerticesMesh3D<u32>> LoadMesh3D_OBJ(string filename);
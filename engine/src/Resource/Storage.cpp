@@ -1,5 +1,8 @@
 #include "Storage.hpp"
 
+#include <Profile/Profiler.hpp>
+#include <Profile/MemoryTracker.hpp>
+
 #include <filesystem>
 #include <fstream>
 
@@ -8,16 +11,32 @@ namespace Morph {
 ResourceStorage::ResourceStorage(string resSeparator)
     : m_resSeparator(resSeparator)
 {   
+#ifdef MORPH_RES_PACK
+    MountPack(MORPH_RES_PACK);
+#endif
 }
 ResourceStorage::ResourceStorage(const unord_map<string, string>& resFoldersToPaths, string resSeparator)
     : m_resFoldersToPaths(resFoldersToPaths), m_resSeparator(resSeparator)
 {
+#ifdef MORPH_RES_PACK
+    MountPack(MORPH_RES_PACK);
+#endif
 }
 
 void ResourceStorage::InsertResFolder(const string& name, const string& path)
 {
     m_resFoldersToPaths.insert_or_assign(name, path);
 }
+bool ResourceStorage::MountPack(const string& packPath)
+{
+    m_pack = PackFile::Open(packPath);
+    return m_pack.has_value();
+}
+bool ResourceStorage::IsResPath(const string& path) const
+{
+    string::size_type sepPos = path.find(m_resSeparator);
+    return sepPos != string::npos && m_resFoldersToPaths.count(path.substr(0, sepPos)) > 0;
+}
 opt<string> ResourceStorage::GetResFolderPath(const string& resFolder) const
 {
     auto folderPathPairIt = m_resFoldersToPaths.find(resFolder);
@@ -60,12 +79,26 @@ opt<string> ResourceStorage::GetResPathOrNormalPath(const string& resFolderRelPa
 
 opt<string> ResourceStorage::ReadFileRes(const string& resFolderRelPath) const
 {
+    if(opt<MappedFile> packed = MapPacked(resFolderRelPath)) {
+        return packed->str();
+    }
     opt<string> maybePath = GetPath(resFolderRelPath);
     if(maybePath) {
         return ReadFile(maybePath.value());
     }
     return {};
 }
+opt<MappedFile> ResourceStorage::MapFileRes(const string& resFolderRelPath) const
+{
+    if(opt<MappedFile> packed = MapPacked(resFolderRelPath)) {
+        return packed;
+    }
+    opt<string> maybePath = GetPath(resFolderRelPath);
+    if(maybePath) {
+        return MapFile(maybePath.value());
+    }
+    return {};
+}
 bool ResourceStorage::WriteToFileRes(const string& resFolderRelPath, const string& contents) const
 {
     opt<string> maybePath = GetPath(resFolderRelPath);
@@ -77,12 +110,26 @@ bool ResourceStorage::WriteToFileRes(const string& resFolderRelPath, const strin
 
 opt<string> ResourceStorage::ReadFileResOrNormal(const string& resFolderRelPathOrNormalPath) const
 {
+    if(opt<MappedFile> packed = MapPacked(resFolderRelPathOrNormalPath)) {
+        return packed->str();
+    }
     opt<string> maybePath = GetResPathOrNormalPath(resFolderRelPathOrNormalPath);
     if(maybePath) {
         return ReadFile(maybePath.value());
     }
     return {};
 }
+opt<MappedFile> ResourceStorage::MapFileResOrNormal(const string& resFolderRelPathOrNormalPath) const
+{
+    if(opt<MappedFile> packed = MapPacked(resFolderRelPathOrNormalPath)) {
+        return packed;
+    }
+    opt<string> maybePath = GetResPathOrNormalPath(resFolderRelPathOrNormalPath);
+    if(maybePath) {
+        return MapFile(maybePath.value());
+    }
+    return {};
+}
 bool ResourceStorage::WriteToFileResOrNormal(const string& resFolderRelPathOrNormalPath, const string& contents) const
 {
     opt<string> maybePath = GetResPathOrNormalPath(resFolderRelPathOrNormalPath);
@@ -95,17 +142,45 @@ bool ResourceStorage::WriteToFileResOrNormal(const string& resFolderRelPathOrNor
 
 opt<string> ResourceStorage::ReadFile(const string& filePathStr)
 {
+    MORPH_PROFILE_FUNCTION();
+    MORPH_MEMORY_TAG("resource");
     std::filesystem::path filePath(filePathStr);
     std::ifstream file(filePathStr, std::ios::binary);
     if(file) {
-        std::uintmax_t fileSize = std::filesystem::file_size(filePath);
+        std::error_code error;
+        std::uintmax_t fileSize = std::filesystem::file_size(filePath, error);
+        if(error) {
+            return {};
+        }
         std::string contents;
-        contents.reserve(fileSize);
-        contents.assign((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        contents.resize(fileSize);
+        file.read(contents.data(), fileSize);
+        contents.resize(file.gcount());
         return contents;
     }
     return {};
 }
+opt<MappedFile> ResourceStorage::MapFile(const string& filePathStr)
+{
+    MORPH_PROFILE_FUNCTION();
+    MORPH_MEMORY_TAG("resource");
+    return MappedFile::Map(filePathStr);
+}
+opt<MappedFile> ResourceStorage::MapPacked(const string& resFolderRelPath) const
+{
+    MORPH_PROFILE_FUNCTION();
+    MORPH_MEMORY_TAG("resource");
+    if(!m_pack) {
+        return {};
+    }
+    string::size_type sepPos = resFolderRelPath.find(m_resSeparator);
+    if(sepPos == string::npos) {
+        return {};
+    }
+    string resFolder = resFolderRelPath.substr(0, sepPos);
+    string relPath = resFolderRelPath.substr(sepPos + m_resSeparator.size());
+    return m_pack->Map(PackFile::EntryName(resFolder, relPath));
+}
 bool ResourceStorage::WriteToFile(const string& filePathStr, const string& contents)
 {
     std::ofstream file(filePathStr, std::ios::binary);
@@ -1,9 +1,11 @@
-
 #ifndef MORPH_RESOURCE_STORAGE_HPP
 #define MORPH_RESOURCE_STORAGE_HPP
 
 #include <Core/Core.hpp>
 
+#include "MappedFile.hpp"
+#include "PackFile.hpp"
+
 namespace Morph {
 
 class ResourceStorage
@@ -11,25 +13,37 @@ class ResourceStorage
 private:
     unord_map<string, string> m_resFoldersToPaths;
     string m_resSeparator;
+    opt<PackFile> m_pack;
 public:
     ResourceStorage(string resSeparator = ":");
     ResourceStorage(const unord_map<string, string>& resFoldersToPaths, string resSeparator = ":");
 
     void InsertResFolder(const string& name, const string& path);
+    // res paths are looked up in the pack first and then in the res folders
+    bool MountPack(const string& packPath);
+    inline bool HasPack() const { return m_pack.has_value(); }
+    bool IsResPath(const string& path) const;
+    inline const string& GetResSeparator() const { return m_resSeparator; }
     opt<string> GetResFolderPath(const string& resFolder) const;
     opt<string> GetPath(const string& resFolderRelPath) const;
     opt<string> GetPath(const string& resFolder, const string& relPath) const;
     opt<string> GetResPathOrNormalPath(const string& resFolderRelPathOrNormalPath) const;
 
     opt<string> ReadFileRes(const string& resFolderRelPath) const;
+    opt<MappedFile> MapFileRes(const string& resFolderRelPath) const;
     bool WriteToFileRes(const string& resFolderRelPath, const string& contents) const;
 
     opt<string> ReadFileResOrNormal(const string& resFolderRelPathOrNormalPath) const;
+    opt<MappedFile> MapFileResOrNormal(const string& resFolderRelPathOrNormalPath) const;
     bool WriteToFileResOrNormal(const string& resFolderRelPathOrNormalPath, const string& contents) const;
 
     static opt<string> ReadFile(const string& path);
+    // maps the whole file into memory without copying it, contents are valid as long as the returned view exists
+    static opt<MappedFile> MapFile(const string& path);
     static bool WriteToFile(const string& path, const string& contents);
 
+private:
+    opt<MappedFile> MapPacked(const string& resFolderRelPath) const;
 };
 
 }
@@ -1,6 +1,7 @@
 #include "Manager.hpp"
 
 #include <Graphics/OpenGL.hpp>
+#include <Profile/Profiler.hpp>
 
 namespace Morph {
 
@@ -197,14 +198,17 @@ opt<cref<Monitor>> WindowManager::GetMonitor(MonitorID id) const
 }
 void WindowManager::PollEvents()
 {
+    MORPH_PROFILE_FUNCTION();
     glfwPollEvents();
 }
 void WindowManager::WaitEvents()
 {
+    MORPH_PROFILE_FUNCTION();
     glfwWaitEvents();
 }
 void WindowManager::WaitEventsWithTimeout(double timeoutSeconds)
 {
+    MORPH_PROFILE_FUNCTION();
     glfwWaitEventsTimeout(timeoutSeconds);
 }
 void WindowManager::WakeUpFromWaitEvents()
@@ -0,0 +1,126 @@
+#include "Benchmark.hpp"
+
+#include <algorithm>
+#include <sstream>
+#include <iomanip>
+
+namespace Morph {
+
+vector<pair<string, BenchmarkFunc>>& Benchmarks::Registered()
+{
+    static vector<pair<string, BenchmarkFunc>> s_registered;
+    return s_registered;
+}
+
+bool Benchmarks::Register(const string& name, BenchmarkFunc func)
+{
+    Registered().push_back({name, func});
+    return true;
+}
+
+vector<BenchmarkResult> Benchmarks::RunAll(const BenchmarkConfig& config)
+{
+    vector<pair<string, BenchmarkFunc>> benchmarks = Registered();
+    std::sort(benchmarks.begin(), benchmarks.end(),
+        [](const auto& a, const auto& b) { return a.first < b.first; }
+    );
+    vector<BenchmarkResult> results;
+    for(const auto& [name, func] : benchmarks) {
+        if(!config.filter.empty() && name.find(config.filter) == string::npos) {
+            continue;
+        }
+        results.push_back(Run(name, func, config));
+        const BenchmarkResult& result = results.back();
+        spdlog::info("{:<50} median {:>14.1f} ns  p95 {:>14.1f} ns  ({} x {} iterations)",
+            result.name, result.median, result.p95, result.repetitions, result.iterations);
+    }
+    return results;
+}
+
+BenchmarkResult Benchmarks::Run(const string& name, BenchmarkFunc func, const BenchmarkConfig& config)
+{
+    auto runRepetition = [&](u64 iterations) -> f64 {
+        BenchmarkState state(iterations);
+        func(state);
+        return state.GetElapsedSeconds();
+    };
+
+    // find iteration count for the minimal repetition time
+    u64 iterations = 1;
+    while(true) {
+        f64 seconds = runRepetition(iterations);
+        if(seconds >= config.minRepetitionSeconds || iterations >= (1ull << 30)) {
+            break;
+        }
+        f64 scale = seconds > 0 ? config.minRepetitionSeconds / seconds * 1.2 : 10.0;
+        iterations = (u64)(iterations * std::clamp(scale, 2.0, 10.0));
+    }
+
+    for(u32 i = 0; i < config.warmup; ++i) {
+        runRepetition(iterations);
+    }
+    vector<f64> times;
+    times.reserve(config.repetitions);
+    for(u32 i = 0; i < std::max<u32>(config.repetitions, 1); ++i) {
+        times.push_back(runRepetition(iterations) * 1e9 / iterations);
+    }
+    std::sort(times.begin(), times.end());
+
+    BenchmarkResult result;
+    result.name = name;
+    result.iterations = iterations;
+    result.repetitions = (u32)times.size();
+    usize middle = times.size() / 2;
+    result.median = times.size() % 2 == 1 ? times[middle] : (times[middle - 1] + times[middle]) / 2;
+    // nearest rank percentile
+    result.p95 = times[std::min(times.size() - 1, (usize)std::ceil(0.95 * times.size()) - 1)];
+    result.min = times.front();
+    f64 sum = 0;
+    for(f64 time : times) {
+        sum += time;
+    }
+    result.mean = sum / times.size();
+    return result;
+}
+
+string Benchmarks::ToJson(const vector<BenchmarkResult>& results)
+{
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(1);
+    out << "{\n    \"unit\": \"ns\",\n    \"benchmarks\": [";
+    for(usize i = 0; i < results.size(); ++i) {
+        const BenchmarkResult& result = results[i];
+        out << (i == 0 ? "\n" : ",\n")
+            << "        { \"name\": \"" << result.name << "\""
+            << ", \"iterations\": " << result.iterations
+            << ", \"repetitions\": " << result.repetitions
+            << ", \"median\": " << result.median
+            << ", \"p95\": " << result.p95
+            << ", \"min\": " << result.min
+            << ", \"mean\": " << result.mean << " }";
+    }
+    out << "\n    ]\n}\n";
+    return out.str();
+}
+
+bool Benchmarks::Compare(const vector<BenchmarkResult>& results, const BenchmarkBaseline& baseline, const string& filter)
+{
+    vector<pair<string, f64>> medians;
+    for(const BenchmarkResult& result : results) {
+        medians.push_back({result.name, result.median});
+    }
+    bool passed = true;
+    for(const BenchmarkComparison& comparison : baseline.Compare(medians, "ns", false, filter)) {
+        if(comparison.failed) {
+            spdlog::error("{}", comparison.message);
+            passed = false;
+        } else if(!comparison.hasBaseline) {
+            spdlog::warn("{}", comparison.message);
+        } else {
+            spdlog::info("{}", comparison.message);
+        }
+    }
+    return passed;
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,102 @@
+#ifndef MORPH_BENCHMARK_HPP
+#define MORPH_BENCHMARK_HPP
+
+#include <Morph.hpp>
+#include <Profile/BenchmarkBaseline.hpp>
+
+#include <chrono>
+
+namespace Morph {
+
+// Passed to every benchmark, the timed part is the body of the while(state.KeepRunning()) loop.
+class BenchmarkState
+{
+private:
+    using clock = std::chrono::steady_clock;
+    u64 m_iterations;
+    u64 m_remaining;
+    bool m_started = false;
+    clock::time_point m_start;
+    std::chrono::duration<f64> m_elapsed = std::chrono::duration<f64>(0);
+public:
+    BenchmarkState(u64 iterations) : m_iterations(iterations), m_remaining(iterations) {}
+
+    inline bool KeepRunning() {
+        if(!m_started) {
+            m_started = true;
+            m_start = clock::now();
+        }
+        if(m_remaining == 0) {
+            m_elapsed += clock::now() - m_start;
+            return false;
+        }
+        --m_remaining;
+        return true;
+    }
+    // excludes per iteration setup from the measured time
+    inline void PauseTiming() { m_elapsed += clock::now() - m_start; }
+    inline void ResumeTiming() { m_start = clock::now(); }
+
+    inline u64 GetIterations() const { return m_iterations; }
+    inline f64 GetElapsedSeconds() const { return m_elapsed.count(); }
+};
+
+// keeps the compiler from removing computations whose result is not used
+template<typename T>
+inline void DoNotOptimize(const T& value) {
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "r,m"(value) : "memory");
+#else
+    static volatile const void* s_sink;
+    s_sink = &value;
+#endif
+}
+
+using BenchmarkFunc = void (*)(BenchmarkState& state);
+
+struct BenchmarkConfig
+{
+    u32 warmup = 3;
+    u32 repetitions = 20;
+    // iterations per repetition are increased until one repetition takes at least this long
+    f64 minRepetitionSeconds = 0.01;
+    string filter;
+};
+
+// times are in nanoseconds per iteration
+struct BenchmarkResult
+{
+    string name;
+    u64 iterations;
+    u32 repetitions;
+    f64 median;
+    f64 p95;
+    f64 min;
+    f64 mean;
+};
+
+class Benchmarks
+{
+private:
+    static vector<pair<string, BenchmarkFunc>>& Registered();
+public:
+    static bool Register(const string& name, BenchmarkFunc func);
+
+    static vector<BenchmarkResult> RunAll(const BenchmarkConfig& config);
+    static BenchmarkResult Run(const string& name, BenchmarkFunc func, const BenchmarkConfig& config);
+
+    static string ToJson(const vector<BenchmarkResult>& results);
+    // compares the medians with a file produced by ToJson and read with the "median" key, prints the comparison,
+    // returns false when some benchmark is slower than its baseline allows or a benchmark of the baseline matching
+    // the filter did not run
+    static bool Compare(const vector<BenchmarkResult>& results, const BenchmarkBaseline& baseline, const string& filter);
+};
+
+}
+
+#define MORPH_BENCHMARK(suite, name) \
+    static void suite##_##name##_Benchmark(::Morph::BenchmarkState& state); \
+    static const bool suite##_##name##_Registered = ::Morph::Benchmarks::Register(#suite "." #name, suite##_##name##_Benchmark); \
+    static void suite##_##name##_Benchmark(::Morph::BenchmarkState& state)
+
+#endif // MORPH_BENCHMARK_HPP
\ No newline at end of file
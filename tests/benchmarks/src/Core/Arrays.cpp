@@ -0,0 +1,29 @@
+#include <Benchmark.hpp>
+
+#include <Core/Arrays.hpp>
+
+using namespace Morph;
+
+// same width only resizes the underlying vector
+MORPH_BENCHMARK(CoreArrays, vector2d_resize_rows) {
+    vector2d<vec3> data;
+    while(state.KeepRunning()) {
+        state.PauseTiming();
+        data.assign(uvec2(512, 512), vec3(1));
+        state.ResumeTiming();
+        data.resize(uvec2(512, 600));
+    }
+    DoNotOptimize(data);
+}
+
+// different width moves every element to a new buffer
+MORPH_BENCHMARK(CoreArrays, vector2d_resize_columns) {
+    vector2d<vec3> data;
+    while(state.KeepRunning()) {
+        state.PauseTiming();
+        data.assign(uvec2(512, 512), vec3(1));
+        state.ResumeTiming();
+        data.resize(uvec2(600, 512));
+    }
+    DoNotOptimize(data);
+}
@@ -0,0 +1,66 @@
+#include <Benchmark.hpp>
+
+#include <Core/EventSystem.hpp>
+
+using namespace Morph;
+
+namespace {
+
+struct BenchEvent
+{
+    int value;
+};
+
+class BenchEventSystem : public IEventSystem<BenchEvent>
+{
+private:
+    EventSystem m_eventSystem;
+public:
+    void Send(int value) {
+        m_eventSystem.Execute(BenchEvent{value});
+    }
+    MORPH_EVENT_ACTIONS(BenchEvent, m_eventSystem)
+};
+
+class BenchListener
+{
+private:
+    MethodAttacher<BenchEvent, BenchListener> m_attacher;
+    int m_sum = 0;
+public:
+    BenchListener(BenchEventSystem* system) : m_attacher(system, this, &BenchListener::OnEvent) {}
+    void OnEvent(const BenchEvent& event) { m_sum += event.value; }
+    int sum() const { return m_sum; }
+};
+
+void ExecuteWithListeners(BenchmarkState& state, usize listenerCount)
+{
+    BenchEventSystem system;
+    vector<unique<BenchListener>> listeners;
+    for(usize i = 0; i < listenerCount; ++i) {
+        listeners.push_back(std::make_unique<BenchListener>(&system));
+    }
+    int value = 0;
+    while(state.KeepRunning()) {
+        system.Send(value++);
+    }
+    DoNotOptimize(listeners.front()->sum());
+}
+
+}
+
+MORPH_BENCHMARK(CoreEventSystem, execute_1_handler) {
+    ExecuteWithListeners(state, 1);
+}
+
+MORPH_BENCHMARK(CoreEventSystem, execute_16_handlers) {
+    ExecuteWithListeners(state, 16);
+}
+
+MORPH_BENCHMARK(CoreEventSystem, attach_detach) {
+    BenchEventSystem system;
+    while(state.KeepRunning()) {
+        BenchListener listener(&system);
+        DoNotOptimize(listener);
+    }
+}
@@ -0,0 +1,49 @@
+#include <Benchmark.hpp>
+
+#include <Core/Identification.hpp>
+
+using namespace Morph;
+
+MORPH_BENCHMARK(CoreIdentification, store_remove) {
+    Identificator<u64> identificator;
+    vector<ID> ids;
+    for(u64 i = 0; i < 1024; ++i) {
+        ids.push_back(identificator.Store(i));
+    }
+    usize i = 0;
+    while(state.KeepRunning()) {
+        ID& id = ids[i++ & 1023];
+        identificator.Remove(id);
+        id = identificator.Store(i);
+    }
+    DoNotOptimize(ids);
+}
+
+MORPH_BENCHMARK(CoreIdentification, find) {
+    Identificator<u64> identificator;
+    for(u64 i = 0; i < 1024; ++i) {
+        identificator.Store(i);
+    }
+    u64 sum = 0;
+    ID id = 0;
+    while(state.KeepRunning()) {
+        opt<ref<u64>> value = identificator.Find(id++ & 1023);
+        sum += value ? value->get() : 0;
+    }
+    DoNotOptimize(sum);
+}
+
+MORPH_BENCHMARK(CoreIdentification, id_gen) {
+    IdGen idGen;
+    vector<ID> ids(1024);
+    for(ID& id : ids) {
+        id = idGen.Gen();
+    }
+    usize i = 0;
+    while(state.KeepRunning()) {
+        ID& id = ids[i++ & 1023];
+        idGen.Remove(id);
+        id = idGen.Gen();
+    }
+    DoNotOptimize(ids);
+}
@@ -0,0 +1,74 @@
+#include <Benchmark.hpp>
+
+#include <Resource/GraphicsProgramPreprocessor.hpp>
+
+#include <filesystem>
+#include <sstream>
+
+using namespace Morph;
+
+namespace {
+
+// render program with two shaders, a shared include and a nested include
+string WriteTestProgram()
+{
+    std::filesystem::path dir = std::filesystem::temp_directory_path() / "morph_bench_shaders";
+    std::filesystem::create_directories(dir / "libs");
+
+    std::ostringstream common;
+    for(int i = 0; i < 100; ++i) {
+        common << "float commonFunc" << i << "(float x) { return x * " << i << ".0 + 1.0; }\n";
+    }
+    common << "#include \"libs/Math.glsl\"\n";
+    ResourceStorage::WriteToFile((dir / "libs" / "Common.glsl").string(), common.str());
+
+    std::ostringstream math;
+    for(int i = 0; i < 100; ++i) {
+        math << "vec3 mathFunc" << i << "(vec3 v) { return v * " << i << ".0; }\n";
+    }
+    ResourceStorage::WriteToFile((dir / "libs" / "Math.glsl").string(), math.str());
+
+    std::ostringstream program;
+    program << "#version 450 core\n";
+    program << "#include \"libs/Common.glsl\"\n";
+    program << "#type vertex\n";
+    program << "layout(location = 0) in vec3 inPosition;\n";
+    for(int i = 0; i < 50; ++i) {
+        program << "uniform float vertexUniform" << i << ";\n";
+    }
+    program << "void main() { gl_Position = vec4(inPosition, 1.0); }\n";
+    program << "#type fragment\n";
+    program << "#include \"libs/Math.glsl\"\n";
+    for(int i = 0; i < 50; ++i) {
+        program << "uniform float fragmentUniform" << i << ";\n";
+    }
+    program << "out vec4 outColor;\n";
+    program << "void main() { outColor = vec4(mathFunc1(vec3(1.0)), 1.0); }\n";
+    string path = (dir / "Program.glsl").string();
+    ResourceStorage::WriteToFile(path, program.str());
+    return path;
+}
+
+}
+
+MORPH_BENCHMARK(ResourceGraphicsProgramPreprocessor, render_program) {
+    string path = WriteTestProgram();
+    ResourceStorage storage;
+    GraphicsProgramPreprocessor preprocessor(storage, {
+        GraphicsProgramDefine("BENCH_DEFINE", 1)
+    });
+    // fail loudly instead of timing the error path
+    auto check = preprocessor.PreprocessRenderProgram(path);
+    if(std::holds_alternative<GraphicsProgramPreprocessorError>(check)) {
+        panic("preprocessing failed: {}", std::get<GraphicsProgramPreprocessorError>(check).message());
+    }
+    usize size = 0;
+    while(state.KeepRunning()) {
+        auto result = preprocessor.PreprocessRenderProgram(path);
+        if(auto* sources = std::get_if<0>(&result)) {
+            size += (*sources)[0].size();
+        }
+    }
+    DoNotOptimize(size);
+    std::filesystem::remove_all(std::filesystem::path(path).parent_path());
+}
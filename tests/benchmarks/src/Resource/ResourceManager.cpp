@@ -0,0 +1,90 @@
+#include <Benchmark.hpp>
+
+#include <Resource/Storage.hpp>
+#include <Resource/ResourceManager.hpp>
+
+#include <filesystem>
+#include <sstream>
+
+using namespace Morph;
+
+namespace {
+
+// grid of quads with positions, uvs and normals
+string WriteGridObj(const string& name, u32 size)
+{
+    std::ostringstream obj;
+    for(u32 y = 0; y <= size; ++y) {
+        for(u32 x = 0; x <= size; ++x) {
+            obj << "v " << x << " 0 " << y << "\n";
+            obj << "vt " << (f64)x / size << " " << (f64)y / size << "\n";
+        }
+    }
+    obj << "vn 0 1 0\n";
+    for(u32 y = 0; y < size; ++y) {
+        for(u32 x = 0; x < size; ++x) {
+            u32 i0 = y * (size + 1) + x + 1;
+            u32 i1 = i0 + 1;
+            u32 i2 = i0 + size + 2;
+            u32 i3 = i0 + size + 1;
+            obj << "f " << i0 << "/" << i0 << "/1 " << i1 << "/" << i1 << "/1 "
+                << i2 << "/" << i2 << "/1 " << i3 << "/" << i3 << "/1\n";
+        }
+    }
+    string path = (std::filesystem::temp_directory_path() / name).string();
+    ResourceStorage::WriteToFile(path, obj.str());
+    return path;
+}
+
+// smooth gradient with run length encoded scanlines, the left half of every scanline is one run per component
+string WriteGradientHdr(const string& name, u32 width, u32 height)
+{
+    string contents = "#?RADIANCE\nFORMAT=32-bit_rle_rgbe\n\n-Y " + std::to_string(height) + " +X " + std::to_string(width) + "\n";
+    for(u32 y = 0; y < height; ++y) {
+        contents += {2, 2, (char)(width >> 8), (char)(width & 0xff)};
+        for(u32 c = 0; c < 4; ++c) {
+            u32 x = 0;
+            while(x < width / 2) {
+                u32 run = std::min(width / 2 - x, 127u);
+                contents += (char)(128 + run);
+                contents += (char)(c == 3 ? 128 : 64);
+                x += run;
+            }
+            while(x < width) {
+                u32 count = std::min(width - x, 128u);
+                contents += (char)count;
+                for(u32 i = 0; i < count; ++i) {
+                    contents += (char)(c == 3 ? 128 + y % 4 : (x + i + y * c) & 0xff);
+                }
+                x += count;
+            }
+        }
+    }
+    string path = (std::filesystem::temp_directory_path() / name).string();
+    ResourceStorage::WriteToFile(path, contents);
+    return path;
+}
+
+}
+
+MORPH_BENCHMARK(ResourceManager, load_mesh_obj_64x64) {
+    string path = WriteGridObj("morph_bench_grid_64.obj", 64);
+    usize indices = 0;
+    while(state.KeepRunning()) {
+        opt<IndexedVerticesMesh3D<u32>> mesh = ResourceManager::LoadMesh3D_OBJ(path);
+        indices += mesh ? mesh->indices.size() : 0;
+    }
+    DoNotOptimize(indices);
+    std::filesystem::remove(path);
+}
+
+MORPH_BENCHMARK(ResourceManager, load_image_hdr_1024x512) {
+    string path = WriteGradientHdr("morph_bench_gradient.hdr", 1024, 512);
+    usize bytes = 0;
+    while(state.KeepRunning()) {
+        opt<Image2D> image = ResourceManager::LoadImage2D_HDR(path);
+        bytes += image ? image->data.size() : 0;
+    }
+    DoNotOptimize(bytes);
+    std::filesystem::remove(path);
+}
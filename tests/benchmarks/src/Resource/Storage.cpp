@@ -0,0 +1,46 @@
+#include <Benchmark.hpp>
+
+#include <Resource/Storage.hpp>
+
+#include <filesystem>
+
+using namespace Morph;
+
+namespace {
+
+string WriteTestFile(const string& name, usize size)
+{
+    string path = (std::filesystem::temp_directory_path() / name).string();
+    string contents(size, '\0');
+    for(usize i = 0; i < size; ++i) {
+        contents[i] = (char)(i * 31 + i / 4096);
+    }
+    ResourceStorage::WriteToFile(path, contents);
+    return path;
+}
+
+void ReadFile(BenchmarkState& state, usize size)
+{
+    string path = WriteTestFile("morph_bench_read_" + std::to_string(size) + ".bin", size);
+    usize total = 0;
+    while(state.KeepRunning()) {
+        opt<string> contents = ResourceStorage::ReadFile(path);
+        total += contents ? contents->size() : 0;
+    }
+    DoNotOptimize(total);
+    std::filesystem::remove(path);
+}
+
+}
+
+MORPH_BENCHMARK(ResourceStorage, read_file_4kb) {
+    ReadFile(state, 4 << 10);
+}
+
+MORPH_BENCHMARK(ResourceStorage, read_file_1mb) {
+    ReadFile(state, 1 << 20);
+}
+
+MORPH_BENCHMARK(ResourceStorage, read_file_16mb) {
+    ReadFile(state, 16 << 20);
+}
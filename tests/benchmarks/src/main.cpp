@@ -0,0 +1,72 @@
+#include "Benchmark.hpp"
+
+#include <Resource/Storage.hpp>
+
+#include <cstring>
+
+using namespace Morph;
+
+static void PrintUsage()
+{
+    spdlog::info("usage: morph_benchmarks [--filter text] [--out results.json] [--compare baseline.json]");
+    spdlog::info("                        [--tolerance 0.5] [--repetitions 20] [--warmup 3] [--min-time 0.01]");
+}
+
+int main(int argc, char** argv) {
+    BenchmarkConfig config;
+    opt<string> outPath;
+    opt<string> baselinePath;
+    // overrides the tolerances of the baseline file when given
+    opt<f64> tolerance;
+    for(int i = 1; i < argc; ++i) {
+        auto nextArg = [&]() -> const char* {
+            if(i + 1 >= argc) {
+                PrintUsage();
+                std::exit(2);
+            }
+            return argv[++i];
+        };
+        if(std::strcmp(argv[i], "--filter") == 0) {
+            config.filter = nextArg();
+        } else if(std::strcmp(argv[i], "--out") == 0) {
+            outPath = nextArg();
+        } else if(std::strcmp(argv[i], "--compare") == 0) {
+            baselinePath = nextArg();
+        } else if(std::strcmp(argv[i], "--tolerance") == 0) {
+            tolerance = std::atof(nextArg());
+        } else if(std::strcmp(argv[i], "--repetitions") == 0) {
+            config.repetitions = (u32)std::atoi(nextArg());
+        } else if(std::strcmp(argv[i], "--warmup") == 0) {
+            config.warmup = (u32)std::atoi(nextArg());
+        } else if(std::strcmp(argv[i], "--min-time") == 0) {
+            config.minRepetitionSeconds = std::atof(nextArg());
+        } else {
+            PrintUsage();
+            return 2;
+        }
+    }
+
+    vector<BenchmarkResult> results = Benchmarks::RunAll(config);
+
+    string json = Benchmarks::ToJson(results);
+    if(outPath) {
+        if(!ResourceStorage::WriteToFile(outPath.value(), json)) {
+            spdlog::error("failed to write {}", outPath.value());
+            return 1;
+        }
+    } else if(!baselinePath) {
+        fmt::print("{}", json);
+    }
+
+    if(baselinePath) {
+        opt<BenchmarkBaseline> baseline = BenchmarkBaseline::Read(baselinePath.value(), "median", tolerance);
+        if(!baseline) {
+            spdlog::error("failed to read baseline {}", baselinePath.value());
+            return 1;
+        }
+        if(!Benchmarks::Compare(results, baseline.value(), config.filter)) {
+            return 1;
+        }
+    }
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,44 @@
+#include <gtest/gtest.h>
+
+#include <Core/JobManager.hpp>
+
+#include <atomic>
+
+using namespace Morph;
+
+namespace {
+
+class CountingJob : public Job
+{
+public:
+    CountingJob(std::atomic<int>* counter) : m_counter(counter) {}
+    void Run() override { ++*m_counter; }
+private:
+    std::atomic<int>* m_counter;
+};
+
+}
+
+TEST(CoreJobManager, default_workers) {
+    JobManager jobManager;
+    ASSERT_GE(jobManager.GetMaxNumberOfWorkers(), 1);
+}
+
+TEST(CoreJobManager, given_workers) {
+    JobManager jobManager(3);
+    ASSERT_EQ(jobManager.GetMaxNumberOfWorkers(), 3);
+}
+
+TEST(CoreJobManager, runs_all_jobs) {
+    std::atomic<int> counter(0);
+    JobManager jobManager(2);
+    std::vector<CountingJob> jobs(100, CountingJob(&counter));
+    for(CountingJob& job : jobs) {
+        jobManager.SubmitJob(&job);
+    }
+    jobManager.WaitForJobsToFinish();
+    ASSERT_EQ(counter.load(), 100);
+    for(const CountingJob& job : jobs) {
+        ASSERT_TRUE(job.IsFinished());
+    }
+}
@@ -0,0 +1,95 @@
+#include <gtest/gtest.h>
+
+#include <Core/RingBuffer.hpp>
+#include <Core/Log.hpp>
+
+#include <spdlog/sinks/ostream_sink.h>
+
+#include <thread>
+#include <sstream>
+
+using namespace Morph;
+
+
+TEST(CoreRingBuffer, push_pop_order) {
+    RingBuffer<int> buffer(3);
+    ASSERT_EQ(buffer.capacity(), 4);
+    for(int i = 0; i < 4; ++i) {
+        ASSERT_TRUE(buffer.TryPush([&](int& value) { value = i; }));
+    }
+    ASSERT_FALSE(buffer.TryPush([](int& value) { value = 100; }));
+    for(int i = 0; i < 4; ++i) {
+        int popped = -1;
+        ASSERT_TRUE(buffer.TryPop([&](int& value) { popped = value; }));
+        ASSERT_EQ(popped, i);
+    }
+    ASSERT_FALSE(buffer.TryPop([](int&) {}));
+}
+
+TEST(CoreRingBuffer, multiple_producers) {
+    RingBuffer<usize> buffer(64);
+    const usize producerCount = 4;
+    const usize perProducer = 5000;
+    vector<std::thread> producers;
+    for(usize p = 0; p < producerCount; ++p) {
+        producers.emplace_back([&buffer, p, perProducer]() {
+            for(usize i = 0; i < perProducer; ++i) {
+                while(!buffer.TryPush([&](usize& value) { value = p * perProducer + i; })) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    usize sum = 0;
+    usize count = 0;
+    while(count < producerCount * perProducer) {
+        if(buffer.TryPop([&](usize& value) { sum += value; })) {
+            ++count;
+        }
+    }
+    for(auto& producer : producers) {
+        producer.join();
+    }
+    usize total = producerCount * perProducer;
+    ASSERT_EQ(sum, total * (total - 1) / 2);
+}
+
+TEST(CoreLog, async_write) {
+    std::ostringstream stream;
+    auto sink = std::make_shared<spdlog::sinks::ostream_sink_mt>(stream);
+    sink->set_pattern("%v");
+    spdlog::logger logger("test_async", sink);
+    logger.set_level(spdlog::level::info);
+
+    Log::Init(LogMode::ASYNC);
+    ASSERT_TRUE(Log::IsAsync());
+    string temporary = "text";
+    Log::Write(&logger, spdlog::level::info, "{} {} {}", 1, temporary, 2.5);
+    temporary = "changed";
+    Log::Write(&logger, spdlog::level::debug, "filtered {}", 3);
+    Log::Write(&logger, spdlog::level::warn, "{}", "literal");
+    Log::Flush();
+    ASSERT_EQ(stream.str(), "1 text 2.5\nliteral\n");
+
+    Log::Shutdown();
+    ASSERT_FALSE(Log::IsAsync());
+    Log::Write(&logger, spdlog::level::info, "sync {}", 4);
+    ASSERT_EQ(stream.str(), "1 text 2.5\nliteral\nsync 4\n");
+}
+
+TEST(CoreLog, init_inherits_default_level) {
+    spdlog::level::level_enum level = spdlog::get_level();
+    // the loggers of an earlier Init are still registered
+    spdlog::drop("ENGINE");
+    spdlog::drop("APP");
+    spdlog::set_level(spdlog::level::warn);
+    Log::Init();
+    ASSERT_EQ(Log::client()->level(), spdlog::level::warn);
+    ASSERT_EQ(Log::engine()->level(), spdlog::level::warn);
+    ASSERT_EQ(Log::client()->sinks().size(), 1);
+    spdlog::set_level(spdlog::level::trace);
+    ASSERT_EQ(Log::client()->level(), spdlog::level::trace);
+    spdlog::drop("ENGINE");
+    spdlog::drop("APP");
+    spdlog::set_level(level);
+}
\ No newline at end of file
@@ -0,0 +1,62 @@
+#include <gtest/gtest.h>
+
+#include <Core/TripleBuffer.hpp>
+
+#include <atomic>
+#include <thread>
+
+using namespace Morph;
+
+TEST(CoreTripleBuffer, newest_value) {
+    TripleBuffer<int> buffer(-1);
+    ASSERT_FALSE(buffer.Update());
+    ASSERT_EQ(buffer.ReadBuffer(), -1);
+    for(int i = 0; i < 3; ++i) {
+        buffer.WriteBuffer() = i;
+        buffer.Publish();
+    }
+    ASSERT_TRUE(buffer.Update());
+    ASSERT_EQ(buffer.ReadBuffer(), 2);
+    ASSERT_FALSE(buffer.Update());
+    ASSERT_EQ(buffer.ReadBuffer(), 2);
+    buffer.WriteBuffer() = 3;
+    buffer.Publish();
+    ASSERT_TRUE(buffer.Update());
+    ASSERT_EQ(buffer.ReadBuffer(), 3);
+}
+
+TEST(CoreTripleBuffer, concurrent_handoff) {
+    struct Frame {
+        int values[64];
+    };
+    TripleBuffer<Frame> buffer(Frame{});
+    const int frameCount = 20000;
+    std::atomic<bool> done(false);
+    std::thread producer([&]() {
+        for(int i = 1; i <= frameCount; ++i) {
+            for(int& value : buffer.WriteBuffer().values) {
+                value = i;
+            }
+            buffer.Publish();
+        }
+        done = true;
+    });
+    // every taken frame is complete and newer than the one before
+    int last = 0;
+    bool finished = false;
+    while(!finished) {
+        finished = done.load();
+        if(!buffer.Update()) {
+            continue;
+        }
+        const Frame& frame = buffer.ReadBuffer();
+        for(int value : frame.values) {
+            ASSERT_EQ(value, frame.values[0]);
+        }
+        ASSERT_GT(frame.values[0], last);
+        last = frame.values[0];
+    }
+    producer.join();
+    buffer.Update();
+    ASSERT_EQ(buffer.ReadBuffer().values[0], frameCount);
+}
\ No newline at end of file
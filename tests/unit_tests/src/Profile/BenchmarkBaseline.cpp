@@ -0,0 +1,78 @@
+#include <gtest/gtest.h>
+
+#include <Profile/BenchmarkBaseline.hpp>
+
+using namespace Morph;
+
+namespace {
+
+const char* s_baselineJson = R"({
+    "unit": "samples/s",
+    "tolerance": 1.0,
+    "spp": 16,
+    "benchmarks": [
+        { "name": "a", "rate": 100.0, "time": 10.0 },
+        { "name": "b", "rate": 200.0, "time": 20.0, "tolerance": 0.1 }
+    ]
+})";
+
+}
+
+TEST(ProfileBenchmarkBaseline, parse) {
+    opt<BenchmarkBaseline> baseline = BenchmarkBaseline::Parse(s_baselineJson, "rate");
+    ASSERT_TRUE(baseline.has_value());
+    ASSERT_EQ(baseline->GetSetting("spp"), 16.0);
+    ASSERT_FALSE(baseline->GetSetting("threads").has_value());
+    const vector<BenchmarkBaselineEntry>& entries = baseline->GetEntries();
+    ASSERT_EQ(entries.size(), 2);
+    ASSERT_EQ(entries[0].name, "a");
+    ASSERT_EQ(entries[0].value, 100.0);
+    ASSERT_EQ(entries[0].tolerance, 1.0);
+    ASSERT_EQ(entries[1].value, 200.0);
+    ASSERT_EQ(entries[1].tolerance, 0.1);
+
+    // the given tolerance wins over the file wide and the per benchmark one
+    baseline = BenchmarkBaseline::Parse(s_baselineJson, "time", 0.25);
+    ASSERT_TRUE(baseline.has_value());
+    ASSERT_EQ(baseline->GetEntries()[0].value, 10.0);
+    ASSERT_EQ(baseline->GetEntries()[0].tolerance, 0.25);
+    ASSERT_EQ(baseline->GetEntries()[1].tolerance, 0.25);
+
+    ASSERT_FALSE(BenchmarkBaseline::Parse("{ \"unit\": \"ns\" }", "time").has_value());
+}
+
+TEST(ProfileBenchmarkBaseline, compare) {
+    opt<BenchmarkBaseline> rates = BenchmarkBaseline::Parse(s_baselineJson, "rate");
+    ASSERT_TRUE(rates.has_value());
+    vector<BenchmarkComparison> comparisons = rates->Compare({{"a", 60.0}, {"b", 150.0}, {"c", 1.0}}, "samples/s", true);
+    ASSERT_EQ(comparisons.size(), 3);
+    ASSERT_NEAR(comparisons[0].slowdown, 100.0 / 60.0, 1e-12);
+    ASSERT_FALSE(comparisons[0].failed);
+    ASSERT_TRUE(comparisons[1].failed);
+    ASSERT_FALSE(comparisons[2].hasBaseline);
+    ASSERT_FALSE(comparisons[2].failed);
+
+    opt<BenchmarkBaseline> times = BenchmarkBaseline::Parse(s_baselineJson, "time");
+    ASSERT_TRUE(times.has_value());
+    comparisons = times->Compare({{"a", 21.0}, {"b", 21.0}}, "ns", false);
+    ASSERT_NEAR(comparisons[0].slowdown, 2.1, 1e-12);
+    ASSERT_TRUE(comparisons[0].failed);
+    ASSERT_FALSE(comparisons[1].failed);
+    ASSERT_NE(comparisons[0].message.find("allowed 2.00x"), string::npos);
+}
+
+TEST(ProfileBenchmarkBaseline, compare_not_run) {
+    opt<BenchmarkBaseline> times = BenchmarkBaseline::Parse(s_baselineJson, "time");
+    ASSERT_TRUE(times.has_value());
+    // b was renamed to c, its baseline entry must not pass silently
+    vector<BenchmarkComparison> comparisons = times->Compare({{"a", 10.0}, {"c", 20.0}}, "ns", false);
+    ASSERT_EQ(comparisons.size(), 3);
+    ASSERT_FALSE(comparisons[1].hasBaseline);
+    ASSERT_EQ(comparisons[2].name, "b");
+    ASSERT_TRUE(comparisons[2].failed);
+
+    // entries left out by the filter are not expected to run
+    comparisons = times->Compare({{"a", 10.0}}, "ns", false, "a");
+    ASSERT_EQ(comparisons.size(), 1);
+    ASSERT_FALSE(comparisons[0].failed);
+}
\ No newline at end of file
@@ -0,0 +1,43 @@
+#include <gtest/gtest.h>
+
+#include <Profile/MemoryTracker.hpp>
+
+using namespace Morph;
+
+
+TEST(ProfileMemoryTracker, register_tag) {
+    MemoryTag tag = MemoryTracker::RegisterTag("memory_tracker_test_register");
+    ASSERT_NE(tag, MemoryTracker::UNTAGGED);
+    ASSERT_EQ(MemoryTracker::RegisterTag("memory_tracker_test_register"), tag);
+    ASSERT_STREQ(MemoryTracker::GetStats(tag).name, "memory_tracker_test_register");
+}
+
+TEST(ProfileMemoryTracker, counters) {
+    MemoryTag tag = MemoryTracker::RegisterTag("memory_tracker_test_counters");
+    MemoryTracker::OnAllocate(tag, 100);
+    MemoryTracker::OnAllocate(tag, 50);
+    MemoryTracker::OnFree(tag, 100);
+    MemoryTagStats stats = MemoryTracker::GetStats(tag);
+    ASSERT_EQ(stats.liveBytes, 50);
+    ASSERT_EQ(stats.peakBytes, 150);
+    ASSERT_EQ(stats.liveCount, 1);
+    ASSERT_EQ(stats.totalCount, 2);
+    MemoryTracker::OnFree(tag, 50);
+}
+
+TEST(ProfileMemoryTracker, tag_scope) {
+    MemoryTag tag = MemoryTracker::RegisterTag("memory_tracker_test_scope");
+    MemoryTag previous = MemoryTracker::GetCurrentTag();
+    {
+        MemoryTagScope scope(tag);
+        ASSERT_EQ(MemoryTracker::GetCurrentTag(), tag);
+        if(MemoryTracker::IsEnabled()) {
+            unique<vector<u64>> data = std::make_unique<vector<u64>>(1000);
+            MemoryTagStats stats = MemoryTracker::GetStats(tag);
+            ASSERT_GE(stats.liveBytes, 1000 * sizeof(u64));
+            ASSERT_GE(stats.liveCount, 2);
+        }
+    }
+    ASSERT_EQ(MemoryTracker::GetCurrentTag(), previous);
+    ASSERT_EQ(MemoryTracker::GetStats(tag).liveBytes, 0);
+}
\ No newline at end of file
@@ -0,0 +1,67 @@
+#include <gtest/gtest.h>
+
+#include <Profile/Profiler.hpp>
+
+#include <thread>
+
+using namespace Morph;
+
+
+TEST(ProfileProfiler, scope_records_event) {
+    {
+        ProfileScope scope("profiler_test_scope");
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    string json = Profiler::ChromeTraceJson();
+    ASSERT_NE(json.find("\"name\":\"profiler_test_scope\""), string::npos);
+    ASSERT_NE(json.find("\"traceEvents\":["), string::npos);
+}
+
+TEST(ProfileProfiler, thread_names_and_frames) {
+    u64 frames = Profiler::GetFrameCount();
+    std::thread thread([]() {
+        Profiler::SetThreadName("profiler \"test\" thread");
+        Profiler::MarkFrame();
+        Profiler::Record("profiler_test_thread_event", Profiler::Now(), Profiler::Now() + 1000);
+        Profiler::MarkFrame();
+    });
+    thread.join();
+    ASSERT_EQ(Profiler::GetFrameCount(), frames + 2);
+    string json = Profiler::ChromeTraceJson();
+    ASSERT_NE(json.find("\"name\":\"profiler \\\"test\\\" thread\""), string::npos);
+    ASSERT_NE(json.find("\"name\":\"profiler_test_thread_event\""), string::npos);
+    ASSERT_NE(json.find("\"name\":\"Frame\""), string::npos);
+}
+
+TEST(ProfileProfiler, buffer_overwrites_oldest) {
+    unique<ProfileThreadBuffer> buffer = std::make_unique<ProfileThreadBuffer>(0);
+    for(u64 i = 0; i < ProfileThreadBuffer::CAPACITY + 10; ++i) {
+        buffer->Push("event", i, i + 1);
+    }
+    vector<ProfileEvent> events = buffer->Snapshot();
+    // the slot of the next event may be in the middle of a write and is left out
+    ASSERT_EQ(events.size(), ProfileThreadBuffer::CAPACITY - 1);
+    ASSERT_EQ(events.front().start, 11);
+    ASSERT_EQ(events.back().start, ProfileThreadBuffer::CAPACITY + 9);
+}
+
+TEST(ProfileProfiler, snapshot_while_writing) {
+    unique<ProfileThreadBuffer> buffer = std::make_unique<ProfileThreadBuffer>(0);
+    std::atomic<bool> done = false;
+    std::thread writer([&]() {
+        for(u64 i = 0; i < ProfileThreadBuffer::CAPACITY * 8; ++i) {
+            buffer->Push("event", i, i + 1);
+        }
+        done = true;
+    });
+    // every snapshot is a run of consecutive events without any from a later lap of the buffer
+    bool consecutive = true;
+    while(!done) {
+        vector<ProfileEvent> events = buffer->Snapshot();
+        for(usize i = 1; i < events.size(); ++i) {
+            consecutive = consecutive && events[i].start == events[0].start + i;
+        }
+    }
+    writer.join();
+    ASSERT_TRUE(consecutive);
+}
\ No newline at end of file
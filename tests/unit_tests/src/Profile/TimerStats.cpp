@@ -0,0 +1,68 @@
+#include <gtest/gtest.h>
+
+#include <Profile/TimerStats.hpp>
+
+using namespace Morph;
+
+
+TEST(ProfileTimerHistogram, bucket_bounds) {
+    for(u64 value : {0ull, 1ull, 31ull, 32ull, 33ull, 1000ull, 16666666ull, 1ull << 40}) {
+        u32 bucket = TimerHistogram::GetBucket(value);
+        ASSERT_LE(TimerHistogram::GetBucketLowerBound(bucket), value);
+        ASSERT_GE(TimerHistogram::GetBucketUpperBound(bucket), value);
+    }
+    for(u32 bucket = 1; bucket < TimerHistogram::BUCKET_COUNT; ++bucket) {
+        ASSERT_EQ(TimerHistogram::GetBucketLowerBound(bucket), TimerHistogram::GetBucketUpperBound(bucket - 1) + 1);
+    }
+    ASSERT_EQ(TimerHistogram::GetBucket(UINT64_MAX), TimerHistogram::BUCKET_COUNT - 1);
+}
+
+TEST(ProfileTimerHistogram, percentile_error) {
+    unique<TimerHistogram> histogram = std::make_unique<TimerHistogram>();
+    for(u64 i = 1; i <= 1000; ++i) {
+        histogram->Record(i * 1000);
+    }
+    ASSERT_EQ(histogram->GetCount(), 1000);
+    f64 p50 = (f64)histogram->GetPercentile(0.5);
+    f64 p99 = (f64)histogram->GetPercentile(0.99);
+    ASSERT_NEAR(p50, 500000, 500000 / 16.0);
+    ASSERT_NEAR(p99, 990000, 990000 / 16.0);
+}
+
+TEST(ProfileTimerStats, window_summary) {
+    TimerStats stats(100);
+    for(int i = 1; i <= 200; ++i) {
+        stats.Record(i * 0.001);
+    }
+    TimerStatsSummary window = stats.GetWindowSummary();
+    ASSERT_EQ(window.count, 100);
+    ASSERT_NEAR(window.min, 0.101, 1e-9);
+    ASSERT_NEAR(window.max, 0.200, 1e-9);
+    ASSERT_NEAR(window.mean, 0.1505, 1e-9);
+    ASSERT_NEAR(window.p50, 0.150, 1e-9);
+    ASSERT_NEAR(window.p95, 0.195, 1e-9);
+    ASSERT_NEAR(window.p99, 0.199, 1e-9);
+    ASSERT_EQ(stats.GetWindow().size(), 100);
+    ASSERT_NEAR(stats.GetWindow().front(), 0.101, 1e-9);
+
+    TimerStatsSummary total = stats.GetTotalSummary();
+    ASSERT_EQ(total.count, 200);
+    ASSERT_NEAR(total.min, 0.001, 1e-9);
+    ASSERT_NEAR(total.max, 0.200, 1e-9);
+    ASSERT_NEAR(total.p50, 0.100, 0.100 / 16.0);
+}
+
+TEST(ProfileTimerStats, spike_detection) {
+    TimerStats stats;
+    for(int i = 0; i < 100; ++i) {
+        ASSERT_FALSE(stats.Record(0.016));
+    }
+    ASSERT_TRUE(stats.Record(0.050));
+    ASSERT_FALSE(stats.Record(0.017));
+    ASSERT_EQ(stats.GetSpikeCount(), 1);
+    ASSERT_NEAR(stats.GetLastSpike(), 0.050, 1e-9);
+    ASSERT_NEAR(stats.GetAverage(), 0.016, 0.001);
+    stats.Reset();
+    ASSERT_EQ(stats.GetCount(), 0);
+    ASSERT_EQ(stats.GetWindowSummary().count, 0);
+}
\ No newline at end of file
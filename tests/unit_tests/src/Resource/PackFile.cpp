@@ -0,0 +1,74 @@
+#include <gtest/gtest.h>
+
+#include <Resource/PackFile.hpp>
+#include <Resource/Compression.hpp>
+#include <Resource/Storage.hpp>
+
+#include <filesystem>
+
+using namespace Morph;
+
+TEST(ResourceCompression, lz4_roundtrip) {
+    string contents;
+    for(int i = 0; i < 1000; ++i) {
+        contents += "repeated line " + std::to_string(i % 17) + "\n";
+    }
+    string compressed = LZ4Compression::Compress(contents.data(), contents.size());
+    ASSERT_LT(compressed.size(), contents.size());
+    string decompressed(contents.size(), '\0');
+    ASSERT_TRUE(LZ4Compression::Decompress(compressed.data(), compressed.size(), decompressed.data(), decompressed.size()));
+    ASSERT_EQ(contents, decompressed);
+}
+
+TEST(ResourceCompression, lz4_small_input) {
+    string contents = "abc";
+    string compressed = LZ4Compression::Compress(contents.data(), contents.size());
+    string decompressed(contents.size(), '\0');
+    ASSERT_TRUE(LZ4Compression::Decompress(compressed.data(), compressed.size(), decompressed.data(), decompressed.size()));
+    ASSERT_EQ(contents, decompressed);
+}
+
+TEST(ResourceCompression, lz4_wrong_size) {
+    string contents(100, 'x');
+    string compressed = LZ4Compression::Compress(contents.data(), contents.size());
+    string decompressed(contents.size() - 1, '\0');
+    ASSERT_FALSE(LZ4Compression::Decompress(compressed.data(), compressed.size(), decompressed.data(), decompressed.size()));
+}
+
+TEST(ResourcePackFile, write_map) {
+    string compressible(10000, 'a');
+    string small = "small file";
+    PackFileWriter writer;
+    writer.AddFile("engine", "shaders/a.glsl", compressible);
+    writer.AddFile("app", "b.txt", small);
+    writer.AddFile("app", "empty.txt", "");
+    ASSERT_TRUE(writer.Write("test.pack"));
+
+    opt<PackFile> pack = PackFile::Open("test.pack");
+    ASSERT_TRUE(pack.has_value());
+    ASSERT_EQ(pack->GetEntryCount(), 3);
+    ASSERT_EQ(pack->Map("engine/shaders/a.glsl")->str(), compressible);
+    ASSERT_EQ(pack->Map("app/b.txt")->str(), small);
+    ASSERT_TRUE(pack->Map("app/empty.txt")->empty());
+    ASSERT_FALSE(pack->Map("app/c.txt").has_value());
+}
+
+TEST(ResourcePackFile, storage_lookup) {
+    std::filesystem::create_directories("pack_test_res/dir");
+    ResourceStorage::WriteToFile("pack_test_res/dir/file.txt", "packed contents");
+    PackFileWriter writer;
+    ASSERT_TRUE(writer.AddDirectory("app", "pack_test_res/"));
+    ASSERT_TRUE(writer.Write("test_storage.pack"));
+    std::filesystem::remove_all("pack_test_res");
+
+    ResourceStorage storage(unord_map<string, string>({{"app", "pack_test_res/"}}));
+    ASSERT_TRUE(storage.MountPack("test_storage.pack"));
+    ASSERT_EQ(storage.ReadFileRes("app:dir/file.txt").value(), "packed contents");
+    ASSERT_EQ(storage.MapFileRes("app:/dir/./file.txt")->str(), "packed contents");
+    ASSERT_FALSE(storage.ReadFileRes("app:dir/missing.txt").has_value());
+}
+
+TEST(ResourcePackFile, open_invalid) {
+    ResourceStorage::WriteToFile("invalid.pack", "not a pack file, definitely not");
+    ASSERT_FALSE(PackFile::Open("invalid.pack").has_value());
+}
@@ -0,0 +1,204 @@
+#include <gtest/gtest.h>
+
+#include <Core/JobManager.hpp>
+#include <Resource/Storage.hpp>
+#include <Resource/ResourceManager.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+
+using namespace Morph;
+
+namespace {
+
+// pixel with a distinct value for every position, stays within the mantissa range
+array<u8, 4> TestPixel(uint x, uint y)
+{
+    return {(u8)(x * 7 + y), (u8)(x / 3 + 100), (u8)(y * 5 + 1), (u8)(120 + (x + y) % 16)};
+}
+
+string HDRHeader(uint width, uint height, const string& ySign = "-")
+{
+    return "#?RADIANCE\n# written by the test\nGAMMA=1\nFORMAT=32-bit_rle_rgbe\nEXPOSURE=1.0\n\n"
+        + ySign + "Y " + std::to_string(height) + " +X " + std::to_string(width) + "\n";
+}
+
+string FlatHDR(uint width, uint height)
+{
+    string contents = HDRHeader(width, height);
+    for(uint y = 0; y < height; ++y) {
+        for(uint x = 0; x < width; ++x) {
+            array<u8, 4> p = TestPixel(x, y);
+            contents.append((const char*)p.data(), 4);
+        }
+    }
+    return contents;
+}
+
+// new style run length encoding, runs where the bytes repeat and literal spans elsewhere
+string RunLengthHDR(uint width, uint height)
+{
+    string contents = HDRHeader(width, height);
+    for(uint y = 0; y < height; ++y) {
+        contents += {2, 2, (char)(width >> 8), (char)(width & 0xff)};
+        for(uint c = 0; c < 4; ++c) {
+            vector<u8> bytes(width);
+            for(uint x = 0; x < width; ++x) {
+                // half of the scanline is flat so it turns into runs
+                bytes[x] = TestPixel(x < width / 2 ? 0 : x, y)[c];
+            }
+            uint x = 0;
+            while(x < width) {
+                uint run = 1;
+                while(x + run < width && run < 127 && bytes[x + run] == bytes[x]) {
+                    run++;
+                }
+                if(run > 2) {
+                    contents += (char)(128 + run);
+                    contents += (char)bytes[x];
+                    x += run;
+                } else {
+                    uint count = std::min(width - x, 128u);
+                    contents += (char)count;
+                    contents.append((const char*)&bytes[x], count);
+                    x += count;
+                }
+            }
+        }
+    }
+    return contents;
+}
+
+float ExpectedValue(u8 mantissa, u8 exponent)
+{
+    return exponent == 0 ? 0.0f : std::ldexp((float)mantissa, exponent - 136);
+}
+
+// scanline y of the file is row height - 1 - y of the image
+void ExpectPixels(const Image2D& image, uint width, uint height, bool halfFlat)
+{
+    ASSERT_EQ(image.dim, uvec2(width, height));
+    ASSERT_EQ(image.format, TextureSizedFormat::RGB32F);
+    ASSERT_EQ(image.data.size(), width * height * 3 * sizeof(f32));
+    const f32* rgb = (const f32*)image.data.data();
+    for(uint y = 0; y < height; ++y) {
+        for(uint x = 0; x < width; ++x) {
+            array<u8, 4> p = TestPixel(halfFlat && x < width / 2 ? 0 : x, y);
+            const f32* pixel = rgb + ((height - 1 - y) * width + x) * 3;
+            for(uint c = 0; c < 3; ++c) {
+                ASSERT_EQ(pixel[c], ExpectedValue(p[c], p[3])) << x << " " << y << " " << c;
+            }
+        }
+    }
+}
+
+}
+
+TEST(ResourceManager, load_hdr_flat) {
+    string filename = "test_flat.hdr";
+    ResourceStorage::WriteToFile(filename, FlatHDR(13, 5));
+    opt<Image2D> image = ResourceManager::LoadImage2D_HDR(filename);
+    ASSERT_TRUE(image.has_value());
+    ExpectPixels(image.value(), 13, 5, false);
+    std::filesystem::remove(filename);
+}
+
+TEST(ResourceManager, load_hdr_run_length_encoded) {
+    string filename = "test_rle.hdr";
+    ResourceStorage::WriteToFile(filename, RunLengthHDR(301, 17));
+    opt<Image2D> image = ResourceManager::LoadImage2D_HDR(filename);
+    ASSERT_TRUE(image.has_value());
+    ExpectPixels(image.value(), 301, 17, true);
+    std::filesystem::remove(filename);
+}
+
+TEST(ResourceManager, load_hdr_jobs) {
+    string filename = "test_rle_jobs.hdr";
+    ResourceStorage::WriteToFile(filename, RunLengthHDR(256, 67));
+    JobManager jobManager;
+    opt<Image2D> image = ResourceManager::LoadImage2D_HDR(filename, &jobManager);
+    ASSERT_TRUE(image.has_value());
+    ExpectPixels(image.value(), 256, 67, true);
+    std::filesystem::remove(filename);
+}
+
+TEST(ResourceManager, load_hdr_old_style_runs) {
+    string filename = "test_old_runs.hdr";
+    // the second pixel is repeated 2 + (1 << 8) times
+    string contents = HDRHeader(261, 1);
+    contents += {10, 20, 30, (char)130, 40, 50, 60, (char)129, 1, 1, 1, 2, 1, 1, 1, 1, 70, 80, 90, (char)128};
+    ResourceStorage::WriteToFile(filename, contents);
+    opt<Image2D> image = ResourceManager::LoadImage2D_HDR(filename);
+    ASSERT_TRUE(image.has_value());
+    const f32* rgb = (const f32*)image->data.data();
+    ASSERT_EQ(rgb[0], ExpectedValue(10, 130));
+    ASSERT_EQ(rgb[258 * 3 + 1], ExpectedValue(50, 129));
+    ASSERT_EQ(rgb[260 * 3 + 2], ExpectedValue(90, 128));
+    std::filesystem::remove(filename);
+}
+
+TEST(ResourceManager, load_hdr_old_style_runs_overflow) {
+    string filename = "test_old_runs_overflow.hdr";
+    // four empty runs shift the count of the fifth by 32 bits
+    string contents = HDRHeader(2, 1);
+    contents += {10, 20, 30, (char)130};
+    for(uint i = 0; i < 4; ++i) {
+        contents += {1, 1, 1, 0};
+    }
+    contents += {1, 1, 1, 1};
+    ResourceStorage::WriteToFile(filename, contents);
+    ASSERT_FALSE(ResourceManager::LoadImage2D_HDR(filename).has_value());
+    std::filesystem::remove(filename);
+}
+
+TEST(ResourceManager, load_hdr_rgbe) {
+    string filename = "test_rgbe.hdr";
+    ResourceStorage::WriteToFile(filename, RunLengthHDR(301, 17));
+    JobManager jobManager;
+    opt<Image2D> image = ResourceManager::LoadImage2D_HDR_RGBE(filename, &jobManager);
+    ASSERT_TRUE(image.has_value());
+    ASSERT_EQ(image->dim, uvec2(301, 17));
+    ASSERT_EQ(image->format, TextureSizedFormat::RGBA8);
+    ASSERT_EQ(image->data.size(), 301 * 17 * 4);
+    const array<f32, 256>& scales = ResourceManager::RGBEScales();
+    for(uint y = 0; y < 17; ++y) {
+        for(uint x = 0; x < 301; ++x) {
+            array<u8, 4> p = TestPixel(x < 301 / 2 ? 0 : x, y);
+            const u8* pixel = image->data.data() + ((16 - y) * 301 + x) * 4;
+            ASSERT_TRUE(std::equal(p.begin(), p.end(), pixel)) << x << " " << y;
+            ASSERT_EQ(pixel[0] * scales[pixel[3]], ExpectedValue(p[0], p[3]));
+        }
+    }
+    std::filesystem::remove(filename);
+}
+
+TEST(ResourceManager, load_hdr_bottom_up) {
+    string filename = "test_bottom_up.hdr";
+    string contents = HDRHeader(1, 2, "+");
+    contents += {1, 2, 3, (char)136, 4, 5, 6, (char)136};
+    ResourceStorage::WriteToFile(filename, contents);
+    opt<Image2D> image = ResourceManager::LoadImage2D_HDR(filename);
+    ASSERT_TRUE(image.has_value());
+    const f32* rgb = (const f32*)image->data.data();
+    ASSERT_EQ(rgb[0], 1.0f);
+    ASSERT_EQ(rgb[3], 4.0f);
+    std::filesystem::remove(filename);
+}
+
+TEST(ResourceManager, load_hdr_broken) {
+    string filename = "test_broken.hdr";
+    string truncated = RunLengthHDR(64, 4);
+    truncated.resize(truncated.size() - 10);
+    ResourceStorage::WriteToFile(filename, truncated);
+    ASSERT_FALSE(ResourceManager::LoadImage2D_HDR(filename).has_value());
+
+    ResourceStorage::WriteToFile(filename, "#?RADIANCE\nFORMAT=32-bit_rle_xyze\n\n-Y 1 +X 1\n\1\1\1\1");
+    ASSERT_FALSE(ResourceManager::LoadImage2D_HDR(filename).has_value());
+
+    ResourceStorage::WriteToFile(filename, "P6\n1 1\n255\n");
+    ASSERT_FALSE(ResourceManager::LoadImage2D_HDR(filename).has_value());
+
+    ASSERT_FALSE(ResourceManager::LoadImage2D_HDR("this_file_does_not_exist.hdr").has_value());
+    std::filesystem::remove(filename);
+}
\ No newline at end of file
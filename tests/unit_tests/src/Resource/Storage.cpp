@@ -12,4 +12,41 @@ TEST(ResourceStorage, write_read) {
     opt<string> contentsAfterRead = ResourceStorage::ReadFile(filename);
     ASSERT_TRUE(contentsAfterRead.has_value());
     ASSERT_EQ(contents, contentsAfterRead.value());
-}
\ No newline at end of file
+}
+TEST(ResourceStorage, write_map) {
+    string filename = "test_map.txt";
+    string contents = "some testing \n words, { some more \n words, [bla, bla] }";
+
+    ResourceStorage::WriteToFile(filename, contents);
+    opt<MappedFile> mappedFile = ResourceStorage::MapFile(filename);
+    ASSERT_TRUE(mappedFile.has_value());
+    ASSERT_EQ(contents, mappedFile->view());
+}
+
+TEST(ResourceStorage, map_copy_keeps_mapping) {
+    string filename = "test_map_copy.txt";
+    string contents = "mapped contents";
+
+    ResourceStorage::WriteToFile(filename, contents);
+    MappedFile copy;
+    {
+        opt<MappedFile> mappedFile = ResourceStorage::MapFile(filename);
+        ASSERT_TRUE(mappedFile.has_value());
+        copy = mappedFile.value();
+    }
+    ASSERT_EQ(contents, copy.str());
+}
+
+TEST(ResourceStorage, map_empty) {
+    string filename = "test_map_empty.txt";
+
+    ResourceStorage::WriteToFile(filename, "");
+    opt<MappedFile> mappedFile = ResourceStorage::MapFile(filename);
+    ASSERT_TRUE(mappedFile.has_value());
+    ASSERT_TRUE(mappedFile->empty());
+}
+
+TEST(ResourceStorage, map_missing) {
+    opt<MappedFile> mappedFile = ResourceStorage::MapFile("this_file_does_not_exist.txt");
+    ASSERT_FALSE(mappedFile.has_value());
+}
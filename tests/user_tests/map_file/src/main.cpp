@@ -0,0 +1,92 @@
+#include <iostream>
+
+#include <spdlog/spdlog.h>
+
+#include <Morph.hpp>
+#include <Resource/Storage.hpp>
+#include <Profile/Timer.hpp>
+
+#include <filesystem>
+#include <fstream>
+
+namespace Morph {
+
+// compares ResourceStorage::ReadFile and ResourceStorage::MapFile, both read every byte of the file
+class Benchmark
+{
+private:
+    static constexpr int s_repetitions = 3;
+public:
+    void Run(const vector<usize>& fileSizes) {
+        for(usize fileSize : fileSizes) {
+            string filename = "map_file_bench_" + std::to_string(fileSize) + ".bin";
+            if(!WriteTestFile(filename, fileSize)) {
+                spdlog::error("failed to create file {}", filename);
+                continue;
+            }
+            f64 readTime = 0;
+            f64 mapTime = 0;
+            u64 readSum = 0;
+            u64 mapSum = 0;
+            for(int r = 0; r < s_repetitions; ++r) {
+                TimerResult readResult;
+                {
+                    Timer timer(readResult);
+                    opt<string> contents = ResourceStorage::ReadFile(filename);
+                    readSum = contents ? Checksum(contents->data(), contents->size()) : 0;
+                }
+                TimerResult mapResult;
+                {
+                    Timer timer(mapResult);
+                    opt<MappedFile> contents = ResourceStorage::MapFile(filename);
+                    mapSum = contents ? Checksum(contents->data(), contents->size()) : 0;
+                }
+                readTime += readResult.GetMiliSeconds();
+                mapTime += mapResult.GetMiliSeconds();
+            }
+            readTime /= s_repetitions;
+            mapTime /= s_repetitions;
+            spdlog::info("{:>10} B: ReadFile {:10.3f} ms, MapFile {:10.3f} ms, speedup {:6.2f}x{}",
+                fileSize, readTime, mapTime, readTime / mapTime, readSum == mapSum ? "" : " (checksum mismatch)");
+            std::filesystem::remove(filename);
+        }
+    }
+private:
+    bool WriteTestFile(const string& filename, usize fileSize) {
+        std::ofstream file(filename, std::ios::binary);
+        if(!file) {
+            return false;
+        }
+        vector<char> block(1 << 20);
+        for(usize i = 0; i < block.size(); ++i) {
+            block[i] = (char)(i * 31 + 7);
+        }
+        for(usize written = 0; written < fileSize; written += block.size()) {
+            file.write(block.data(), std::min(block.size(), fileSize - written));
+        }
+        return (bool)file;
+    }
+    u64 Checksum(const char* data, usize size) {
+        u64 sum = 0;
+        for(usize i = 0; i < size; ++i) {
+            sum += (u8)data[i];
+        }
+        return sum;
+    }
+};
+
+}
+
+int main(int argc, char** argv) {
+    using namespace Morph;
+    // sizes in MB can be passed as arguments, defaults to 1 MB, 100 MB and 1 GB
+    vector<usize> fileSizes;
+    for(int i = 1; i < argc; ++i) {
+        fileSizes.push_back((usize)std::stoull(argv[i]) << 20);
+    }
+    if(fileSizes.empty()) {
+        fileSizes = {usize(1) << 20, usize(100) << 20, usize(1) << 30};
+    }
+    Benchmark benchmark;
+    benchmark.Run(fileSizes);
+}
@@ -0,0 +1,43 @@
+#include <iostream>
+
+#include <spdlog/spdlog.h>
+
+#include <Morph.hpp>
+#include <Resource/PackFile.hpp>
+
+// Packs resource folders into a single archive read by ResourceStorage::MountPack.
+// usage: morph_pack <output.pack> [--no-compress] <resFolder>=<directory>...
+int main(int argc, char** argv) {
+    using namespace Morph;
+    if(argc < 3) {
+        spdlog::error("usage: morph_pack <output.pack> [--no-compress] <resFolder>=<directory>...");
+        return EXIT_FAILURE;
+    }
+    string outputPath = argv[1];
+    bool compress = true;
+    PackFileWriter writer;
+    for(int i = 2; i < argc; ++i) {
+        string arg = argv[i];
+        if(arg == "--no-compress") {
+            compress = false;
+            continue;
+        }
+        string::size_type eqPos = arg.find('=');
+        if(eqPos == string::npos) {
+            spdlog::error("invalid argument: {}", arg);
+            return EXIT_FAILURE;
+        }
+        string resFolder = arg.substr(0, eqPos);
+        string dirPath = arg.substr(eqPos + 1);
+        if(!writer.AddDirectory(resFolder, dirPath)) {
+            spdlog::error("cannot read directory: {}", dirPath);
+            return EXIT_FAILURE;
+        }
+    }
+    if(!writer.Write(outputPath, compress)) {
+        spdlog::error("cannot write pack: {}", outputPath);
+        return EXIT_FAILURE;
+    }
+    spdlog::info("packed {} files into {}", writer.GetFileCount(), outputPath);
+    return EXIT_SUCCESS;
+}